@@ -6,12 +6,18 @@
  */
 
 // TODO: Fix: The (de)compressors don't work with wchar_t!
+// (xz compression is refused for wchar_t, as it is only implemented for char streams)
 #ifndef __TLIBS_COMP_H__
 #define __TLIBS_COMP_H__
 
 #include <memory>
 #include <type_traits>
 #include <vector>
+#include <deque>
+#include <string>
+#include <future>
+#include <functional>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 
@@ -21,12 +27,21 @@
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/lzma.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/iostreams/copy.hpp>
+#include <boost/crc.hpp>
 
 #include "../string/string.h"
 #include "../log/log.h"
+#include "../helper/thread.h"
+
+
+// block size for the parallel (de)compression
+#define TLIBS_COMP_BLOCK (1 << 20)
 
 
 namespace tl {
@@ -36,7 +51,7 @@ namespace ios = boost::iostreams;
 
 enum class Compressor
 {
-	GZ, BZ2, Z, XZ,
+	GZ, BZ2, Z, XZ, ZSTD,
 	AUTO, INVALID
 };
 
@@ -62,6 +77,12 @@ Compressor comp_from_magic(const t_char* pcMagic, std::size_t iLen)
 		return Compressor::BZ2;
 
 
+	if(iLen<4)
+		return Compressor::INVALID;
+	if(pcMagic[0]==0x28 && pcMagic[1]==0xb5 && pcMagic[2]==0x2f && pcMagic[3]==0xfd)
+		return Compressor::ZSTD;
+
+
 	if(iLen<6)
 		return Compressor::INVALID;
 	if(pcMagic[0]==0xfd && pcMagic[1]=='7' && pcMagic[2]=='z' &&
@@ -80,6 +101,7 @@ Compressor comp_from_ext(const t_str& strExt)
 	else if(strExt == "bz2") return Compressor::BZ2;
 	else if(strExt == "xz") return Compressor::XZ;
 	else if(strExt == "z") return Compressor::Z;
+	else if(strExt == "zst") return Compressor::ZSTD;
 	return Compressor::INVALID;
 }
 
@@ -88,9 +110,21 @@ Compressor comp_from_ext(const t_str& strExt)
 
 
 
+template<class t_char>
+bool _decomp_par(std::basic_istream<t_char>& istr, std::basic_ostream<t_char>& ostr,
+	Compressor comp, unsigned int iThreads);
+template<class t_char>
+bool _comp_par(std::basic_istream<t_char>& istr, std::basic_ostream<t_char>& ostr,
+	Compressor comp, unsigned int iThreads);
+
+
+/**
+ * @param iThreads number of threads, 0: all hardware threads, 1: no block mode
+ */
 template<class t_char=char>
 bool decomp_stream_to_stream(std::basic_istream<t_char>& istr,
-	std::basic_ostream<t_char>& ostr, Compressor comp=Compressor::AUTO)
+	std::basic_ostream<t_char>& ostr, Compressor comp=Compressor::AUTO,
+	unsigned int iThreads=1)
 {
 	typedef typename std::make_unsigned<t_char>::type t_uchar;
 
@@ -103,6 +137,9 @@ bool decomp_stream_to_stream(std::basic_istream<t_char>& istr,
 		comp = comp_from_magic(pcMagic, 6);
 	}
 
+	if(iThreads != 1)
+		return _decomp_par<t_char>(istr, ostr, comp, iThreads);
+
 	using filtering_streambuf = typename std::conditional<
 		std::is_same<t_char, char>::value,
 		ios::filtering_streambuf<ios::input>, ios::filtering_wstreambuf<ios::input>>::type;
@@ -116,10 +153,9 @@ bool decomp_stream_to_stream(std::basic_istream<t_char>& istr,
 	else if(comp == Compressor::Z)
 		bufInput.push(ios::basic_zlib_decompressor<t_alloc>());
 	else if(comp == Compressor::XZ)
-	{
-		log_err("XZ decompression not yet supported.");
-		return false;
-	}
+		bufInput.push(ios::basic_lzma_decompressor<t_alloc>());
+	else if(comp == Compressor::ZSTD)
+		bufInput.push(ios::basic_zstd_decompressor<t_alloc>());
 	else
 	{
 		log_err("Unknown decompression selected.");
@@ -132,13 +168,35 @@ bool decomp_stream_to_stream(std::basic_istream<t_char>& istr,
 	return true;
 }
 
+/**
+ * @param iThreads number of threads, 0: all hardware threads, 1: no block mode
+ * xz compression is only available for char streams
+ */
 template<class t_char=char>
 bool comp_stream_to_stream(std::basic_istream<t_char>& istr,
-	std::basic_ostream<t_char>& ostr, Compressor comp=Compressor::GZ)
+	std::basic_ostream<t_char>& ostr, Compressor comp=Compressor::GZ,
+	unsigned int iThreads=1)
 {
 	if(comp == Compressor::AUTO)
 		comp = Compressor::GZ;
 
+	// boost's lzma_compressor drops data on inputs longer than a few MiB,
+	// so xz is always written as independent streams of one block each,
+	// which is only implemented for char streams
+	if(comp == Compressor::XZ)
+	{
+		if(!std::is_same<t_char, char>::value)
+		{
+			log_err("XZ compression is only supported for char streams.");
+			return false;
+		}
+
+		return _comp_par<t_char>(istr, ostr, comp, iThreads);
+	}
+
+	if(iThreads != 1)
+		return _comp_par<t_char>(istr, ostr, comp, iThreads);
+
 	using filtering_streambuf = typename std::conditional<
 		std::is_same<t_char, char>::value,
 		ios::filtering_streambuf<ios::input>, ios::filtering_wstreambuf<ios::input>>::type;
@@ -151,11 +209,8 @@ bool comp_stream_to_stream(std::basic_istream<t_char>& istr,
 		bufInput.push(ios::basic_bzip2_compressor<t_alloc>());
 	else if(comp == Compressor::Z)
 		bufInput.push(ios::basic_zlib_compressor<t_alloc>(/*ios::zlib_params(9)*/));
-	else if(comp == Compressor::XZ)
-	{
-		log_err("XZ compression not yet supported.");
-		return false;
-	}
+	else if(comp == Compressor::ZSTD)
+		bufInput.push(ios::basic_zstd_compressor<t_alloc>());
 	else
 	{
 		log_err("Unknown compression selected.");
@@ -175,7 +230,8 @@ bool comp_stream_to_stream(std::basic_istream<t_char>& istr,
 
 
 template<class t_char=char>
-inline bool __comp_file_to_file(const char* pcFileIn, const char* pcFileOut, Compressor comp, bool bDecomp=0)
+inline bool __comp_file_to_file(const char* pcFileIn, const char* pcFileOut, Compressor comp,
+	bool bDecomp=0, unsigned int iThreads=1)
 {
 	std::basic_ifstream<t_char> ifstr(pcFileIn, std::ios_base::binary);
 	if(!ifstr.is_open())
@@ -201,28 +257,32 @@ inline bool __comp_file_to_file(const char* pcFileIn, const char* pcFileOut, Com
 		else
 			strExt = get_fileext(std::string(pcFileOut));
 
-		if(strExt == "gz")
-			comp = Compressor::GZ;
-		else if(strExt == "bz2")
-			comp = Compressor::BZ2;
+		Compressor compExt = comp_from_ext(strExt);
+		if(compExt != Compressor::INVALID)
+			comp = compExt;
 	}
 
 	if(bDecomp)
-		return decomp_stream_to_stream<t_char>(ifstr, ofstr, comp);
+		return decomp_stream_to_stream<t_char>(ifstr, ofstr, comp, iThreads);
 	else
-		return comp_stream_to_stream<t_char>(ifstr, ofstr, comp);
+		return comp_stream_to_stream<t_char>(ifstr, ofstr, comp, iThreads);
 }
 
+/**
+ * @param iThreads number of threads, 0: all hardware threads, 1: no block mode
+ */
 template<class t_char=char>
-bool comp_file_to_file(const char* pcFileIn, const char* pcFileOut, Compressor comp=Compressor::AUTO)
+bool comp_file_to_file(const char* pcFileIn, const char* pcFileOut,
+	Compressor comp=Compressor::AUTO, unsigned int iThreads=1)
 {
-	return __comp_file_to_file<t_char>(pcFileIn, pcFileOut, comp, 0);
+	return __comp_file_to_file<t_char>(pcFileIn, pcFileOut, comp, 0, iThreads);
 }
 
 template<class t_char=char>
-bool decomp_file_to_file(const char* pcFileIn, const char* pcFileOut, Compressor comp=Compressor::AUTO)
+bool decomp_file_to_file(const char* pcFileIn, const char* pcFileOut,
+	Compressor comp=Compressor::AUTO, unsigned int iThreads=1)
 {
-	return __comp_file_to_file<t_char>(pcFileIn, pcFileOut, comp, 1);
+	return __comp_file_to_file<t_char>(pcFileIn, pcFileOut, comp, 1, iThreads);
 }
 
 
@@ -263,6 +323,9 @@ template<class T> struct _comp_alloc
 template<class T> using _t_comp_arr = std::vector<T, _comp_alloc<T>>;
 
 
+static inline std::size_t _comp_decomp_len(const void* pvIn, std::size_t iLenIn, Compressor comp);
+
+
 template<class t_char=char>
 inline bool __comp_mem_to_mem(const t_char* pcIn, std::size_t iLenIn,
 	t_char*& pcOut, std::size_t& iLenOut, Compressor comp, bool bDecomp=0)
@@ -270,7 +333,12 @@ inline bool __comp_mem_to_mem(const t_char* pcIn, std::size_t iLenIn,
 	ios::stream<ios::basic_array_source<t_char>> istr(pcIn, iLenIn);
 	_comp_alloc<t_char> alloc;
 	_t_comp_arr<t_char> vecOut(alloc);
-	vecOut.reserve(iLenIn);
+
+	// take the output size from the container if it is stored there
+	std::size_t iLenHint = 0;
+	if(bDecomp)
+		iLenHint = _comp_decomp_len(pcIn, iLenIn*sizeof(t_char), comp) / sizeof(t_char);
+	vecOut.reserve(iLenHint ? iLenHint : iLenIn);
 
 	using filtering_ostream = typename std::conditional<
 		std::is_same<t_char,char>::value,
@@ -422,10 +490,9 @@ create_autodecomp_istream(std::basic_istream<t_char>& istr)
 	else if(comp == Compressor::Z)
 		ptrIstr->push(ios::basic_zlib_decompressor<t_alloc>());
 	else if(comp == Compressor::XZ)
-	{
-		log_err("XZ decompression not yet supported.");
-		return nullptr;
-	}
+		ptrIstr->push(ios::basic_lzma_decompressor<t_alloc>());
+	else if(comp == Compressor::ZSTD)
+		ptrIstr->push(ios::basic_zstd_decompressor<t_alloc>());
 
 	ptrIstr->push(istr);
 	return ptrIstr;
@@ -450,12 +517,918 @@ create_comp_ostream(std::basic_ostream<t_char>& ostr,
 	else if(comp == Compressor::Z)
 		ptrOstr->push(ios::basic_zlib_compressor<t_alloc>());
 	else if(comp == Compressor::XZ)
-		log_err("XZ compression not yet supported.");
+	{
+		log_err("XZ compression is not supported for output streams, use comp_stream_to_stream.");
+		return nullptr;
+	}
+	else if(comp == Compressor::ZSTD)
+		ptrOstr->push(ios::basic_zstd_compressor<t_alloc>());
 
 	ptrOstr->push(ostr);
 	return ptrOstr;
 }
 
 
+//--------------------------------------------------------------------------------
+// parallel block-wise (de)compression of char streams
+//--------------------------------------------------------------------------------
+
+
+using _t_comp_block = std::vector<char>;
+
+
+/**
+ * runs a (de)compression filter over a memory block and appends the result
+ */
+template<class t_filter>
+bool _comp_filter_block(const char* pcIn, std::size_t iLen,
+	_t_comp_block& vecOut, const t_filter& filter)
+{
+	try
+	{
+		ios::filtering_streambuf<ios::input> bufInput;
+		bufInput.push(filter);
+		bufInput.push(ios::array_source(pcIn, iLen));
+		ios::copy(bufInput, ios::back_inserter(vecOut));
+	}
+	catch(const std::exception& ex)
+	{
+		log_err("Block (de)compression failed: ", ex.what(), ".");
+		return false;
+	}
+
+	return true;
+}
+
+
+static inline std::uint32_t _comp_get_le(const void* pv, std::size_t iBytes)
+{
+	const unsigned char* pc = reinterpret_cast<const unsigned char*>(pv);
+
+	std::uint32_t iVal = 0;
+	for(std::size_t i=0; i<iBytes; ++i)
+		iVal |= std::uint32_t(pc[i]) << (8*i);
+	return iVal;
+}
+
+static inline void _comp_put_le32(char* pc, std::uint32_t iVal)
+{
+	for(std::size_t i=0; i<4; ++i)
+		pc[i] = char((iVal >> (8*i)) & 0xff);
+}
+
+/**
+ * appends iLen bytes from the stream to the block
+ */
+static inline bool _comp_read_append(std::istream& istr, _t_comp_block& vec, std::size_t iLen)
+{
+	const std::size_t iOldLen = vec.size();
+	vec.resize(iOldLen + iLen);
+	istr.read(vec.data() + iOldLen, std::streamsize(iLen));
+	return std::size_t(istr.gcount()) == iLen;
+}
+
+
+/**
+ * ordered pipeline:
+ * fktNext(job) fetches the next job and returns false at the end,
+ * fktProc(job, vecOut) runs concurrently on up to iThreads jobs,
+ * the results are written in input order
+ */
+template<class t_job, class t_next, class t_proc>
+bool _comp_pipeline(t_next&& fktNext, t_proc&& fktProc,
+	std::ostream& ostr, unsigned int iThreads)
+{
+	using t_res = std::pair<bool, _t_comp_block>;
+	std::deque<std::future<t_res>> queue;
+	bool bOk = 1;
+
+	auto write_front = [&queue, &ostr, &bOk]() -> void
+	{
+		t_res res = queue.front().get();
+		queue.pop_front();
+
+		if(!res.first)
+			bOk = 0;
+		if(bOk)
+			ostr.write(res.second.data(), std::streamsize(res.second.size()));
+	};
+
+	while(bOk)
+	{
+		t_job job;
+		if(!fktNext(job))
+			break;
+
+		queue.emplace_back(std::async(std::launch::async,
+			[&fktProc](const t_job& job) -> t_res
+			{
+				t_res res;
+				res.first = fktProc(job, res.second);
+				return res;
+			}, std::move(job)));
+
+		while(queue.size() >= iThreads)
+			write_front();
+	}
+
+	while(queue.size())
+		write_front();
+
+	return bOk && bool(ostr);
+}
+
+
+// -----------------------------------------------------------------------------
+// gzip
+
+
+/**
+ * compresses a block into an independent gzip member,
+ * the total member length is stored in an extra "TL" subfield
+ */
+static inline bool _comp_gz_member(const _t_comp_block& vecIn, _t_comp_block& vecOut)
+{
+	static const unsigned char pcHdr[] =
+	{
+		0x1f, 0x8b, 8 /*deflate*/, 4 /*FEXTRA*/,
+		0, 0, 0, 0 /*mtime*/, 0 /*xfl*/, 255 /*os*/,
+		8, 0 /*xlen*/, 'T', 'L', 4, 0 /*slen*/,
+		0, 0, 0, 0 /*member length*/
+	};
+
+	vecOut.assign(pcHdr, pcHdr + sizeof(pcHdr));
+
+	ios::zlib_params params;
+	params.noheader = true;
+	if(!_comp_filter_block(vecIn.data(), vecIn.size(), vecOut, ios::zlib_compressor(params)))
+		return false;
+
+	boost::crc_32_type crc;
+	crc.process_bytes(vecIn.data(), vecIn.size());
+
+	vecOut.resize(vecOut.size() + 8);
+	_comp_put_le32(vecOut.data() + vecOut.size() - 8, std::uint32_t(crc.checksum()));
+	_comp_put_le32(vecOut.data() + vecOut.size() - 4, std::uint32_t(vecIn.size()));
+	_comp_put_le32(vecOut.data() + sizeof(pcHdr) - 4, std::uint32_t(vecOut.size()));
+
+	return true;
+}
+
+
+/**
+ * gets the member length from the gzip extra field,
+ * either from our "TL" or from a BGZF "BC" subfield
+ * @return 0 if the member is not indexed
+ */
+static inline std::size_t _comp_gz_member_len(const char* pcExtra, std::size_t iXLen)
+{
+	for(std::size_t iPos=0; iPos+4 <= iXLen;)
+	{
+		const char c1 = pcExtra[iPos], c2 = pcExtra[iPos+1];
+		const std::size_t iSubLen = _comp_get_le(pcExtra+iPos+2, 2);
+		iPos += 4;
+		if(iPos + iSubLen > iXLen)
+			break;
+
+		if(c1=='T' && c2=='L' && iSubLen==4)
+			return _comp_get_le(pcExtra+iPos, 4);
+		else if(c1=='B' && c2=='C' && iSubLen==2)
+			return _comp_get_le(pcExtra+iPos, 2) + 1;
+
+		iPos += iSubLen;
+	}
+
+	return 0;
+}
+
+
+/**
+ * decompresses a complete gzip member
+ */
+static inline bool _decomp_gz_member(const _t_comp_block& vecIn, _t_comp_block& vecOut)
+{
+	const unsigned char* pc = reinterpret_cast<const unsigned char*>(vecIn.data());
+	const std::size_t iLen = vecIn.size();
+
+	if(iLen < 18 || pc[0] != 0x1f || pc[1] != 0x8b || pc[2] != 8)
+	{
+		log_err("Invalid gzip member.");
+		return false;
+	}
+
+	// skip optional header fields
+	const unsigned char cFlags = pc[3];
+	std::size_t iPos = 10;
+	if(cFlags & 4)
+		iPos += 2 + _comp_get_le(pc+10, 2);
+	for(unsigned char cStrFlag : { 8, 16 })	// name, comment
+	{
+		if(!(cFlags & cStrFlag)) continue;
+		while(iPos < iLen && pc[iPos]) ++iPos;
+		++iPos;
+	}
+	if(cFlags & 2)
+		iPos += 2;
+
+	if(iPos + 8 > iLen)
+	{
+		log_err("Invalid gzip member.");
+		return false;
+	}
+
+	ios::zlib_params params;
+	params.noheader = true;
+	if(!_comp_filter_block(vecIn.data()+iPos, iLen-iPos-8, vecOut, ios::zlib_decompressor(params)))
+		return false;
+
+	boost::crc_32_type crc;
+	crc.process_bytes(vecOut.data(), vecOut.size());
+	if(std::uint32_t(crc.checksum()) != _comp_get_le(pc+iLen-8, 4)
+		|| std::uint32_t(vecOut.size()) != _comp_get_le(pc+iLen-4, 4))
+	{
+		log_err("Checksum mismatch in gzip member.");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * indexed members are decompressed in parallel,
+ * the rest of the stream is decompressed serially once a member without index is found
+ */
+static inline bool _decomp_par_gz(std::istream& istr, std::ostream& ostr, unsigned int iThreads)
+{
+	std::streampos posMember = istr.tellg();
+	bool bSerial = 0, bErr = 0;
+
+	auto fktNext = [&istr, &posMember, &bSerial, &bErr](_t_comp_block& vecMember) -> bool
+	{
+		posMember = istr.tellg();
+
+		vecMember.clear();
+		if(!_comp_read_append(istr, vecMember, 12))
+		{
+			// let the serial decompressor deal with trailing data
+			if(istr.gcount())
+				bSerial = 1;
+			return false;
+		}
+
+		std::size_t iMemberLen = 0;
+		if(vecMember[0]==char(0x1f) && vecMember[1]==char(0x8b) && (vecMember[3] & 4))
+		{
+			const std::size_t iXLen = _comp_get_le(vecMember.data()+10, 2);
+			if(_comp_read_append(istr, vecMember, iXLen))
+				iMemberLen = _comp_gz_member_len(vecMember.data()+12, iXLen);
+		}
+
+		if(iMemberLen == 0)
+		{
+			bSerial = 1;
+			return false;
+		}
+
+		if(iMemberLen < vecMember.size() + 8
+			|| !_comp_read_append(istr, vecMember, iMemberLen - vecMember.size()))
+		{
+			log_err("Truncated gzip member.");
+			bErr = 1;
+			return false;
+		}
+
+		return true;
+	};
+
+	if(!_comp_pipeline<_t_comp_block>(fktNext, _decomp_gz_member, ostr, iThreads) || bErr)
+		return false;
+
+	if(bSerial)
+	{
+		istr.clear();
+		if(posMember < 0 || !istr.seekg(posMember, std::ios::beg))
+		{
+			log_err("Cannot rewind the input stream to decompress unindexed gzip members.");
+			return false;
+		}
+		return decomp_stream_to_stream<char>(istr, ostr, Compressor::GZ, 1);
+	}
+
+	return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// xz
+
+
+static inline bool _comp_xz_varint(const unsigned char* pc, std::size_t iLen,
+	std::size_t& iPos, std::uint64_t& iVal)
+{
+	iVal = 0;
+	for(std::size_t iShift=0; iPos<iLen && iShift<63; iShift+=7)
+	{
+		const unsigned char c = pc[iPos++];
+		iVal |= std::uint64_t(c & 0x7f) << iShift;
+		if(!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+
+/**
+ * finds the streams in a (multi-stream) xz file by walking the stream footers
+ * and indices backwards from the end of the (seekable) input
+ * @param piUncompLen optionally returns the total uncompressed length from the indices
+ */
+static inline bool _comp_xz_streams(std::istream& istr,
+	std::vector<std::pair<std::streamoff, std::streamoff>>& vecStreams,
+	std::uint64_t *piUncompLen = nullptr)
+{
+	if(piUncompLen)
+		*piUncompLen = 0;
+
+	const std::streamoff iBegin = istr.tellg();
+	istr.seekg(0, std::ios::end);
+	std::streamoff iEnd = istr.tellg();
+	if(iBegin < 0 || iEnd < 0)
+		return false;
+
+	while(iEnd > iBegin)
+	{
+		unsigned char pcFooter[12];
+		if(iEnd - iBegin < 24 || !istr.seekg(iEnd-12, std::ios::beg)
+			|| !istr.read(reinterpret_cast<char*>(pcFooter), 12))
+			return false;
+
+		// stream padding
+		if(_comp_get_le(pcFooter+8, 4) == 0)
+		{
+			iEnd -= 4;
+			continue;
+		}
+
+		if(pcFooter[10] != 'Y' || pcFooter[11] != 'Z')
+			return false;
+
+		const std::streamoff iIdxLen = (std::streamoff(_comp_get_le(pcFooter+4, 4)) + 1) * 4;
+		if(iEnd - iBegin < 24 + iIdxLen)
+			return false;
+
+		std::vector<unsigned char> vecIdx(iIdxLen);
+		if(!istr.seekg(iEnd-12-iIdxLen, std::ios::beg)
+			|| !istr.read(reinterpret_cast<char*>(vecIdx.data()), iIdxLen))
+			return false;
+
+		// sum of the padded block lengths
+		std::size_t iPos = 1;
+		std::uint64_t iNumRecs = 0, iBlocksLen = 0;
+		if(vecIdx[0] != 0 || !_comp_xz_varint(vecIdx.data(), vecIdx.size(), iPos, iNumRecs))
+			return false;
+		for(std::uint64_t iRec=0; iRec<iNumRecs; ++iRec)
+		{
+			std::uint64_t iUnpadded = 0, iUncomp = 0;
+			if(!_comp_xz_varint(vecIdx.data(), vecIdx.size(), iPos, iUnpadded)
+				|| !_comp_xz_varint(vecIdx.data(), vecIdx.size(), iPos, iUncomp))
+				return false;
+			iBlocksLen += (iUnpadded + 3) & ~std::uint64_t(3);
+			if(piUncompLen)
+				*piUncompLen += iUncomp;
+		}
+
+		const std::streamoff iStreamLen = 12 + std::streamoff(iBlocksLen) + iIdxLen + 12;
+		if(iEnd - iBegin < iStreamLen)
+			return false;
+
+		vecStreams.insert(vecStreams.begin(), std::make_pair(iEnd-iStreamLen, iStreamLen));
+		iEnd -= iStreamLen;
+	}
+
+	return true;
+}
+
+
+/**
+ * the streams of a multi-stream xz file are decompressed in parallel,
+ * otherwise the input is decompressed serially
+ */
+static inline bool _decomp_par_xz(std::istream& istr, std::ostream& ostr, unsigned int iThreads)
+{
+	const std::streampos posBegin = istr.tellg();
+
+	std::vector<std::pair<std::streamoff, std::streamoff>> vecStreams;
+	bool bIndexed = _comp_xz_streams(istr, vecStreams) && vecStreams.size() > 1;
+
+	istr.clear();
+	istr.seekg(posBegin, std::ios::beg);
+	if(!bIndexed)
+		return decomp_stream_to_stream<char>(istr, ostr, Compressor::XZ, 1);
+
+	std::size_t iStream = 0;
+	bool bErr = 0;
+	auto fktNext = [&istr, &vecStreams, &iStream, &bErr](_t_comp_block& vecStream) -> bool
+	{
+		if(iStream >= vecStreams.size())
+			return false;
+
+		const auto& stream = vecStreams[iStream++];
+		if(!istr.seekg(stream.first, std::ios::beg)
+			|| !_comp_read_append(istr, vecStream, std::size_t(stream.second)))
+		{
+			log_err("Cannot read xz stream.");
+			bErr = 1;
+			return false;
+		}
+		return true;
+	};
+
+	auto fktProc = [](const _t_comp_block& vecIn, _t_comp_block& vecOut) -> bool
+	{
+		return _comp_filter_block(vecIn.data(), vecIn.size(), vecOut, ios::lzma_decompressor());
+	};
+
+	return _comp_pipeline<_t_comp_block>(fktNext, fktProc, ostr, iThreads) && !bErr;
+}
+
+
+// -----------------------------------------------------------------------------
+// zstd
+
+
+/**
+ * length of the zstd frame header following the descriptor byte
+ * @param piSizeLen optionally returns the length of the content size field
+ */
+static inline std::size_t _comp_zstd_hdr_len(unsigned char cDescr, std::size_t *piSizeLen = nullptr)
+{
+	const unsigned int iSizeFlag = cDescr >> 6;
+	const bool bSingleSeg = (cDescr >> 5) & 1;
+	const std::size_t iDictLens[] = { 0, 1, 2, 4 };
+
+	const std::size_t iSizeLen = (iSizeFlag==0 ? (bSingleSeg ? 1 : 0) : (std::size_t(1) << iSizeFlag));
+	if(piSizeLen)
+		*piSizeLen = iSizeLen;
+
+	return (bSingleSeg ? 0 : 1) + iDictLens[cDescr & 3] + iSizeLen;
+}
+
+
+/**
+ * reads the next zstd frame by walking its block headers, skippable frames are ignored
+ * @return 1: frame read, 0: end of input, -1: error
+ */
+static inline int _comp_zstd_frame(std::istream& istr, _t_comp_block& vecFrame)
+{
+	while(1)
+	{
+		vecFrame.clear();
+		if(!_comp_read_append(istr, vecFrame, 4))
+			return istr.gcount() ? -1 : 0;
+
+		const std::uint32_t iMagic = _comp_get_le(vecFrame.data(), 4);
+		if((iMagic & 0xfffffff0) == 0x184d2a50)
+		{
+			if(!_comp_read_append(istr, vecFrame, 4))
+				return -1;
+			const std::uint32_t iSkip = _comp_get_le(vecFrame.data()+4, 4);
+			if(!istr.ignore(iSkip) || std::uint32_t(istr.gcount()) != iSkip)
+				return -1;
+			continue;
+		}
+		else if(iMagic != 0xfd2fb528)
+		{
+			return -1;
+		}
+
+		// frame header
+		if(!_comp_read_append(istr, vecFrame, 1))
+			return -1;
+		const unsigned char cDescr = static_cast<unsigned char>(vecFrame[4]);
+		const bool bChecksum = (cDescr >> 2) & 1;
+		if(!_comp_read_append(istr, vecFrame, _comp_zstd_hdr_len(cDescr)))
+			return -1;
+
+		// blocks
+		bool bLast = 0;
+		while(!bLast)
+		{
+			if(!_comp_read_append(istr, vecFrame, 3))
+				return -1;
+			const std::uint32_t iBlockHdr = _comp_get_le(vecFrame.data()+vecFrame.size()-3, 3);
+			bLast = iBlockHdr & 1;
+			const unsigned int iType = (iBlockHdr >> 1) & 3;
+			if(iType == 3)
+				return -1;
+
+			const std::size_t iBlockLen = (iType == 1 ? 1 : (iBlockHdr >> 3));
+			if(!_comp_read_append(istr, vecFrame, iBlockLen))
+				return -1;
+		}
+
+		if(bChecksum && !_comp_read_append(istr, vecFrame, 4))
+			return -1;
+
+		return 1;
+	}
+}
+
+
+/**
+ * all zstd frames are decompressed in parallel
+ */
+static inline bool _decomp_par_zstd(std::istream& istr, std::ostream& ostr, unsigned int iThreads)
+{
+	bool bErr = 0;
+	auto fktNext = [&istr, &bErr](_t_comp_block& vecFrame) -> bool
+	{
+		int iRet = _comp_zstd_frame(istr, vecFrame);
+		if(iRet < 0)
+		{
+			log_err("Invalid zstd frame.");
+			bErr = 1;
+		}
+		return iRet > 0;
+	};
+
+	auto fktProc = [](const _t_comp_block& vecIn, _t_comp_block& vecOut) -> bool
+	{
+		return _comp_filter_block(vecIn.data(), vecIn.size(), vecOut, ios::zstd_decompressor());
+	};
+
+	return _comp_pipeline<_t_comp_block>(fktNext, fktProc, ostr, iThreads) && !bErr;
+}
+
+
+// -----------------------------------------------------------------------------
+
+
+/**
+ * compresses independent blocks of TLIBS_COMP_BLOCK bytes in parallel
+ * and concatenates the resulting gzip members, bzip2/xz streams or zstd frames
+ */
+static inline bool _comp_par_impl(std::istream& istr, std::ostream& ostr,
+	Compressor comp, unsigned int iThreads)
+{
+	// zlib streams cannot be concatenated
+	if(comp == Compressor::Z)
+		return comp_stream_to_stream<char>(istr, ostr, comp, 1);
+
+	std::function<bool(const _t_comp_block&, _t_comp_block&)> fktProc;
+	if(comp == Compressor::GZ)
+		fktProc = _comp_gz_member;
+	else if(comp == Compressor::BZ2)
+		fktProc = [](const _t_comp_block& vecIn, _t_comp_block& vecOut) -> bool
+		{ return _comp_filter_block(vecIn.data(), vecIn.size(), vecOut, ios::bzip2_compressor()); };
+	else if(comp == Compressor::XZ)
+		fktProc = [](const _t_comp_block& vecIn, _t_comp_block& vecOut) -> bool
+		{ return _comp_filter_block(vecIn.data(), vecIn.size(), vecOut, ios::lzma_compressor()); };
+	else if(comp == Compressor::ZSTD)
+		fktProc = [](const _t_comp_block& vecIn, _t_comp_block& vecOut) -> bool
+		{ return _comp_filter_block(vecIn.data(), vecIn.size(), vecOut, ios::zstd_compressor()); };
+	else
+	{
+		log_err("Unknown compression selected.");
+		return false;
+	}
+
+	bool bFirst = 1;
+	auto fktNext = [&istr, &bFirst](_t_comp_block& vecBlock) -> bool
+	{
+		vecBlock.resize(TLIBS_COMP_BLOCK);
+		istr.read(vecBlock.data(), std::streamsize(vecBlock.size()));
+		vecBlock.resize(std::size_t(istr.gcount()));
+
+		// an empty input still gives a valid (empty) compressed stream
+		const bool bNext = bFirst || vecBlock.size();
+		bFirst = 0;
+		return bNext;
+	};
+
+	return _comp_pipeline<_t_comp_block>(fktNext, fktProc, ostr,
+		get_num_threads(std::size_t(-1), iThreads));
+}
+
+static inline bool _decomp_par_impl(std::istream& istr, std::ostream& ostr,
+	Compressor comp, unsigned int iThreads)
+{
+	iThreads = get_num_threads(std::size_t(-1), iThreads);
+
+	if(comp == Compressor::GZ)
+		return _decomp_par_gz(istr, ostr, iThreads);
+	else if(comp == Compressor::XZ)
+		return _decomp_par_xz(istr, ostr, iThreads);
+	else if(comp == Compressor::ZSTD)
+		return _decomp_par_zstd(istr, ostr, iThreads);
+
+	// bzip2 stream boundaries are not byte-aligned and zlib has only one stream
+	return decomp_stream_to_stream<char>(istr, ostr, comp, 1);
+}
+
+
+
+//--------------------------------------------------------------------------------
+// decompressed length from container trailers and indices
+//--------------------------------------------------------------------------------
+
+
+/**
+ * sums the uncompressed lengths stored in the trailers of the gzip members;
+ * the members are walked using their index, for unindexed members
+ * only the last trailer can be used (which is exact for single-member files)
+ */
+static inline std::uint64_t _comp_gz_content_len(const unsigned char* pc, std::size_t iLen)
+{
+	std::uint64_t iContentLen = 0;
+	std::size_t iPos = 0;
+
+	while(iPos + 12 <= iLen && pc[iPos]==0x1f && pc[iPos+1]==0x8b && (pc[iPos+3] & 4))
+	{
+		const std::size_t iXLen = _comp_get_le(pc+iPos+10, 2);
+		if(iPos + 12 + iXLen > iLen)
+			break;
+
+		const std::size_t iMemberLen = _comp_gz_member_len(
+			reinterpret_cast<const char*>(pc+iPos+12), iXLen);
+		if(iMemberLen < 12 + iXLen + 8 || iPos + iMemberLen > iLen)
+			break;
+
+		iContentLen += _comp_get_le(pc+iPos+iMemberLen-4, 4);
+		iPos += iMemberLen;
+	}
+
+	if(iPos + 18 <= iLen)
+		iContentLen += _comp_get_le(pc+iLen-4, 4);
+
+	return iContentLen;
+}
+
+
+/**
+ * sums the content sizes stored in the zstd frame headers
+ * @return 0 if a frame does not store its content size
+ */
+static inline std::uint64_t _comp_zstd_content_len(const unsigned char* pc, std::size_t iLen)
+{
+	std::uint64_t iContentLen = 0;
+	std::size_t iPos = 0;
+
+	while(iPos + 8 <= iLen)
+	{
+		const std::uint32_t iMagic = _comp_get_le(pc+iPos, 4);
+		if((iMagic & 0xfffffff0) == 0x184d2a50)
+		{
+			iPos += 8 + _comp_get_le(pc+iPos+4, 4);
+			continue;
+		}
+		else if(iMagic != 0xfd2fb528)
+		{
+			return 0;
+		}
+
+		const unsigned char cDescr = pc[iPos+4];
+		std::size_t iSizeLen = 0;
+		const std::size_t iHdrLen = _comp_zstd_hdr_len(cDescr, &iSizeLen);
+		iPos += 5 + iHdrLen;
+		if(iSizeLen == 0 || iPos > iLen)
+			return 0;
+
+		const unsigned char* pcSize = pc + iPos - iSizeLen;
+		std::uint64_t iSize = _comp_get_le(pcSize, std::min<std::size_t>(iSizeLen, 4));
+		if(iSizeLen == 8)
+			iSize |= std::uint64_t(_comp_get_le(pcSize+4, 4)) << 32;
+		else if(iSizeLen == 2)
+			iSize += 256;
+		iContentLen += iSize;
+
+		// skip the blocks
+		bool bLast = 0;
+		while(!bLast)
+		{
+			if(iPos + 3 > iLen)
+				return 0;
+			const std::uint32_t iBlockHdr = _comp_get_le(pc+iPos, 3);
+			const unsigned int iType = (iBlockHdr >> 1) & 3;
+			if(iType == 3)
+				return 0;
+			bLast = iBlockHdr & 1;
+			iPos += 3 + (iType == 1 ? 1 : (iBlockHdr >> 3));
+		}
+
+		if(cDescr & 4)
+			iPos += 4;
+	}
+
+	return iContentLen;
+}
+
+
+/**
+ * gets the decompressed length from the gzip trailers, the xz indices
+ * or the zstd frame headers
+ * @return 0 if the format does not store it
+ */
+static inline std::size_t _comp_decomp_len(const void* pvIn, std::size_t iLenIn, Compressor comp)
+{
+	const unsigned char* pc = reinterpret_cast<const unsigned char*>(pvIn);
+	if(comp == Compressor::AUTO)
+		comp = comp_from_magic(pc, std::min<std::size_t>(iLenIn, 6));
+
+	std::uint64_t iLen = 0;
+	if(comp == Compressor::GZ)
+	{
+		iLen = _comp_gz_content_len(pc, iLenIn);
+	}
+	else if(comp == Compressor::XZ)
+	{
+		ios::stream<ios::array_source> istr(reinterpret_cast<const char*>(pvIn), iLenIn);
+		std::vector<std::pair<std::streamoff, std::streamoff>> vecStreams;
+		if(!_comp_xz_streams(istr, vecStreams, &iLen))
+			iLen = 0;
+	}
+	else if(comp == Compressor::ZSTD)
+	{
+		iLen = _comp_zstd_content_len(pc, iLenIn);
+	}
+
+	// don't trust corrupted lengths beyond the maximum compression ratios
+	if(iLen > std::uint64_t(iLenIn) * 8192)
+		iLen = 0;
+	return std::size_t(iLen);
+}
+
+
+//--------------------------------------------------------------------------------
+
+
+/**
+ * read-only memory-mapped file:
+ * uncompressed files are accessed directly in the mapped pages,
+ * compressed ones are decompressed into one buffer which is
+ * preallocated from the length stored in the container, if available
+ */
+class CompMappedFile
+{
+	protected:
+		ios::mapped_file_source m_file;
+		std::vector<char> m_vecDecomp;
+		Compressor m_comp = Compressor::INVALID;
+
+		const char *m_pcData = nullptr;
+		std::size_t m_iLen = 0;
+		bool m_bOk = 0;
+
+	public:
+		CompMappedFile() = default;
+		CompMappedFile(const std::string& strFile, unsigned int iThreads=1)
+		{ Open(strFile, iThreads); }
+		~CompMappedFile() { Close(); }
+
+		CompMappedFile(const CompMappedFile&) = delete;
+		CompMappedFile& operator=(const CompMappedFile&) = delete;
+
+		/**
+		 * @param iThreads threads for the block-wise decompression, see decomp_stream_to_stream
+		 */
+		bool Open(const std::string& strFile, unsigned int iThreads=1)
+		{
+			Close();
+
+			// empty files cannot be mapped
+			{
+				std::ifstream ifstr(strFile, std::ios::binary | std::ios::ate);
+				if(!ifstr)
+				{
+					log_err("Cannot open file \"", strFile, "\".");
+					return false;
+				}
+				if(ifstr.tellg() == 0)
+				{
+					m_bOk = 1;
+					return m_bOk;
+				}
+			}
+
+			try
+			{
+				m_file.open(strFile);
+			}
+			catch(const std::exception& ex)
+			{
+				log_err("Cannot map file \"", strFile, "\": ", ex.what(), ".");
+				return false;
+			}
+
+			const char* pcFile = m_file.data();
+			const std::size_t iFileLen = m_file.size();
+			m_comp = comp_from_magic(reinterpret_cast<const unsigned char*>(pcFile),
+				std::min<std::size_t>(iFileLen, 6));
+
+			if(m_comp == Compressor::INVALID)
+			{
+				m_pcData = pcFile;
+				m_iLen = iFileLen;
+				m_bOk = 1;
+				return m_bOk;
+			}
+
+			const std::size_t iLenHint = _comp_decomp_len(pcFile, iFileLen, m_comp);
+			m_vecDecomp.reserve(iLenHint ? iLenHint : iFileLen*4);
+
+			try
+			{
+				ios::stream<ios::array_source> istr(pcFile, iFileLen);
+				ios::stream<ios::back_insert_device<std::vector<char>>> ostr(m_vecDecomp);
+				m_bOk = decomp_stream_to_stream<char>(istr, ostr, m_comp, iThreads);
+				ostr.flush();
+			}
+			catch(const std::exception& ex)
+			{
+				log_err("Cannot decompress file \"", strFile, "\": ", ex.what(), ".");
+				m_bOk = 0;
+			}
+
+			// the compressed data is not needed anymore
+			m_file.close();
+
+			m_pcData = m_vecDecomp.data();
+			m_iLen = m_vecDecomp.size();
+			return m_bOk;
+		}
+
+		void Close()
+		{
+			if(m_file.is_open())
+				m_file.close();
+			m_vecDecomp.clear();
+			m_vecDecomp.shrink_to_fit();
+
+			m_comp = Compressor::INVALID;
+			m_pcData = nullptr;
+			m_iLen = 0;
+			m_bOk = 0;
+		}
+
+		bool IsOk() const { return m_bOk; }
+		operator bool() const { return IsOk(); }
+
+		/**
+		 * Compressor::INVALID for uncompressed (directly mapped) files
+		 */
+		Compressor GetCompressor() const { return m_comp; }
+		bool IsMapped() const { return m_bOk && m_comp == Compressor::INVALID; }
+
+		// contiguous view of the (decompressed) file contents
+		const char* data() const { return m_pcData; }
+		std::size_t size() const { return m_iLen; }
+		const char* begin() const { return m_pcData; }
+		const char* end() const { return m_pcData + m_iLen; }
+
+		std::string str() const { return std::string(m_pcData, m_iLen); }
+
+		/**
+		 * istream reading directly from the view (valid while the file is open)
+		 */
+		std::shared_ptr<std::istream> GetIstream() const
+		{
+			return std::make_shared<ios::stream<ios::array_source>>(
+				m_pcData ? m_pcData : "", m_iLen);
+		}
+};
+
+
+// block mode is only available for char streams
+template<class t_char>
+bool _comp_par_impl(std::basic_istream<t_char>& istr, std::basic_ostream<t_char>& ostr,
+	Compressor comp, unsigned int)
+{
+	return comp_stream_to_stream<t_char>(istr, ostr, comp, 1);
+}
+
+template<class t_char>
+bool _decomp_par_impl(std::basic_istream<t_char>& istr, std::basic_ostream<t_char>& ostr,
+	Compressor comp, unsigned int)
+{
+	return decomp_stream_to_stream<t_char>(istr, ostr, comp, 1);
+}
+
+
+template<class t_char>
+bool _comp_par(std::basic_istream<t_char>& istr, std::basic_ostream<t_char>& ostr,
+	Compressor comp, unsigned int iThreads)
+{
+	return _comp_par_impl(istr, ostr, comp, iThreads);
+}
+
+template<class t_char>
+bool _decomp_par(std::basic_istream<t_char>& istr, std::basic_ostream<t_char>& ostr,
+	Compressor comp, unsigned int iThreads)
+{
+	return _decomp_par_impl(istr, ostr, comp, iThreads);
+}
+
+
 }
 #endif
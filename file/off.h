@@ -14,9 +14,15 @@
 #include <list>
 #include <unordered_set>
 #include <string>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
 
 #include "../math/linalg.h"
 #include "../string/string.h"
+#include "../log/log.h"
+#include "comp.h"
 
 
 namespace tl{
@@ -282,6 +288,243 @@ public:
 	}
 };
 
+
+// -----------------------------------------------------------------------------
+
+
+/**
+ * writes an off file while the mesh is being produced.
+ * as the header holds the numbers of vertices and polygons, they have to be known beforehand.
+ * the binary variant is geomview's "OFF BINARY" with big-endian 32 bit values.
+ */
+template<class t_real = double>
+class Off3dStreamWriter
+{
+public:
+	using t_vec = ublas::vector<t_real>;
+
+protected:
+	std::ofstream m_ofstr;
+	std::shared_ptr<std::ostream> m_pCompOstr;
+	std::ostream *m_pOstr = nullptr;
+
+	// output is collected here and passed on in large chunks
+	std::string m_strBuf;
+	static constexpr const std::size_t m_iBufLen = 1 << 20;
+	int m_iPrec = 6;
+
+	bool m_bBinary = 0;
+	std::size_t m_iNumVerts = 0, m_iNumPolys = 0;
+	std::size_t m_iCurVert = 0, m_iCurPoly = 0;
+
+protected:
+	void PutReal(t_real d)
+	{
+		if(m_bBinary)
+		{
+			float f = float(d);
+			std::uint32_t iVal = 0;
+			std::memcpy(&iVal, &f, sizeof(f));
+			PutInt(iVal);
+		}
+		else
+		{
+			char pcNum[64];
+			int iLen = std::snprintf(pcNum, sizeof(pcNum), "%.*g", m_iPrec, double(d));
+			m_strBuf.append(pcNum, std::size_t(iLen));
+		}
+	}
+
+	void PutInt(std::uint32_t iVal)
+	{
+		if(m_bBinary)
+		{
+			for(int i=3; i>=0; --i)
+				m_strBuf.push_back(char((iVal >> (8*i)) & 0xff));
+		}
+		else
+		{
+			char pcNum[32];
+			int iLen = std::snprintf(pcNum, sizeof(pcNum), "%u", unsigned(iVal));
+			m_strBuf.append(pcNum, std::size_t(iLen));
+		}
+	}
+
+	void PutSep(char c)
+	{
+		if(!m_bBinary)
+			m_strBuf.push_back(c);
+	}
+
+	void FlushBuf(bool bForce = 0)
+	{
+		if(!m_pOstr || (!bForce && m_strBuf.size() < m_iBufLen))
+			return;
+
+		m_pOstr->write(m_strBuf.data(), m_strBuf.size());
+		m_strBuf.clear();
+	}
+
+public:
+	Off3dStreamWriter() = default;
+	~Off3dStreamWriter() { Close(); }
+
+	Off3dStreamWriter(const Off3dStreamWriter&) = delete;
+	Off3dStreamWriter& operator=(const Off3dStreamWriter&) = delete;
+
+	void SetPrecision(int iPrec) { m_iPrec = iPrec; }
+	bool IsOpen() const { return m_pOstr != nullptr; }
+
+	/**
+	 * writes the header to a stream, optionally compressed
+	 */
+	bool Open(std::ostream& ostr, std::size_t iNumVerts, std::size_t iNumPolys,
+		bool bBinary = 0, Compressor comp = Compressor::INVALID,
+		const std::string& strComment = "")
+	{
+		Close();
+
+		if(comp != Compressor::INVALID)
+		{
+			m_pCompOstr = create_comp_ostream<char>(ostr, comp);
+			if(!m_pCompOstr)
+				return false;
+			m_pOstr = m_pCompOstr.get();
+		}
+		else
+		{
+			m_pOstr = &ostr;
+		}
+
+		m_bBinary = bBinary;
+		m_iNumVerts = iNumVerts;
+		m_iNumPolys = iNumPolys;
+		m_iCurVert = m_iCurPoly = 0;
+		m_strBuf.reserve(m_iBufLen + 4096);
+
+		if(m_bBinary)
+		{
+			m_strBuf.append("OFF BINARY\n");
+		}
+		else
+		{
+			m_strBuf.append("OFF\n\n");
+			if(strComment != "")
+				m_strBuf.append("# " + strComment + "\n\n");
+		}
+
+		PutInt(std::uint32_t(iNumVerts)); PutSep(' ');
+		PutInt(std::uint32_t(iNumPolys)); PutSep(' ');
+		PutInt(0); PutSep('\n');
+		return true;
+	}
+
+	bool Open(const char* pcFile, std::size_t iNumVerts, std::size_t iNumPolys,
+		bool bBinary = 0, Compressor comp = Compressor::INVALID,
+		const std::string& strComment = "")
+	{
+		Close();
+
+		m_ofstr.open(pcFile, std::ios_base::binary);
+		if(!m_ofstr)
+		{
+			log_err("Cannot open \"", pcFile, "\" for writing.");
+			return false;
+		}
+
+		return Open(m_ofstr, iNumVerts, iNumPolys, bBinary, comp, strComment);
+	}
+
+	/**
+	 * flushes all output and checks that the announced numbers of elements were written
+	 */
+	bool Close()
+	{
+		if(!m_pOstr)
+			return false;
+
+		FlushBuf(1);
+		bool bOk = !m_pOstr->fail();
+
+		if(m_iCurVert != m_iNumVerts || m_iCurPoly != m_iNumPolys)
+		{
+			log_err("OFF file has ", m_iCurVert, " of ", m_iNumVerts, " vertices and ",
+				m_iCurPoly, " of ", m_iNumPolys, " polygons.");
+			bOk = false;
+		}
+
+		m_pCompOstr.reset();
+		m_pOstr = nullptr;
+		if(m_ofstr.is_open())
+			m_ofstr.close();
+
+		return bOk;
+	}
+
+	bool AddVertex(t_real dX, t_real dY, t_real dZ)
+	{
+		if(m_iCurVert >= m_iNumVerts)
+		{
+			log_err("Too many vertices for OFF file.");
+			return false;
+		}
+
+		PutReal(dX); PutSep(' ');
+		PutReal(dY); PutSep(' ');
+		PutReal(dZ); PutSep('\n');
+		++m_iCurVert;
+
+		FlushBuf();
+		return true;
+	}
+
+	bool AddVertex(const t_vec& vec)
+	{
+		return AddVertex(vec.size() > 0 ? vec[0] : t_real(0),
+			vec.size() > 1 ? vec[1] : t_real(0),
+			vec.size() > 2 ? vec[2] : t_real(0));
+	}
+
+	/**
+	 * adds a polygon, all vertices have to be written before
+	 */
+	template<class t_cont = std::vector<std::size_t>>
+	bool AddPoly(const t_cont& contIdx)
+	{
+		if(m_iCurVert != m_iNumVerts)
+		{
+			log_err("All vertices have to be written before the OFF polygons.");
+			return false;
+		}
+		if(m_iCurPoly >= m_iNumPolys)
+		{
+			log_err("Too many polygons for OFF file.");
+			return false;
+		}
+
+		PutInt(std::uint32_t(contIdx.size()));
+		for(std::size_t iIdx : contIdx)
+		{
+			PutSep(' ');
+			PutInt(std::uint32_t(iIdx));
+		}
+
+		// number of colour components
+		if(m_bBinary)
+			PutInt(0);
+		PutSep('\n');
+		++m_iCurPoly;
+
+		FlushBuf();
+		return true;
+	}
+
+	bool AddPoly(std::initializer_list<std::size_t> lstIdx)
+	{
+		return AddPoly<std::initializer_list<std::size_t>>(lstIdx);
+	}
+};
+
 }
 
 #endif
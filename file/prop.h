@@ -14,6 +14,12 @@
 #include <fstream>
 #include <type_traits>
 #include <map>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <typeindex>
+#include <mutex>
+#include <atomic>
 #include <algorithm>
 
 #include <boost/version.hpp>
@@ -23,6 +29,7 @@
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/optional.hpp>
+#include <boost/any.hpp>
 
 #include "../string/string.h"
 #include "../helper/traits.h"
@@ -39,6 +46,12 @@
 #endif
 
 
+// default number of cached query addresses
+#ifndef TLIBS_PROP_CACHE_SIZE
+	#define TLIBS_PROP_CACHE_SIZE 1024
+#endif
+
+
 namespace tl {
 
 namespace prop = ::boost::property_tree;
@@ -105,6 +118,111 @@ get_prop_path(const std::string& _strAddr, const typename t_str::value_type& chS
 // ----------------------------------------------------------------------------
 
 
+/**
+ * lru cache of resolved property nodes and their converted values,
+ * keyed by the query address.
+ * the entries point into the owner's tree, so copies start out empty.
+ */
+template<class t_str, class t_prop>
+class PropCache
+{
+public:
+	struct Entry
+	{
+		const t_prop *pNode = nullptr;	// nullptr: address not found
+		std::map<std::type_index, boost::any> mapVals;
+	};
+
+protected:
+	using t_lst = std::list<std::pair<t_str, Entry>>;
+
+	t_lst m_lst;
+	std::unordered_map<t_str, typename t_lst::iterator> m_map;
+	std::size_t m_iMaxSize = TLIBS_PROP_CACHE_SIZE;
+
+	// incremented whenever the cache is invalidated
+	std::atomic<std::size_t> m_iGen{0};
+	std::mutex m_mtx;
+
+	void Shrink(std::size_t iSize)
+	{
+		while(m_lst.size() > iSize)
+		{
+			m_map.erase(m_lst.back().first);
+			m_lst.pop_back();
+		}
+	}
+
+public:
+	PropCache() = default;
+	PropCache(const PropCache<t_str, t_prop>& cache) : m_iMaxSize(cache.m_iMaxSize) {}
+
+	PropCache<t_str, t_prop>& operator=(const PropCache<t_str, t_prop>& cache)
+	{
+		if(this != &cache)
+		{
+			Clear();
+			SetMaxSize(cache.m_iMaxSize);
+		}
+		return *this;
+	}
+
+	std::mutex& GetMutex() { return m_mtx; }
+	std::size_t GetGeneration() const { return m_iGen.load(); }
+
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_lst.clear();
+		m_map.clear();
+		++m_iGen;
+	}
+
+	/**
+	 * 0 disables the cache
+	 */
+	void SetMaxSize(std::size_t iSize)
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_iMaxSize = iSize;
+		Shrink(m_iMaxSize);
+	}
+
+	std::size_t GetSize()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		return m_lst.size();
+	}
+
+	// Find and Insert have to be called with the mutex locked
+	Entry* Find(const t_str& strAddr)
+	{
+		auto iter = m_map.find(strAddr);
+		if(iter == m_map.end())
+			return nullptr;
+
+		// mark as most recently used
+		m_lst.splice(m_lst.begin(), m_lst, iter->second);
+		return &iter->second->second;
+	}
+
+	Entry* Insert(const t_str& strAddr, const t_prop *pNode)
+	{
+		if(m_iMaxSize == 0)
+			return nullptr;
+
+		Shrink(m_iMaxSize - 1);
+		m_lst.emplace_front(strAddr, Entry());
+		m_lst.front().second.pNode = pNode;
+		m_map.emplace(strAddr, m_lst.begin());
+		return &m_lst.front().second;
+	}
+};
+
+
+// ----------------------------------------------------------------------------
+
+
 template<class _t_str = std::string, bool bCaseSensitive=0>
 class Prop
 {
@@ -113,21 +231,95 @@ public:
 	using t_ch = typename t_str::value_type;
 	using t_prop = prop::basic_ptree<t_str, t_str, StringComparer<t_str, bCaseSensitive>>;
 	using t_propval = typename t_prop::value_type;
+	using t_cache = PropCache<t_str, t_prop>;
 
 protected:
 	t_prop m_prop;
 	t_ch m_chSep = '/';
 
+	// resolved query addresses, invalidated on every modification
+	mutable t_cache m_cache;
+
+	/**
+	 * finds the node to an address, bypassing the cache
+	 */
+	const t_prop* ResolveNode(const t_str& strAddr) const
+	{
+		try
+		{
+			auto optPath = get_prop_path<t_str>(strAddr, m_chSep);
+			if(!optPath)
+				return nullptr;
+
+			auto optNode = m_prop.get_child_optional(*optPath);
+			if(optNode)
+				return &*optNode;
+		}
+		catch(const std::exception& ex) {}
+
+		return nullptr;
+	}
+
+	/**
+	 * looks up a value using the cache, the cache mutex has to be locked
+	 */
+	template<typename T>
+	bool QueryLocked(const t_str& strAddr, T& tOut) const
+	{
+		// Insert returns nullptr if the cache is disabled, the node is resolved only once anyway
+		typename t_cache::Entry *pEntry = m_cache.Find(strAddr);
+		const t_prop *pNode = pEntry ? pEntry->pNode : ResolveNode(strAddr);
+		if(!pEntry)
+			pEntry = m_cache.Insert(strAddr, pNode);
+
+		if(!pNode)
+			return false;
+
+		if(pEntry)
+		{
+			auto iter = pEntry->mapVals.find(std::type_index(typeid(T)));
+			if(iter != pEntry->mapVals.end())
+			{
+				tOut = boost::any_cast<const T&>(iter->second);
+				return true;
+			}
+		}
+
+		try
+		{
+			tOut = tl::str_to_var<T, t_str>(pNode->data());
+		}
+		catch(const std::exception& ex)
+		{
+			return false;
+		}
+
+		// if T is a string type, trim it
+		if(std::is_same<t_str, T>::value)
+			trim(*reinterpret_cast<t_str*>(&tOut));
+
+		if(pEntry)
+			pEntry->mapVals.emplace(std::type_index(typeid(T)), tOut);
+		return true;
+	}
+
 public:
 	Prop(t_ch chSep = '/') : m_chSep(chSep) {}
 	Prop(const t_prop& prop, t_ch chSep='/') : m_prop(prop), m_chSep(chSep) {}
 	Prop(t_prop&& prop, t_ch chSep='/') : m_prop(std::move(prop)), m_chSep(chSep) {}
 	virtual ~Prop() = default;
 
-	void SetSeparator(t_ch ch) { m_chSep = ch; }
+	void SetSeparator(t_ch ch) { m_chSep = ch; InvalidateCache(); }
 
 	const t_prop& GetProp() const { return m_prop; }
-	void SetProp(const t_prop& prop) { m_prop = prop; }
+	void SetProp(const t_prop& prop) { m_prop = prop; InvalidateCache(); }
+
+	/**
+	 * has to be called after modifying the tree from outside
+	 */
+	void InvalidateCache() { m_cache.Clear(); }
+	void SetCacheSize(std::size_t iSize) { m_cache.SetMaxSize(iSize); }
+	std::size_t GetCacheGeneration() const { return m_cache.GetGeneration(); }
 
 	bool Load(const t_ch* pcFile)
 	{
@@ -167,6 +359,8 @@ public:
 
 	bool Load(std::basic_istream<t_ch>& istr, PropType ty)
 	{
+		InvalidateCache();
+
 		try
 		{
 			switch(ty)
@@ -284,25 +478,18 @@ public:
 	T Query(const t_str& strAddr, const T* pDef=nullptr, bool *pbOk=nullptr) const
 	{
 		T tOut;
-		try
+		bool bOk = 0;
 		{
-			auto optPath = get_prop_path<t_str>(strAddr, m_chSep);
-			if(!optPath) throw std::exception();
-
-			tOut = tl::str_to_var<T, t_str>(m_prop.template get<t_str>(*optPath));
+			std::lock_guard<std::mutex> lock(m_cache.GetMutex());
+			bOk = QueryLocked<T>(strAddr, tOut);
 		}
-		catch(const std::exception& ex)
+
+		if(pbOk) *pbOk = bOk;
+		if(!bOk)
 		{
-			if(pbOk) *pbOk = 0;
 			if(pDef) return *pDef;
 			return T();
 		}
-
-		// if T is a string type, trim it
-		if(std::is_same<t_str, T>::value)
-			trim(*reinterpret_cast<t_str*>(&tOut));
-
-		if(pbOk) *pbOk = 1;
 		return tOut;
 	}
 
@@ -312,6 +499,98 @@ public:
 		return Query<T>(_strAddr, &def, pbOk);
 	}
 
+	/**
+	 * queries a list of addresses in one go
+	 * @param pvecOk optionally returns which of the queries succeeded
+	 */
+	template<typename T>
+	std::vector<T> QueryMany(const std::vector<t_str>& vecAddrs, const T* pDef=nullptr,
+		std::vector<bool> *pvecOk=nullptr) const
+	{
+		std::vector<T> vecRet;
+		vecRet.reserve(vecAddrs.size());
+		if(pvecOk)
+			pvecOk->resize(vecAddrs.size());
+
+		std::lock_guard<std::mutex> lock(m_cache.GetMutex());
+		for(std::size_t iAddr=0; iAddr<vecAddrs.size(); ++iAddr)
+		{
+			T tOut;
+			bool bOk = QueryLocked<T>(vecAddrs[iAddr], tOut);
+			if(pvecOk)
+				(*pvecOk)[iAddr] = bOk;
+
+			if(bOk)
+				vecRet.emplace_back(std::move(tOut));
+			else
+				vecRet.emplace_back(pDef ? *pDef : T());
+		}
+
+		return vecRet;
+	}
+
+	template<typename T>
+	std::vector<T> QueryMany(const std::vector<t_str>& vecAddrs, const T def,
+		std::vector<bool> *pvecOk=nullptr) const
+	{
+		return QueryMany<T>(vecAddrs, &def, pvecOk);
+	}
+
+
+	/**
+	 * prepared query which keeps its converted value until the tree is modified;
+	 * an instance must not be shared between threads
+	 */
+	template<typename T>
+	class Prepared
+	{
+		protected:
+			const Prop<_t_str, bCaseSensitive> *m_pProp = nullptr;
+			t_str m_strAddr;
+
+			mutable std::size_t m_iGen = std::size_t(-1);
+			mutable T m_tVal{};
+			mutable bool m_bOk = 0;
+
+		public:
+			Prepared() = default;
+			Prepared(const Prop<_t_str, bCaseSensitive>& prop, const t_str& strAddr)
+				: m_pProp(&prop), m_strAddr(strAddr)
+			{}
+
+			const t_str& GetAddr() const { return m_strAddr; }
+
+			T Get(const T* pDef=nullptr, bool *pbOk=nullptr) const
+			{
+				if(!m_pProp)
+				{
+					if(pbOk) *pbOk = 0;
+					return pDef ? *pDef : T();
+				}
+
+				// the generation is read first, a concurrent modification then triggers a reload
+				const std::size_t iGen = m_pProp->m_cache.GetGeneration();
+				if(iGen != m_iGen)
+				{
+					m_tVal = m_pProp->template Query<T>(m_strAddr, nullptr, &m_bOk);
+					m_iGen = iGen;
+				}
+
+				if(pbOk) *pbOk = m_bOk;
+				if(!m_bOk && pDef) return *pDef;
+				return m_tVal;
+			}
+
+			T Get(const T def, bool *pbOk=nullptr) const { return Get(&def, pbOk); }
+			T operator()() const { return Get(); }
+	};
+
+	template<typename T>
+	Prepared<T> Prepare(const t_str& strAddr) const
+	{
+		return Prepared<T>(*this, strAddr);
+	}
+
 	template<typename T>
 	boost::optional<T> QueryOpt(const t_str& strAddr) const
 	{
@@ -447,6 +726,7 @@ public:
 	{
 		auto optPath = get_prop_path<t_str>(strKey, m_chSep);
 		if(!optPath) return;
+		InvalidateCache();
 
 		//std::cout << "type: " << get_typename<remove_constref_t<T>>() << std::endl;
 		if(std::is_convertible<T, t_str>::value)
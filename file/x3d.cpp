@@ -18,4 +18,5 @@ namespace tl{
 	template class X3dPolygon<double>;
 	template class X3dLines<double>;
 	template class X3d<double>;
+	template class X3dStreamWriter<double>;
 }
@@ -10,11 +10,19 @@
 
 #include <ostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
 
 #include "../math/linalg.h"
 #include "../math/quat.h"
+#include "../log/log.h"
+#include "comp.h"
 
 namespace tl{
 
@@ -423,5 +431,431 @@ class X3d
 		const X3dScene<t_real>& GetScene() const { return m_scene; }
 };
 
+
+// -----------------------------------------------------------------------------
+
+
+/**
+ * writes an x3d scene while it is being produced, without building the element tree.
+ * identical shapes are only defined once and then reused (DEF/USE),
+ * polygons are collected into indexed face sets with shared vertices.
+ */
+template<class t_real = double>
+class X3dStreamWriter
+{
+	public:
+		using t_vec = ublas::vector<t_real>;
+		using t_quat = math::quaternion<t_real>;
+
+	protected:
+		std::ofstream m_ofstr;
+		std::shared_ptr<std::ostream> m_pCompOstr;
+		std::ostream *m_pOstr = nullptr;
+
+		// output is collected here and passed on in large chunks
+		std::string m_strBuf;
+		static constexpr const std::size_t m_iBufLen = 1 << 20;
+		int m_iPrec = 6;
+
+		std::size_t m_iOpenTrafos = 0;
+
+		// shape descriptions that have already been defined, and their DEF names
+		std::unordered_map<std::string, std::size_t> m_mapShapes;
+		std::string m_strShape;
+
+		// face set being assembled
+		struct VertHash
+		{
+			std::size_t operator()(const std::array<t_real, 3>& arr) const
+			{
+				std::hash<t_real> hash;
+				return hash(arr[0]) ^ (hash(arr[1]) << 1) ^ (hash(arr[2]) << 2);
+			}
+		};
+
+		bool m_bInFaceSet = 0;
+		t_vec m_vecFaceColor;
+		std::vector<t_real> m_vecFaceVerts;
+		std::vector<std::size_t> m_vecFaceIdx;
+		std::unordered_map<std::array<t_real, 3>, std::size_t, VertHash> m_mapFaceVerts;
+
+	protected:
+		void Put(const char* pc) { m_strBuf.append(pc); }
+		void Put(const std::string& str) { m_strBuf.append(str); }
+		void Put(char c) { m_strBuf.push_back(c); }
+
+		void PutReal(std::string& str, t_real d) const
+		{
+			char pcNum[64];
+			int iLen = std::snprintf(pcNum, sizeof(pcNum), "%.*g", m_iPrec, double(d));
+			str.append(pcNum, std::size_t(iLen));
+		}
+
+		void PutReal(t_real d) { PutReal(m_strBuf, d); }
+
+		void PutIdx(std::size_t iIdx)
+		{
+			char pcNum[32];
+			int iLen = std::snprintf(pcNum, sizeof(pcNum), "%zu", iIdx);
+			m_strBuf.append(pcNum, std::size_t(iLen));
+		}
+
+		void PutVec(std::string& str, const t_vec& vec, std::size_t iNum) const
+		{
+			for(std::size_t i=0; i<iNum; ++i)
+			{
+				if(i) str.push_back(' ');
+				PutReal(str, i < vec.size() ? vec[i] : t_real(0));
+			}
+		}
+
+		void PutColor(std::string& str, const t_vec& vecColor) const
+		{
+			if(vecColor.size() < 3)
+				return;
+
+			str.append("<Appearance>\n<Material diffuseColor=\"");
+			PutVec(str, vecColor, 3);
+			str.append("\" ");
+			if(vecColor.size() >= 4)
+			{
+				str.append("transparency=\"");
+				PutReal(str, vecColor[3]);
+				str.append("\" ");
+			}
+			str.append("/>\n</Appearance>\n");
+		}
+
+		void FlushBuf(bool bForce = 0)
+		{
+			if(!m_pOstr || (!bForce && m_strBuf.size() < m_iBufLen))
+				return;
+
+			m_pOstr->write(m_strBuf.data(), m_strBuf.size());
+			m_strBuf.clear();
+		}
+
+		/**
+		 * writes the shape in m_strShape at the given position,
+		 * the first occurrence defines it, the following ones reuse it
+		 */
+		void PutShape(const t_vec& vecPos)
+		{
+			Put("<Transform translation=\"");
+			PutVec(m_strBuf, vecPos, 3);
+			Put("\">\n");
+
+			auto iter = m_mapShapes.find(m_strShape);
+			if(iter == m_mapShapes.end())
+			{
+				const std::size_t iDef = m_mapShapes.size();
+				m_mapShapes.emplace(m_strShape, iDef);
+
+				Put("<Shape DEF=\"tl_shape_");
+				PutIdx(iDef);
+				Put("\">\n");
+				Put(m_strShape);
+				Put("</Shape>\n");
+			}
+			else
+			{
+				Put("<Shape USE=\"tl_shape_");
+				PutIdx(iter->second);
+				Put("\" />\n");
+			}
+
+			Put("</Transform>\n");
+			FlushBuf();
+		}
+
+	public:
+		X3dStreamWriter() = default;
+		virtual ~X3dStreamWriter() { Close(); }
+
+		X3dStreamWriter(const X3dStreamWriter&) = delete;
+		X3dStreamWriter& operator=(const X3dStreamWriter&) = delete;
+
+		void SetPrecision(int iPrec) { m_iPrec = iPrec; }
+		bool IsOpen() const { return m_pOstr != nullptr; }
+
+		/**
+		 * starts writing to a stream, optionally compressed (e.g. Compressor::GZ for .x3dz)
+		 */
+		bool Open(std::ostream& ostr, Compressor comp = Compressor::INVALID,
+			const std::string& strComment = "")
+		{
+			Close();
+
+			if(comp != Compressor::INVALID)
+			{
+				m_pCompOstr = create_comp_ostream<char>(ostr, comp);
+				if(!m_pCompOstr)
+					return false;
+				m_pOstr = m_pCompOstr.get();
+			}
+			else
+			{
+				m_pOstr = &ostr;
+			}
+
+			m_strBuf.reserve(m_iBufLen + 4096);
+			if(strComment.size())
+			{
+				Put("<!--\n");
+				Put(strComment);
+				Put("\n-->\n");
+			}
+			Put("<X3D>\n<Scene>\n");
+			return true;
+		}
+
+		bool Open(const char* pcFile, Compressor comp = Compressor::INVALID,
+			const std::string& strComment = "")
+		{
+			Close();
+
+			m_ofstr.open(pcFile, std::ios_base::binary);
+			if(!m_ofstr)
+			{
+				log_err("Cannot open \"", pcFile, "\" for writing.");
+				return false;
+			}
+
+			return Open(m_ofstr, comp, strComment);
+		}
+
+		/**
+		 * finishes the scene and flushes all output
+		 */
+		bool Close()
+		{
+			if(!m_pOstr)
+				return false;
+
+			if(m_bInFaceSet)
+				EndFaceSet();
+			while(m_iOpenTrafos)
+				EndTrafo();
+
+			Put("</Scene>\n</X3D>\n");
+			FlushBuf(1);
+
+			const bool bOk = !m_pOstr->fail();
+			m_pCompOstr.reset();
+			m_pOstr = nullptr;
+			if(m_ofstr.is_open())
+				m_ofstr.close();
+
+			m_mapShapes.clear();
+			return bOk;
+		}
+
+		// ---------------------------------------------------------------------
+		// groups
+
+		void BeginTrafo(const t_vec& vecTrans, const t_vec* pvecScale = nullptr,
+			const t_quat* pquatRot = nullptr)
+		{
+			Put("<Transform translation=\"");
+			PutVec(m_strBuf, vecTrans, 3);
+			Put("\" ");
+			if(pvecScale)
+			{
+				Put("scale=\"");
+				PutVec(m_strBuf, *pvecScale, 3);
+				Put("\" ");
+			}
+			if(pquatRot)
+			{
+				Put("rotation=\"");
+				PutReal(pquatRot->R_component_1()); Put(' ');
+				PutReal(pquatRot->R_component_2()); Put(' ');
+				PutReal(pquatRot->R_component_3()); Put(' ');
+				PutReal(pquatRot->R_component_4());
+				Put("\" ");
+			}
+			Put(">\n");
+			++m_iOpenTrafos;
+		}
+
+		void EndTrafo()
+		{
+			if(!m_iOpenTrafos)
+			{
+				log_err("No open x3d transformation.");
+				return;
+			}
+
+			Put("</Transform>\n");
+			--m_iOpenTrafos;
+			FlushBuf();
+		}
+
+		// ---------------------------------------------------------------------
+		// instanced shapes
+
+		void AddSphere(const t_vec& vecPos, t_real dRad, const t_vec& vecColor = t_vec())
+		{
+			m_strShape = "<Sphere radius=\"";
+			PutReal(m_strShape, dRad);
+			m_strShape.append("\" />\n");
+			PutColor(m_strShape, vecColor);
+			PutShape(vecPos);
+		}
+
+		void AddCube(const t_vec& vecPos, const t_vec& vecLengths, const t_vec& vecColor = t_vec())
+		{
+			m_strShape = "<Box size=\"";
+			PutVec(m_strShape, vecLengths, 3);
+			m_strShape.append("\" />\n");
+			PutColor(m_strShape, vecColor);
+			PutShape(vecPos);
+		}
+
+		void AddCylinder(const t_vec& vecPos, t_real dRad, t_real dHeight,
+			const t_vec& vecColor = t_vec())
+		{
+			m_strShape = "<Cylinder height=\"";
+			PutReal(m_strShape, dHeight);
+			m_strShape.append("\" radius=\"");
+			PutReal(m_strShape, dRad);
+			m_strShape.append("\" />\n");
+			PutColor(m_strShape, vecColor);
+			PutShape(vecPos);
+		}
+
+		// ---------------------------------------------------------------------
+		// lines and faces
+
+		void AddLines(const std::vector<t_vec>& vecVerts, const t_vec& vecColor = t_vec(),
+			bool bCloseLines = 1)
+		{
+			Put("<Shape>\n<IndexedLineSet coordIndex=\"");
+			for(std::size_t iVert=0; iVert<vecVerts.size(); ++iVert)
+			{
+				PutIdx(iVert);
+				Put(' ');
+			}
+			if(bCloseLines)
+				Put("0 ");
+			Put("-1\">\n<Coordinate point=\"");
+			for(std::size_t iVert=0; iVert<vecVerts.size(); ++iVert)
+			{
+				if(iVert) Put(", ");
+				PutVec(m_strBuf, vecVerts[iVert], 3);
+			}
+			Put("\" />\n</IndexedLineSet>\n");
+			PutColor(m_strBuf, vecColor);
+			Put("</Shape>\n");
+			FlushBuf();
+		}
+
+		/**
+		 * collects the following polygons into one face set
+		 */
+		void BeginFaceSet(const t_vec& vecColor = t_vec())
+		{
+			if(m_bInFaceSet)
+				EndFaceSet();
+
+			m_bInFaceSet = 1;
+			m_vecFaceColor = vecColor;
+		}
+
+		/**
+		 * adds a vertex to the face set, equal vertices are shared
+		 * @return vertex index
+		 */
+		std::size_t AddVertex(const t_vec& vec)
+		{
+			std::array<t_real, 3> arr{{
+				vec.size() > 0 ? vec[0] : t_real(0),
+				vec.size() > 1 ? vec[1] : t_real(0),
+				vec.size() > 2 ? vec[2] : t_real(0) }};
+
+			auto iter = m_mapFaceVerts.find(arr);
+			if(iter != m_mapFaceVerts.end())
+				return iter->second;
+
+			const std::size_t iIdx = m_vecFaceVerts.size() / 3;
+			m_vecFaceVerts.insert(m_vecFaceVerts.end(), arr.begin(), arr.end());
+			m_mapFaceVerts.emplace(arr, iIdx);
+			return iIdx;
+		}
+
+		void AddFace(const std::vector<std::size_t>& vecIdx)
+		{
+			if(!m_bInFaceSet)
+				BeginFaceSet();
+
+			m_vecFaceIdx.insert(m_vecFaceIdx.end(), vecIdx.begin(), vecIdx.end());
+			m_vecFaceIdx.push_back(std::size_t(-1));
+		}
+
+		void AddPolygon(const std::vector<t_vec>& vecVerts)
+		{
+			if(!m_bInFaceSet)
+				BeginFaceSet();
+
+			for(const t_vec& vec : vecVerts)
+				m_vecFaceIdx.push_back(AddVertex(vec));
+			m_vecFaceIdx.push_back(std::size_t(-1));
+		}
+
+		void EndFaceSet()
+		{
+			if(!m_bInFaceSet)
+				return;
+			m_bInFaceSet = 0;
+
+			if(m_vecFaceIdx.size())
+			{
+				Put("<Shape>\n<IndexedFaceSet solid=\"false\" coordIndex=\"");
+				for(std::size_t iIdx : m_vecFaceIdx)
+				{
+					if(iIdx == std::size_t(-1))
+						Put("-1 ");
+					else
+					{
+						PutIdx(iIdx);
+						Put(' ');
+					}
+					FlushBuf();
+				}
+				Put("\">\n<Coordinate point=\"");
+				for(std::size_t iVert=0; iVert<m_vecFaceVerts.size(); iVert+=3)
+				{
+					if(iVert) Put(", ");
+					PutReal(m_vecFaceVerts[iVert]); Put(' ');
+					PutReal(m_vecFaceVerts[iVert+1]); Put(' ');
+					PutReal(m_vecFaceVerts[iVert+2]);
+					FlushBuf();
+				}
+				Put("\" />\n</IndexedFaceSet>\n");
+				PutColor(m_strBuf, m_vecFaceColor);
+				Put("</Shape>\n");
+				FlushBuf();
+			}
+
+			m_vecFaceVerts.clear();
+			m_vecFaceIdx.clear();
+			m_mapFaceVerts.clear();
+		}
+
+		// ---------------------------------------------------------------------
+
+		/**
+		 * writes an element of the tree representation
+		 */
+		void AddElem(const X3dElem<t_real>& elem)
+		{
+			std::ostringstream ostr;
+			ostr.precision(m_iPrec);
+			elem.Write(ostr);
+			Put(ostr.str());
+			FlushBuf();
+		}
+};
+
 }
 #endif
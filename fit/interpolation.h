@@ -18,6 +18,7 @@
 #include "../math/geo.h"
 #include "../math/math.h"
 #include "../helper/misc.h"
+#include "../helper/thread.h"
 #include "../log/log.h"
 #include "funcmod.h"
 
@@ -56,6 +57,7 @@ ublas::vector<T> bezier(const ublas::vector<T>* P, std::size_t N, T t)
 
 /**
  * see: http://mathworld.wolfram.com/B-Spline.html
+ * recursive definition, O(2^j), see bspline_basis for the evaluation
  */
 template<typename T>
 T bspline_base(int i, int j, T t, const std::vector<T>& knots)
@@ -80,23 +82,138 @@ T bspline_base(int i, int j, T t, const std::vector<T>& knots)
 }
 
 
+/**
+ * knot span k with knots[k] <= t < knots[k+1] for N control points,
+ * clamped to the valid spans [degree, N-1]
+ */
+template<typename T>
+std::size_t bspline_span(std::size_t N, unsigned int iDegree, T t, const std::vector<T>& knots)
+{
+	if(t >= knots[N])
+		return N-1;
+	if(t <= knots[iDegree])
+		return iDegree;
+
+	auto iter = std::upper_bound(knots.begin()+iDegree, knots.begin()+N+1, t);
+	return std::size_t(iter - knots.begin()) - 1;
+}
+
+
+/**
+ * the iDegree+1 basis functions (or their iDeriv-th derivatives)
+ * which are non-zero in knot span iSpan, i.e. N_{iSpan-iDegree..iSpan, iDegree}(t)
+ * @see (Piegl 1997), algorithm A2.2, and the derivative formula, equ. 2.9
+ */
+template<typename T>
+void bspline_basis(std::size_t iSpan, unsigned int iDegree, T t, const std::vector<T>& knots,
+	T* pN, unsigned int iDeriv = 0)
+{
+	std::fill(pN, pN+iDegree+1, T(0));
+	if(iDeriv > iDegree)
+		return;
+
+	// basis functions of degree iDegree-iDeriv, Cox-de Boor triangle
+	const unsigned int iDeg0 = iDegree - iDeriv;
+	pN[0] = T(1);
+	for(unsigned int j=1; j<=iDeg0; ++j)
+	{
+		T saved = T(0);
+		for(unsigned int r=0; r<j; ++r)
+		{
+			const T right = knots[iSpan+r+1] - t;
+			const T left = t - knots[iSpan+1+r-j];
+			const T temp = pN[r] / (right + left);
+			pN[r] = saved + right*temp;
+			saved = left*temp;
+		}
+		pN[j] = saved;
+	}
+
+	// raise the degree by differentiating, in place from the back
+	for(unsigned int q=iDeg0+1; q<=iDegree; ++q)
+	{
+		for(unsigned int j=q+1; j-- > 0;)
+		{
+			// basis function index i = iSpan-q+j
+			const std::size_t i = iSpan+j-q;
+			T val = T(0);
+
+			const T dLeft = knots[i+q] - knots[i];
+			if(j > 0 && dLeft != T(0))
+				val += T(q) / dLeft * pN[j-1];
+
+			const T dRight = knots[i+q+1] - knots[i+1];
+			if(j < q && dRight != T(0))
+				val -= T(q) / dRight * pN[j];
+
+			pN[j] = val;
+		}
+	}
+}
+
+
+/**
+ * evaluates a B-spline (or its iDeriv-th derivative) at the n parameters pT
+ * using only the degree+1 active basis functions per parameter.
+ * the N control points have iDim coordinates each, which are stored consecutively,
+ * the results are written in the same layout to the preallocated pOut.
+ * sorted parameters are fastest, as the previous knot span is tried first.
+ */
+template<typename T>
+void bspline_n(const T* pCtrl, std::size_t N, std::size_t iDim, const std::vector<T>& knots,
+	const T* pT, std::size_t n, T* pOut, unsigned int iDeriv = 0)
+{
+	if(N == 0 || knots.size() < N+1)
+	{
+		std::fill(pOut, pOut + n*iDim, T(0));
+		return;
+	}
+
+	const unsigned int iDegree = unsigned(knots.size() - N - 1);
+	std::vector<T> vecN(iDegree+1);
+	std::size_t iSpan = iDegree;
+
+	for(std::size_t j=0; j<n; ++j)
+	{
+		const T t = pT[j];
+		if(!(knots[iSpan] <= t && t < knots[iSpan+1]))
+			iSpan = bspline_span(N, iDegree, t, knots);
+
+		bspline_basis(iSpan, iDegree, t, knots, vecN.data(), iDeriv);
+
+		T* pRes = pOut + j*iDim;
+		std::fill(pRes, pRes+iDim, T(0));
+		for(unsigned int k=0; k<=iDegree; ++k)
+		{
+			const T* pP = pCtrl + (iSpan-iDegree+k)*iDim;
+			for(std::size_t d=0; d<iDim; ++d)
+				pRes[d] += vecN[k] * pP[d];
+		}
+	}
+}
+
+
 /**
  * see: http://mathworld.wolfram.com/B-Spline.html
+ * zero outside [knots.front(), knots.back()]
  */
 template<typename T>
 ublas::vector<T> bspline(const ublas::vector<T>* P, std::size_t N, T t, const std::vector<T>& knots)
 {
 	if(N==0) return ublas::vector<T>(0);
-	const int n = N-1;
-	const int m = knots.size()-1;
-	const int degree = m-n-1;
 
-	ublas::vector<T> vec(P[0].size());
-	for(std::size_t i=0; i<vec.size(); ++i)
-		vec[i] = T(0);
+	ublas::vector<T> vec = ublas::zero_vector<T>(P[0].size());
+	if(knots.size() < N+1 || t < knots.front() || t > knots.back())
+		return vec;
 
-	for(int i=0; i<=n; ++i)
-		vec += P[i]*bspline_base(i, degree, t, knots);
+	const unsigned int iDegree = unsigned(knots.size() - N - 1);
+	const std::size_t iSpan = bspline_span(N, iDegree, t, knots);
+
+	std::vector<T> vecN(iDegree+1);
+	bspline_basis(iSpan, iDegree, t, knots, vecN.data());
+
+	for(unsigned int k=0; k<=iDegree; ++k)
+		vec += P[iSpan-iDegree+k] * vecN[k];
 
 	return vec;
 }
@@ -125,7 +242,8 @@ template<typename T=double>
 class BSpline : public FunctionModel_param<ublas::vector<T>>
 {
 	protected:
-		std::unique_ptr<ublas::vector<T>[]> m_pvecs;
+		// control points, x and y interleaved
+		std::vector<T> m_vecCtrl;
 		std::size_t m_iN, m_iDegree;
 		std::vector<T> m_vecKnots;
 
@@ -135,24 +253,180 @@ class BSpline : public FunctionModel_param<ublas::vector<T>>
 
 		virtual ublas::vector<T> operator()(T t) const override;
 		virtual const char* GetModelName() const override { return "bspline"; };
+
+		// evaluates the curve at n parameters t = 0..1
+		void eval_n(const T* pT, std::size_t n, T* pX, T* pY) const;
+};
+
+/**
+ * tabulated function with contiguous, sorted x and y arrays,
+ * shared by the linear and cubic interpolators.
+ * uniformly spaced x values are detected and looked up by direct index computation.
+ */
+template<typename T=double>
+class InterpTable : public FunctionModel<T>
+{
+protected:
+	std::vector<T> m_vecX, m_vecY;
+
+	bool m_bUniform = false;
+	T m_dInvStep = T(0);
+
+public:
+	InterpTable(std::size_t N, const T *px, const T *py);
+	virtual ~InterpTable() = default;
+
+	std::size_t GetSize() const { return m_vecX.size(); }
+	const std::vector<T>& GetX() const { return m_vecX; }
+	const std::vector<T>& GetY() const { return m_vecY; }
+	bool IsUniform() const { return m_bUniform; }
+
+	// index i of the interval [x_i, x_i+1] containing x, clamped to the first and last one
+	std::size_t FindInterval(T x) const;
+
+	// evaluates at n positions, sorted ones are processed in one pass
+	virtual void eval_n(const T* px, std::size_t n, T* py) const = 0;
+
+protected:
+	/**
+	 * calls fkt(i, x) for all positions with the interval index i
+	 */
+	template<class t_func>
+	void walk(const T* px, std::size_t n, T* py, t_func&& fkt) const
+	{
+		const std::size_t N = m_vecX.size();
+		if(N < 2 || m_bUniform)
+		{
+			for(std::size_t j=0; j<n; ++j)
+				py[j] = fkt(FindInterval(px[j]), px[j]);
+			return;
+		}
+
+		std::size_t i = 0;
+		for(std::size_t j=0; j<n; ++j)
+		{
+			const T x = px[j];
+
+			// continue from the previous interval, or search again
+			if(x >= m_vecX[i])
+			{
+				for(int iStep=0; iStep<8 && i+2<N && x>=m_vecX[i+1]; ++iStep)
+					++i;
+				if(i+2<N && x>=m_vecX[i+1])
+					i = FindInterval(x);
+			}
+			else
+			{
+				i = FindInterval(x);
+			}
+
+			py[j] = fkt(i, x);
+		}
+	}
 };
 
+
+/**
+ * piecewise linear interpolation, linear extrapolation at the ends
+ */
 template<typename T=double>
-class LinInterp : public FunctionModel<T>
+class LinInterp : public InterpTable<T>
 {
 protected:
-	std::unique_ptr<ublas::vector<T>[]> m_pvecs;
-	std::size_t m_iN;
+	std::vector<T> m_vecSlope;
+
+	T eval(std::size_t i, T x) const
+	{
+		return this->m_vecY[i] + (x - this->m_vecX[i])*m_vecSlope[i];
+	}
 
 public:
 	LinInterp(std::size_t N, const T *px, const T *py);
 	virtual ~LinInterp() = default;
 
 	virtual T operator()(T x) const override;
+	virtual void eval_n(const T* px, std::size_t n, T* py) const override;
 	virtual const char* GetModelName() const override { return "linear_interpolation"; };
 };
 
 
+/**
+ * piecewise cubic Hermite interpolation with node derivatives given by
+ * a natural cubic spline (bMonotone = 0), or by the monotonicity-preserving PCHIP scheme (bMonotone = 1).
+ * the end polynomials are used for extrapolation.
+ * @see https://en.wikipedia.org/wiki/Cubic_Hermite_spline
+ * @see F. N. Fritsch and J. Butland, SIAM J. Sci. Stat. Comput. 5(2), pp. 300-304 (1984), doi: https://doi.org/10.1137/0905021
+ */
+template<typename T=double>
+class CubicInterp : public InterpTable<T>
+{
+protected:
+	std::vector<T> m_vecD;
+	bool m_bMonotone = false;
+
+	T eval(std::size_t i, T x) const
+	{
+		const T h = this->m_vecX[i+1] - this->m_vecX[i];
+		const T t = (x - this->m_vecX[i]) / h;
+		const T y0 = this->m_vecY[i], y1 = this->m_vecY[i+1];
+		const T d0 = m_vecD[i]*h, d1 = m_vecD[i+1]*h;
+
+		// hermite form, horner scheme
+		const T c2 = T(3)*(y1-y0) - T(2)*d0 - d1;
+		const T c3 = T(2)*(y0-y1) + d0 + d1;
+		return y0 + t*(d0 + t*(c2 + t*c3));
+	}
+
+	void CalcSpline();
+	void CalcPchip();
+
+public:
+	CubicInterp(std::size_t N, const T *px, const T *py, bool bMonotone = false);
+	virtual ~CubicInterp() = default;
+
+	virtual T operator()(T x) const override;
+	virtual void eval_n(const T* px, std::size_t n, T* py) const override;
+	virtual const char* GetModelName() const override
+	{ return m_bMonotone ? "pchip_interpolation" : "cubic_interpolation"; };
+};
+
+
+/**
+ * cubic smoothing spline, minimising
+ * sum_i w_i (y_i - f(x_i))^2 + lambda * int f''(x)^2 dx
+ * in a clamped cubic B-spline basis with knots at the distinct x values
+ * (the classical smoothing spline) or, for iSegments > 0, at equidistant positions.
+ * for dense data, only every n-th x value is used as knot, as the normal equations
+ * lose precision for lambda/h^3 >~ 1/epsilon at a knot spacing h.
+ * lambda has the units of x^3, the boundary polynomials are used for extrapolation.
+ * @see https://en.wikipedia.org/wiki/Smoothing_spline
+ */
+template<typename T=double>
+class SmoothSpline : public FunctionModel<T>
+{
+public:
+	static constexpr std::size_t MAX_DATA_KNOTS = 500;
+
+protected:
+	std::vector<T> m_vecKnots, m_vecCoeffs;
+
+public:
+	SmoothSpline(std::size_t N, const T *px, const T *py, T dLambda,
+		const T *pw=nullptr, std::size_t iSegments=0);
+	virtual ~SmoothSpline() = default;
+
+	virtual T operator()(T x) const override;
+	virtual const char* GetModelName() const override { return "smoothing_spline"; };
+
+	// evaluates the spline (or its derivatives) at n positions
+	void eval_n(const T* px, std::size_t n, T* py, unsigned int iDeriv=0) const;
+
+	bool IsOk() const { return !m_vecCoeffs.empty(); }
+	const std::vector<T>& GetKnots() const { return m_vecKnots; }
+	const std::vector<T>& GetCoeffs() const { return m_vecCoeffs; }
+};
+
+
 
 template<class T>
 Bezier<T>::Bezier(std::size_t N, const T *px, const T *py) : m_iN(N)
@@ -181,27 +455,25 @@ ublas::vector<T> Bezier<T>::operator()(T t) const
 
 template<class T>
 BSpline<T>::BSpline(std::size_t N, const T *px, const T *py, unsigned int iDegree)
-	: m_iN(N), m_iDegree(iDegree)
+	: m_iN(N), m_iDegree(N ? std::min<std::size_t>(iDegree, N-1) : 0)
 {
-	m_pvecs.reset(new ublas::vector<T>[m_iN]);
+	m_vecCtrl.resize(2*m_iN);
 
 	for(std::size_t i=0; i<m_iN; ++i)
 	{
-		m_pvecs[i].resize(2);
-		m_pvecs[i][0] = px[i];
-		m_pvecs[i][1] = py[i];
+		m_vecCtrl[2*i] = px[i];
+		m_vecCtrl[2*i+1] = py[i];
 	}
 
 	std::size_t iM = m_iDegree + m_iN + 1;
 	m_vecKnots.resize(iM);
 
-	const T eps = std::numeric_limits<T>::epsilon();
-
 	// set knots to uniform, nonperiodic B-Spline
+	// (the end knots are repeated, which the de Boor evaluation handles)
 	for(unsigned int i=0; i<m_iDegree+1; ++i)
-		m_vecKnots[i] = 0.+i*eps;
+		m_vecKnots[i] = 0.;
 	for(unsigned int i=iM-m_iDegree-1; i<iM; ++i)
-		m_vecKnots[i] = 1.-i*eps;
+		m_vecKnots[i] = 1.;
 	for(unsigned int i=m_iDegree+1; i<iM-m_iDegree-1; ++i)
 		m_vecKnots[i] = T(i+1-m_iDegree-1) / T(iM-2*m_iDegree-2 + 1);
 
@@ -224,66 +496,421 @@ ublas::vector<T> BSpline<T>::operator()(T t) const
 		return vecNull;
 	}
 
-	ublas::vector<T> vec = tl::bspline<T>(m_pvecs.get(), m_iN, t, m_vecKnots);
-
-	// remove epsilon dependence
-	if(t<=0.) vec = m_pvecs[0];
-	if(t>=1.) vec = m_pvecs[m_iN-1];
+	t = std::min(std::max(t, T(0)), T(1));
 
+	ublas::vector<T> vec(2);
+	tl::bspline_n<T>(m_vecCtrl.data(), m_iN, 2, m_vecKnots, &t, 1, &vec[0]);
 	return vec;
 }
 
+template<class T>
+void BSpline<T>::eval_n(const T* pT, std::size_t n, T* pX, T* pY) const
+{
+	std::vector<T> vecT(pT, pT+n), vecXY(2*n);
+	for(T& t : vecT)
+		t = std::min(std::max(t, T(0)), T(1));
+
+	tl::bspline_n<T>(m_vecCtrl.data(), m_iN, 2, m_vecKnots, vecT.data(), n, vecXY.data());
+
+	for(std::size_t i=0; i<n; ++i)
+	{
+		pX[i] = vecXY[2*i];
+		pY[i] = vecXY[2*i+1];
+	}
+}
+
 
 template<class T>
-LinInterp<T>::LinInterp(std::size_t N, const T *px, const T *py)
-	: m_iN(N)
+InterpTable<T>::InterpTable(std::size_t N, const T *px, const T *py)
 {
-	m_pvecs.reset(new ublas::vector<T>[m_iN]);
+	// sort by x values, for duplicate x values the first one is kept
+	std::vector<std::size_t> vecIdx(N);
+	for(std::size_t i=0; i<N; ++i)
+		vecIdx[i] = i;
+	std::stable_sort(vecIdx.begin(), vecIdx.end(),
+		[px](std::size_t i, std::size_t j) -> bool { return px[i] < px[j]; });
+
+	m_vecX.reserve(N);
+	m_vecY.reserve(N);
+	for(std::size_t i : vecIdx)
+	{
+		if(!m_vecX.empty() && !(px[i] > m_vecX.back()))
+			continue;
+		m_vecX.push_back(px[i]);
+		m_vecY.push_back(py[i]);
+	}
 
-	for(std::size_t i=0; i<m_iN; ++i)
+	// uniform grid?
+	const std::size_t iN = m_vecX.size();
+	if(iN >= 2)
 	{
-		m_pvecs[i].resize(2);
-		m_pvecs[i][0] = px[i];
-		m_pvecs[i][1] = py[i];
+		const T dRange = m_vecX.back() - m_vecX.front();
+		const T dStep = dRange / T(iN-1);
+		const T dTol = dRange * T(1e-10);
+
+		m_bUniform = true;
+		for(std::size_t i=1; i<iN-1; ++i)
+		{
+			if(std::abs(m_vecX[i] - (m_vecX.front() + T(i)*dStep)) > dTol)
+			{
+				m_bUniform = false;
+				break;
+			}
+		}
+		m_dInvStep = T(1) / dStep;
 	}
+}
 
-	// ensure that vector is sorted by x values
-	std::stable_sort(m_pvecs.get(), m_pvecs.get()+m_iN,
-		[](const ublas::vector<T>& vec1, const ublas::vector<T>& vec2) -> bool
-		{ return vec1[0] < vec2[0]; });
+template<class T>
+std::size_t InterpTable<T>::FindInterval(T x) const
+{
+	const std::size_t N = m_vecX.size();
+	if(N < 2)
+		return 0;
+
+	if(m_bUniform)
+	{
+		const T dIdx = (x - m_vecX.front()) * m_dInvStep;
+		if(!(dIdx > T(0)))
+			return 0;
+		if(dIdx >= T(N-2))
+			return N-2;
+		return std::size_t(dIdx);
+	}
+
+	auto iter = std::upper_bound(m_vecX.begin()+1, m_vecX.end()-1, x);
+	return std::size_t(iter - m_vecX.begin()) - 1;
+}
+
+
+template<class T>
+LinInterp<T>::LinInterp(std::size_t N, const T *px, const T *py)
+	: InterpTable<T>(N, px, py)
+{
+	const std::size_t iN = this->m_vecX.size();
+	m_vecSlope.resize(iN ? iN-1 : 0);
+	for(std::size_t i=0; i+1<iN; ++i)
+	{
+		m_vecSlope[i] = (this->m_vecY[i+1] - this->m_vecY[i]) /
+			(this->m_vecX[i+1] - this->m_vecX[i]);
+	}
 }
 
 template<class T>
 T LinInterp<T>::operator()(T x) const
 {
-	const auto* iterBegin = m_pvecs.get();
-	const auto* iterEnd = m_pvecs.get() + m_iN;
+	if(this->m_vecX.size() == 0)
+		return T(0);
+	if(this->m_vecX.size() == 1)
+		return this->m_vecY[0];
+
+	return eval(this->FindInterval(x), x);
+}
+
+template<class T>
+void LinInterp<T>::eval_n(const T* px, std::size_t n, T* py) const
+{
+	if(this->m_vecX.size() < 2)
+	{
+		std::fill(py, py+n, this->m_vecX.size() ? this->m_vecY[0] : T(0));
+		return;
+	}
+
+	this->walk(px, n, py, [this](std::size_t i, T x) -> T { return eval(i, x); });
+}
+
+
+template<class T>
+CubicInterp<T>::CubicInterp(std::size_t N, const T *px, const T *py, bool bMonotone)
+	: InterpTable<T>(N, px, py), m_bMonotone(bMonotone)
+{
+	const std::size_t iN = this->m_vecX.size();
+	m_vecD.resize(iN, T(0));
+	if(iN < 2)
+		return;
+
+	if(iN == 2)
+		m_vecD[0] = m_vecD[1] = (this->m_vecY[1]-this->m_vecY[0]) / (this->m_vecX[1]-this->m_vecX[0]);
+	else if(m_bMonotone)
+		CalcPchip();
+	else
+		CalcSpline();
+}
+
+/**
+ * node derivatives of the natural cubic spline, from the tridiagonal system for the second derivatives
+ * @see https://en.wikipedia.org/wiki/Spline_interpolation
+ */
+template<class T>
+void CubicInterp<T>::CalcSpline()
+{
+	const std::vector<T>& x = this->m_vecX;
+	const std::vector<T>& y = this->m_vecY;
+	const std::size_t N = x.size();
+
+	// second derivatives, M_0 = M_N-1 = 0, thomas algorithm
+	std::vector<T> vecM(N, T(0)), vecC(N, T(0));
+	for(std::size_t i=1; i+1<N; ++i)
+	{
+		const T h0 = x[i]-x[i-1], h1 = x[i+1]-x[i];
+		const T rhs = T(6)*((y[i+1]-y[i])/h1 - (y[i]-y[i-1])/h0);
+		const T denom = T(2)*(h0+h1) - h0*vecC[i-1];
+
+		vecC[i] = h1 / denom;
+		vecM[i] = (rhs - h0*vecM[i-1]) / denom;
+	}
+	vecM[N-1] = T(0);
+	for(std::size_t i=N-1; i-- > 1;)
+		vecM[i] -= vecC[i]*vecM[i+1];
+
+	for(std::size_t i=0; i+1<N; ++i)
+	{
+		const T h = x[i+1]-x[i];
+		m_vecD[i] = (y[i+1]-y[i])/h - h*(T(2)*vecM[i] + vecM[i+1])/T(6);
+	}
+	const T h = x[N-1]-x[N-2];
+	m_vecD[N-1] = (y[N-1]-y[N-2])/h + h*(vecM[N-2] + T(2)*vecM[N-1])/T(6);
+}
+
+/**
+ * node derivatives of the piecewise cubic hermite interpolating polynomial,
+ * weighted harmonic means of the secants, zero at local extrema
+ */
+template<class T>
+void CubicInterp<T>::CalcPchip()
+{
+	const std::vector<T>& x = this->m_vecX;
+	const std::vector<T>& y = this->m_vecY;
+	const std::size_t N = x.size();
+
+	std::vector<T> vecH(N-1), vecDelta(N-1);
+	for(std::size_t i=0; i+1<N; ++i)
+	{
+		vecH[i] = x[i+1]-x[i];
+		vecDelta[i] = (y[i+1]-y[i]) / vecH[i];
+	}
+
+	for(std::size_t i=1; i+1<N; ++i)
+	{
+		if(vecDelta[i-1]*vecDelta[i] <= T(0))
+		{
+			m_vecD[i] = T(0);
+			continue;
+		}
+
+		const T w1 = T(2)*vecH[i] + vecH[i-1];
+		const T w2 = vecH[i] + T(2)*vecH[i-1];
+		m_vecD[i] = (w1+w2) / (w1/vecDelta[i-1] + w2/vecDelta[i]);
+	}
+
+	// shape-preserving three-point formula at the ends
+	auto end_deriv = [](T h0, T h1, T delta0, T delta1) -> T
+	{
+		T d = ((T(2)*h0 + h1)*delta0 - h0*delta1) / (h0 + h1);
+		if(d*delta0 <= T(0))
+			d = T(0);
+		else if(delta0*delta1 <= T(0) && std::abs(d) > std::abs(T(3)*delta0))
+			d = T(3)*delta0;
+		return d;
+	};
+
+	m_vecD[0] = end_deriv(vecH[0], vecH[1], vecDelta[0], vecDelta[1]);
+	m_vecD[N-1] = end_deriv(vecH[N-2], vecH[N-3], vecDelta[N-2], vecDelta[N-3]);
+}
 
-	if(m_iN == 0)
+template<class T>
+T CubicInterp<T>::operator()(T x) const
+{
+	if(this->m_vecX.size() == 0)
 		return T(0);
-	if(m_iN == 1)
-		return (*iterBegin)[1];
+	if(this->m_vecX.size() == 1)
+		return this->m_vecY[0];
+
+	return eval(this->FindInterval(x), x);
+}
 
-	const auto* iterLower = std::lower_bound(iterBegin, iterEnd, x,
-		[](const ublas::vector<T>& vec, const T& x) -> bool
-		{ return vec[0] < x; });
-	//const auto* iterUpper = std::upper_bound(iterBegin, iterEnd, x,
-	//	[](const T& x, const ublas::vector<T>& vec) -> bool
-	//	{ return x < vec[0]; });
+template<class T>
+void CubicInterp<T>::eval_n(const T* px, std::size_t n, T* py) const
+{
+	if(this->m_vecX.size() < 2)
+	{
+		std::fill(py, py+n, this->m_vecX.size() ? this->m_vecY[0] : T(0));
+		return;
+	}
 
-	// lower bound at end of range?
-	if(iterLower == iterEnd || iterLower == iterEnd-1)
-		iterLower = iterEnd - 2;
-	const auto* iter2 = iterLower + 1;
+	this->walk(px, n, py, [this](std::size_t i, T x) -> T { return eval(i, x); });
+}
 
-	T xrange = (*iter2)[0] - (*iterLower)[0];
-	T xpos = (x-(*iterLower)[0]) / xrange;
 
-	return tl::lerp<T,T>((*iterLower)[1], (*iter2)[1], xpos);
+/**
+ * solves the symmetric positive definite banded system A x = b by Cholesky decomposition
+ * vecA holds the upper band, A(i, i+k) at vecA[i*(iBand+1) + k], and is overwritten.
+ * the solution is written to vecB.
+ */
+template<typename T>
+bool _band_cholesky_solve(std::vector<T>& vecA, std::vector<T>& vecB, std::size_t N, std::size_t iBand)
+{
+	const std::size_t W = iBand+1;
+	auto U = [&vecA, W](std::size_t i, std::size_t j) -> T& { return vecA[i*W + (j-i)]; };
+
+	// A = U^T U
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const std::size_t k0 = i>iBand ? i-iBand : 0;
+
+		T d = U(i,i);
+		const T dDiag = d;
+		for(std::size_t k=k0; k<i; ++k)
+			d -= U(k,i)*U(k,i);
+		if(!(d > std::numeric_limits<T>::epsilon() * dDiag))
+			return false;
+		U(i,i) = std::sqrt(d);
+
+		for(std::size_t j=i+1; j<std::min(N, i+W); ++j)
+		{
+			T sum = U(i,j);
+			for(std::size_t k=(j>iBand ? j-iBand : 0); k<i; ++k)
+				sum -= U(k,i)*U(k,j);
+			U(i,j) = sum / U(i,i);
+		}
+	}
+
+	// U^T z = b
+	for(std::size_t i=0; i<N; ++i)
+	{
+		for(std::size_t k=(i>iBand ? i-iBand : 0); k<i; ++k)
+			vecB[i] -= U(k,i)*vecB[k];
+		vecB[i] /= U(i,i);
+	}
+
+	// U x = z
+	for(std::size_t i=N; i-- > 0;)
+	{
+		for(std::size_t j=i+1; j<std::min(N, i+W); ++j)
+			vecB[i] -= U(i,j)*vecB[j];
+		vecB[i] /= U(i,i);
+	}
+
+	return true;
+}
+
+
+template<class T>
+SmoothSpline<T>::SmoothSpline(std::size_t N, const T *px, const T *py, T dLambda,
+	const T *pw, std::size_t iSegments)
+{
+	constexpr unsigned int DEG = 3;
+
+	std::vector<std::size_t> vecIdx(N);
+	for(std::size_t i=0; i<N; ++i)
+		vecIdx[i] = i;
+	std::stable_sort(vecIdx.begin(), vecIdx.end(),
+		[px](std::size_t i, std::size_t j) -> bool { return px[i] < px[j]; });
+
+	if(N < 2 || !(px[vecIdx.front()] < px[vecIdx.back()]))
+	{
+		log_err("Smoothing spline needs at least two distinct x values.");
+		return;
+	}
+	const T xmin = px[vecIdx.front()], xmax = px[vecIdx.back()];
+
+	// clamped knot vector
+	m_vecKnots.assign(DEG+1, xmin);
+	if(iSegments == 0)
+	{
+		std::vector<T> vecInner;
+		for(std::size_t i : vecIdx)
+		{
+			if(px[i] > xmin && px[i] < xmax && (vecInner.empty() || px[i] > vecInner.back()))
+				vecInner.push_back(px[i]);
+		}
+
+		// thin out the knots for dense data
+		const std::size_t iStride = vecInner.size() / MAX_DATA_KNOTS + 1;
+		for(std::size_t i=iStride/2; i<vecInner.size(); i+=iStride)
+			m_vecKnots.push_back(vecInner[i]);
+	}
+	else
+	{
+		for(std::size_t iSeg=1; iSeg<iSegments; ++iSeg)
+			m_vecKnots.push_back(xmin + (xmax-xmin)*T(iSeg)/T(iSegments));
+	}
+	m_vecKnots.insert(m_vecKnots.end(), DEG+1, xmax);
+	const std::size_t iNumBasis = m_vecKnots.size() - DEG - 1;
+
+	// normal equations, banded with DEG upper diagonals
+	std::vector<T> vecA(iNumBasis*(DEG+1), T(0)), vecB(iNumBasis, T(0));
+	auto add = [&vecA](std::size_t i, std::size_t j, T val) -> void { vecA[i*(DEG+1) + (j-i)] += val; };
+	T basis[DEG+1];
+
+	std::size_t iSpan = DEG;
+	for(std::size_t i : vecIdx)
+	{
+		iSpan = bspline_span(iNumBasis, DEG, px[i], m_vecKnots);
+		bspline_basis(iSpan, DEG, px[i], m_vecKnots, basis);
+		const T w = pw ? pw[i] : T(1);
+
+		for(unsigned int a=0; a<=DEG; ++a)
+		{
+			vecB[iSpan-DEG+a] += w * basis[a] * py[i];
+			for(unsigned int b=a; b<=DEG; ++b)
+				add(iSpan-DEG+a, iSpan-DEG+b, w * basis[a] * basis[b]);
+		}
+	}
+
+	// roughness penalty, f'' is linear in each span, so 2-point Gauss quadrature is exact
+	const T dNode = T(1) / std::sqrt(T(3));
+	for(iSpan=DEG; iSpan<iNumBasis; ++iSpan)
+	{
+		const T h = m_vecKnots[iSpan+1] - m_vecKnots[iSpan];
+		if(h <= T(0))
+			continue;
+
+		for(T dPos : { -dNode, dNode })
+		{
+			const T x = m_vecKnots[iSpan] + T(0.5)*h*(T(1) + dPos);
+			bspline_basis(iSpan, DEG, x, m_vecKnots, basis, 2);
+
+			for(unsigned int a=0; a<=DEG; ++a)
+				for(unsigned int b=a; b<=DEG; ++b)
+					add(iSpan-DEG+a, iSpan-DEG+b, dLambda * T(0.5)*h * basis[a] * basis[b]);
+		}
+	}
+
+	if(!_band_cholesky_solve(vecA, vecB, iNumBasis, DEG))
+	{
+		log_err("Smoothing spline system is singular, increase lambda or reduce the number of segments.");
+		return;
+	}
+	m_vecCoeffs = std::move(vecB);
+}
+
+template<class T>
+T SmoothSpline<T>::operator()(T x) const
+{
+	T y = T(0);
+	eval_n(&x, 1, &y);
+	return y;
+}
+
+template<class T>
+void SmoothSpline<T>::eval_n(const T* px, std::size_t n, T* py, unsigned int iDeriv) const
+{
+	if(!IsOk())
+	{
+		std::fill(py, py+n, T(0));
+		return;
+	}
+
+	tl::bspline_n<T>(m_vecCoeffs.data(), m_vecCoeffs.size(), 1, m_vecKnots, px, n, py, iDeriv);
 }
 
 // ----------------------------------------------------------------------------
 
+/**
+ * finds peaks using a spline through all data points
+ * @see PeakFinder for long spectra
+ */
 template<typename T>
 void find_peaks(std::size_t iLen, const T* px, const T* py, unsigned int iOrder,
 	std::vector<T>& vecMaximaX, std::vector<T>& vecMaximaSize, std::vector<T>& vecMaximaWidth)
@@ -298,14 +925,10 @@ void find_peaks(std::size_t iLen, const T* px, const T* py, unsigned int iOrder,
 
 	const T* pdyMin = std::min_element(py, py+iLen);
 
+	std::vector<T> vecT(iNumSpline);
 	for(std::size_t iSpline=0; iSpline<iNumSpline; ++iSpline)
-	{
-		const T dT = T(iSpline) / T(iNumSpline-1);
-		ublas::vector<T> vec = spline(dT);
-
-		pSplineX[iSpline] = vec[0];
-		pSplineY[iSpline] = vec[1];
-	}
+		vecT[iSpline] = T(iSpline) / T(iNumSpline-1);
+	spline.eval_n(vecT.data(), iNumSpline, pSplineX, pSplineY);
 
 	tl::diff(iNumSpline, pSplineX, pSplineY, pSplineDiff);
 	tl::diff(iNumSpline, pSplineX, pSplineDiff, pSplineDiff2);
@@ -375,11 +998,13 @@ void find_peaks(std::size_t iLen, const T* px, const T* py, unsigned int iOrder,
 
 
 
-	std::ostringstream ostrDbg;
-	ostrDbg << "Prefitter found peaks at: ";
-	for(T dValX : vecMaximaX)
-		ostrDbg << dValX << ", ";
-	log_debug(ostrDbg.str());
+	TLIBS_LOG_DEBUG("Prefitter found peaks at: ", log_lazy([&vecMaximaX]() -> std::string
+	{
+		std::ostringstream ostrDbg;
+		for(T dValX : vecMaximaX)
+			ostrDbg << dValX << ", ";
+		return ostrDbg.str();
+	}));
 
 
 	delete[] pSplineX;
@@ -387,6 +1012,344 @@ void find_peaks(std::size_t iLen, const T* px, const T* py, unsigned int iOrder,
 	delete[] pSplineDiff;
 	delete[] pSplineDiff2;
 }
+
+
+
+// ----------------------------------------------------------------------------
+// peak search using smoothed derivatives
+
+/**
+ * Savitzky-Golay coefficients for the iDeriv-th derivative at the centre of a
+ * window of 2*iHalfWidth+1 equidistant points with unit spacing:
+ *   y^(iDeriv)_i = sum_j c_j * y_(i+j),  j = -iHalfWidth .. iHalfWidth
+ * the values are those of a least-squares polynomial of order iOrder through the window
+ * @see A. Savitzky and M. J. E. Golay, Anal. Chem. 36(8), pp. 1627-1639 (1964), doi: https://doi.org/10.1021/ac60214a047
+ */
+template<typename T>
+std::vector<T> savitzky_golay(unsigned int iHalfWidth, unsigned int iOrder, unsigned int iDeriv=0)
+{
+	const std::size_t iWindow = 2*iHalfWidth + 1;
+	if(iOrder >= iWindow || iDeriv > iOrder)
+	{
+		log_err("Invalid Savitzky-Golay parameters: window ", iWindow,
+			", order ", iOrder, ", derivative ", iDeriv, ".");
+		return std::vector<T>();
+	}
+
+	// normal equations in scaled coordinates u = j / iHalfWidth
+	const T dScale = T(std::max(iHalfWidth, 1u));
+	ublas::matrix<T> matATA = ublas::zero_matrix<T>(iOrder+1, iOrder+1);
+	for(int j=-int(iHalfWidth); j<=int(iHalfWidth); ++j)
+	{
+		const T u = T(j) / dScale;
+		for(unsigned int k=0; k<=iOrder; ++k)
+			for(unsigned int l=0; l<=iOrder; ++l)
+				matATA(k,l) += std::pow(u, T(k+l));
+	}
+
+	// only row iDeriv of the inverse is needed
+	ublas::matrix<T> matInv;
+	if(!inverse(matATA, matInv))
+	{
+		log_err("Cannot calculate Savitzky-Golay coefficients.");
+		return std::vector<T>();
+	}
+
+	const T dFact = boost::math::factorial<T>(iDeriv) / std::pow(dScale, T(iDeriv));
+	std::vector<T> vecCoeffs(iWindow);
+	for(int j=-int(iHalfWidth); j<=int(iHalfWidth); ++j)
+	{
+		const T u = T(j) / dScale;
+		T dVal = T(0);
+		for(unsigned int k=0; k<=iOrder; ++k)
+			dVal += matInv(iDeriv, k) * std::pow(u, T(k));
+		vecCoeffs[j + int(iHalfWidth)] = dFact * dVal;
+	}
+
+	return vecCoeffs;
+}
+
+
+/**
+ * properties of a peak found by PeakFinder
+ */
+template<class T=double>
+struct PeakInfo
+{
+	std::size_t iIdx = 0;		// index of the data point nearest to the maximum
+	T dX = T(0);			// position of the maximum
+	T dHeight = T(0);		// smoothed value at the maximum
+	T dProminence = T(0);	// height above the higher of the two bases
+	T dWidth = T(0);		// fwhm estimated from the curvature and prominence
+	T dBaseLeft = T(0);		// lowest value between the peak and a higher one to the left
+	T dBaseRight = T(0);	// lowest value between the peak and a higher one to the right
+};
+
+
+/**
+ * peak search in a single pass over a spectrum
+ *
+ * maxima are the zero crossings of the Savitzky-Golay smoothed derivative.
+ * the prominence is tracked on a stack of the peaks which have no higher
+ * peak to their right yet, so that the bases of each peak are known
+ * as soon as a higher peak (or the end of the data) is reached.
+ * the coefficients are calculated once in the constructor.
+ * @see https://en.wikipedia.org/wiki/Topographic_prominence
+ */
+template<class T=double>
+class PeakFinder
+{
+protected:
+	unsigned int m_iHalfWidth = 0;
+	std::vector<T> m_vecSmooth, m_vecDiff, m_vecDiff2;
+
+	T m_dMinProminence = T(0);
+	T m_dMinHeight = -std::numeric_limits<T>::max();
+	T m_dMinWidth = T(0);
+	T m_dMaxWidth = std::numeric_limits<T>::max();
+
+	// peak candidate on the prominence stack
+	struct t_cand
+	{
+		PeakInfo<T> peak;
+		T dMinAfter;	// lowest value after the peak up to the next stack element
+	};
+
+protected:
+	/**
+	 * filter value at index i, the data is continued with its end values
+	 */
+	static T conv(const std::vector<T>& vecCoeffs, const T* py, std::size_t iLen,
+		std::size_t i, unsigned int iHalfWidth)
+	{
+		T dVal = T(0);
+		const T* pCoeffs = vecCoeffs.data();
+
+		if(i >= iHalfWidth && i+iHalfWidth < iLen)
+		{
+			const T* pWnd = py + i - iHalfWidth;
+			for(std::size_t j=0; j<vecCoeffs.size(); ++j)
+				dVal += pCoeffs[j] * pWnd[j];
+		}
+		else
+		{
+			for(std::size_t j=0; j<vecCoeffs.size(); ++j)
+			{
+				std::ptrdiff_t iIdx = std::ptrdiff_t(i + j) - std::ptrdiff_t(iHalfWidth);
+				iIdx = clamp<std::ptrdiff_t>(iIdx, 0, std::ptrdiff_t(iLen)-1);
+				dVal += pCoeffs[j] * py[iIdx];
+			}
+		}
+
+		return dVal;
+	}
+
+	/**
+	 * smoothed values and first derivatives for the indices [iStart, iStart+iNum[,
+	 * uses the (anti-)symmetry of the coefficients, c_-j = c_j and c'_-j = -c'_j
+	 */
+	void smooth_block(const T* py, std::size_t iLen, std::size_t iStart, std::size_t iNum,
+		T* pY, T* pDiff) const
+	{
+		const std::size_t iEnd = iStart + iNum;
+		const unsigned int iHalfWidth = m_iHalfWidth;
+
+		// range in which the window is completely inside the data
+		const std::size_t iInnerStart = clamp<std::size_t>(iHalfWidth, iStart, iEnd);
+		const std::size_t iInnerEnd = std::max(iInnerStart,
+			clamp<std::size_t>(iLen > iHalfWidth ? iLen-iHalfWidth : 0, iStart, iEnd));
+
+		for(std::size_t i=iStart; i<iInnerStart; ++i)
+		{
+			pY[i-iStart] = conv(m_vecSmooth, py, iLen, i, iHalfWidth);
+			pDiff[i-iStart] = conv(m_vecDiff, py, iLen, i, iHalfWidth);
+		}
+		for(std::size_t i=iInnerEnd; i<iEnd; ++i)
+		{
+			pY[i-iStart] = conv(m_vecSmooth, py, iLen, i, iHalfWidth);
+			pDiff[i-iStart] = conv(m_vecDiff, py, iLen, i, iHalfWidth);
+		}
+
+		const T* pSmooth = m_vecSmooth.data() + iHalfWidth;
+		const T* pDiffCoeff = m_vecDiff.data() + iHalfWidth;
+
+		for(std::size_t i=iInnerStart; i<iInnerEnd; ++i)
+		{
+			T dY = pSmooth[0] * py[i];
+			T dDiff = T(0);
+
+			for(unsigned int j=1; j<=iHalfWidth; ++j)
+			{
+				const T yRight = py[i+j], yLeft = py[i-j];
+				dY += pSmooth[j] * (yRight + yLeft);
+				dDiff += pDiffCoeff[j] * (yRight - yLeft);
+			}
+
+			pY[i-iStart] = dY;
+			pDiff[i-iStart] = dDiff;
+		}
+	}
+
+	/**
+	 * local x spacing at index i
+	 */
+	static T spacing(const T* px, std::size_t iLen, std::size_t i)
+	{
+		if(!px || iLen < 2) return T(1);
+		const std::size_t i0 = (i > 0) ? i-1 : 0;
+		const std::size_t i1 = std::min(i+1, iLen-1);
+		return (px[i1] - px[i0]) / T(i1 - i0);
+	}
+
+	/**
+	 * completes a peak whose right base is known and checks the filter criteria
+	 */
+	void finish(t_cand& cand, T dBaseRight, std::size_t iLen, const T* px, const T* py,
+		std::vector<PeakInfo<T>>& vecPeaks) const
+	{
+		PeakInfo<T>& peak = cand.peak;
+		peak.dBaseRight = dBaseRight;
+		peak.dProminence = peak.dHeight - std::max(peak.dBaseLeft, peak.dBaseRight);
+
+		if(peak.dProminence < m_dMinProminence || peak.dHeight < m_dMinHeight)
+			return;
+
+		// gaussian: y'' = -A / sigma^2 at the maximum
+		const T dSpacing = spacing(px, iLen, peak.iIdx);
+		const T dCurv = conv(m_vecDiff2, py, iLen, peak.iIdx, m_iHalfWidth) / (dSpacing*dSpacing);
+		if(dCurv < T(0) && peak.dProminence > T(0))
+			peak.dWidth = get_SIGMA2FWHM<T>() * std::sqrt(-peak.dProminence / dCurv);
+
+		if(peak.dWidth < m_dMinWidth || peak.dWidth > m_dMaxWidth)
+			return;
+
+		vecPeaks.push_back(peak);
+	}
+
+
+public:
+	/**
+	 * @param iHalfWidth smoothing window of 2*iHalfWidth+1 points
+	 * @param iOrder order of the smoothing polynomial, at least 2
+	 */
+	PeakFinder(unsigned int iHalfWidth = 5, unsigned int iOrder = 3)
+		: m_iHalfWidth(iHalfWidth)
+	{
+		iOrder = std::max(iOrder, 2u);
+		m_vecSmooth = savitzky_golay<T>(iHalfWidth, iOrder, 0);
+		m_vecDiff = savitzky_golay<T>(iHalfWidth, iOrder, 1);
+		m_vecDiff2 = savitzky_golay<T>(iHalfWidth, iOrder, 2);
+	}
+
+	bool IsOk() const { return m_vecSmooth.size() && m_vecDiff.size() && m_vecDiff2.size(); }
+
+	void SetMinProminence(T d) { m_dMinProminence = d; }
+	void SetMinHeight(T d) { m_dMinHeight = d; }
+	void SetWidthRange(T dMin, T dMax) { m_dMinWidth = dMin; m_dMaxWidth = dMax; }
+
+
+	/**
+	 * finds the peaks in a spectrum, sorted by position
+	 * @param px x values (increasing), or nullptr to use the indices
+	 */
+	void find(std::size_t iLen, const T* px, const T* py, std::vector<PeakInfo<T>>& vecPeaks) const
+	{
+		vecPeaks.clear();
+		if(!IsOk() || iLen < 3)
+			return;
+
+		// the bottom element stands for the start of the data
+		std::vector<t_cand> vecStack;
+		vecStack.reserve(64);
+		t_cand candStart;
+		candStart.peak.dHeight = std::numeric_limits<T>::infinity();
+		candStart.dMinAfter = std::numeric_limits<T>::infinity();
+		vecStack.push_back(candStart);
+
+		// smoothed values and derivatives of the current block
+		constexpr std::size_t BLOCK = 256;
+		T bufY[BLOCK], bufDiff[BLOCK];
+		T dPrevY = T(0), dPrevDiff = T(0);
+
+		for(std::size_t iBlock=0; iBlock<iLen; iBlock+=BLOCK)
+		{
+			const std::size_t iNum = std::min(BLOCK, iLen-iBlock);
+			smooth_block(py, iLen, iBlock, iNum, bufY, bufDiff);
+
+			for(std::size_t iBuf=0; iBuf<iNum; ++iBuf)
+			{
+				const std::size_t i = iBlock + iBuf;
+				const T dY = bufY[iBuf];
+				const T dDiff = bufDiff[iBuf];
+
+				// maximum between i-1 and i
+				if(i > 0 && dPrevDiff > T(0) && dDiff <= T(0))
+				{
+					t_cand cand;
+					PeakInfo<T>& peak = cand.peak;
+					peak.iIdx = (dPrevY >= dY) ? i-1 : i;
+					peak.dHeight = std::max(dPrevY, dY);
+
+					const T dFrac = dPrevDiff / (dPrevDiff - dDiff);
+					peak.dX = px ? px[i-1] + dFrac*(px[i]-px[i-1]) : T(i-1) + dFrac;
+
+					// lower or equal peaks to the left get their right base
+					T dMin = vecStack.back().dMinAfter;
+					while(vecStack.back().peak.dHeight <= peak.dHeight)
+					{
+						finish(vecStack.back(), dMin, iLen, px, py, vecPeaks);
+						vecStack.pop_back();
+						dMin = std::min(dMin, vecStack.back().dMinAfter);
+					}
+
+					vecStack.back().dMinAfter = dMin;
+					peak.dBaseLeft = dMin;
+					cand.dMinAfter = std::numeric_limits<T>::infinity();
+					vecStack.push_back(cand);
+				}
+
+				vecStack.back().dMinAfter = std::min(vecStack.back().dMinAfter, dY);
+				dPrevY = dY;
+				dPrevDiff = dDiff;
+			}
+		}
+
+		// remaining peaks have no higher one to their right
+		T dMin = vecStack.back().dMinAfter;
+		while(vecStack.size() > 1)
+		{
+			finish(vecStack.back(), dMin, iLen, px, py, vecPeaks);
+			vecStack.pop_back();
+			dMin = std::min(dMin, vecStack.back().dMinAfter);
+		}
+
+		std::sort(vecPeaks.begin(), vecPeaks.end(),
+			[](const PeakInfo<T>& peak1, const PeakInfo<T>& peak2) -> bool
+			{ return peak1.iIdx < peak2.iIdx; });
+	}
+
+
+	/**
+	 * finds the peaks in iSpectra spectra (e.g. one per detector pixel),
+	 * spectrum i starts at pY + i*iStride and all share the x values
+	 * (iThreads == 0 uses all hardware threads)
+	 */
+	void find_n(std::size_t iLen, const T* px, const T* pY, std::size_t iSpectra,
+		std::vector<std::vector<PeakInfo<T>>>& vecPeaks,
+		unsigned int iThreads = 0, std::size_t iStride = 0) const
+	{
+		if(iStride == 0)
+			iStride = iLen;
+
+		vecPeaks.resize(iSpectra);
+		run_stripes(iSpectra, get_num_threads(iSpectra, iThreads),
+			[&](std::size_t iStart, std::size_t iEnd) -> void
+		{
+			for(std::size_t iSpec=iStart; iSpec<iEnd; ++iSpec)
+				find(iLen, px, pY + iSpec*iStride, vecPeaks[iSpec]);
+		});
+	}
+};
 }
 
 #endif
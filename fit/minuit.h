@@ -67,8 +67,12 @@ protected:
 	const t_real* m_py = nullptr;
 	const t_real* m_pdy = nullptr;
 
+	// optional weights, 0 masks out a data point
+	const t_real* m_pw = nullptr;
+
 	t_real_min m_dSigma = 1.;
 	bool m_bDebug = 0;
+	unsigned int m_iThreads = 1;
 
 public:
 	Chi2Function(const MinuitFuncModel* fkt=0,
@@ -95,7 +99,8 @@ public:
 		//if(!bParamsOk)
 		//	return std::numeric_limits<t_real_min>::max();
 
-		return tl::chi2<t_real_min, decltype(*pfkt), const t_real*>(*pfkt, m_uiLen, m_px, m_py, m_pdy);
+		return tl::chi2<t_real_min, decltype(*pfkt), const t_real*>(*pfkt, m_uiLen, m_px, m_py, m_pdy,
+			m_pw, m_iThreads);
 	}
 
 	virtual t_real_min Up() const override { return m_dSigma*m_dSigma; }
@@ -103,7 +108,7 @@ public:
 	virtual t_real_min operator()(const std::vector<t_real_min>& vecParams) const override
 	{
 		t_real_min dChi2 = chi2(vecParams);
-		if(m_bDebug) tl::log_debug("Chi2 = ", dChi2);
+		if(m_bDebug) TLIBS_LOG_DEBUG("Chi2 = ", dChi2);
 		return dChi2;
 	}
 
@@ -111,6 +116,13 @@ public:
 	t_real_min GetSigma() const { return m_dSigma; }
 
 	void SetDebug(bool b) { m_bDebug = b; }
+
+	void SetWeights(const t_real* pw) { m_pw = pw; }
+
+	/**
+	 * threads for the chi^2 sum, the model has to be thread-safe for iThreads != 1
+	 */
+	void SetNumThreads(unsigned int iThreads) { m_iThreads = iThreads; }
 };
 
 
@@ -212,7 +224,7 @@ public:
 			dChi += dSingleChi;
 
 			if(m_bDebug && iNumParamSets>1)
-				tl::log_debug("Function ", iParamSet, " chi2 = ", dSingleChi);
+				TLIBS_LOG_DEBUG("Function ", iParamSet, " chi2 = ", dSingleChi);
 		}
 		dChi /= t_real_min(iNumParamSets);
 		return dChi;
@@ -227,7 +239,7 @@ public:
 			dChi += dSingleChi;
 
 			if(m_bDebug && m_vecFkt.size()>1)
-				tl::log_debug("Function ", iFkt, " chi2 = ", dSingleChi);
+				TLIBS_LOG_DEBUG("Function ", iFkt, " chi2 = ", dSingleChi);
 		}
 		dChi /= t_real_min(m_vecFkt.size());
 		return dChi;
@@ -238,7 +250,7 @@ public:
 	virtual t_real_min operator()(const std::vector<t_real_min>& vecParams) const override
 	{
 		t_real_min dChi2 = chi2(vecParams);
-		if(m_bDebug) tl::log_debug("Total chi2 = ", dChi2);
+		if(m_bDebug) TLIBS_LOG_DEBUG("Total chi2 = ", dChi2);
 		return dChi2;
 	}
 
@@ -266,7 +278,11 @@ protected:
 	const t_cont<t_real> *m_pvecY = nullptr;
 	const t_cont<t_real> *m_pvecDY = nullptr;
 
+	// optional weights, 0 masks out a data point
+	const t_cont<t_real> *m_pvecW = nullptr;
+
 	bool m_bDebug = 0;
+	unsigned int m_iThreads = 1;
 
 public:
 	Chi2Function_nd(const MinuitFuncModel_nd* fkt,
@@ -285,7 +301,7 @@ public:
 		pfkt->SetParams(vecParams);
 
 		return tl::chi2_nd<t_real_min, t_real, decltype(*pfkt), t_cont>
-			(*pfkt, *m_pvecvecX, *m_pvecY, *m_pvecDY);
+			(*pfkt, *m_pvecvecX, *m_pvecY, *m_pvecDY, m_pvecW, m_iThreads);
 	}
 
 	virtual t_real_min Up() const override
@@ -297,11 +313,18 @@ public:
 	virtual t_real_min operator()(const std::vector<t_real_min>& vecParams) const override
 	{
 		t_real_min dChi2 = chi2(vecParams);
-		if(m_bDebug) tl::log_debug("Chi2 = ", dChi2);
+		if(m_bDebug) TLIBS_LOG_DEBUG("Chi2 = ", dChi2);
 		return dChi2;
 	}
 
 	void SetDebug(bool b) { m_bDebug = b; }
+
+	void SetWeights(const t_cont<t_real>* pvecW) { m_pvecW = pvecW; }
+
+	/**
+	 * threads for the chi^2 sum, the model has to be thread-safe for iThreads != 1
+	 */
+	void SetNumThreads(unsigned int iThreads) { m_iThreads = iThreads; }
 };
 
 
@@ -363,7 +386,7 @@ bool fit(t_func&& func,
 		}
 
 		if(bDebug)
-			tl::log_debug(mini);
+			TLIBS_LOG_DEBUG(mini);
 
 		return bValidFit;
 	}
@@ -416,7 +439,7 @@ bool minimise(t_func&& func, const std::vector<std::string>& vecParamNames,
 		}
 
 		if(bDebug)
-			tl::log_debug(mini);
+			TLIBS_LOG_DEBUG(mini);
 
 		return bMinimumValid;
 	}
@@ -10,8 +10,13 @@
 
 #include <boost/optional.hpp>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "../helper/proc.h"
 
 
@@ -41,6 +46,102 @@ struct PlotObj
 };
 
 
+/**
+ * writes plots to the gnuplot pipe from a background thread.
+ * one plot can be waiting while another one is written (double buffering);
+ * a waiting plot is replaced (dropped) if a newer one arrives, its commands are kept.
+ */
+class GnuPlotFeeder
+{
+protected:
+	std::ostream& m_ostr;
+
+	std::mutex m_mtx;
+	std::condition_variable m_condPending, m_condIdle;
+
+	// waiting commands and plot
+	std::string m_strCmds, m_strPlot;
+	bool m_bPending = 0, m_bBusy = 0, m_bStop = 0;
+	std::size_t m_iDropped = 0;
+
+	std::thread m_thread;
+
+	void Run()
+	{
+		std::string strCmds, strPlot;
+
+		while(1)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mtx);
+				m_bBusy = 0;
+				m_condIdle.notify_all();
+
+				m_condPending.wait(lock, [this]() -> bool { return m_bPending || m_bStop; });
+				if(!m_bPending)
+					break;
+
+				strCmds.swap(m_strCmds);
+				strPlot.swap(m_strPlot);
+				m_strCmds.clear();
+				m_strPlot.clear();
+				m_bPending = 0;
+				m_bBusy = 1;
+			}
+
+			m_ostr.write(strCmds.data(), strCmds.size());
+			m_ostr.write(strPlot.data(), strPlot.size());
+			m_ostr.flush();
+		}
+	}
+
+public:
+	GnuPlotFeeder(std::ostream& ostr) : m_ostr(ostr), m_thread(&GnuPlotFeeder::Run, this) {}
+
+	~GnuPlotFeeder()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_bStop = 1;
+		}
+		m_condPending.notify_one();
+		m_thread.join();
+	}
+
+	/**
+	 * queues a plot, strPlot gets swapped with a free buffer
+	 */
+	void Submit(const std::string& strCmds, std::string& strPlot)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if(m_bPending)
+				++m_iDropped;
+
+			m_strCmds += strCmds;
+			m_strPlot.swap(strPlot);
+			m_bPending = 1;
+		}
+		m_condPending.notify_one();
+	}
+
+	/**
+	 * waits until everything has been written
+	 */
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		m_condIdle.wait(lock, [this]() -> bool { return !m_bPending && !m_bBusy; });
+	}
+
+	std::size_t GetNumDropped()
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		return m_iDropped;
+	}
+};
+
+
 template<class t_real = double>
 class GnuPlot
 {
@@ -48,6 +149,14 @@ protected:
 	std::string m_strVersion;
 	std::unique_ptr<PipeProc<char>> m_pProc;
 
+	// send data in gnuplot's binary format
+	bool m_bBinary = true;
+
+	// asynchronous mode: commands are collected and sent along with the next plot
+	std::unique_ptr<GnuPlotFeeder> m_pFeeder;
+	std::ostringstream m_ostrAsyncCmds;
+	std::string m_strPlot;
+
 	std::vector<PlotObj<t_real>> m_vecObjs;
 	// has to be 0 to show plot
 	int m_iStartCounter = 0;
@@ -62,16 +171,21 @@ protected:
 	unsigned int m_iPrec = 8;
 
 protected:
-	std::string BuildCmd();
+	std::string BuildCmd(bool bBinary);
 	std::string BuildTable(const std::vector<t_real>& vecX, const std::vector<t_real>& vecY,
-		const std::vector<t_real>& vecYErr, const std::vector<t_real>& vecXErr);
+		const std::vector<t_real>& vecYErr, const std::vector<t_real>& vecXErr, bool bBinary=0);
+	std::string BuildBinarySpec(std::size_t iRecords, std::size_t iCols) const;
 	void RefreshVars();
+	void SendPlot();
 
 public:
 	GnuPlot() = default;
 	virtual ~GnuPlot() { DeInit(); }
 
-	bool Init();
+	/**
+	 * starts the plotter, strGplTool can be replaced by another program reading the commands
+	 */
+	bool Init(const std::string& strGplTool = "gnuplot");
 	void DeInit();
 
 	bool IsReady() const;
@@ -112,6 +226,21 @@ public:
 	void SetLegendPlace(const std::string& strPlace) { m_strLegendPlacement = strPlace; }
 
 	void SetPrec(unsigned int iPrec);
+
+	/**
+	 * binary data transfer, on by default
+	 */
+	void SetBinary(bool bBinary) { m_bBinary = bBinary; }
+	bool IsBinary() const { return m_bBinary; }
+
+	/**
+	 * asynchronous mode: plots are written to gnuplot from a background thread,
+	 * dropping plots that would have to wait behind another one
+	 */
+	void SetAsync(bool bAsync);
+	bool IsAsync() const { return m_pFeeder != nullptr; }
+	void WaitAsync();
+	std::size_t GetNumDroppedPlots();
 };
 
 }
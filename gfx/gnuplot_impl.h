@@ -13,29 +13,124 @@
 #include "../log/log.h"
 
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
 
 #include "gnuplot.h"
 
 
 namespace tl {
 
+/**
+ * appends the raw bytes of a value to a buffer
+ */
+template<class T>
+void _gpl_append_raw(std::string& str, T val)
+{
+	const std::size_t iPos = str.size();
+	str.resize(iPos + sizeof(T));
+	std::memcpy(&str[iPos], &val, sizeof(T));
+}
+
+
 template<class t_real>
 void GnuPlot<t_real>::DeInit()
 {
+	SetAsync(0);
+
 	m_iStartCounter = 0;
 	m_pProc.reset(nullptr);
 }
 
 
 template<class t_real>
-bool GnuPlot<t_real>::Init()
+void GnuPlot<t_real>::SetAsync(bool bAsync)
+{
+	if(bAsync)
+	{
+		if(!IsReady() || m_pFeeder)
+			return;
+
+		m_ostrAsyncCmds.str("");
+		m_ostrAsyncCmds.precision(m_iPrec);
+		m_pFeeder.reset(new GnuPlotFeeder(m_pProc->GetOstr()));
+	}
+	else if(m_pFeeder)
+	{
+		// writes the remaining plot and stops the thread
+		m_pFeeder.reset();
+		m_pProc->GetOstr().precision(m_iPrec);
+
+		const std::string strCmds = m_ostrAsyncCmds.str();
+		m_ostrAsyncCmds.str("");
+		m_pProc->GetOstr() << strCmds;
+		m_pProc->GetOstr().flush();
+	}
+}
+
+
+template<class t_real>
+void GnuPlot<t_real>::WaitAsync()
+{
+	if(m_pFeeder)
+		m_pFeeder->Wait();
+}
+
+
+template<class t_real>
+std::size_t GnuPlot<t_real>::GetNumDroppedPlots()
+{
+	return m_pFeeder ? m_pFeeder->GetNumDropped() : 0;
+}
+
+
+/**
+ * sends the plot in m_strPlot, in asynchronous mode together with the collected commands
+ */
+template<class t_real>
+void GnuPlot<t_real>::SendPlot()
+{
+	if(m_pFeeder)
+	{
+		m_pFeeder->Submit(m_ostrAsyncCmds.str(), m_strPlot);
+		m_ostrAsyncCmds.str("");
+	}
+	else
+	{
+		m_pProc->GetOstr().write(m_strPlot.data(), m_strPlot.size());
+		m_pProc->GetOstr().flush();
+	}
+
+	m_strPlot.clear();
+}
+
+
+/**
+ * binary format specifier for records of t_real values
+ */
+template<class t_real>
+std::string GnuPlot<t_real>::BuildBinarySpec(std::size_t iRecords, std::size_t iCols) const
+{
+	const char* pcType = (sizeof(t_real) == 8 ? "%float64" : "%float32");
+
+	std::ostringstream ostr;
+	ostr << "binary record=" << iRecords << " format=\"";
+	for(std::size_t iCol=0; iCol<iCols; ++iCol)
+		ostr << pcType;
+	ostr << "\" ";
+
+	return ostr.str();
+}
+
+
+template<class t_real>
+bool GnuPlot<t_real>::Init(const std::string& strGplTool)
 {
 	if(IsReady()) return true;
 	DeInit();
-	const std::string strGplTool = "gnuplot";
 
 
 	// get gnuplot version
@@ -76,20 +171,20 @@ void GnuPlot<t_real>::SetTerminal(int iWnd, const char* pcBackend, t_real dW, t_
 	if(!IsReady()) return;
 	if(m_bTermLocked) return;
 
-	m_pProc->GetOstr() << "set output\n";
-	m_pProc->GetOstr() << "set obj 1 rectangle behind fillcolor rgbcolor \"white\" from screen 0,0 to screen 1,1\n";
+	GetStream() << "set output\n";
+	GetStream() << "set obj 1 rectangle behind fillcolor rgbcolor \"white\" from screen 0,0 to screen 1,1\n";
 
-	m_pProc->GetOstr() << "set term " << pcBackend <<  " " << iWnd << " "
+	GetStream() << "set term " << pcBackend <<  " " << iWnd << " "
 		<< "enhanced font \"NimbusSanL-Regu,12\" persist dashed "
 //		<< "title \"" << "Plot " << (iWnd+1) << "\" noraise "
 		;
 
 	if(dW>=t_real(0) && dH>=t_real(0))
-		m_pProc->GetOstr() << "size " << dW << "," << dH << " ";
+		GetStream() << "size " << dW << "," << dH << " ";
 	else
-		m_pProc->GetOstr() << "size 640,480 ";
+		GetStream() << "size 640,480 ";
 
-	m_pProc->GetOstr() << "\n";
+	GetStream() << "\n";
 }
 
 
@@ -104,21 +199,21 @@ void GnuPlot<t_real>::SetFileTerminal(const char* pcFile, t_real dW, t_real dH)
 
 	if(str_is_equal(strExt, std::string("pdf"), 0))
 	{
-		m_pProc->GetOstr() << "set term pdf "
+		GetStream() << "set term pdf "
 			<< "enhanced color font \"NimbusSanL-Regu,16\" ";
 
 		if(dW>=t_real(0) && dH>=t_real(0))
-			m_pProc->GetOstr() << "size " << dW << "," << dH << " ";
-		m_pProc->GetOstr() << "\n";
+			GetStream() << "size " << dW << "," << dH << " ";
+		GetStream() << "\n";
 	}
 	else if(str_is_equal(strExt, std::string("ps"), 0))
 	{
-		m_pProc->GetOstr() << "set term postscript eps "
+		GetStream() << "set term postscript eps "
 			<< "enhanced color font \"NimbusSanL-Regu,16\" ";
 
 		if(dW>=t_real(0) && dH>=t_real(0))
-			m_pProc->GetOstr() << "size " << dW << "," << dH << " ";
-		m_pProc->GetOstr() << "\n";
+			GetStream() << "size " << dW << "," << dH << " ";
+		GetStream() << "\n";
 	}
 	else
 	{
@@ -126,7 +221,7 @@ void GnuPlot<t_real>::SetFileTerminal(const char* pcFile, t_real dW, t_real dH)
 		return;
 	}
 
-	m_pProc->GetOstr() << "set output \"" << strFile << "\"\n";
+	GetStream() << "set output \"" << strFile << "\"\n";
 }
 
 
@@ -136,7 +231,10 @@ void GnuPlot<t_real>::SetPrec(unsigned int iPrec)
 	if(!IsReady()) return;
 
 	m_iPrec = iPrec;
-	if(m_pProc)
+	m_ostrAsyncCmds.precision(m_iPrec);
+
+	// the feeder thread owns the pipe stream, it gets the precision in SetAsync(0)
+	if(!m_pFeeder)
 		m_pProc->GetOstr().precision(m_iPrec);
 }
 
@@ -147,10 +245,10 @@ void GnuPlot<t_real>::RefreshVars()
 	if(!IsReady()) return;
 
 	if(m_bHasLegend)
-		m_pProc->GetOstr() << "set key on " << m_strLegendPlacement
+		GetStream() << "set key on " << m_strLegendPlacement
 			<< " box 1 " << m_strLegendOpts << "\n";
 	else
-		m_pProc->GetOstr() << "set nokey\n";
+		GetStream() << "set nokey\n";
 }
 
 
@@ -160,25 +258,31 @@ void GnuPlot<t_real>::SimplePlot(const std::vector<t_real>& vecX, const std::vec
 	LineStyle style)
 {
 	if(!IsReady()) return;
-	m_pProc->GetOstr() << "plot \"-\" ";
+
+	const std::size_t iSize = std::min(vecX.size(), vecY.size());
+	const bool bBinary = m_bBinary && iSize;
+	const std::size_t iCols = 2 + (vecXErr.size() ? 1 : 0) + (vecYErr.size() ? 1 : 0);
+
+	m_strPlot = "plot \"-\" ";
+	if(bBinary)
+		m_strPlot += BuildBinarySpec(iSize, iCols);
 
 	switch(style)
 	{
 		case STYLE_LINES_SOLID:
-			m_pProc->GetOstr() << "using ($1):($2) with lines linetype 1 linewidth 1 ";
+			m_strPlot += "using ($1):($2) with lines linetype 1 linewidth 1 ";
 			break;
 		case STYLE_LINES_DASHED:
-			m_pProc->GetOstr() << "using ($1):($2) with lines linetype 2 linewidth 1 ";
+			m_strPlot += "using ($1):($2) with lines linetype 2 linewidth 1 ";
 			break;
 		default:
 		case STYLE_POINTS:
 			break;
 	}
-	m_pProc->GetOstr() << "\n";
+	m_strPlot += "\n";
 
-	std::string strTable = BuildTable(vecX, vecY, vecYErr, vecXErr);
-	m_pProc->GetOstr() << strTable;
-	m_pProc->GetOstr().flush();
+	m_strPlot += BuildTable(vecX, vecY, vecYErr, vecXErr, bBinary);
+	SendPlot();
 }
 
 
@@ -196,6 +300,8 @@ void GnuPlot<t_real>::SimplePlot2d(const std::vector<std::vector<t_real> >& vec,
 
 	std::vector<std::size_t>::iterator iterMin =
 		std::min_element(vecSizes.begin(), vecSizes.end());
+	if(iterMin == vecSizes.end() || *iterMin == 0)
+		return;
 	std::size_t iXCntMin = *iterMin;
 
 
@@ -216,44 +322,65 @@ void GnuPlot<t_real>::SimplePlot2d(const std::vector<std::vector<t_real> >& vec,
 
 	// ----------------------------------------
 	// ranges
-	m_pProc->GetOstr() << "set tics out scale 0.75\n";
+	GetStream() << "set tics out scale 0.75\n";
 
 	t_real dRangeMinX = tic_trafo<t_real>(iXDim, dMinX, dMaxX, 0, -0.5);
 	t_real dRangeMaxX = tic_trafo<t_real>(iXDim, dMinX, dMaxX, 0, t_real(iXDim)-0.5);
 	t_real dRangeMinY = tic_trafo<t_real>(iYDim, dMinY, dMaxY, 0, -0.5);
 	t_real dRangeMaxY = tic_trafo<t_real>(iYDim, dMinY, dMaxY, 0, t_real(iYDim)-0.5);
 
-	m_pProc->GetOstr() << "set xrange [" << dRangeMinX << ":" << dRangeMaxX << "]\n";
-	m_pProc->GetOstr() << "set yrange [" << dRangeMinY << ":" << dRangeMaxY << "]\n";
+	GetStream() << "set xrange [" << dRangeMinX << ":" << dRangeMaxX << "]\n";
+	GetStream() << "set yrange [" << dRangeMinY << ":" << dRangeMaxY << "]\n";
 	// ----------------------------------------
 
-	// ----------------------------------------
-	// tics
-	std::ostringstream ostrTics;
-	ostrTics.precision(m_iPrec);
-
-	ostrTics << "using (" << dMinX << " + " << "($1)/" << iXDim
-		<< " * (" << dMaxX << "-" << dMinX << "))" << " : "
-		<< "(" << dMinY << " + " << "($2)/" << iYDim
-		<< " * (" << dMaxY << "-" << dMinY << "))" << " : ($3)";
+	std::ostringstream ostrPlot;
+	ostrPlot.precision(m_iPrec);
 
-	std::string strTics = ostrTics.str();
-	// ----------------------------------------
+	if(m_bBinary)
+	{
+		// pixel (iX, iY) is centred at origin + (iX*dx, iY*dy)
+		ostrPlot << "plot \"-\" binary array=(" << iXDim << "," << iYDim << ")"
+			<< " format=\"%float32\""
+			<< " origin=(" << dMinX << "," << dMinY << ")"
+			<< " dx=" << (dMaxX-dMinX)/t_real(iXDim)
+			<< " dy=" << (dMaxY-dMinY)/t_real(iYDim)
+			<< " with image\n";
+		m_strPlot = ostrPlot.str();
+
+		m_strPlot.reserve(m_strPlot.size() + iXDim*iYDim*sizeof(float));
+		for(std::size_t iY=0; iY<iYDim; ++iY)
+			for(std::size_t iX=0; iX<iXDim; ++iX)
+				_gpl_append_raw<float>(m_strPlot, float(vec[iY][iX]));
+	}
+	else
+	{
+		// ----------------------------------------
+		// tics
+		std::ostringstream ostrTics;
+		ostrTics.precision(m_iPrec);
 
-	m_pProc->GetOstr() << "plot \"-\" " << strTics << " matrix with image\n";
+		ostrTics << "using (" << dMinX << " + " << "($1)/" << iXDim
+			<< " * (" << dMaxX << "-" << dMinX << "))" << " : "
+			<< "(" << dMinY << " + " << "($2)/" << iYDim
+			<< " * (" << dMaxY << "-" << dMinY << "))" << " : ($3)";
 
+		std::string strTics = ostrTics.str();
+		// ----------------------------------------
 
-	for(std::size_t iY=0; iY<vec.size(); ++iY)
-	{
-		for(std::size_t iX=0; iX<iXCntMin; ++iX)
-			m_pProc->GetOstr() << vec[iY][iX] << " ";
-		m_pProc->GetOstr() << "\n";
-	}
+		ostrPlot << "plot \"-\" " << strTics << " matrix with image\n";
 
-	m_pProc->GetOstr() << "end\nend\n";
+		for(std::size_t iY=0; iY<iYDim; ++iY)
+		{
+			for(std::size_t iX=0; iX<iXDim; ++iX)
+				ostrPlot << vec[iY][iX] << " ";
+			ostrPlot << "\n";
+		}
 
+		ostrPlot << "end\nend\n";
+		m_strPlot = ostrPlot.str();
+	}
 
-	m_pProc->GetOstr().flush();
+	SendPlot();
 }
 
 
@@ -290,11 +417,14 @@ void GnuPlot<t_real>::FinishPlot()
 
 	if(--m_iStartCounter == 0)
 	{
-		std::string strCmd = BuildCmd();
+		m_strPlot = BuildCmd(m_bBinary);
 		RefreshVars();
 
 		if(m_strCmdFileOutput != "")
 		{
+			// the script file gets the data as text
+			const std::string strCmd = m_bBinary ? BuildCmd(0) : m_strPlot;
+
 			std::ofstream ofCmd(m_strCmdFileOutput);
 			if(!!ofCmd)
 			{
@@ -308,16 +438,14 @@ void GnuPlot<t_real>::FinishPlot()
 			}
 		}
 
-		m_pProc->GetOstr() << strCmd;
-		//m_pProc->GetOstr() << "replot\n";
-		m_pProc->GetOstr().flush();
+		SendPlot();
 		m_vecObjs.clear();
 	}
 }
 
 
 template<class t_real>
-std::string GnuPlot<t_real>::BuildCmd()
+std::string GnuPlot<t_real>::BuildCmd(bool bBinary)
 {
 	m_bHasLegend = 0;
 
@@ -349,7 +477,12 @@ std::string GnuPlot<t_real>::BuildCmd()
 		strPointStyle = ostrTmp.str();
 
 
+		const std::size_t iSize = std::min(obj.vecX.size(), obj.vecY.size());
+
 		ostr << "\"-\" ";
+		if(bBinary && iSize)
+			ostr << BuildBinarySpec(iSize, 2 + (bHasXErr ? 1 : 0) + (bHasYErr ? 1 : 0));
+
 		switch(obj.linestyle)
 		{
 			case STYLE_LINES_SOLID:
@@ -397,7 +530,8 @@ std::string GnuPlot<t_real>::BuildCmd()
 
 	for(const PlotObj<t_real>& obj : m_vecObjs)
 	{
-		std::string strTab = BuildTable(obj.vecX, obj.vecY, obj.vecErrY, obj.vecErrX);
+		const bool bBinaryObj = bBinary && std::min(obj.vecX.size(), obj.vecY.size());
+		std::string strTab = BuildTable(obj.vecX, obj.vecY, obj.vecErrY, obj.vecErrX, bBinaryObj);
 		ostr << strTab;
 	}
 
@@ -407,15 +541,33 @@ std::string GnuPlot<t_real>::BuildCmd()
 
 template<class t_real>
 std::string GnuPlot<t_real>::BuildTable(const std::vector<t_real>& vecX, const std::vector<t_real>& vecY,
-	const std::vector<t_real>& vecYErr, const std::vector<t_real>& vecXErr)
+	const std::vector<t_real>& vecYErr, const std::vector<t_real>& vecXErr, bool bBinary)
 {
-	std::ostringstream ostr;
-	ostr.precision(m_iPrec);
-
 	const std::size_t iSize = std::min(vecX.size(), vecY.size());
 	const bool bHasXErr = (vecXErr.size() != 0);
 	const bool bHasYErr = (vecYErr.size() != 0);
 
+	if(bBinary)
+	{
+		// raw records, see BuildBinarySpec
+		std::string strTab;
+		strTab.reserve(iSize * 4*sizeof(t_real));
+
+		for(std::size_t iDat=0; iDat<iSize; ++iDat)
+		{
+			_gpl_append_raw<t_real>(strTab, vecX[iDat]);
+			_gpl_append_raw<t_real>(strTab, vecY[iDat]);
+
+			if(bHasXErr) _gpl_append_raw<t_real>(strTab, vecXErr[iDat]);
+			if(bHasYErr) _gpl_append_raw<t_real>(strTab, vecYErr[iDat]);
+		}
+
+		return strTab;
+	}
+
+	std::ostringstream ostr;
+	ostr.precision(m_iPrec);
+
 	for(std::size_t iDat=0; iDat<iSize; ++iDat)
 	{
 		ostr << vecX[iDat] << " " << vecY[iDat];
@@ -436,8 +588,8 @@ void GnuPlot<t_real>::SetXLabel(const char* pcLab)
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "set xlabel \"" << pcLab << "\"\n";
-	//m_pProc->GetOstr().flush();
+	GetStream() << "set xlabel \"" << pcLab << "\"\n";
+	//GetStream().flush();
 }
 
 
@@ -446,8 +598,8 @@ void GnuPlot<t_real>::SetYLabel(const char* pcLab)
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "set ylabel \"" << pcLab << "\"\n";
-	//m_pProc->GetOstr().flush();
+	GetStream() << "set ylabel \"" << pcLab << "\"\n";
+	//GetStream().flush();
 }
 
 
@@ -456,8 +608,8 @@ void GnuPlot<t_real>::SetTitle(const char* pcTitle)
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "set title \"" << pcTitle << "\"\n";
-	//m_pProc->GetOstr().flush();
+	GetStream() << "set title \"" << pcTitle << "\"\n";
+	//GetStream().flush();
 }
 
 
@@ -467,8 +619,8 @@ void GnuPlot<t_real>::SetXRange(t_real dMin, t_real dMax)
 	if(!IsReady()) return;
 
 	//std::cout << "xmin: "  << dMin << ", xmax: " << dMax << std::endl;
-	m_pProc->GetOstr() << "set xrange [" << dMin << ":" << dMax << "]\n";
-	m_pProc->GetOstr().flush();
+	GetStream() << "set xrange [" << dMin << ":" << dMax << "]\n";
+	GetStream().flush();
 }
 
 
@@ -477,8 +629,8 @@ void GnuPlot<t_real>::SetYRange(t_real dMin, t_real dMax)
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "set yrange [" << dMin << ":" << dMax << "]\n";
-	m_pProc->GetOstr().flush();
+	GetStream() << "set yrange [" << dMin << ":" << dMax << "]\n";
+	GetStream().flush();
 }
 
 
@@ -488,10 +640,10 @@ void GnuPlot<t_real>::SetLogX(t_real tBase)
 	if(!IsReady()) return;
 
 	if(tBase >= 0.)
-		m_pProc->GetOstr() << "set logscale x " << tBase << "\n";
+		GetStream() << "set logscale x " << tBase << "\n";
 	else
-		m_pProc->GetOstr() << "unset logscale x\n";
-	m_pProc->GetOstr().flush();
+		GetStream() << "unset logscale x\n";
+	GetStream().flush();
 }
 
 
@@ -501,10 +653,10 @@ void GnuPlot<t_real>::SetLogY(t_real tBase)
 	if(!IsReady()) return;
 
 	if(tBase >= 0.)
-		m_pProc->GetOstr() << "set logscale y " << tBase << "\n";
+		GetStream() << "set logscale y " << tBase << "\n";
 	else
-		m_pProc->GetOstr() << "unset logscale y\n";
-	m_pProc->GetOstr().flush();
+		GetStream() << "unset logscale y\n";
+	GetStream().flush();
 }
 
 
@@ -514,11 +666,11 @@ void GnuPlot<t_real>::SetGrid(bool bOn)
 	if(!IsReady()) return;
 
 	if(bOn)
-		m_pProc->GetOstr() << "set grid\n";
+		GetStream() << "set grid\n";
 	else
-		m_pProc->GetOstr() << "unset grid\n";
+		GetStream() << "unset grid\n";
 
-	m_pProc->GetOstr().flush();
+	GetStream().flush();
 }
 
 
@@ -527,8 +679,8 @@ void GnuPlot<t_real>::ClearArrows()
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "unset arrow\n";
-	m_pProc->GetOstr().flush();
+	GetStream() << "unset arrow\n";
+	GetStream().flush();
 }
 
 
@@ -537,13 +689,13 @@ void GnuPlot<t_real>::AddArrow(t_real dX0, t_real dY0, t_real dX1, t_real dY1, b
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "set arrow from " << dX0 << "," << dY0
+	GetStream() << "set arrow from " << dX0 << "," << dY0
 			<< " to " << dX1 << "," << dY1;
 	if(!bHead)
-		m_pProc->GetOstr() << " nohead";
+		GetStream() << " nohead";
 
-	m_pProc->GetOstr() << "\n";
-	m_pProc->GetOstr().flush();
+	GetStream() << "\n";
+	GetStream().flush();
 }
 
 
@@ -552,22 +704,30 @@ void GnuPlot<t_real>::SetColorBarRange(t_real dMin, t_real dMax, bool bCyclic)
 {
 	if(!IsReady()) return;
 
-	m_pProc->GetOstr() << "set cbrange [" << dMin << ":" << dMax << "]\n";
+	GetStream() << "set cbrange [" << dMin << ":" << dMax << "]\n";
 
 	if(bCyclic)
-		m_pProc->GetOstr() << "set palette defined (0 \"#0000ff\", 0.33333 \"#ff0000\", 0.66666 \"#ff9900\", 1 \"#0000ff\")\n";
+		GetStream() << "set palette defined (0 \"#0000ff\", 0.33333 \"#ff0000\", 0.66666 \"#ff9900\", 1 \"#0000ff\")\n";
 	else
-		m_pProc->GetOstr() << "set palette defined (0 \"#0000ff\", 1 \"#ff0000\")\n";
+		GetStream() << "set palette defined (0 \"#0000ff\", 1 \"#ff0000\")\n";
 
-	m_pProc->GetOstr().flush();
+	GetStream().flush();
 }
 
 
 template<class t_real>
 bool GnuPlot<t_real>::IsReady() const { return m_pProc && m_pProc->IsReady(); }
 
+/**
+ * command stream, in asynchronous mode the commands are sent with the next plot
+ */
 template<class t_real>
-std::ostream& GnuPlot<t_real>::GetStream() { return m_pProc->GetOstr(); }
+std::ostream& GnuPlot<t_real>::GetStream()
+{
+	if(m_pFeeder)
+		return m_ostrAsyncCmds;
+	return m_pProc->GetOstr();
+}
 
 }
 
@@ -288,5 +288,48 @@ public:
 #endif
 
 
+
+/**
+ * number of threads to use for iJobs independent jobs
+ * iThreads == 0 selects the number of hardware threads
+ */
+static inline unsigned int get_num_threads(std::size_t iJobs, unsigned int iThreads = 0)
+{
+	if(iThreads == 0)
+		iThreads = std::max<unsigned int>(1, std::thread::hardware_concurrency());
+
+	iThreads = unsigned(std::min<std::size_t>(iThreads, iJobs));
+	return std::max<unsigned int>(iThreads, 1);
+}
+
+
+/**
+ * splits the index range [0, iLen[ into iThreads contiguous stripes
+ * and runs fkt(iStart, iEnd) for each of them in a thread pool
+ */
+template<class t_func>
+void run_stripes(std::size_t iLen, unsigned int iThreads, t_func&& fkt)
+{
+	if(iThreads <= 1)
+	{
+		fkt(std::size_t(0), iLen);
+		return;
+	}
+
+	const std::size_t iStripe = (iLen + iThreads - 1) / iThreads;
+
+	ThreadPool<void()> tp(iThreads);
+	for(std::size_t iStart=0; iStart<iLen; iStart+=iStripe)
+	{
+		const std::size_t iEnd = std::min(iStart+iStripe, iLen);
+		tp.AddTask([&fkt, iStart, iEnd]() -> void { fkt(iStart, iEnd); });
+	}
+	tp.StartTasks();
+
+	for(auto& fut : tp.GetFutures())
+		fut.get();
+}
+
+
 }
 #endif
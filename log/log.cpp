@@ -9,48 +9,62 @@
 #include <iomanip>
 #include <cstring>
 #include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
 #include <boost/date_time/c_time.hpp>
 
 
 namespace tl {
 std::recursive_mutex Log::s_mtx;
+std::atomic<bool> Log::s_bAsync(false);
 bool Log::s_bTermCmds = 1;
 
-std::string Log::get_timestamp()
+/**
+ * the date part is only formatted again when the second changes,
+ * callers hold s_mtx
+ */
+std::string Log::get_timestamp(const t_clock::time_point& now)
 {
 	namespace ch = std::chrono;
-	using ch::system_clock;
 	using boost::date_time::c_time;
 
-	system_clock::time_point now = system_clock::now();
+	static std::time_t s_tmCached = std::time_t(-1);
+	static std::string s_strCached;
 
 	// milliseconds
 	ch::milliseconds msecs = ch::duration_cast<ch::milliseconds>(now.time_since_epoch());
 	auto secs = ch::duration_cast<ch::seconds>(msecs);
 	msecs -= ch::duration_cast<ch::milliseconds>(secs);
-	std::ostringstream ostrmsecs;
-	ostrmsecs << std::setw(3) << std::right << std::setfill('0') << msecs.count();
+
+	char cMSecs[8];
+	std::snprintf(cMSecs, sizeof cMSecs, "%03d", int(msecs.count()));
 
 	// time and date
-	std::time_t tm = system_clock::to_time_t(now);
-	std::tm tmNow;
-	c_time::localtime(&tm, &tmNow);
-	// /*std::*/localtime_r(&tm, &tmNow);
-
-	std::string::value_type cTime[64];
-	std::strftime(cTime, sizeof cTime, "%Y-%b-%d %H:%M:%S.", &tmNow);
-	if(std::strlen(cTime))
-	{	// if a time string is available, return it
-		std::strcat(cTime, ostrmsecs.str().c_str());
-		return std::string(cTime);
-	}
-	else
-	{	// else return the raw seconds
-		std::ostringstream ostrsecs;
-		ostrsecs << secs.count();
-		ostrsecs << "." << ostrmsecs.str();
-		return ostrsecs.str();
+	std::time_t tm = t_clock::to_time_t(now);
+	if(tm != s_tmCached)
+	{
+		std::tm tmNow;
+		c_time::localtime(&tm, &tmNow);
+		// /*std::*/localtime_r(&tm, &tmNow);
+
+		std::string::value_type cTime[64];
+		std::strftime(cTime, sizeof cTime, "%Y-%b-%d %H:%M:%S.", &tmNow);
+		if(std::strlen(cTime))
+		{	// if a time string is available, use it
+			s_strCached = cTime;
+		}
+		else
+		{	// else use the raw seconds
+			std::ostringstream ostrsecs;
+			ostrsecs << secs.count() << ".";
+			s_strCached = ostrsecs.str();
+		}
+		s_tmCached = tm;
 	}
+
+	return s_strCached + cMSecs;
 }
 
 std::string Log::get_thread_id()
@@ -79,11 +93,11 @@ std::string Log::get_color(LogColor col, bool bBold)
 	}
 }
 
-void Log::begin_log()
+void Log::begin_log(const t_clock::time_point& now, std::thread::id idThread)
 {
 	s_mtx.lock();
 
-	std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
+	std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs(idThread);
 	std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
 
 	for(t_pairOstr &pairOstr : vecOstrs)
@@ -97,7 +111,7 @@ void Log::begin_log()
 			(*pOstr) << get_color(m_col, 1);
 		if(m_bShowDate)
 		{
-			std::string strTimeStamp = get_timestamp();
+			std::string strTimeStamp = get_timestamp(now);
 			if(strTimeStamp != "")
 				(*pOstr) << strTimeStamp << ", ";
 		}
@@ -109,15 +123,15 @@ void Log::begin_log()
 			using t_mapKey = typename t_threadmap::value_type::first_type;
 			//using t_mapVal = typename t_threadmap::value_type::second_type;
 
-			t_mapKey idThread = std::this_thread::get_id();
-			typename t_threadmap::const_iterator iterMap = s_threadmap.find(idThread);
+			t_mapKey idThreadKey = idThread;
+			typename t_threadmap::const_iterator iterMap = s_threadmap.find(idThreadKey);
 			if(iterMap == s_threadmap.end())
 			{
 				++m_iNumThreads;
 				std::ostringstream ostrThread;
 				ostrThread << "Thread " << m_iNumThreads;
 
-				iterMap = s_threadmap.insert({idThread, ostrThread.str()}).first;
+				iterMap = s_threadmap.insert({idThreadKey, ostrThread.str()}).first;
 			}
 
 			(*pOstr) << iterMap->second << ", ";
@@ -129,10 +143,10 @@ void Log::begin_log()
 	}
 }
 
-void Log::end_log()
+void Log::end_log(std::thread::id idThread, bool bFlush)
 {
-        std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
-        std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
+	std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs(idThread);
+	std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
 
 	for(t_pairOstr& pairOstr : vecOstrs)
 	{
@@ -143,7 +157,9 @@ void Log::end_log()
 			continue;
 		if(bCol)
 			(*pOstr) << get_color(LogColor::NONE);
-		(*pOstr) << std::endl;
+		(*pOstr) << '\n';
+		if(bFlush)
+			pOstr->flush();
 	}
 	s_mtx.unlock();
 }
@@ -166,12 +182,12 @@ void Log::dec_depth()
 	}
 }
 
-Log::Log() : m_vecOstrs{{&std::cerr, 1}}
+Log::Log() : m_vecOstrs{{&std::cerr, 1}}, m_iNumOstrs(1)
 {}
 
 Log::Log(const std::string& strInfo, LogColor col, std::ostream* pOstr)
 	: m_vecOstrs{{pOstr ? pOstr : &std::cerr, 1}},
-	  m_strInfo(strInfo), m_col(col)
+	  m_strInfo(strInfo), m_col(col), m_iNumOstrs(1)
 {}
 
 Log::~Log()
@@ -180,16 +196,20 @@ Log::~Log()
 
 	m_mapOstrsTh.clear();
 	m_vecOstrs.clear();
+	m_iNumOstrs = 0;
 }
 
-std::vector<Log::t_pairOstr>& Log::GetThreadOstrs()
+std::vector<Log::t_pairOstr>& Log::GetThreadOstrs(std::thread::id idThread)
 {
-	return m_mapOstrsTh[std::this_thread::get_id()];
+	return m_mapOstrsTh[idThread];
 }
 
 void Log::AddOstr(std::ostream* pOstr, bool bCol, bool bThreadLocal)
 {
 	std::lock_guard<decltype(s_mtx)> _lck(s_mtx);
+	if(pOstr)
+		++m_iNumOstrs;
+
 	if(bThreadLocal)
 	{
 		std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
@@ -215,20 +235,432 @@ void Log::RemoveOstr(std::ostream* pOstr)
 	if(iterNewEnd != m_vecOstrs.end())
 		m_vecOstrs.resize(iterNewEnd-m_vecOstrs.begin());
 
+	auto fktValid = [](const t_iter::value_type& pairOstr) -> bool
+	{
+		return pairOstr.first != nullptr;
+	};
+
+	std::size_t iNumOstrs = std::count_if(m_vecOstrs.begin(), m_vecOstrs.end(), fktValid);
 	for(t_mapthreadOstrs::value_type& pairTh : m_mapOstrsTh)
 	{
 		t_iter iterNewEndTh = std::remove_if(pairTh.second.begin(), pairTh.second.end(), fktDel);
 		if(iterNewEndTh != pairTh.second.end())
 			pairTh.second.resize(iterNewEndTh - pairTh.second.begin());
+		iNumOstrs += std::count_if(pairTh.second.begin(), pairTh.second.end(), fktValid);
 	}
+
+	m_iNumOstrs = iNumOstrs;
 }
 
 
+
+// ----------------------------------------------------------------------------
+// asynchronous mode
+
+/**
+ * preformatted message
+ */
+struct LogRecord
+{
+	Log* pLog = nullptr;
+	Log::t_clock::time_point tm;
+	std::thread::id idThread;
+	std::string strMsg;
+};
+
+
+/**
+ * lock-free single-producer single-consumer ring buffer
+ */
+class LogRing
+{
+protected:
+	std::vector<LogRecord> m_vecRecs;
+	std::size_t m_iMask = 0;
+
+	// producer and consumer positions on separate cache lines
+	alignas(64) std::atomic<std::size_t> m_iHead{0};
+	alignas(64) std::atomic<std::size_t> m_iTail{0};
+
+public:
+	// the producing thread has exited or switched to a new ring
+	std::atomic<bool> m_bOrphaned{false};
+
+public:
+	LogRing(std::size_t iSize)
+	{
+		std::size_t iPow2 = 2;
+		while(iPow2 < iSize) iPow2 <<= 1;
+
+		m_vecRecs.resize(iPow2);
+		m_iMask = iPow2 - 1;
+	}
+
+	bool push(LogRecord&& rec)
+	{
+		const std::size_t iHead = m_iHead.load(std::memory_order_relaxed);
+		if(iHead - m_iTail.load(std::memory_order_acquire) > m_iMask)
+			return false;
+
+		m_vecRecs[iHead & m_iMask] = std::move(rec);
+		m_iHead.store(iHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	template<class t_cont>
+	std::size_t pop_all(t_cont& cont)
+	{
+		std::size_t iTail = m_iTail.load(std::memory_order_relaxed);
+		const std::size_t iHead = m_iHead.load(std::memory_order_acquire);
+		const std::size_t iNum = iHead - iTail;
+
+		for(; iTail != iHead; ++iTail)
+			cont.emplace_back(std::move(m_vecRecs[iTail & m_iMask]));
+
+		m_iTail.store(iTail, std::memory_order_release);
+		return iNum;
+	}
+
+	std::size_t fill_level() const
+	{
+		return m_iHead.load(std::memory_order_acquire) - m_iTail.load(std::memory_order_acquire);
+	}
+
+	std::size_t size() const { return m_iMask + 1; }
+	std::size_t pushed() const { return m_iHead.load(std::memory_order_acquire); }
+};
+
+
+/**
+ * background thread writing the queued messages to the streams of their loggers
+ */
+class LogAsyncWriter
+{
+protected:
+	std::mutex m_mtxRings;
+	std::vector<std::shared_ptr<LogRing>> m_vecRings;
+	std::size_t m_iRingSize = 1024;
+	std::atomic<LogOverflow> m_overflow{LogOverflow::BLOCK};
+
+	// incremented whenever the rings are recreated,
+	// rings of older generations stay in m_vecRings until they are drained
+	std::atomic<std::uint64_t> m_iGeneration{0};
+
+	std::unique_ptr<std::thread> m_pThread;
+	std::atomic<bool> m_bRunning{false}, m_bStop{false};
+
+	// number of threads currently in Push, Stop waits for them before the last drain
+	std::atomic<std::size_t> m_iPushing{0};
+	std::mutex m_mtxWake;
+	std::condition_variable m_cvWake;
+
+	// messages of all rings removed from the ring list
+	std::atomic<std::uint64_t> m_iPushedRemoved{0};
+	std::atomic<std::uint64_t> m_iWritten{0};
+	std::atomic<std::uint64_t> m_iDropped{0};
+	std::uint64_t m_iDroppedReported = 0;
+	Log::t_clock::time_point m_tmDroppedReported;
+
+	struct ThreadRing
+	{
+		std::shared_ptr<LogRing> pRing;
+		std::uint64_t iGeneration = 0;
+
+		~ThreadRing() { if(pRing) pRing->m_bOrphaned = true; }
+	};
+
+protected:
+	/**
+	 * moves all queued messages to vecRecs, removes rings of exited threads
+	 */
+	void Collect(std::vector<LogRecord>& vecRecs)
+	{
+		std::lock_guard<std::mutex> _lck(m_mtxRings);
+
+		for(auto iter = m_vecRings.begin(); iter != m_vecRings.end();)
+		{
+			const bool bOrphaned = (*iter)->m_bOrphaned.load();
+			(*iter)->pop_all(vecRecs);
+
+			if(bOrphaned)
+			{
+				m_iPushedRemoved += (*iter)->pushed();
+				iter = m_vecRings.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	/**
+	 * @param iNumQueued number of records that came from the rings
+	 */
+	void Write(std::vector<LogRecord>& vecRecs, std::size_t iNumQueued)
+	{
+		// messages from different threads in temporal order
+		std::stable_sort(vecRecs.begin(), vecRecs.end(),
+			[](const LogRecord& rec1, const LogRecord& rec2) -> bool
+			{ return rec1.tm < rec2.tm; });
+
+		std::lock_guard<decltype(Log::s_mtx)> _lck(Log::s_mtx);
+		std::vector<std::ostream*> vecOstrs;
+
+		for(LogRecord& rec : vecRecs)
+		{
+			Log& log = *rec.pLog;
+			log.begin_log(rec.tm, rec.idThread);
+
+			for(const Log::t_pairOstr& pair : arrayunion({log.m_vecOstrs, log.GetThreadOstrs(rec.idThread)}))
+			{
+				if(!pair.first) continue;
+				(*pair.first) << rec.strMsg;
+				vecOstrs.push_back(pair.first);
+			}
+
+			log.end_log(rec.idThread, 0);
+		}
+
+		// flush each stream only once per batch
+		std::sort(vecOstrs.begin(), vecOstrs.end());
+		vecOstrs.erase(std::unique(vecOstrs.begin(), vecOstrs.end()), vecOstrs.end());
+		for(std::ostream* pOstr : vecOstrs)
+			pOstr->flush();
+
+		m_iWritten += iNumQueued;
+	}
+
+	void Run()
+	{
+		std::vector<LogRecord> vecRecs;
+
+		while(1)
+		{
+			vecRecs.clear();
+			Collect(vecRecs);
+			const std::size_t iNumQueued = vecRecs.size();
+
+			// report dropped messages at most once per second
+			const std::uint64_t iDropped = m_iDropped.load();
+			const Log::t_clock::time_point tmNow = Log::t_clock::now();
+			if(iDropped != m_iDroppedReported &&
+				(m_bStop.load() || tmNow - m_tmDroppedReported >= std::chrono::seconds(1)))
+			{
+				LogRecord rec;
+				rec.pLog = &log_warn;
+				rec.tm = tmNow;
+				rec.idThread = std::this_thread::get_id();
+				rec.strMsg = std::to_string(iDropped - m_iDroppedReported)
+					+ " log message(s) dropped.";
+				vecRecs.emplace_back(std::move(rec));
+				m_iDroppedReported = iDropped;
+				m_tmDroppedReported = tmNow;
+			}
+
+			if(vecRecs.size())
+			{
+				Write(vecRecs, iNumQueued);
+				continue;
+			}
+
+			if(m_bStop.load())
+				break;
+
+			std::unique_lock<std::mutex> lck(m_mtxWake);
+			m_cvWake.wait_for(lck, std::chrono::milliseconds(2));
+		}
+	}
+
+	std::uint64_t GetNumPushed()
+	{
+		std::lock_guard<std::mutex> _lck(m_mtxRings);
+
+		std::uint64_t iPushed = m_iPushedRemoved.load();
+		for(const auto& pRing : m_vecRings)
+			iPushed += pRing->pushed();
+		return iPushed;
+	}
+
+	LogRing* GetThreadRing()
+	{
+		static thread_local ThreadRing s_ring;
+
+		const std::uint64_t iGen = m_iGeneration.load(std::memory_order_acquire);
+		if(!s_ring.pRing || s_ring.iGeneration != iGen)
+		{
+			std::lock_guard<std::mutex> _lck(m_mtxRings);
+
+			// this thread does not push into the old ring anymore,
+			// the writer removes it after it has written its remaining messages
+			if(s_ring.pRing)
+				s_ring.pRing->m_bOrphaned = true;
+
+			s_ring.pRing = std::make_shared<LogRing>(m_iRingSize);
+			s_ring.iGeneration = iGen;
+			m_vecRings.push_back(s_ring.pRing);
+		}
+
+		return s_ring.pRing.get();
+	}
+
+public:
+	~LogAsyncWriter()
+	{
+		Log::s_bAsync = false;
+		Stop();
+	}
+
+	void Start(std::size_t iRingSize, LogOverflow overflow)
+	{
+		Stop();
+
+		{
+			std::lock_guard<std::mutex> _lck(m_mtxRings);
+			m_iRingSize = iRingSize;
+			m_overflow = overflow;
+			++m_iGeneration;
+		}
+
+		m_bStop = false;
+		m_pThread.reset(new std::thread([this]() { Run(); }));
+		m_bRunning = true;
+	}
+
+	/**
+	 * writes the remaining messages and ends the writer thread
+	 */
+	void Stop()
+	{
+		if(!m_pThread)
+			return;
+
+		// threads entering Push from now on write synchronously,
+		// the ones already in it finish their push before the writer drains the rings
+		m_bRunning = false;
+		while(m_iPushing.load())
+		{
+			m_cvWake.notify_one();
+			std::this_thread::yield();
+		}
+
+		m_bStop = true;
+		m_cvWake.notify_one();
+		m_pThread->join();
+		m_pThread.reset();
+	}
+
+	/**
+	 * queues a message, returns false if the writer is stopping and rec has to be written directly
+	 */
+	bool Push(LogRecord&& rec)
+	{
+		++m_iPushing;
+		if(!m_bRunning.load())
+		{
+			--m_iPushing;
+			return false;
+		}
+
+		LogRing* pRing = GetThreadRing();
+
+		while(!pRing->push(std::move(rec)))
+		{
+			if(m_overflow == LogOverflow::DROP)
+			{
+				++m_iDropped;
+				--m_iPushing;
+				return true;
+			}
+
+			m_cvWake.notify_one();
+			std::this_thread::yield();
+		}
+
+		// wake the writer early if the buffer gets full
+		if(pRing->fill_level() == pRing->size()/2)
+			m_cvWake.notify_one();
+
+		--m_iPushing;
+		return true;
+	}
+
+	/**
+	 * writes a message in the calling thread
+	 */
+	void WriteDirect(LogRecord&& rec)
+	{
+		std::vector<LogRecord> vecRecs;
+		vecRecs.emplace_back(std::move(rec));
+		Write(vecRecs, 0);
+	}
+
+	void Flush()
+	{
+		const std::uint64_t iPushed = GetNumPushed();
+		while(m_bRunning.load() && m_iWritten.load() < iPushed)
+		{
+			m_cvWake.notify_one();
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+	std::uint64_t GetNumDropped() const { return m_iDropped.load(); }
+};
+
+
 Log log_info("INFO", LogColor::WHITE, &std::cerr),
 	log_warn("WARNING", LogColor::YELLOW, &std::cerr),
 	log_err("ERROR", LogColor::RED, &std::cerr),
 	log_crit("CRITICAL", LogColor::PURPLE, &std::cerr),
 	log_debug("DEBUG", LogColor::CYAN, &std::cerr);
+
+// defined after the loggers, so that it is destroyed (and flushed) before them
+static LogAsyncWriter g_logwriter;
+
+
+std::ostringstream& Log::GetAsyncOstr()
+{
+	static thread_local std::ostringstream s_ostr;
+	return s_ostr;
+}
+
+void Log::PushAsync(std::string&& strMsg)
+{
+	LogRecord rec;
+	rec.pLog = this;
+	rec.tm = t_clock::now();
+	rec.idThread = std::this_thread::get_id();
+	rec.strMsg = std::move(strMsg);
+
+	if(!g_logwriter.Push(std::move(rec)))
+		g_logwriter.WriteDirect(std::move(rec));
+}
+
+void Log::SetAsync(bool bAsync, std::size_t iBufSize, LogOverflow overflow)
+{
+	if(bAsync)
+	{
+		s_bAsync = false;
+		g_logwriter.Start(iBufSize, overflow);
+		s_bAsync = true;
+	}
+	else
+	{
+		s_bAsync = false;
+		g_logwriter.Stop();
+	}
+}
+
+void Log::FlushAsync()
+{
+	g_logwriter.Flush();
+}
+
+std::uint64_t Log::GetNumDropped()
+{
+	return g_logwriter.GetNumDropped();
+}
 }
 
 
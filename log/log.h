@@ -14,13 +14,37 @@
 #include <sstream>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
 #include <utility>
+#include <type_traits>
 
 #include "../helper/array.h"
 
 
+/**
+ * log calls below this level are removed at compile time by the TLIBS_LOG_* macros
+ * (0: debug, 1: info, 2: warning, 3: error, 4: critical, 5: none)
+ */
+#ifndef TLIBS_LOG_MIN_LEVEL
+	#define TLIBS_LOG_MIN_LEVEL 0
+#endif
+
+
 namespace tl {
 
+enum class LogLevel
+{
+	DEBUG = 0, INFO = 1, WARN = 2,
+	ERR = 3, CRIT = 4, NONE = 5
+};
+
+constexpr bool log_level_enabled(LogLevel lvl)
+{
+	return int(lvl) >= TLIBS_LOG_MIN_LEVEL;
+}
+
 enum class LogColor
 {
 	NONE,
@@ -29,13 +53,28 @@ enum class LogColor
 	WHITE, BLACK
 };
 
+/**
+ * what to do when the message buffer of a thread is full in asynchronous mode
+ */
+enum class LogOverflow
+{
+	DROP,		// discard the message
+	BLOCK,		// wait for the writer thread
+};
+
 class Log
 {
+	friend class LogAsyncWriter;
+
+public:
+	using t_clock = std::chrono::system_clock;
+
 private:
 	int m_iDepth = 0;
 
 protected:
 	static std::recursive_mutex s_mtx;
+	static std::atomic<bool> s_bAsync;
 
 	// pair of ostream and colour flag
 	using t_pairOstr = std::pair<std::ostream*, bool>;
@@ -49,24 +88,57 @@ protected:
 	bool m_bEnabled = 1;
 	bool m_bShowDate = 1;
 
+	// number of output streams, including the thread-local ones
+	std::atomic<std::size_t> m_iNumOstrs{0};
+
 	bool m_bShowThread = 0;
 	unsigned int m_iNumThreads = 0;
 
 	static bool s_bTermCmds;
 
 protected:
-	static std::string get_timestamp();
+	static std::string get_timestamp(const t_clock::time_point& now = t_clock::now());
 	static std::string get_thread_id();
 	static std::string get_color(LogColor col, bool bBold=0);
 
-	std::vector<t_pairOstr>& GetThreadOstrs();
+	std::vector<t_pairOstr>& GetThreadOstrs(std::thread::id idThread = std::this_thread::get_id());
 
-	void begin_log();
-	void end_log();
+	void begin_log(const t_clock::time_point& now = t_clock::now(),
+		std::thread::id idThread = std::this_thread::get_id());
+	void end_log(std::thread::id idThread = std::this_thread::get_id(), bool bFlush = 1);
 
 	void inc_depth();
 	void dec_depth();
 
+	// asynchronous mode
+	static std::ostringstream& GetAsyncOstr();
+	void PushAsync(std::string&& strMsg);
+
+	template<typename t_arg>
+	static void write_args(std::ostream& ostr, t_arg&& arg)
+	{
+		ostr << std::forward<t_arg>(arg);
+	}
+
+	template<typename t_arg, typename... t_args>
+	static void write_args(std::ostream& ostr, t_arg&& arg, t_args&&... args)
+	{
+		ostr << std::forward<t_arg>(arg);
+		write_args(ostr, std::forward<t_args>(args)...);
+	}
+
+	/**
+	 * formats the message in the calling thread and hands it to the writer thread
+	 */
+	template<typename... t_args>
+	void log_async(t_args&&... args)
+	{
+		std::ostringstream& ostr = GetAsyncOstr();
+		ostr.str("");
+		write_args(ostr, std::forward<t_args>(args)...);
+		PushAsync(ostr.str());
+	}
+
 public:
 	Log();
 	Log(const std::string& strInfo, LogColor col, std::ostream* = nullptr);
@@ -79,7 +151,13 @@ public:
 	template<typename ...t_args>
 	void operator()(t_args&&... args)
 	{
-		if(!m_bEnabled) return;
+		if(!IsActive()) return;
+		if(s_bAsync.load(std::memory_order_relaxed))
+		{
+			log_async(std::forward<t_args>(args)...);
+			return;
+		}
+
 		begin_log();
 
 		std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
@@ -93,11 +171,23 @@ public:
 		end_log();
 	}
 #else
-	template<typename t_arg>
-	void operator()(t_arg&& arg)
+	template<typename... t_args>
+	void operator()(t_args&&... args)
 	{
-		if(!m_bEnabled) return;
+		if(!IsActive()) return;
+		if(s_bAsync.load(std::memory_order_relaxed))
+		{
+			log_async(std::forward<t_args>(args)...);
+			return;
+		}
 
+		log_sync(std::forward<t_args>(args)...);
+	}
+
+protected:
+	template<typename t_arg>
+	void log_sync(t_arg&& arg)
+	{
 		inc_depth();
 		std::vector<t_pairOstr>& vecOstrsTh = GetThreadOstrs();
 		std::vector<t_pairOstr> vecOstrs = arrayunion({m_vecOstrs, vecOstrsTh});
@@ -111,26 +201,108 @@ public:
 	}
 
 	template<typename t_arg, typename... t_args>
-	void operator()(t_arg&& arg, t_args&&... args)
+	void log_sync(t_arg&& arg, t_args&&... args)
 	{
-		if(!m_bEnabled) return;
-
 		inc_depth();
-		(*this)(std::forward<t_arg>(arg));
-		(*this)(std::forward<t_args>(args)...);
+		log_sync(std::forward<t_arg>(arg));
+		log_sync(std::forward<t_args>(args)...);
 		dec_depth();
 	}
+
+public:
 #endif
 
 	void SetEnabled(bool bEnab) { m_bEnabled = bEnab; }
+	bool IsEnabled() const { return m_bEnabled; }
+
+	/**
+	 * is the logger enabled and does it have output streams?
+	 */
+	bool IsActive() const { return m_bEnabled && m_iNumOstrs.load(std::memory_order_relaxed); }
 	void SetShowDate(bool bDate) { m_bShowDate = bDate; }
 	void SetShowThread(bool bThread) { m_bShowThread = bThread; }
 
 	static void SetUseTermCmds(bool bCmds) { s_bTermCmds = bCmds; }
+
+	/**
+	 * in asynchronous mode the messages are queued in a lock-free buffer per thread
+	 * and written to the streams by a background thread
+	 * @param iBufSize number of messages per thread, rounded up to a power of two
+	 */
+	static void SetAsync(bool bAsync, std::size_t iBufSize = 1024,
+		LogOverflow overflow = LogOverflow::BLOCK);
+	static bool IsAsync() { return s_bAsync.load(); }
+
+	/**
+	 * waits until all queued messages have been written
+	 */
+	static void FlushAsync();
+
+	/**
+	 * number of messages dropped because of full buffers
+	 */
+	static std::uint64_t GetNumDropped();
 };
 
 
 extern Log log_info, log_warn, log_err, log_crit, log_debug;
 
+
+
+/**
+ * argument which is only formatted when it is actually written,
+ * e.g. log_debug("x = ", log_lazy([&]() { return var_to_str(x); }))
+ */
+template<class t_func>
+class LogLazy
+{
+protected:
+	t_func m_fkt;
+
+	mutable bool m_bEvaluated = 0;
+	mutable std::string m_str;
+
+public:
+	LogLazy(t_func fkt) : m_fkt(std::move(fkt)) {}
+
+	const std::string& str() const
+	{
+		if(!m_bEvaluated)
+		{
+			std::ostringstream ostr;
+			ostr << m_fkt();
+			m_str = ostr.str();
+			m_bEvaluated = 1;
+		}
+		return m_str;
+	}
+
+	friend std::ostream& operator<<(std::ostream& ostr, const LogLazy<t_func>& lazy)
+	{
+		return ostr << lazy.str();
+	}
+};
+
+template<class t_func>
+LogLazy<typename std::decay<t_func>::type> log_lazy(t_func&& fkt)
+{
+	return LogLazy<typename std::decay<t_func>::type>(std::forward<t_func>(fkt));
+}
+
 }
+
+
+/**
+ * log calls which are removed at compile time if their level is below TLIBS_LOG_MIN_LEVEL,
+ * the arguments are only evaluated if the logger is active
+ */
+#define TLIBS_LOG(LOGGER, LEVEL, ...) \
+	do { if(::tl::log_level_enabled(LEVEL) && (LOGGER).IsActive()) (LOGGER)(__VA_ARGS__); } while(0)
+
+#define TLIBS_LOG_DEBUG(...) TLIBS_LOG(::tl::log_debug, ::tl::LogLevel::DEBUG, __VA_ARGS__)
+#define TLIBS_LOG_INFO(...) TLIBS_LOG(::tl::log_info, ::tl::LogLevel::INFO, __VA_ARGS__)
+#define TLIBS_LOG_WARN(...) TLIBS_LOG(::tl::log_warn, ::tl::LogLevel::WARN, __VA_ARGS__)
+#define TLIBS_LOG_ERR(...) TLIBS_LOG(::tl::log_err, ::tl::LogLevel::ERR, __VA_ARGS__)
+#define TLIBS_LOG_CRIT(...) TLIBS_LOG(::tl::log_crit, ::tl::LogLevel::CRIT, __VA_ARGS__)
+
 #endif
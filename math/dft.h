@@ -13,6 +13,8 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <algorithm>
+#include <cmath>
 #include <boost/functional/hash.hpp>
 
 #include "math.h"
@@ -559,6 +561,369 @@ class FFT : public Fourier_base<T>
 		}
 };
 
+
+//==============================================================================
+
+
+/**
+ * iterative radix-2 fft with pre-calculated twiddle factors and bit-reversal indices,
+ * n has to be a power of two, the transformation is in-place and not normalised
+ */
+template<class T=double>
+class FFTPlan
+{
+	protected:
+		std::size_t m_n = 0;
+		std::vector<T> m_vecTwiddleR, m_vecTwiddleI;
+		std::vector<std::size_t> m_vecRev;
+
+	public:
+		FFTPlan(std::size_t n) : m_n(n), m_vecTwiddleR(n/2), m_vecTwiddleI(n/2), m_vecRev(n)
+		{
+			for(std::size_t k=0; k<n/2; ++k)
+			{
+				const T dPhase = T(2)*get_pi<T>()*T(k)/T(n);
+				m_vecTwiddleR[k] = std::cos(dPhase);
+				m_vecTwiddleI[k] = -std::sin(dPhase);
+			}
+
+			for(std::size_t i=1; i<n; ++i)
+				m_vecRev[i] = (m_vecRev[i>>1] >> 1) | ((i & 1) ? n>>1 : 0);
+		}
+
+		std::size_t size() const { return m_n; }
+
+		void trafo(std::complex<T>* pData, bool bInv=0) const
+		{
+			const std::size_t n = m_n;
+			T* pRI = reinterpret_cast<T*>(pData);
+
+			for(std::size_t i=0; i<n; ++i)
+			{
+				const std::size_t j = m_vecRev[i];
+				if(i < j)
+					std::swap(pData[i], pData[j]);
+			}
+
+			const T dSign = bInv ? T(-1) : T(1);
+			for(std::size_t iLen=2; iLen<=n; iLen<<=1)
+			{
+				const std::size_t iHalf = iLen/2;
+				const std::size_t iStep = n/iLen;
+
+				for(std::size_t i=0; i<n; i+=iLen)
+				{
+					for(std::size_t k=0; k<iHalf; ++k)
+					{
+						const T wR = m_vecTwiddleR[k*iStep];
+						const T wI = dSign * m_vecTwiddleI[k*iStep];
+
+						T* pU = pRI + 2*(i+k);
+						T* pV = pRI + 2*(i+k+iHalf);
+
+						const T vR = pV[0]*wR - pV[1]*wI;
+						const T vI = pV[0]*wI + pV[1]*wR;
+
+						pV[0] = pU[0] - vR; pV[1] = pU[1] - vI;
+						pU[0] += vR; pU[1] += vI;
+					}
+				}
+			}
+		}
+};
+
+
+enum class ConvMode
+{
+	FULL,	// length of signal + length of kernel - 1
+	SAME	// length of signal, centred on the kernel
+};
+
+
+/**
+ * discrete convolution with a fixed kernel, e.g. a resolution function.
+ * long signals use overlap-add fft convolution with cached kernel spectra,
+ * short ones are convolved directly.
+ * as both the signals and the kernel are real, two signal blocks share one complex fft.
+ * the work buffers make an object non-reentrant, use one per thread.
+ */
+template<class T=double>
+class FFTConv
+{
+	protected:
+		using t_cplx = std::complex<T>;
+
+		// plan and normalised kernel spectrum for an fft size
+		struct Spectrum
+		{
+			std::shared_ptr<FFTPlan<T>> pPlan;
+			std::vector<T> vecR, vecI;
+		};
+
+		struct Block
+		{
+			std::size_t iSig, iStart;
+		};
+
+		std::vector<T> m_vecKernel;
+		std::unordered_map<std::size_t, Spectrum> m_mapSpectra;
+
+		std::vector<t_cplx> m_vecBuf;
+		std::vector<Block> m_vecBlocks;
+
+	protected:
+		static std::size_t next_pow2(std::size_t n)
+		{
+			std::size_t iPow = 1;
+			while(iPow < n) iPow <<= 1;
+			return iPow;
+		}
+
+		/**
+		 * fft size: one block for short signals, otherwise a few kernel lengths
+		 */
+		std::size_t GetFFTSize(std::size_t iMaxLen) const
+		{
+			const std::size_t K = m_vecKernel.size();
+			const std::size_t iSingle = next_pow2(iMaxLen + K - 1);
+			const std::size_t iBlock = next_pow2(std::max<std::size_t>(8*K, 256));
+			return std::min(iSingle, iBlock);
+		}
+
+		const Spectrum& GetSpectrum(std::size_t N)
+		{
+			auto iter = m_mapSpectra.find(N);
+			if(iter != m_mapSpectra.end())
+				return iter->second;
+
+			Spectrum spec;
+			spec.pPlan = std::make_shared<FFTPlan<T>>(N);
+
+			std::vector<t_cplx> vecBuf(N);
+			for(std::size_t i=0; i<m_vecKernel.size(); ++i)
+				vecBuf[i] = t_cplx(m_vecKernel[i], T(0));
+			spec.pPlan->trafo(vecBuf.data(), 0);
+
+			// include the normalisation of the inverse transformation
+			spec.vecR.resize(N);
+			spec.vecI.resize(N);
+			for(std::size_t i=0; i<N; ++i)
+			{
+				spec.vecR[i] = vecBuf[i].real() / T(N);
+				spec.vecI[i] = vecBuf[i].imag() / T(N);
+			}
+
+			return m_mapSpectra.emplace(N, std::move(spec)).first->second;
+		}
+
+		void ConvolveDirect(const T* pIn, std::size_t iLen, T* pOut) const
+		{
+			const std::size_t K = m_vecKernel.size();
+			const T* pKernel = m_vecKernel.data();
+
+			std::fill(pOut, pOut + iLen + K - 1, T(0));
+			for(std::size_t m=0; m<iLen; ++m)
+			{
+				const T dIn = pIn[m];
+				T* pOutM = pOut + m;
+				for(std::size_t k=0; k<K; ++k)
+					pOutM[k] += dIn * pKernel[k];
+			}
+		}
+
+		/**
+		 * overlap-add convolution of all signals, the blocks are processed in pairs
+		 */
+		void ConvolveFFT(const std::vector<const T*>& vecIn, const std::vector<std::size_t>& vecLen,
+			const std::vector<T*>& vecOut)
+		{
+			const std::size_t K = m_vecKernel.size();
+			const std::size_t iMaxLen = *std::max_element(vecLen.begin(), vecLen.end());
+			const std::size_t N = GetFFTSize(iMaxLen);
+			const std::size_t L = N - K + 1;
+			const Spectrum& spec = GetSpectrum(N);
+
+			m_vecBlocks.clear();
+			for(std::size_t iSig=0; iSig<vecIn.size(); ++iSig)
+			{
+				std::fill(vecOut[iSig], vecOut[iSig] + vecLen[iSig] + K - 1, T(0));
+				for(std::size_t iStart=0; iStart<vecLen[iSig]; iStart+=L)
+					m_vecBlocks.push_back(Block{iSig, iStart});
+			}
+
+			m_vecBuf.resize(N);
+			T* pBuf = reinterpret_cast<T*>(m_vecBuf.data());
+
+			for(std::size_t iBlock=0; iBlock<m_vecBlocks.size(); iBlock+=2)
+			{
+				const Block* pBlocks[2] = { &m_vecBlocks[iBlock],
+					iBlock+1 < m_vecBlocks.size() ? &m_vecBlocks[iBlock+1] : nullptr };
+
+				// first block in the real, second block in the imaginary part
+				std::fill(pBuf, pBuf + 2*N, T(0));
+				for(int iPart=0; iPart<2; ++iPart)
+				{
+					if(!pBlocks[iPart]) continue;
+
+					const Block& block = *pBlocks[iPart];
+					const T* pIn = vecIn[block.iSig] + block.iStart;
+					const std::size_t iBlockLen = std::min(L, vecLen[block.iSig] - block.iStart);
+					for(std::size_t j=0; j<iBlockLen; ++j)
+						pBuf[2*j + iPart] = pIn[j];
+				}
+
+				spec.pPlan->trafo(m_vecBuf.data(), 0);
+				for(std::size_t j=0; j<N; ++j)
+				{
+					const T dR = pBuf[2*j], dI = pBuf[2*j+1];
+					pBuf[2*j] = dR*spec.vecR[j] - dI*spec.vecI[j];
+					pBuf[2*j+1] = dR*spec.vecI[j] + dI*spec.vecR[j];
+				}
+				spec.pPlan->trafo(m_vecBuf.data(), 1);
+
+				for(int iPart=0; iPart<2; ++iPart)
+				{
+					if(!pBlocks[iPart]) continue;
+
+					const Block& block = *pBlocks[iPart];
+					const std::size_t iOutLen = vecLen[block.iSig] + K - 1;
+					const std::size_t iBlockLen = std::min(L, vecLen[block.iSig] - block.iStart);
+					const std::size_t iNum = std::min(iBlockLen + K - 1, iOutLen - block.iStart);
+
+					T* pOut = vecOut[block.iSig] + block.iStart;
+					for(std::size_t j=0; j<iNum; ++j)
+						pOut[j] += pBuf[2*j + iPart];
+				}
+			}
+		}
+
+	public:
+		FFTConv() = default;
+		FFTConv(const std::vector<T>& vecKernel) { SetKernel(vecKernel); }
+		virtual ~FFTConv() = default;
+
+		void SetKernel(const T* pKernel, std::size_t iLen)
+		{
+			m_vecKernel.assign(pKernel, pKernel + iLen);
+			m_mapSpectra.clear();
+		}
+
+		void SetKernel(const std::vector<T>& vecKernel)
+		{
+			SetKernel(vecKernel.data(), vecKernel.size());
+		}
+
+		const std::vector<T>& GetKernel() const { return m_vecKernel; }
+
+		std::size_t GetOutLen(std::size_t iLen, ConvMode mode = ConvMode::FULL) const
+		{
+			if(!iLen || m_vecKernel.empty()) return 0;
+			return mode == ConvMode::SAME ? iLen : iLen + m_vecKernel.size() - 1;
+		}
+
+		/**
+		 * estimates whether the fft path is faster than the direct convolution
+		 */
+		bool UseFFT(std::size_t iLen) const
+		{
+			const std::size_t K = m_vecKernel.size();
+			if(K < 32 || !iLen)
+				return false;
+
+			const std::size_t N = GetFFTSize(iLen);
+			const std::size_t L = N - K + 1;
+			const std::size_t iPairs = ((iLen + L - 1) / L + 1) / 2;
+
+			const T dDirect = T(iLen) * T(K);
+			const T dFFT = T(iPairs) * T(N) * (T(3)*std::log2(T(N)) + T(6));
+			return dFFT < dDirect;
+		}
+
+		/**
+		 * convolves the signal with the kernel, pOut needs GetOutLen(iLen, mode) elements
+		 */
+		void Convolve(const T* pIn, std::size_t iLen, T* pOut, ConvMode mode = ConvMode::FULL)
+		{
+			const std::size_t K = m_vecKernel.size();
+			if(!iLen || !K)
+				return;
+
+			T* pFull = pOut;
+			std::vector<T> vecFull;
+			if(mode == ConvMode::SAME)
+			{
+				vecFull.resize(iLen + K - 1);
+				pFull = vecFull.data();
+			}
+
+			if(UseFFT(iLen))
+				ConvolveFFT({ pIn }, { iLen }, { pFull });
+			else
+				ConvolveDirect(pIn, iLen, pFull);
+
+			if(mode == ConvMode::SAME)
+				std::copy(pFull + (K-1)/2, pFull + (K-1)/2 + iLen, pOut);
+		}
+
+		std::vector<T> Convolve(const std::vector<T>& vecIn, ConvMode mode = ConvMode::FULL)
+		{
+			std::vector<T> vecOut(GetOutLen(vecIn.size(), mode));
+			Convolve(vecIn.data(), vecIn.size(), vecOut.data(), mode);
+			return vecOut;
+		}
+
+		/**
+		 * convolves many signals with the kernel, sharing the ffts between them
+		 */
+		std::vector<std::vector<T>> ConvolveMany(const std::vector<std::vector<T>>& vecIns,
+			ConvMode mode = ConvMode::FULL)
+		{
+			const std::size_t K = m_vecKernel.size();
+			std::vector<std::vector<T>> vecOuts(vecIns.size());
+
+			std::vector<const T*> vecIn;
+			std::vector<std::size_t> vecLen;
+			std::vector<T*> vecOut;
+			std::size_t iMaxLen = 0;
+
+			for(std::size_t iSig=0; iSig<vecIns.size(); ++iSig)
+			{
+				if(vecIns[iSig].empty() || !K)
+					continue;
+
+				vecOuts[iSig].resize(vecIns[iSig].size() + K - 1);
+				vecIn.push_back(vecIns[iSig].data());
+				vecLen.push_back(vecIns[iSig].size());
+				vecOut.push_back(vecOuts[iSig].data());
+				iMaxLen = std::max(iMaxLen, vecIns[iSig].size());
+			}
+
+			if(vecIn.size() && UseFFT(iMaxLen))
+			{
+				ConvolveFFT(vecIn, vecLen, vecOut);
+			}
+			else
+			{
+				for(std::size_t iSig=0; iSig<vecIn.size(); ++iSig)
+					ConvolveDirect(vecIn[iSig], vecLen[iSig], vecOut[iSig]);
+			}
+
+			if(mode == ConvMode::SAME)
+			{
+				for(std::size_t iSig=0; iSig<vecOuts.size(); ++iSig)
+				{
+					std::vector<T>& vec = vecOuts[iSig];
+					if(vec.empty()) continue;
+
+					vec.erase(vec.begin(), vec.begin() + (K-1)/2);
+					vec.resize(vecIns[iSig].size());
+				}
+			}
+
+			return vecOuts;
+		}
+};
+
 }
 
 #endif
@@ -10,6 +10,10 @@
 
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
 #include <boost/math/distributions/normal.hpp>
 #include <boost/math/distributions/lognormal.hpp>
@@ -25,6 +29,8 @@
 #include <boost/math/distributions/gamma.hpp>
 #include <boost/math/distributions/logistic.hpp>
 
+#include "rand.h"
+
 namespace tl {
 namespace m = boost::math;
 
@@ -283,11 +289,46 @@ template<class t_real=double>
 class DistrBase
 {
 public:
+	virtual ~DistrBase() = default;
+
 	virtual t_real pdf(t_real x) const = 0;
 	virtual t_real cdf(t_real x) const = 0;	// cdf(x) == P(X <= x)
 	virtual t_real cdf_inv(t_real p) const = 0;
 
 	virtual t_real operator()(t_real x) const { return pdf(x); }
+
+
+	/**
+	 * array versions, one virtual call per array
+	 */
+	virtual void pdf_n(const t_real* px, t_real* py, std::size_t n) const
+	{
+		for(std::size_t i=0; i<n; ++i)
+			py[i] = pdf(px[i]);
+	}
+
+	virtual void cdf_n(const t_real* px, t_real* py, std::size_t n) const
+	{
+		for(std::size_t i=0; i<n; ++i)
+			py[i] = cdf(px[i]);
+	}
+
+	virtual void cdf_inv_n(const t_real* pp, t_real* px, std::size_t n) const
+	{
+		for(std::size_t i=0; i<n; ++i)
+			px[i] = cdf_inv(pp[i]);
+	}
+
+	/**
+	 * fills an array with random numbers following the distribution
+	 * (inversion method by default)
+	 */
+	virtual void sample_n(t_real* px, std::size_t n, Philox4x32& eng,
+		unsigned int iThreads = 1) const
+	{
+		rand01_n<t_real>(px, n, eng, iThreads);
+		cdf_inv_n(px, px, n);
+	}
 };
 
 
@@ -354,6 +395,28 @@ public:
 	{
 		return m::quantile(distr, p);
 	}
+
+
+	virtual void pdf_n(const t_real* px, t_real* py, std::size_t n) const override
+	{
+		for(std::size_t i=0; i<n; ++i)
+			py[i] = m::pdf(distr, traits_type::bIsDiscrete ? std::round(px[i]) : px[i]);
+	}
+
+	virtual void cdf_n(const t_real* px, t_real* py, std::size_t n) const override
+	{
+		for(std::size_t i=0; i<n; ++i)
+			py[i] = m::cdf(distr, traits_type::bIsDiscrete ? std::round(px[i]) : px[i]);
+	}
+
+	virtual void cdf_inv_n(const t_real* pp, t_real* px, std::size_t n) const override
+	{
+		for(std::size_t i=0; i<n; ++i)
+			px[i] = m::quantile(distr, pp[i]);
+	}
+
+
+	const t_distr& GetDistr() const { return distr; }
 };
 // ----------------------------------------------------------------------------
 
@@ -382,5 +445,451 @@ template<class t_real> using t_hypergeo_dist = Distr<m::hypergeometric_distribut
 // ----------------------------------------------------------------------------
 
 
+
+// ----------------------------------------------------------------------------
+/**
+ * coefficients of the cubic y(t) = c[0] + t*(c[1] + t*(c[2] + t*c[3])), t in [0, 1]
+ * through (0, y0) and (1, y1) with slopes dy/dt = m0, m1,
+ * the slopes are limited to keep the cubic monotonic (Fritsch-Carlson)
+ * @see https://doi.org/10.1137/0717021
+ */
+template<class t_real>
+void _distr_hermite(t_real y0, t_real y1, t_real m0, t_real m1, t_real* c)
+{
+	const t_real dy = y1 - y0;
+
+	if(dy <= t_real(0))
+	{
+		m0 = m1 = t_real(0);
+	}
+	else
+	{
+		// also catches infinite and nan slopes
+		if(!(m0 >= t_real(0))) m0 = t_real(0);
+		if(!(m1 >= t_real(0))) m1 = t_real(0);
+		if(!(m0 <= t_real(3)*dy)) m0 = t_real(3)*dy;
+		if(!(m1 <= t_real(3)*dy)) m1 = t_real(3)*dy;
+
+		const t_real dRad = (m0*m0 + m1*m1) / (dy*dy);
+		if(dRad > t_real(9))
+		{
+			const t_real dTau = t_real(3) / std::sqrt(dRad);
+			m0 *= dTau;
+			m1 *= dTau;
+		}
+	}
+
+	c[0] = y0;
+	c[1] = m0;
+	c[2] = t_real(3)*dy - t_real(2)*m0 - m1;
+	c[3] = m0 + m1 - t_real(2)*dy;
+}
+
+
+/**
+ * continuous distribution with tabulated cdf and inverse cdf
+ *
+ * the table nodes (x, cdf(x), pdf(x)) are placed adaptively, the intervals
+ * are bisected until the monotonic Hermite interpolants of cdf and cdf_inv
+ * reach the requested error at the interval midpoints (where the error of
+ * a cubic Hermite interpolant peaks) and quarter points:
+ *   |cdf_tab(x) - cdf(x)| <= eps  and  |cdf(cdf_inv_tab(p)) - p| <= eps.
+ * the tails p < eps and p > 1-eps are not tabulated but forwarded to the
+ * exact functions.
+ * @see (Hoermann and Leydold 2003), https://doi.org/10.1145/858481.858482
+ */
+template<class t_distr, class t_real=typename t_distr::value_type>
+class DistrTable : public DistrBase<t_real>
+{
+	static_assert(!t_distr::traits_type::bIsDiscrete,
+		"Tabulation is only supported for continuous distributions.");
+
+public:
+	using value_type = t_real;
+	using distr_type = t_distr;
+
+protected:
+	struct t_node { t_real x, F, f; };
+
+	t_distr m_distr;
+
+	// table nodes, x and cdf are increasing
+	std::vector<t_real> m_vecX, m_vecF;
+
+	// per interval: inverse scales and coefficients of cdf(x) and cdf_inv(p)
+	std::vector<t_real> m_vecInvDX, m_vecInvDF;
+	std::vector<std::array<t_real, 4>> m_vecCoeffF, m_vecCoeffX;
+
+	// guide table: first interval for p in [j/G, (j+1)/G[
+	std::vector<std::size_t> m_vecGuide;
+
+	t_real m_dMaxErr = t_real(0);
+	bool m_bOk = false;
+
+
+protected:
+	t_node make_node(t_real x) const
+	{
+		return t_node{ x, m_distr.cdf(x), m_distr.pdf(x) };
+	}
+
+	/**
+	 * checks if an interval is accurate enough, returns the midpoint otherwise
+	 */
+	bool check_interval(const t_node& nodeL, const t_node& nodeR, t_real dEps,
+		t_node& nodeMid, t_real& dErr) const
+	{
+		const t_real dF = nodeR.F - nodeL.F;
+		const t_real dX = nodeR.x - nodeL.x;
+		dErr = t_real(0);
+
+		// the interpolants are monotonic, so their error is bounded by dF
+		if(dF <= dEps)
+		{
+			dErr = std::max(dF, t_real(0));
+			return true;
+		}
+
+		// no more resolution in x
+		const t_real xMid = nodeL.x + t_real(0.5)*dX;
+		if(xMid <= nodeL.x || xMid >= nodeR.x)
+		{
+			dErr = dF;
+			return true;
+		}
+
+		// cdf error at the x midpoint and quarter points
+		t_real cF[4];
+		_distr_hermite(nodeL.F, nodeR.F, nodeL.f*dX, nodeR.f*dX, cF);
+		nodeMid = make_node(xMid);
+		t_real dErrF = std::abs(poly(cF, t_real(0.5)) - nodeMid.F);
+		for(t_real t : { t_real(0.25), t_real(0.75) })
+			dErrF = std::max(dErrF, std::abs(poly(cF, t) - m_distr.cdf(nodeL.x + t*dX)));
+
+		// inverse cdf error at the p midpoint and quarter points
+		t_real cX[4];
+		_distr_hermite(nodeL.x, nodeR.x, dF/nodeL.f, dF/nodeR.f, cX);
+		t_real dErrInv = t_real(0);
+		for(t_real t : { t_real(0.25), t_real(0.5), t_real(0.75) })
+			dErrInv = std::max(dErrInv, std::abs(m_distr.cdf(poly(cX, t)) - (nodeL.F + t*dF)));
+
+		dErr = std::max(dErrF, dErrInv);
+		return dErr <= dEps;
+	}
+
+	/**
+	 * evaluates the cubic of an interval
+	 */
+	static t_real poly(const t_real* c, t_real t)
+	{
+		return c[0] + t*(c[1] + t*(c[2] + t*c[3]));
+	}
+
+
+public:
+	/**
+	 * @param dEps requested absolute error in probability
+	 * @param iMaxNodes table size limit, IsOk() is false if it is reached
+	 */
+	DistrTable(const t_distr& distr, t_real dEps = t_real(1e-10),
+		std::size_t iMaxNodes = std::size_t(1) << 16)
+		: m_distr(distr)
+	{
+		constexpr std::size_t iInitNodes = 16;
+		iMaxNodes = std::max(iMaxNodes, iInitNodes);
+
+		const t_real xMin = m_distr.cdf_inv(dEps);
+		const t_real xMax = m_distr.cdf_inv(t_real(1) - dEps);
+		if(!std::isfinite(xMin) || !std::isfinite(xMax) || !(xMin < xMax))
+			return;
+
+		// initial equidistant nodes, pending right interval ends in reverse order
+		std::vector<t_node> vecStack;
+		vecStack.reserve(iInitNodes + 64);
+		for(std::size_t i=0; i<iInitNodes; ++i)
+		{
+			const t_real x = (i==0) ? xMax :
+				xMax - (xMax-xMin)*t_real(i)/t_real(iInitNodes-1);
+			vecStack.push_back(make_node(x));
+		}
+
+		// depth-first bisection from left to right
+		std::vector<t_node> vecNodes;
+		vecNodes.push_back(vecStack.back());
+		vecStack.pop_back();
+
+		m_bOk = true;
+		while(!vecStack.empty())
+		{
+			t_node nodeMid;
+			t_real dErr = t_real(0);
+			bool bAccept = check_interval(vecNodes.back(), vecStack.back(), dEps,
+				nodeMid, dErr);
+
+			if(!bAccept && vecNodes.size() + vecStack.size() >= iMaxNodes)
+			{
+				bAccept = true;
+				m_bOk = false;
+			}
+
+			if(bAccept)
+			{
+				m_dMaxErr = std::max(m_dMaxErr, dErr);
+				vecNodes.push_back(vecStack.back());
+				vecStack.pop_back();
+			}
+			else
+			{
+				vecStack.push_back(nodeMid);
+			}
+		}
+
+		// interval coefficients
+		const std::size_t iIntervals = vecNodes.size() - 1;
+		m_vecX.reserve(vecNodes.size());
+		m_vecF.reserve(vecNodes.size());
+		m_vecInvDX.reserve(iIntervals);
+		m_vecInvDF.reserve(iIntervals);
+		m_vecCoeffF.resize(iIntervals);
+		m_vecCoeffX.resize(iIntervals);
+
+		for(const t_node& node : vecNodes)
+		{
+			m_vecX.push_back(node.x);
+			m_vecF.push_back(node.F);
+		}
+
+		for(std::size_t i=0; i<iIntervals; ++i)
+		{
+			const t_node& nodeL = vecNodes[i];
+			const t_node& nodeR = vecNodes[i+1];
+			const t_real dX = nodeR.x - nodeL.x;
+			const t_real dF = nodeR.F - nodeL.F;
+
+			m_vecInvDX.push_back(t_real(1) / dX);
+			m_vecInvDF.push_back(dF > t_real(0) ? t_real(1) / dF : t_real(0));
+			_distr_hermite(nodeL.F, nodeR.F, nodeL.f*dX, nodeR.f*dX, m_vecCoeffF[i].data());
+			_distr_hermite(nodeL.x, nodeR.x, dF/nodeL.f, dF/nodeR.f, m_vecCoeffX[i].data());
+		}
+
+		// guide table with one entry per interval
+		m_vecGuide.resize(iIntervals);
+		std::size_t iInterval = 0;
+		for(std::size_t j=0; j<iIntervals; ++j)
+		{
+			const t_real p = t_real(j) / t_real(iIntervals);
+			while(iInterval+1 < iIntervals && m_vecF[iInterval+1] <= p)
+				++iInterval;
+			m_vecGuide[j] = iInterval;
+		}
+	}
+
+
+	bool IsOk() const { return m_bOk; }
+	std::size_t GetNumNodes() const { return m_vecX.size(); }
+
+	/**
+	 * largest error found while building the table
+	 */
+	t_real GetMaxError() const { return m_dMaxErr; }
+
+	const t_distr& GetDistr() const { return m_distr; }
+
+
+	virtual t_real pdf(t_real x) const override
+	{
+		return m_distr.pdf(x);
+	}
+
+	virtual t_real cdf(t_real x) const override
+	{
+		if(m_vecX.size() < 2 || !(x >= m_vecX.front() && x <= m_vecX.back()))
+			return m_distr.cdf(x);
+
+		std::size_t i = std::upper_bound(m_vecX.begin(), m_vecX.end(), x) - m_vecX.begin();
+		i = std::min(i, m_vecX.size()-1) - 1;
+		return poly(m_vecCoeffF[i].data(), (x - m_vecX[i]) * m_vecInvDX[i]);
+	}
+
+	virtual t_real cdf_inv(t_real p) const override
+	{
+		if(m_vecF.size() < 2 || !(p >= m_vecF.front() && p <= m_vecF.back()))
+			return m_distr.cdf_inv(p);
+
+		const std::size_t iIntervals = m_vecGuide.size();
+		std::size_t i = m_vecGuide[std::min(std::size_t(p * t_real(iIntervals)), iIntervals-1)];
+		while(i+1 < iIntervals && m_vecF[i+1] < p)
+			++i;
+		return poly(m_vecCoeffX[i].data(), (p - m_vecF[i]) * m_vecInvDF[i]);
+	}
+
+
+	virtual void pdf_n(const t_real* px, t_real* py, std::size_t n) const override
+	{
+		m_distr.pdf_n(px, py, n);
+	}
+
+	virtual void cdf_n(const t_real* px, t_real* py, std::size_t n) const override
+	{
+		for(std::size_t i=0; i<n; ++i)
+			py[i] = DistrTable::cdf(px[i]);
+	}
+
+	virtual void cdf_inv_n(const t_real* pp, t_real* px, std::size_t n) const override
+	{
+		for(std::size_t i=0; i<n; ++i)
+			px[i] = DistrTable::cdf_inv(pp[i]);
+	}
+};
+
+
+/**
+ * discrete distribution with an alias table for sampling
+ * (Walker's method in Vose's formulation, O(1) per sample)
+ * the table covers the values with cdf in [eps, 1-eps] and is renormalised,
+ * the truncated probability is therefore at most 2*eps
+ * @see https://doi.org/10.1109/32.92917
+ */
+template<class t_distr, class t_real=typename t_distr::value_type>
+class DistrAlias : public DistrBase<t_real>
+{
+	static_assert(t_distr::traits_type::bIsDiscrete,
+		"Alias tables are only supported for discrete distributions.");
+
+public:
+	using value_type = t_real;
+	using distr_type = t_distr;
+
+protected:
+	t_distr m_distr;
+
+	// smallest value in the table
+	t_real m_dMin = t_real(0);
+
+	// acceptance probability and alias of each value
+	std::vector<t_real> m_vecProb;
+	std::vector<std::uint32_t> m_vecAlias;
+
+
+public:
+	DistrAlias(const t_distr& distr, t_real dEps = t_real(1e-12))
+		: m_distr(distr)
+	{
+		const auto range = m::support(m_distr.GetDistr());
+		t_real dMin = std::floor(m_distr.cdf_inv(dEps));
+		t_real dMax = std::ceil(m_distr.cdf_inv(t_real(1) - dEps));
+		dMin = std::max(dMin, std::ceil(range.first));
+		dMax = std::min(dMax, std::floor(range.second));
+		if(!std::isfinite(dMin) || !std::isfinite(dMax) || dMax < dMin ||
+			dMax - dMin >= t_real(std::numeric_limits<std::uint32_t>::max()))
+			return;
+
+		const std::size_t iSize = std::size_t(dMax - dMin) + 1;
+		m_dMin = dMin;
+		m_vecProb.resize(iSize);
+		m_vecAlias.resize(iSize);
+
+		t_real dTotal = t_real(0);
+		for(std::size_t i=0; i<iSize; ++i)
+		{
+			m_vecProb[i] = m_distr.pdf(dMin + t_real(i));
+			dTotal += m_vecProb[i];
+		}
+
+		// split into under- and overfull bins
+		std::vector<std::uint32_t> vecSmall, vecLarge;
+		vecSmall.reserve(iSize);
+		vecLarge.reserve(iSize);
+
+		const t_real dScale = t_real(iSize) / dTotal;
+		for(std::size_t i=0; i<iSize; ++i)
+		{
+			m_vecProb[i] *= dScale;
+			m_vecAlias[i] = std::uint32_t(i);
+			if(m_vecProb[i] < t_real(1))
+				vecSmall.push_back(std::uint32_t(i));
+			else
+				vecLarge.push_back(std::uint32_t(i));
+		}
+
+		// fill each underfull bin from an overfull one
+		while(!vecSmall.empty() && !vecLarge.empty())
+		{
+			const std::uint32_t iSmall = vecSmall.back();
+			const std::uint32_t iLarge = vecLarge.back();
+			vecSmall.pop_back();
+
+			m_vecAlias[iSmall] = iLarge;
+			m_vecProb[iLarge] -= t_real(1) - m_vecProb[iSmall];
+
+			if(m_vecProb[iLarge] < t_real(1))
+			{
+				vecLarge.pop_back();
+				vecSmall.push_back(iLarge);
+			}
+		}
+
+		// remaining bins are full up to rounding
+		for(std::uint32_t i : vecSmall) m_vecProb[i] = t_real(1);
+		for(std::uint32_t i : vecLarge) m_vecProb[i] = t_real(1);
+	}
+
+
+	bool IsOk() const { return !m_vecProb.empty(); }
+	std::size_t GetSize() const { return m_vecProb.size(); }
+	const t_distr& GetDistr() const { return m_distr; }
+
+
+	/**
+	 * maps a uniform random number in [0, 1[ to a sample
+	 */
+	t_real sample(t_real u) const
+	{
+		const std::size_t iSize = m_vecProb.size();
+		const t_real dBin = u * t_real(iSize);
+		const std::size_t iBin = std::min(std::size_t(dBin), iSize-1);
+
+		const std::size_t iVal = (dBin - t_real(iBin) < m_vecProb[iBin])
+			? iBin : m_vecAlias[iBin];
+		return m_dMin + t_real(iVal);
+	}
+
+
+	virtual t_real pdf(t_real x) const override { return m_distr.pdf(x); }
+	virtual t_real cdf(t_real x) const override { return m_distr.cdf(x); }
+	virtual t_real cdf_inv(t_real p) const override { return m_distr.cdf_inv(p); }
+
+	virtual void pdf_n(const t_real* px, t_real* py, std::size_t n) const override
+	{
+		m_distr.pdf_n(px, py, n);
+	}
+
+	virtual void cdf_n(const t_real* px, t_real* py, std::size_t n) const override
+	{
+		m_distr.cdf_n(px, py, n);
+	}
+
+	virtual void cdf_inv_n(const t_real* pp, t_real* px, std::size_t n) const override
+	{
+		m_distr.cdf_inv_n(pp, px, n);
+	}
+
+	virtual void sample_n(t_real* px, std::size_t n, Philox4x32& eng,
+		unsigned int iThreads = 1) const override
+	{
+		if(m_vecProb.empty())
+		{
+			DistrBase<t_real>::sample_n(px, n, eng, iThreads);
+			return;
+		}
+
+		rand01_n<t_real>(px, n, eng, iThreads);
+		for(std::size_t i=0; i<n; ++i)
+			px[i] = sample(px[i]);
+	}
+};
+// ----------------------------------------------------------------------------
+
+
 }
 #endif
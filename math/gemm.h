@@ -0,0 +1,464 @@
+/**
+ * cache-blocked and threaded matrix-matrix and matrix-vector products
+ * for contiguous (row- or column-major) storage
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @date oct-2026
+ * @license GPLv2 or GPLv3
+ * @desc blocking scheme follows, e.g., (Goto 2008)
+ */
+
+#ifndef __TLIBS_GEMM_H__
+#define __TLIBS_GEMM_H__
+
+#include <cstddef>
+#include <vector>
+#include <complex>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+
+#include "../helper/thread.h"
+
+
+namespace tl {
+
+namespace ublas = boost::numeric::ublas;
+
+
+// ----------------------------------------------------------------------------
+// block sizes and thresholds
+
+struct gemm_consts
+{
+	enum : std::size_t
+	{
+		MC = 64,		// rows of a packed block of A
+		KC = 256,		// inner dimension of the packed blocks
+		NC = 256,		// columns of a packed block of B
+
+		// minimum number of multiplications for which the blocked kernels pay off
+		MIN_OPS_MM = 48*48*48,
+		MIN_OPS_MV = 64*64,
+
+		// minimum number of multiplications per thread
+		MIN_OPS_MM_THREAD = 128*128*128,
+		MIN_OPS_MV_THREAD = 256*1024,
+	};
+};
+
+
+/**
+ * number of threads to use for a given amount of work
+ * iThreads == 0 selects the number automatically
+ */
+static inline unsigned int gemm_num_threads(std::size_t iOps, std::size_t iOpsPerThread,
+	std::size_t iMaxThreads, unsigned int iThreads = 0)
+{
+	if(iThreads == 0)
+	{
+		iThreads = std::max<unsigned int>(1, std::thread::hardware_concurrency());
+		iThreads = unsigned(std::min<std::size_t>(iThreads, iOps/iOpsPerThread));
+	}
+
+	iThreads = unsigned(std::min<std::size_t>(iThreads, iMaxThreads));
+	return std::max<unsigned int>(iThreads, 1);
+}
+
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// kernels on raw memory
+
+/**
+ * copies the (iRows x iCols) block of a strided matrix into a contiguous
+ * row-major buffer
+ */
+template<class T>
+void gemm_pack(const T* pMat, std::ptrdiff_t iRowStride, std::ptrdiff_t iColStride,
+	std::size_t iRows, std::size_t iCols, T* pPacked)
+{
+	if(iColStride == 1)
+	{
+		for(std::size_t i=0; i<iRows; ++i)
+			std::copy(pMat + i*iRowStride, pMat + i*iRowStride + iCols, pPacked + i*iCols);
+	}
+	else
+	{
+		for(std::size_t i=0; i<iRows; ++i)
+			for(std::size_t j=0; j<iCols; ++j)
+				pPacked[i*iCols + j] = pMat[i*iRowStride + j*iColStride];
+	}
+}
+
+
+/**
+ * C += A*B for a packed (iM x iK) block A and a packed (iK x iN) block B,
+ * C is row-major with row stride iRowStrideC.
+ * four rows of C are updated at a time so that each row of B is reused from
+ * registers, the innermost loop runs over contiguous memory to allow vectorisation.
+ */
+template<class T>
+void gemm_kernel(const T* pA, const T* pB, T* pC, std::ptrdiff_t iRowStrideC,
+	std::size_t iM, std::size_t iN, std::size_t iK)
+{
+	std::size_t i = 0;
+
+	for(; i+4 <= iM; i+=4)
+	{
+		T *pC0 = pC + (i+0)*iRowStrideC;
+		T *pC1 = pC + (i+1)*iRowStrideC;
+		T *pC2 = pC + (i+2)*iRowStrideC;
+		T *pC3 = pC + (i+3)*iRowStrideC;
+
+		for(std::size_t k=0; k<iK; ++k)
+		{
+			const T a0 = pA[(i+0)*iK + k];
+			const T a1 = pA[(i+1)*iK + k];
+			const T a2 = pA[(i+2)*iK + k];
+			const T a3 = pA[(i+3)*iK + k];
+			const T *pBk = pB + k*iN;
+
+			for(std::size_t j=0; j<iN; ++j)
+			{
+				const T b = pBk[j];
+				pC0[j] += a0*b;
+				pC1[j] += a1*b;
+				pC2[j] += a2*b;
+				pC3[j] += a3*b;
+			}
+		}
+	}
+
+	// remaining rows
+	for(; i<iM; ++i)
+	{
+		T *pCi = pC + i*iRowStrideC;
+
+		for(std::size_t k=0; k<iK; ++k)
+		{
+			const T a = pA[i*iK + k];
+			const T *pBk = pB + k*iN;
+
+			for(std::size_t j=0; j<iN; ++j)
+				pCi[j] += a*pBk[j];
+		}
+	}
+}
+
+
+/**
+ * C = A*B for strided matrices, A: (iM x iK), B: (iK x iN), C: (iM x iN)
+ * the rows of C are distributed over iThreads threads (0: automatic);
+ * the result does not depend on the number of threads.
+ */
+template<class T>
+void gemm(std::size_t iM, std::size_t iN, std::size_t iK,
+	const T* pA, std::ptrdiff_t iRowStrideA, std::ptrdiff_t iColStrideA,
+	const T* pB, std::ptrdiff_t iRowStrideB, std::ptrdiff_t iColStrideB,
+	T* pC, std::ptrdiff_t iRowStrideC, std::ptrdiff_t iColStrideC,
+	unsigned int iThreads = 0)
+{
+	// column-major C: calculate C^t = B^t A^t instead
+	if(iColStrideC != 1)
+	{
+		std::swap(iM, iN);
+		std::swap(pA, pB);
+		std::swap(iRowStrideA, iColStrideB);
+		std::swap(iColStrideA, iRowStrideB);
+		std::swap(iRowStrideC, iColStrideC);
+	}
+
+	// C is row-major now
+	if(iColStrideC != 1)
+	{
+		for(std::size_t i=0; i<iM; ++i)
+			for(std::size_t j=0; j<iN; ++j)
+			{
+				T t = T(0);
+				for(std::size_t k=0; k<iK; ++k)
+					t += pA[i*iRowStrideA + k*iColStrideA] * pB[k*iRowStrideB + j*iColStrideB];
+				pC[i*iRowStrideC + j*iColStrideC] = t;
+			}
+		return;
+	}
+
+	const std::size_t MC = gemm_consts::MC;
+	const std::size_t KC = gemm_consts::KC;
+	const std::size_t NC = gemm_consts::NC;
+
+	iThreads = gemm_num_threads(iM*iN*iK, gemm_consts::MIN_OPS_MM_THREAD,
+		(iM + MC - 1) / MC, iThreads);
+
+	run_stripes(iM, iThreads, [&](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		std::vector<T> vecA(MC*KC), vecB(KC*NC);
+
+		for(std::size_t i=iStart; i<iEnd; ++i)
+			std::fill(pC + i*iRowStrideC, pC + i*iRowStrideC + iN, T(0));
+
+		for(std::size_t j0=0; j0<iN; j0+=NC)
+		{
+			const std::size_t iNC = std::min(NC, iN-j0);
+
+			for(std::size_t k0=0; k0<iK; k0+=KC)
+			{
+				const std::size_t iKC = std::min(KC, iK-k0);
+				gemm_pack(pB + k0*iRowStrideB + j0*iColStrideB,
+					iRowStrideB, iColStrideB, iKC, iNC, vecB.data());
+
+				for(std::size_t i0=iStart; i0<iEnd; i0+=MC)
+				{
+					const std::size_t iMC = std::min(MC, iEnd-i0);
+					gemm_pack(pA + i0*iRowStrideA + k0*iColStrideA,
+						iRowStrideA, iColStrideA, iMC, iKC, vecA.data());
+
+					gemm_kernel(vecA.data(), vecB.data(),
+						pC + i0*iRowStrideC + j0, iRowStrideC, iMC, iNC, iKC);
+				}
+			}
+		}
+	});
+}
+
+
+/**
+ * y = A*x for a strided matrix A: (iM x iN) and contiguous vectors x and y
+ */
+template<class T>
+void gemv(std::size_t iM, std::size_t iN,
+	const T* pA, std::ptrdiff_t iRowStrideA, std::ptrdiff_t iColStrideA,
+	const T* px, T* py, unsigned int iThreads = 0)
+{
+	iThreads = gemm_num_threads(iM*iN, gemm_consts::MIN_OPS_MV_THREAD,
+		(iM + gemm_consts::MC - 1) / gemm_consts::MC, iThreads);
+
+	run_stripes(iM, iThreads, [&](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		// row-major: dot products with four partial sums
+		if(iColStrideA == 1)
+		{
+			for(std::size_t i=iStart; i<iEnd; ++i)
+			{
+				const T *pRow = pA + i*iRowStrideA;
+				T t0 = T(0), t1 = T(0), t2 = T(0), t3 = T(0);
+
+				std::size_t j = 0;
+				for(; j+4 <= iN; j+=4)
+				{
+					t0 += pRow[j+0]*px[j+0];
+					t1 += pRow[j+1]*px[j+1];
+					t2 += pRow[j+2]*px[j+2];
+					t3 += pRow[j+3]*px[j+3];
+				}
+				for(; j<iN; ++j)
+					t0 += pRow[j]*px[j];
+
+				py[i] = (t0+t1) + (t2+t3);
+			}
+		}
+
+		// column-major: y += A_j x_j on the contiguous columns
+		else if(iRowStrideA == 1)
+		{
+			std::fill(py + iStart, py + iEnd, T(0));
+
+			for(std::size_t j=0; j<iN; ++j)
+			{
+				const T *pCol = pA + j*iColStrideA;
+				const T x = px[j];
+
+				for(std::size_t i=iStart; i<iEnd; ++i)
+					py[i] += pCol[i]*x;
+			}
+		}
+
+		// general strides
+		else
+		{
+			for(std::size_t i=iStart; i<iEnd; ++i)
+			{
+				T t = T(0);
+				for(std::size_t j=0; j<iN; ++j)
+					t += pA[i*iRowStrideA + j*iColStrideA]*px[j];
+				py[i] = t;
+			}
+		}
+	});
+}
+
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// ublas interface
+
+template<class T> struct gemm_is_value : std::is_arithmetic<T> {};
+template<class T> struct gemm_is_value<std::complex<T>> : std::is_floating_point<T> {};
+
+
+/**
+ * which matrix types have contiguous row- or column-major storage
+ */
+template<class t_mat>
+struct gemm_storage
+{
+	static constexpr bool value = false;
+};
+
+template<class T, class t_arr>
+struct gemm_storage<ublas::matrix<T, ublas::row_major, t_arr>>
+{
+	static constexpr bool value = gemm_is_value<T>::value;
+
+	static std::ptrdiff_t row_stride(const ublas::matrix<T, ublas::row_major, t_arr>& mat)
+	{ return std::ptrdiff_t(mat.size2()); }
+	static std::ptrdiff_t col_stride(const ublas::matrix<T, ublas::row_major, t_arr>&)
+	{ return 1; }
+};
+
+template<class T, class t_arr>
+struct gemm_storage<ublas::matrix<T, ublas::column_major, t_arr>>
+{
+	static constexpr bool value = gemm_is_value<T>::value;
+
+	static std::ptrdiff_t row_stride(const ublas::matrix<T, ublas::column_major, t_arr>&)
+	{ return 1; }
+	static std::ptrdiff_t col_stride(const ublas::matrix<T, ublas::column_major, t_arr>& mat)
+	{ return std::ptrdiff_t(mat.size1()); }
+};
+
+
+template<class t_vec>
+struct gemv_storage
+{
+	static constexpr bool value = false;
+};
+
+template<class T, class t_arr>
+struct gemv_storage<ublas::vector<T, t_arr>>
+{
+	static constexpr bool value = gemm_is_value<T>::value;
+};
+
+
+/**
+ * blocked matrix-matrix product for contiguous matrices
+ */
+template<class t_mat, typename std::enable_if<gemm_storage<t_mat>::value, char>::type=0>
+t_mat prod_mm_blocked(const t_mat& mat0, const t_mat& mat1, unsigned int iThreads = 0)
+{
+	using t_stor = gemm_storage<t_mat>;
+
+	const std::size_t iM = mat0.size1();
+	const std::size_t iN = mat1.size2();
+	const std::size_t iK = mat0.size2();
+
+	if(iK != mat1.size1())
+		return t_mat(0, 0);
+
+	t_mat matRet(iM, iN);
+	if(iM==0 || iN==0)
+		return matRet;
+	if(iK==0)
+	{
+		std::fill(matRet.data().begin(), matRet.data().end(), typename t_mat::value_type(0));
+		return matRet;
+	}
+
+	gemm(iM, iN, iK,
+		&mat0.data()[0], t_stor::row_stride(mat0), t_stor::col_stride(mat0),
+		&mat1.data()[0], t_stor::row_stride(mat1), t_stor::col_stride(mat1),
+		&matRet.data()[0], t_stor::row_stride(matRet), t_stor::col_stride(matRet),
+		iThreads);
+
+	return matRet;
+}
+
+
+/**
+ * blocked matrix-vector product for contiguous matrices and vectors
+ */
+template<class t_vec, class t_mat,
+	typename std::enable_if<gemm_storage<t_mat>::value && gemv_storage<t_vec>::value, char>::type=0>
+t_vec prod_mv_blocked(const t_mat& mat, const t_vec& vec, unsigned int iThreads = 0)
+{
+	using t_stor = gemm_storage<t_mat>;
+
+	const std::size_t iM = mat.size1();
+	const std::size_t iN = mat.size2();
+
+	if(iN != vec.size())
+		return t_vec(0);
+
+	t_vec vecRet(iM);
+	if(iM == 0)
+		return vecRet;
+	if(iN == 0)
+	{
+		std::fill(vecRet.begin(), vecRet.end(), typename t_vec::value_type(0));
+		return vecRet;
+	}
+
+	gemv(iM, iN, &mat.data()[0], t_stor::row_stride(mat), t_stor::col_stride(mat),
+		&vec.data()[0], &vecRet.data()[0], iThreads);
+
+	return vecRet;
+}
+
+
+/**
+ * uses the blocked matrix-matrix product if the storage allows and the size warrants it
+ */
+template<class t_mat, typename std::enable_if<gemm_storage<t_mat>::value, char>::type=0>
+bool prod_mm_auto(const t_mat& mat0, const t_mat& mat1, t_mat& matRet)
+{
+	if(mat0.size2() != mat1.size1())
+		return false;
+	if(mat0.size1() * mat1.size2() * mat0.size2() < gemm_consts::MIN_OPS_MM)
+		return false;
+
+	matRet = prod_mm_blocked<t_mat>(mat0, mat1);
+	return true;
+}
+
+template<class t_mat, typename std::enable_if<!gemm_storage<t_mat>::value, char>::type=0>
+bool prod_mm_auto(const t_mat&, const t_mat&, t_mat&)
+{
+	return false;
+}
+
+
+/**
+ * uses the blocked matrix-vector product if the storage allows and the size warrants it
+ */
+template<class t_vec, class t_mat,
+	typename std::enable_if<gemm_storage<t_mat>::value && gemv_storage<t_vec>::value, char>::type=0>
+bool prod_mv_auto(const t_mat& mat, const t_vec& vec, t_vec& vecRet)
+{
+	if(mat.size2() != vec.size())
+		return false;
+	if(mat.size1() * mat.size2() < gemm_consts::MIN_OPS_MV)
+		return false;
+
+	vecRet = prod_mv_blocked<t_vec, t_mat>(mat, vec);
+	return true;
+}
+
+template<class t_vec, class t_mat,
+	typename std::enable_if<!(gemm_storage<t_mat>::value && gemv_storage<t_vec>::value), char>::type=0>
+bool prod_mv_auto(const t_mat&, const t_vec&, t_vec&)
+{
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+
+}
+#endif
@@ -14,6 +14,7 @@
 #include "../log/log.h"
 #include "../log/debug.h"
 #include "../helper/traits.h"
+#include "gemm.h"
 
 #include <initializer_list>
 #include <cmath>
@@ -526,11 +527,16 @@ t_mat prod_mm(const t_mat& mat0, const t_mat& mat1)
 
 /**
  * matrix-matrix product -- ublas wrapper
+ * large matrices with contiguous storage use the blocked kernel from gemm.h
  */
 template<typename t_mat = ublas::matrix<double>,
 typename std::enable_if<std::is_convertible<t_mat, ublas::matrix<typename t_mat::value_type>>::value, char>::type=0>
 t_mat prod_mm(const t_mat& mat0, const t_mat& mat1)
 {
+	t_mat matRet;
+	if(prod_mm_auto<t_mat>(mat0, mat1, matRet))
+		return matRet;
+
 	return ublas::prod(mat0, mat1);
 }
 
@@ -563,12 +569,17 @@ t_vec prod_mv(const t_mat& mat, const t_vec& vec)
 
 /**
  * matrix-vector product -- ublas wrapper
+ * large matrices with contiguous storage use the blocked kernel from gemm.h
  */
 template<typename t_vec = ublas::vector<double>,
 typename t_mat = ublas::matrix<typename t_vec::value_type>,
 typename std::enable_if<std::is_convertible<t_vec, ublas::vector<typename t_vec::value_type>>::value, char>::type=0>
 t_vec prod_mv(const t_mat& mat, const t_vec& vec)
 {
+	t_vec vecRet;
+	if(prod_mv_auto<t_vec, t_mat>(mat, vec, vecRet))
+		return vecRet;
+
 	return ublas::prod(mat, vec);
 }
 
@@ -35,6 +35,14 @@ template bool eigenvec_herm(const ublas::matrix<std::complex<double>>& mat,
 	std::vector<ublas::vector<std::complex<double>>>& evecs,
 	std::vector<double>& evals);
 
+template bool eigenvec_herm_batch(const std::complex<double>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, double* pEvals, std::complex<double>* pEvecs,
+	unsigned int iThreads);
+
+template bool eigenvecsel_herm_batch(const std::complex<double>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, double* pEvals, std::complex<double>* pEvecs,
+	std::size_t* pNumFound, double minval, double maxval, double eps, unsigned int iThreads);
+
 }
 
 #endif
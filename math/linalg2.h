@@ -11,7 +11,11 @@
 
 #include "math.h"
 #include "linalg.h"
+#include "../helper/thread.h"
 #include <complex>
+#include <vector>
+#include <atomic>
+#include <limits>
 
 
 namespace tl {
@@ -21,6 +25,157 @@ namespace tl {
 #endif
 
 
+// ----------------------------------------------------------------------------
+// batched hermitian eigenproblems
+
+// matrices up to this order are diagonalised using jacobi rotations
+#define TLIBS_EIGEN_JACOBI_MAX_ORDER 4
+
+
+/**
+ * calculates the eigenvectors of a hermitian matrix using cyclic jacobi rotations
+ * @param pMat row-major matrix of order iOrder
+ * @param pEvals iOrder eigenvalues, sorted in ascending order
+ * @param pEvecs iOrder normalised eigenvectors, eigenvector i is at pEvecs[i*iOrder] (may be nullptr)
+ * @param pWork workspace of 2*iOrder*iOrder elements
+ * @see (Scherer 2010), pp. 120-124
+ */
+template<typename T=double>
+bool eigenvec_herm_jacobi(const std::complex<T>* pMat, std::size_t iOrder,
+	T* pEvals, std::complex<T>* pEvecs, std::complex<T>* pWork,
+	std::size_t iMaxSweeps = 64)
+{
+	using t_cplx = std::complex<T>;
+	const std::size_t N = iOrder;
+	const T eps = std::numeric_limits<T>::epsilon();
+
+	t_cplx *pA = pWork;
+	t_cplx *pV = pWork + N*N;
+
+	T dNorm = T(0);
+	for(std::size_t i=0; i<N*N; ++i)
+	{
+		pA[i] = pMat[i];
+		pV[i] = t_cplx(0);
+		dNorm += std::norm(pA[i]);
+	}
+	for(std::size_t i=0; i<N; ++i)
+		pV[i*N + i] = t_cplx(1);
+
+	bool bConverged = false;
+	for(std::size_t iSweep=0; iSweep<iMaxSweeps; ++iSweep)
+	{
+		T dOff = T(0);
+		for(std::size_t p=0; p<N; ++p)
+			for(std::size_t q=p+1; q<N; ++q)
+				dOff += T(2)*std::norm(pA[p*N + q]);
+
+		if(dOff <= eps*eps*dNorm)
+		{
+			bConverged = true;
+			break;
+		}
+
+		for(std::size_t p=0; p<N; ++p)
+		{
+			for(std::size_t q=p+1; q<N; ++q)
+			{
+				const T dAbs = std::abs(pA[p*N + q]);
+				if(dAbs == T(0))
+					continue;
+
+				// rotation U = [[c, s*ph], [-s*conj(ph), c]] in the (p,q) plane
+				const t_cplx ph = pA[p*N + q] / dAbs;
+				const T tau = (pA[q*N + q].real() - pA[p*N + p].real()) / (T(2)*dAbs);
+				const T t = (tau >= T(0) ? T(1) : T(-1)) / (std::abs(tau) + std::sqrt(T(1) + tau*tau));
+				const T c = T(1) / std::sqrt(T(1) + t*t);
+				const T s = t*c;
+
+				// A <- A U, V <- V U
+				for(std::size_t k=0; k<N; ++k)
+				{
+					const t_cplx akp = pA[k*N + p], akq = pA[k*N + q];
+					pA[k*N + p] = c*akp - s*std::conj(ph)*akq;
+					pA[k*N + q] = s*ph*akp + c*akq;
+
+					const t_cplx vkp = pV[k*N + p], vkq = pV[k*N + q];
+					pV[k*N + p] = c*vkp - s*std::conj(ph)*vkq;
+					pV[k*N + q] = s*ph*vkp + c*vkq;
+				}
+
+				// A <- U^H A
+				for(std::size_t k=0; k<N; ++k)
+				{
+					const t_cplx apk = pA[p*N + k], aqk = pA[q*N + k];
+					pA[p*N + k] = c*apk - s*ph*aqk;
+					pA[q*N + k] = s*std::conj(ph)*apk + c*aqk;
+				}
+
+				pA[p*N + q] = pA[q*N + p] = t_cplx(0);
+				pA[p*N + p] = pA[p*N + p].real();
+				pA[q*N + q] = pA[q*N + q].real();
+			}
+		}
+	}
+
+	for(std::size_t i=0; i<N; ++i)
+	{
+		pEvals[i] = pA[i*N + i].real();
+
+		if(pEvecs)
+		{
+			for(std::size_t k=0; k<N; ++k)
+				pEvecs[i*N + k] = pV[k*N + i];
+		}
+	}
+
+	// sort eigenvalues in ascending order like lapack
+	for(std::size_t i=1; i<N; ++i)
+	{
+		for(std::size_t j=i; j>0 && pEvals[j] < pEvals[j-1]; --j)
+		{
+			std::swap(pEvals[j], pEvals[j-1]);
+			if(pEvecs)
+				std::swap_ranges(pEvecs + j*N, pEvecs + (j+1)*N, pEvecs + (j-1)*N);
+		}
+	}
+
+	if(!bConverged)
+		log_err("Jacobi eigenvalue iteration did not converge.");
+	return bConverged;
+}
+
+
+/**
+ * only keeps the eigenvalues (and eigenvectors) in the range [minval, maxval]
+ * @return number of remaining eigenvalues
+ */
+template<typename T=double>
+std::size_t eigen_select(std::size_t iOrder, T* pEvals, std::complex<T>* pEvecs,
+	T minval, T maxval)
+{
+	// invalid range selects all eigenvalues
+	if(minval > maxval)
+		return iOrder;
+
+	std::size_t iNumFound = 0;
+	for(std::size_t i=0; i<iOrder; ++i)
+	{
+		if(pEvals[i] < minval || pEvals[i] > maxval)
+			continue;
+
+		pEvals[iNumFound] = pEvals[i];
+		if(pEvecs && iNumFound != i)
+			std::copy(pEvecs + i*iOrder, pEvecs + (i+1)*iOrder, pEvecs + iNumFound*iOrder);
+		++iNumFound;
+	}
+
+	return iNumFound;
+}
+
+// ----------------------------------------------------------------------------
+
+
 #ifdef NO_LAPACK	// direct implementation
 
 /**
@@ -69,6 +224,62 @@ bool eigenvec_approxsym(const ublas::matrix<T>& mat,
 }
 
 
+/**
+ * calculates the eigenvectors of a batch of hermitian matrices
+ * (see the lapack version below for the parameters)
+ */
+template<typename T=double>
+bool eigenvec_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, std::complex<T>* pEvecs,
+	unsigned int iThreads=0)
+{
+	if(iOrder == 0)
+		return false;
+	if(iStride == 0)
+		iStride = iOrder*iOrder;
+
+	std::atomic<bool> bOk(true);
+
+	run_stripes(iNumMats, get_num_threads(iNumMats, iThreads),
+		[&](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		std::vector<std::complex<T>> vecWork(2*iOrder*iOrder);
+
+		for(std::size_t iMat=iStart; iMat<iEnd; ++iMat)
+		{
+			if(!eigenvec_herm_jacobi<T>(pMats + iMat*iStride, iOrder,
+				pEvals + iMat*iOrder, pEvecs ? pEvecs + iMat*iOrder*iOrder : nullptr,
+				vecWork.data()))
+				bOk = false;
+		}
+	});
+
+	return bOk;
+}
+
+/**
+ * calculates selected eigenvectors of a batch of hermitian matrices
+ * (see the lapack version below for the parameters, eps is not used here)
+ */
+template<typename T=double>
+bool eigenvecsel_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, std::complex<T>* pEvecs,
+	std::size_t* pNumFound, T minval=-1, T maxval=-2, T /*eps*/=T(-1),
+	unsigned int iThreads=0)
+{
+	bool bOk = eigenvec_herm_batch<T>(pMats, iNumMats, iOrder, iStride,
+		pEvals, pEvecs, iThreads);
+
+	for(std::size_t iMat=0; iMat<iNumMats; ++iMat)
+	{
+		pNumFound[iMat] = eigen_select<T>(iOrder, pEvals + iMat*iOrder,
+			pEvecs ? pEvecs + iMat*iOrder*iOrder : nullptr, minval, maxval);
+	}
+
+	return bOk;
+}
+
+
 #else	// Lapack wrappers
 
 
@@ -146,6 +357,32 @@ bool eigenvecsel_herm(const ublas::matrix<std::complex<T>>& mat,
 	std::vector<T>& evals, bool bNorm=0, T minval=-1, T maxval=-2, T eps=T(-1));
 
 
+/**
+ * calculates the eigenvectors of a batch of hermitian matrices
+ * @param pMats iNumMats row-major matrices of order iOrder, matrix i starts at pMats[i*iStride]
+ * @param iStride distance between the matrices, 0 means iOrder*iOrder
+ * @param pEvals output for iNumMats*iOrder eigenvalues, each set sorted in ascending order
+ * @param pEvecs output for iNumMats*iOrder*iOrder elements, eigenvector j of matrix i
+ *        is at pEvecs[(i*iOrder + j)*iOrder], nullptr only calculates the eigenvalues
+ * @param iThreads number of threads, 0 means all hardware threads
+ */
+template<typename T=double>
+bool eigenvec_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, std::complex<T>* pEvecs,
+	unsigned int iThreads=0);
+
+/**
+ * calculates selected eigenvectors of a batch of hermitian matrices
+ * @param pNumFound output for the number of eigenvalues found in [minval, maxval] per matrix,
+ *        the buffers have the same layout as in eigenvec_herm_batch
+ */
+template<typename T=double>
+bool eigenvecsel_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, std::complex<T>* pEvecs,
+	std::size_t* pNumFound, T minval=-1, T maxval=-2, T eps=T(-1),
+	unsigned int iThreads=0);
+
+
 /**
  * calculates the singular values of a real matrix: M = U diag(vals) V^t
  */
@@ -234,6 +471,18 @@ namespace tl {
 
 #endif
 
+
+/**
+ * calculates only the eigenvalues of a batch of hermitian matrices
+ */
+template<typename T=double>
+bool eigenval_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, unsigned int iThreads=0)
+{
+	return eigenvec_herm_batch<T>(pMats, iNumMats, iOrder, iStride,
+		pEvals, nullptr, iThreads);
+}
+
 }
 
 #endif
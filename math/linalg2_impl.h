@@ -10,6 +10,8 @@
 
 #include "linalg2.h"
 #include <memory>
+#include <vector>
+#include <atomic>
 
 #ifndef NO_LAPACK
 extern "C"
@@ -552,6 +554,197 @@ bool eigenvecsel_herm(const ublas::matrix<std::complex<T>>& mat,
 // ----------------------------------------------------------------------------
 
 
+/**
+ * the matrices are handed to lapack in column-major order, i.e. lapack sees
+ * the transposed = complex conjugated matrix. this avoids the transpositions
+ * in the row-major lapacke wrappers and gives contiguous eigenvectors, which
+ * only have to be conjugated back.
+ * the workspaces are queried and allocated once per thread.
+ */
+template<class T>
+bool eigenvec_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, std::complex<T>* pEvecs,
+	unsigned int iThreads)
+{
+	using t_cplx = std::complex<T>;
+
+	select_func<float, double, decltype(LAPACKE_cheev_work), decltype(LAPACKE_zheev_work)>
+		sfunc(LAPACKE_cheev_work, LAPACKE_zheev_work);
+	auto pfunc = sfunc.get_func<T>();
+
+	if(iOrder == 0)
+		return false;
+	if(iStride == 0)
+		iStride = iOrder*iOrder;
+
+	const std::size_t iOrder2 = iOrder*iOrder;
+	const char cJob = pEvecs ? 'V' : 'N';
+	std::atomic<bool> bOk(true);
+
+	run_stripes(iNumMats, get_num_threads(iNumMats, iThreads),
+		[&](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		// small matrices
+		if(iOrder <= TLIBS_EIGEN_JACOBI_MAX_ORDER)
+		{
+			t_cplx work[2*TLIBS_EIGEN_JACOBI_MAX_ORDER*TLIBS_EIGEN_JACOBI_MAX_ORDER];
+
+			for(std::size_t iMat=iStart; iMat<iEnd; ++iMat)
+			{
+				if(!eigenvec_herm_jacobi<T>(pMats + iMat*iStride, iOrder,
+					pEvals + iMat*iOrder, pEvecs ? pEvecs + iMat*iOrder2 : nullptr, work))
+					bOk = false;
+			}
+			return;
+		}
+
+		std::vector<t_cplx> vecMat(iOrder2);
+		std::vector<T> vecRWork(std::max<std::size_t>(1, 3*iOrder-2));
+
+		// workspace query
+		t_cplx lwork(0);
+		int iInfo = (*pfunc)(LAPACK_COL_MAJOR, cJob, 'U', iOrder,
+			vecMat.data(), iOrder, pEvals, &lwork, -1, vecRWork.data());
+		const int iLWork = (iInfo==0 ? std::max(int(lwork.real()), 1) : int(2*iOrder));
+		std::vector<t_cplx> vecWork(iLWork);
+
+		for(std::size_t iMat=iStart; iMat<iEnd; ++iMat)
+		{
+			const t_cplx *pMat = pMats + iMat*iStride;
+			std::copy(pMat, pMat + iOrder2, vecMat.begin());
+
+			iInfo = (*pfunc)(LAPACK_COL_MAJOR, cJob, 'U', iOrder,
+				vecMat.data(), iOrder, pEvals + iMat*iOrder,
+				vecWork.data(), iLWork, vecRWork.data());
+
+			if(iInfo != 0)
+			{
+				log_err("Could not solve hermitian eigenproblem ", iMat,
+					" (lapack error ", iInfo, ").");
+				bOk = false;
+				continue;
+			}
+
+			if(pEvecs)
+			{
+				t_cplx *pEvec = pEvecs + iMat*iOrder2;
+				for(std::size_t i=0; i<iOrder2; ++i)
+					pEvec[i] = std::conj(vecMat[i]);
+			}
+		}
+	});
+
+	return bOk;
+}
+
+
+template<class T>
+bool eigenvecsel_herm_batch(const std::complex<T>* pMats, std::size_t iNumMats,
+	std::size_t iOrder, std::size_t iStride, T* pEvals, std::complex<T>* pEvecs,
+	std::size_t* pNumFound, T minval, T maxval, T eps, unsigned int iThreads)
+{
+	using t_cplx = std::complex<T>;
+
+	select_func<float, double, decltype(LAPACKE_cheevr_work), decltype(LAPACKE_zheevr_work)>
+		sfunc(LAPACKE_cheevr_work, LAPACKE_zheevr_work);
+	auto pfunc = sfunc.get_func<T>();
+
+	select_func<float, double, decltype(LAPACKE_slamch), decltype(LAPACKE_dlamch)>
+		_lamch(LAPACKE_slamch, LAPACKE_dlamch);
+	auto lamch = _lamch.get_func<T>();
+
+	if(iOrder == 0)
+		return false;
+	if(iStride == 0)
+		iStride = iOrder*iOrder;
+
+	// use maximum precision if none given
+	if(eps < T(0))
+		eps = lamch('S');
+
+	// if an invalid range is given, select all eigenvalues
+	const bool bSelectAll = (minval > maxval);
+
+	const std::size_t iOrder2 = iOrder*iOrder;
+	const char cJob = pEvecs ? 'V' : 'N';
+	std::atomic<bool> bOk(true);
+
+	run_stripes(iNumMats, get_num_threads(iNumMats, iThreads),
+		[&](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		// small matrices
+		if(iOrder <= TLIBS_EIGEN_JACOBI_MAX_ORDER)
+		{
+			t_cplx work[2*TLIBS_EIGEN_JACOBI_MAX_ORDER*TLIBS_EIGEN_JACOBI_MAX_ORDER];
+
+			for(std::size_t iMat=iStart; iMat<iEnd; ++iMat)
+			{
+				T *pEval = pEvals + iMat*iOrder;
+				t_cplx *pEvec = pEvecs ? pEvecs + iMat*iOrder2 : nullptr;
+
+				if(!eigenvec_herm_jacobi<T>(pMats + iMat*iStride, iOrder, pEval, pEvec, work))
+					bOk = false;
+				pNumFound[iMat] = eigen_select<T>(iOrder, pEval, pEvec, minval, maxval);
+			}
+			return;
+		}
+
+		std::vector<t_cplx> vecMat(iOrder2), vecZ(pEvecs ? iOrder2 : 1);
+		std::vector<int> vecSupp(2*iOrder);
+
+		// workspace query
+		t_cplx lwork(0);
+		T lrwork(0);
+		int liwork(0), iNumFound(0);
+		int iInfo = (*pfunc)(LAPACK_COL_MAJOR, cJob, bSelectAll?'A':'V', 'U',
+			iOrder, vecMat.data(), iOrder, minval, maxval, 1, iOrder,
+			eps, &iNumFound, pEvals, vecZ.data(), iOrder, vecSupp.data(),
+			&lwork, -1, &lrwork, -1, &liwork, -1);
+
+		const int iLWork = (iInfo==0 ? std::max(int(lwork.real()), 1) : int(2*iOrder));
+		const int iLRWork = (iInfo==0 ? std::max(int(lrwork), 1) : int(24*iOrder));
+		const int iLIWork = (iInfo==0 ? std::max(liwork, 1) : int(10*iOrder));
+		std::vector<t_cplx> vecWork(iLWork);
+		std::vector<T> vecRWork(iLRWork);
+		std::vector<int> vecIWork(iLIWork);
+
+		for(std::size_t iMat=iStart; iMat<iEnd; ++iMat)
+		{
+			const t_cplx *pMat = pMats + iMat*iStride;
+			std::copy(pMat, pMat + iOrder2, vecMat.begin());
+
+			iNumFound = 0;
+			iInfo = (*pfunc)(LAPACK_COL_MAJOR, cJob, bSelectAll?'A':'V', 'U',
+				iOrder, vecMat.data(), iOrder, minval, maxval, 1, iOrder,
+				eps, &iNumFound, pEvals + iMat*iOrder, vecZ.data(), iOrder, vecSupp.data(),
+				vecWork.data(), iLWork, vecRWork.data(), iLRWork,
+				vecIWork.data(), iLIWork);
+
+			if(iInfo != 0)
+			{
+				log_err("Could not solve hermitian eigenproblem ", iMat,
+					" (lapack error ", iInfo, ").");
+				bOk = false;
+				iNumFound = 0;
+			}
+
+			pNumFound[iMat] = std::size_t(iNumFound);
+			if(pEvecs)
+			{
+				t_cplx *pEvec = pEvecs + iMat*iOrder2;
+				for(std::size_t i=0; i<std::size_t(iNumFound)*iOrder; ++i)
+					pEvec[i] = std::conj(vecZ[i]);
+			}
+		}
+	});
+
+	return bOk;
+}
+
+
+// ----------------------------------------------------------------------------
+
+
 template<typename T>
 bool singvec(const ublas::matrix<T>& mat,
 	ublas::matrix<T>& matU, ublas::matrix<T>& matV, std::vector<T>& vecsvals)
@@ -13,6 +13,9 @@
 #include <vector>
 #include <limits>
 #include <tuple>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include "../helper/traits.h"
 #include <boost/math/special_functions/spherical_harmonic.hpp>
 #include <boost/math/constants/constants.hpp>
@@ -594,5 +597,116 @@ bool is_in_angular_range(T dStart, T dRange, T dAngle)
 
 // -----------------------------------------------------------------------------
 
+/**
+ * exponential function for arrays: pOut[i] = exp(pIn[i]), pIn == pOut is allowed
+ * exp(x) = 2^k * exp(r) with k = round(x/ln(2)) and |r| <= ln(2)/2,
+ * exp(r) is a taylor polynomial and 2^k is put into the exponent bits directly,
+ * which keeps the loops free of branches and library calls, so that they can be vectorised
+ * (e.g. with -O3 -march=native)
+ * relative error: ~2 ulp for double and float, other types use std::exp
+ */
+template<class T = double>
+void exp_n(const T* pIn, T* pOut, std::size_t n)
+{
+	if(std::numeric_limits<T>::is_iec559 && sizeof(T) == sizeof(std::uint64_t))
+	{
+		const T dLog2e = T(1.4426950408889634074);
+		const T dLn2Hi = T(6.93147180369123816490e-01);	// upper bits of ln(2), kf*dLn2Hi is exact
+		const T dLn2Lo = T(1.90821492927058770002e-10);
+		const T dMagic = T(6755399441055744.);	// 1.5 * 2^52, rounds to integers
+		const T dMax = T(709.782712893383973096);
+		const T dMin = T(-745.133219101941108420);
+
+		std::uint64_t uMagic;
+		std::memcpy(&uMagic, &dMagic, sizeof(uMagic));
+
+		for(std::size_t i=0; i<n; ++i)
+		{
+			const T x = pIn[i];
+			const T xc = std::min(std::max(x, dMin), dMax);
+
+			// k = round(x/ln(2)) is in the lower mantissa bits of t
+			const T t = xc*dLog2e + dMagic;
+			const T kf = t - dMagic;
+			std::uint64_t uT;
+			std::memcpy(&uT, &t, sizeof(uT));
+			const std::int64_t k = std::int64_t(uT - uMagic);
+
+			const T r = (xc - kf*dLn2Hi) - kf*dLn2Lo;
+			// estrin's scheme for a shorter dependency chain than horner's
+			const T r2 = r*r, r4 = r2*r2, r8 = r4*r4;
+			const T p0 = (T(1) + r) + r2*(T(1./2.) + r*T(1./6.));
+			const T p1 = (T(1./24.) + r*T(1./120.)) + r2*(T(1./720.) + r*T(1./5040.));
+			const T p2 = (T(1./40320.) + r*T(1./362880.)) + r2*(T(1./3628800.) + r*T(1./39916800.));
+			const T p3 = T(1./479001600.) + r*T(1./6227020800.);
+			const T p = (p0 + r4*p1) + r8*(p2 + r4*p3);
+
+			// scale by 2^k in two steps to also reach the subnormal range
+			const std::int64_t k1 = k/2, k2 = k - k1;
+			const std::uint64_t u1 = std::uint64_t(k1 + 1023) << 52;
+			const std::uint64_t u2 = std::uint64_t(k2 + 1023) << 52;
+			T s1, s2;
+			std::memcpy(&s1, &u1, sizeof(s1));
+			std::memcpy(&s2, &u2, sizeof(s2));
+
+			T y = p*s1*s2;
+			y = (x > dMax) ? std::numeric_limits<T>::infinity() : y;
+			y = (x < dMin) ? T(0) : y;
+			y = (x != x) ? x : y;
+			pOut[i] = y;
+		}
+	}
+	else if(std::numeric_limits<T>::is_iec559 && sizeof(T) == sizeof(std::uint32_t))
+	{
+		const T fLog2e = T(1.44269504088896341);
+		const T fLn2Hi = T(0.693145751953125);	// upper bits of ln(2), kf*fLn2Hi is exact
+		const T fLn2Lo = T(1.42860682030941723212e-06);
+		const T fMagic = T(12582912.);	// 1.5 * 2^23
+		const T fMax = T(88.7228317);
+		const T fMin = T(-103.972076);
+
+		std::uint32_t uMagic;
+		std::memcpy(&uMagic, &fMagic, sizeof(uMagic));
+
+		for(std::size_t i=0; i<n; ++i)
+		{
+			const T x = pIn[i];
+			const T xc = std::min(std::max(x, fMin), fMax);
+
+			const T t = xc*fLog2e + fMagic;
+			const T kf = t - fMagic;
+			std::uint32_t uT;
+			std::memcpy(&uT, &t, sizeof(uT));
+			const std::int32_t k = std::int32_t(uT - uMagic);
+
+			const T r = (xc - kf*fLn2Hi) - kf*fLn2Lo;
+			const T r2 = r*r, r4 = r2*r2;
+			const T p0 = (T(1) + r) + r2*(T(1./2.) + r*T(1./6.));
+			const T p1 = (T(1./24.) + r*T(1./120.)) + r2*(T(1./720.) + r*T(1./5040.));
+			const T p = p0 + r4*p1;
+
+			const std::int32_t k1 = k/2, k2 = k - k1;
+			const std::uint32_t u1 = std::uint32_t(k1 + 127) << 23;
+			const std::uint32_t u2 = std::uint32_t(k2 + 127) << 23;
+			T s1, s2;
+			std::memcpy(&s1, &u1, sizeof(s1));
+			std::memcpy(&s2, &u2, sizeof(s2));
+
+			T y = p*s1*s2;
+			y = (x > fMax) ? std::numeric_limits<T>::infinity() : y;
+			y = (x < fMin) ? T(0) : y;
+			y = (x != x) ? x : y;
+			pOut[i] = y;
+		}
+	}
+	else
+	{
+		for(std::size_t i=0; i<n; ++i)
+			pOut[i] = std::exp(pIn[i]);
+	}
+}
+
+// -----------------------------------------------------------------------------
+
 }
 #endif
@@ -1,5 +1,5 @@
 /**
- * simple numerical integration / differentiation
+ * numerical integration / differentiation
  * @author Tobias Weber <tobias.weber@tum.de>
  * @date june-2015
  * @license GPLv2 or GPLv3
@@ -11,8 +11,12 @@
 #include <functional>
 #include <vector>
 #include <limits>
+#include <algorithm>
 #include <cmath>
 
+#include "math.h"
+#include "../helper/thread.h"
+
 
 namespace tl {
 
@@ -92,6 +96,558 @@ R numint_simpN(const std::function<R(A)>& fkt,
 }
 
 
+// --------------------------------------------------------------------------------
+// adaptive integration with error estimates
+//
+// the *_batch variants take a vectorised integrand which evaluates a whole
+// array of abscissae per call:
+//	void fkt(const A* pX, R* pY, std::size_t N)
+// for the multi-dimensional cubature, pX holds N points with iDim coordinates each.
+// with iThreads != 1 the integrand is called concurrently and has to be thread-safe.
+
+
+/**
+ * evaluates a scalar integrand R fkt(A) or R fkt(const A*) point by point
+ */
+template<class R, class A, class t_func>
+struct numint_batch_adapter
+{
+	const t_func& fkt;
+	std::size_t iDim;
+
+	void operator()(const A* pX, R* pY, std::size_t N) const
+	{
+		for(std::size_t i=0; i<N; ++i)
+			pY[i] = call(pX + i*iDim);
+	}
+
+	template<class t_fkt = t_func>
+	auto call(const A* pX) const -> decltype(std::declval<const t_fkt&>()(*pX))
+	{ return fkt(*pX); }
+
+	template<class t_fkt = t_func>
+	auto call(const A* pX) const -> decltype(std::declval<const t_fkt&>()(pX))
+	{ return fkt(pX); }
+};
+
+
+/**
+ * region of an adaptive integration, ordered by its error estimate
+ */
+template<class R, class A>
+struct numint_region
+{
+	std::vector<A> vecMin, vecMax;
+	R val = R(0), err = R(0);
+	std::size_t iSplitAxis = 0;
+
+	bool operator<(const numint_region<R,A>& reg) const { return err < reg.err; }
+};
+
+
+/**
+ * 21-point Gauss-Kronrod rule with embedded 10-point Gauss rule
+ * @see https://en.wikipedia.org/wiki/Gauss%E2%80%93Kronrod_quadrature_formula
+ * @see R. Piessens et al., QUADPACK (1983), doi: https://doi.org/10.1007/978-3-642-61786-7, routine qk21
+ */
+template<class T>
+struct numint_gk21
+{
+	static constexpr std::size_t NUM_PTS = 21;
+
+	// abscissae on [0, 1], the odd ones are the gauss points
+	static const T* xgk()
+	{
+		static const T x[] = {
+			T(0.995657163025808080735527280689003L), T(0.973906528517171720077964012084452L),
+			T(0.930157491355708226001207180059508L), T(0.865063366688984510732096688423493L),
+			T(0.780817726586416897063717578345042L), T(0.679409568299024406234327365114874L),
+			T(0.562757134668604683339000099272694L), T(0.433395394129247190799265943165784L),
+			T(0.294392862701460198131126603103866L), T(0.148874338981631210884826001129720L),
+			T(0) };
+		return x;
+	}
+
+	static const T* wgk()
+	{
+		static const T w[] = {
+			T(0.011694638867371874278064396062192L), T(0.032558162307964727478818972459390L),
+			T(0.054755896574351996031381300244580L), T(0.075039674810919952767043140916190L),
+			T(0.093125454583697605535065465083366L), T(0.109387158802297641899210590325805L),
+			T(0.123491976262065851077600525452037L), T(0.134709217311473325928054001771707L),
+			T(0.142775938577060080797094273138717L), T(0.147739104901338491374841515972068L),
+			T(0.149445554002916905664936468389821L) };
+		return w;
+	}
+
+	static const T* wg()
+	{
+		static const T w[] = {
+			T(0.066671344308688137593568809893332L), T(0.149451349150580593145776339657697L),
+			T(0.219086362515982043995534934228163L), T(0.269266719309996355091226921569469L),
+			T(0.295524224714752870173892994651338L) };
+		return w;
+	}
+
+	/**
+	 * abscissae of the interval [x0, x1]
+	 */
+	template<class A>
+	static void points(const std::vector<A>& vecMin, const std::vector<A>& vecMax, A* pX)
+	{
+		const A x0 = vecMin[0], x1 = vecMax[0];
+		const A xmid = A(0.5)*(x0+x1), xhalf = A(0.5)*(x1-x0);
+		for(std::size_t j=0; j<10; ++j)
+		{
+			pX[2*j] = xmid - xhalf*A(xgk()[j]);
+			pX[2*j+1] = xmid + xhalf*A(xgk()[j]);
+		}
+		pX[20] = xmid;
+	}
+
+	/**
+	 * integral and error estimate from the function values at the abscissae
+	 */
+	template<class R, class A>
+	static void eval(const std::vector<A>& vecMin, const std::vector<A>& vecMax, const R* pY,
+		R& val, R& err, std::size_t& iSplitAxis)
+	{
+		const A x0 = vecMin[0], x1 = vecMax[0];
+		iSplitAxis = 0;
+		const R half = R(0.5)*R(x1-x0);
+		R resk = R(wgk()[10]) * pY[20], resg = R(0);
+		for(std::size_t j=0; j<10; ++j)
+		{
+			const R sum = pY[2*j] + pY[2*j+1];
+			resk += R(wgk()[j]) * sum;
+			if(j % 2 == 1)
+				resg += R(wg()[j/2]) * sum;
+		}
+
+		// error scaling as in qk21
+		const R reskh = R(0.5)*resk;
+		R resasc = R(wgk()[10]) * std::abs(pY[20] - reskh);
+		for(std::size_t j=0; j<10; ++j)
+			resasc += R(wgk()[j]) * (std::abs(pY[2*j] - reskh) + std::abs(pY[2*j+1] - reskh));
+
+		val = resk * half;
+		err = std::abs((resk-resg) * half);
+		resasc *= std::abs(half);
+		if(resasc != R(0) && err != R(0))
+			err = resasc * std::min(R(1), std::pow(R(200)*err/resasc, R(1.5)));
+	}
+};
+
+
+/**
+ * Genz-Malik degree 7 cubature rule with embedded degree 5 rule
+ * on a hyper-rectangle in iDim >= 2 dimensions, uses 2^n + 2n^2 + 2n + 1 points
+ * @see A. C. Genz and A. A. Malik, J. Comput. Appl. Math. 6(4), pp. 295-302 (1980), doi: https://doi.org/10.1016/0771-050X(80)90039-X
+ */
+template<class T>
+struct numint_genz_malik
+{
+	static std::size_t num_points(std::size_t iDim)
+	{
+		return (std::size_t(1) << iDim) + 2*iDim*iDim + 2*iDim + 1;
+	}
+
+	template<class A>
+	static void points(const std::vector<A>& vecMin, const std::vector<A>& vecMax, A* pX)
+	{
+		const std::size_t iDim = vecMin.size();
+		const A lam2 = A(std::sqrt(T(9)/T(70))), lam4 = A(std::sqrt(T(9)/T(10))), lam5 = A(std::sqrt(T(9)/T(19)));
+
+		std::vector<A> vecMid(iDim), vecHalf(iDim);
+		for(std::size_t i=0; i<iDim; ++i)
+		{
+			vecMid[i] = A(0.5)*(vecMin[i]+vecMax[i]);
+			vecHalf[i] = A(0.5)*(vecMax[i]-vecMin[i]);
+		}
+
+		auto next = [&pX, &vecMid, iDim]() -> A*
+		{
+			A* pPt = pX;
+			std::copy(vecMid.begin(), vecMid.end(), pPt);
+			pX += iDim;
+			return pPt;
+		};
+
+		// centre
+		next();
+
+		// points on the axes
+		for(std::size_t i=0; i<iDim; ++i)
+		{
+			for(A lam : { lam2, -lam2, lam4, -lam4 })
+				next()[i] += lam*vecHalf[i];
+		}
+
+		// points in the coordinate planes
+		for(std::size_t i=0; i<iDim; ++i)
+		{
+			for(std::size_t j=i+1; j<iDim; ++j)
+			{
+				for(int iSign=0; iSign<4; ++iSign)
+				{
+					A* pPt = next();
+					pPt[i] += (iSign & 1 ? -lam4 : lam4) * vecHalf[i];
+					pPt[j] += (iSign & 2 ? -lam4 : lam4) * vecHalf[j];
+				}
+			}
+		}
+
+		// corners
+		for(std::size_t iCorner=0; iCorner<(std::size_t(1)<<iDim); ++iCorner)
+		{
+			A* pPt = next();
+			for(std::size_t i=0; i<iDim; ++i)
+				pPt[i] += ((iCorner >> i) & 1 ? -lam5 : lam5) * vecHalf[i];
+		}
+	}
+
+	/**
+	 * integral, error estimate and the axis with the largest fourth difference
+	 */
+	template<class R, class A>
+	static void eval(const std::vector<A>& vecMin, const std::vector<A>& vecMax, const R* pY,
+		R& val, R& err, std::size_t& iSplitAxis)
+	{
+		const std::size_t iDim = vecMin.size();
+		const R dim = R(iDim);
+
+		R vol = R(1);
+		for(std::size_t i=0; i<iDim; ++i)
+			vol *= R(vecMax[i]-vecMin[i]);
+
+		const R f0 = pY[0];
+		R s2 = R(0), s3 = R(0), s4 = R(0), s5 = R(0);
+		R dMaxDiff = R(-1);
+		iSplitAxis = 0;
+
+		for(std::size_t i=0; i<iDim; ++i)
+		{
+			const R* pAxis = pY + 1 + 4*i;
+			const R f2 = pAxis[0] + pAxis[1], f3 = pAxis[2] + pAxis[3];
+			s2 += f2;
+			s3 += f3;
+
+			// split along the axis with the largest fourth difference, or the widest one
+			const R dDiff = std::abs(f2 - R(2)*f0 - (f3 - R(2)*f0)/R(7));
+			const R dTol = std::abs(dMaxDiff) * R(1e-8);
+			if(dDiff > dMaxDiff + dTol || (dDiff >= dMaxDiff - dTol &&
+				vecMax[i]-vecMin[i] > vecMax[iSplitAxis]-vecMin[iSplitAxis]))
+			{
+				if(dDiff > dMaxDiff)
+					dMaxDiff = dDiff;
+				iSplitAxis = i;
+			}
+		}
+
+		const R* pPlanes = pY + 1 + 4*iDim;
+		for(std::size_t i=0; i<2*iDim*(iDim-1); ++i)
+			s4 += pPlanes[i];
+
+		const R* pCorners = pPlanes + 2*iDim*(iDim-1);
+		for(std::size_t i=0; i<(std::size_t(1)<<iDim); ++i)
+			s5 += pCorners[i];
+
+		const R val7 = (R(12824) - R(9120)*dim + R(400)*dim*dim)/R(19683) * f0
+			+ R(980)/R(6561) * s2 + (R(1820) - R(400)*dim)/R(19683) * s3
+			+ R(200)/R(19683) * s4 + R(6859)/R(19683) / R(std::size_t(1)<<iDim) * s5;
+		const R val5 = (R(729) - R(950)*dim + R(50)*dim*dim)/R(729) * f0
+			+ R(245)/R(486) * s2 + (R(265) - R(100)*dim)/R(1458) * s3
+			+ R(25)/R(729) * s4;
+
+		val = val7 * vol;
+		err = std::abs((val7 - val5) * vol);
+	}
+};
+
+
+/**
+ * adaptive bisection of the regions with the largest errors
+ * t_rule: numint_gk21 or numint_genz_malik
+ */
+template<class R, class A, class t_rule, class t_func>
+R _numint_adaptive(const t_func& fkt, const std::vector<A>& vecMin, const std::vector<A>& vecMax,
+	std::size_t iPtsPerRegion, R epsAbs, R epsRel, R* pErr, std::size_t iMaxRegions, unsigned int iThreads)
+{
+	using t_reg = numint_region<R,A>;
+	const std::size_t iDim = vecMin.size();
+	iThreads = get_num_threads(std::size_t(-1), iThreads);
+
+	// evaluates the regions [iStart, iEnd[, one integrand call per stripe
+	auto eval_regions = [&](t_reg* pRegs, std::size_t iStart, std::size_t iEnd) -> void
+	{
+		std::vector<A> vecX((iEnd-iStart) * iPtsPerRegion * iDim);
+		std::vector<R> vecY((iEnd-iStart) * iPtsPerRegion);
+
+		for(std::size_t iReg=iStart; iReg<iEnd; ++iReg)
+			t_rule::points(pRegs[iReg].vecMin, pRegs[iReg].vecMax, vecX.data() + (iReg-iStart)*iPtsPerRegion*iDim);
+
+		fkt(vecX.data(), vecY.data(), (iEnd-iStart) * iPtsPerRegion);
+
+		for(std::size_t iReg=iStart; iReg<iEnd; ++iReg)
+		{
+			t_reg& reg = pRegs[iReg];
+			t_rule::eval(reg.vecMin, reg.vecMax, vecY.data() + (iReg-iStart)*iPtsPerRegion,
+				reg.val, reg.err, reg.iSplitAxis);
+		}
+	};
+
+	auto eval_all = [&](std::vector<t_reg>& vecRegs) -> void
+	{
+		const unsigned int iThr = get_num_threads(vecRegs.size(), iThreads);
+		run_stripes(vecRegs.size(), iThr, [&](std::size_t iStart, std::size_t iEnd) -> void
+		{
+			eval_regions(vecRegs.data(), iStart, iEnd);
+		});
+	};
+
+	// start with one region per thread, split along the first axis
+	std::vector<t_reg> vecNew(iThreads);
+	for(std::size_t iReg=0; iReg<iThreads; ++iReg)
+	{
+		vecNew[iReg].vecMin = vecMin;
+		vecNew[iReg].vecMax = vecMax;
+		vecNew[iReg].vecMin[0] = vecMin[0] + (vecMax[0]-vecMin[0])*A(iReg)/A(iThreads);
+		if(iReg+1 < iThreads)
+			vecNew[iReg].vecMax[0] = vecMin[0] + (vecMax[0]-vecMin[0])*A(iReg+1)/A(iThreads);
+	}
+	eval_all(vecNew);
+
+	// max-heap on the error estimates
+	std::vector<t_reg> vecHeap;
+	R val = R(0), err = R(0);
+	auto push = [&](t_reg& reg) -> void
+	{
+		val += reg.val;
+		err += reg.err;
+		vecHeap.emplace_back(std::move(reg));
+		std::push_heap(vecHeap.begin(), vecHeap.end());
+	};
+	for(t_reg& reg : vecNew)
+		push(reg);
+
+	while(vecHeap.size() < iMaxRegions)
+	{
+		if(err <= std::max(epsAbs, epsRel*std::abs(val)))
+		{
+			// re-sum to remove accumulated round-off before accepting
+			val = err = R(0);
+			for(const t_reg& reg : vecHeap)
+			{
+				val += reg.val;
+				err += reg.err;
+			}
+			if(err <= std::max(epsAbs, epsRel*std::abs(val)))
+				break;
+		}
+
+		// bisect the worst regions, as many as there are threads
+		vecNew.clear();
+		for(std::size_t iReg=0; iReg<iThreads && !vecHeap.empty(); ++iReg)
+		{
+			std::pop_heap(vecHeap.begin(), vecHeap.end());
+			t_reg reg = std::move(vecHeap.back());
+			vecHeap.pop_back();
+			val -= reg.val;
+			err -= reg.err;
+
+			const std::size_t iAxis = reg.iSplitAxis;
+			const A xmid = A(0.5)*(reg.vecMin[iAxis] + reg.vecMax[iAxis]);
+			if(xmid <= reg.vecMin[iAxis] || xmid >= reg.vecMax[iAxis])
+			{
+				// cannot be split any further
+				reg.err = R(0);
+				push(reg);
+				continue;
+			}
+
+			t_reg reg0 = reg;
+			reg0.vecMax[iAxis] = xmid;
+			reg.vecMin[iAxis] = xmid;
+			vecNew.emplace_back(std::move(reg0));
+			vecNew.emplace_back(std::move(reg));
+		}
+
+		if(vecNew.empty())
+			break;
+		eval_all(vecNew);
+		for(t_reg& reg : vecNew)
+			push(reg);
+	}
+
+	val = err = R(0);
+	for(const t_reg& reg : vecHeap)
+	{
+		val += reg.val;
+		err += reg.err;
+	}
+
+	if(pErr) *pErr = err;
+	return val;
+}
+
+
+/**
+ * adaptive Gauss-Kronrod integration with a batched integrand
+ * bisects the intervals with the largest error estimates until
+ * the total error is below max(epsAbs, epsRel*|integral|)
+ * @see R. Piessens et al., QUADPACK (1983), doi: https://doi.org/10.1007/978-3-642-61786-7, routine qag
+ */
+template<class R=double, class A=double, class t_func>
+R numint_gk_batch(const t_func& fkt, A x0, A x1,
+	R epsAbs = R(1e-10), R epsRel = R(1e-10), R* pErr = nullptr,
+	std::size_t iMaxIntervals = 1024, unsigned int iThreads = 1)
+{
+	return _numint_adaptive<R, A, numint_gk21<A>>(fkt,
+		std::vector<A>{x0}, std::vector<A>{x1}, numint_gk21<A>::NUM_PTS,
+		epsAbs, epsRel, pErr, iMaxIntervals, iThreads);
+}
+
+/**
+ * adaptive Gauss-Kronrod integration of R fkt(A)
+ */
+template<class R=double, class A=double, class t_func>
+R numint_gk(const t_func& fkt, A x0, A x1,
+	R epsAbs = R(1e-10), R epsRel = R(1e-10), R* pErr = nullptr,
+	std::size_t iMaxIntervals = 1024, unsigned int iThreads = 1)
+{
+	return numint_gk_batch<R, A>(numint_batch_adapter<R, A, t_func>{fkt, 1},
+		x0, x1, epsAbs, epsRel, pErr, iMaxIntervals, iThreads);
+}
+
+
+/**
+ * tanh-sinh (double exponential) integration with a batched integrand
+ * copes with integrable singularities at the interval end points,
+ * which are never evaluated; non-finite function values are skipped.
+ * each level halves the step size and evaluates all new abscissae in one call.
+ * @see H. Takahasi and M. Mori, Publ. RIMS 9(3), pp. 721-741 (1974), doi: https://doi.org/10.2977/prims/1195192451
+ * @see https://en.wikipedia.org/wiki/Tanh-sinh_quadrature
+ */
+template<class R=double, class A=double, class t_func>
+R numint_tanhsinh_batch(const t_func& fkt, A x0, A x1,
+	R epsAbs = R(1e-10), R epsRel = R(1e-10), R* pErr = nullptr,
+	std::size_t iMaxLevel = 12)
+{
+	const A pi2 = A(0.5) * get_pi<A>();
+	const A xhalf = A(0.5)*(x1-x0);
+
+	// up to where the distance to the end points is representable
+	const A tmax = std::asinh(std::log(A(2) / std::numeric_limits<A>::min()) / get_pi<A>());
+
+	std::vector<A> vecX;
+	std::vector<R> vecW, vecY;
+
+	R sum = R(0), val = R(0), err = std::numeric_limits<R>::max();
+	for(std::size_t iLevel=0; iLevel<=iMaxLevel; ++iLevel)
+	{
+		const A h = std::ldexp(A(1), -int(iLevel));
+
+		// level 0 has all integer nodes, the others only the new odd multiples of h
+		vecX.clear();
+		vecW.clear();
+		for(std::size_t k = (iLevel==0 ? 0 : 1); ; k += (iLevel==0 ? 1 : 2))
+		{
+			const A t = A(k)*h;
+			if(t > tmax)
+				break;
+
+			// y = 1 - tanh(pi/2 sinh t), w = d/dt tanh(pi/2 sinh t)
+			const A e = std::exp(-A(2)*pi2*std::sinh(t));
+			const A y = A(2)*e / (A(1)+e);
+			const A w = pi2*std::cosh(t) * A(4)*e / ((A(1)+e)*(A(1)+e));
+
+			vecX.push_back(x0 + xhalf*y);
+			vecW.push_back(R(w));
+			if(k != 0)
+			{
+				vecX.push_back(x1 - xhalf*y);
+				vecW.push_back(R(w));
+			}
+		}
+
+		vecY.resize(vecX.size());
+		fkt(vecX.data(), vecY.data(), vecX.size());
+		for(std::size_t i=0; i<vecY.size(); ++i)
+		{
+			if(std::isfinite(vecY[i]))
+				sum += vecW[i] * vecY[i];
+		}
+
+		const R valNew = sum * R(h) * R(xhalf);
+		if(iLevel > 0)
+			err = std::abs(valNew - val);
+		val = valNew;
+
+		if(iLevel >= 3 && err <= std::max(epsAbs, epsRel*std::abs(val)))
+			break;
+	}
+
+	if(pErr) *pErr = err;
+	return val;
+}
+
+/**
+ * tanh-sinh integration of R fkt(A)
+ */
+template<class R=double, class A=double, class t_func>
+R numint_tanhsinh(const t_func& fkt, A x0, A x1,
+	R epsAbs = R(1e-10), R epsRel = R(1e-10), R* pErr = nullptr,
+	std::size_t iMaxLevel = 12)
+{
+	return numint_tanhsinh_batch<R, A>(numint_batch_adapter<R, A, t_func>{fkt, 1},
+		x0, x1, epsAbs, epsRel, pErr, iMaxLevel);
+}
+
+
+/**
+ * adaptive cubature over the hyper-rectangle [vecMin, vecMax] with a batched integrand
+ * uses the Genz-Malik rule, whose cost grows as 2^dim, and Gauss-Kronrod in one dimension
+ * @see J. Berntsen et al., ACM TOMS 17(4), pp. 437-451 (1991), doi: https://doi.org/10.1145/210232.210233
+ */
+template<class R=double, class A=double, class t_func>
+R numint_cubature_batch(const t_func& fkt,
+	const std::vector<A>& vecMin, const std::vector<A>& vecMax,
+	R epsAbs = R(1e-10), R epsRel = R(1e-10), R* pErr = nullptr,
+	std::size_t iMaxEvals = 1000000, unsigned int iThreads = 1)
+{
+	const std::size_t iDim = std::min(vecMin.size(), vecMax.size());
+	if(iDim == 0)
+	{
+		if(pErr) *pErr = R(0);
+		return R(0);
+	}
+	else if(iDim == 1)
+	{
+		return numint_gk_batch<R, A>(fkt, vecMin[0], vecMax[0], epsAbs, epsRel, pErr,
+			std::max<std::size_t>(1, iMaxEvals / (2*numint_gk21<A>::NUM_PTS)), iThreads);
+	}
+
+	const std::size_t iPts = numint_genz_malik<A>::num_points(iDim);
+	return _numint_adaptive<R, A, numint_genz_malik<A>>(fkt,
+		std::vector<A>(vecMin.begin(), vecMin.begin()+iDim),
+		std::vector<A>(vecMax.begin(), vecMax.begin()+iDim), iPts,
+		epsAbs, epsRel, pErr, std::max<std::size_t>(1, iMaxEvals / (2*iPts)), iThreads);
+}
+
+/**
+ * adaptive cubature of R fkt(const A* pX), pX pointing to the coordinates
+ */
+template<class R=double, class A=double, class t_func>
+R numint_cubature(const t_func& fkt,
+	const std::vector<A>& vecMin, const std::vector<A>& vecMax,
+	R epsAbs = R(1e-10), R epsRel = R(1e-10), R* pErr = nullptr,
+	std::size_t iMaxEvals = 1000000, unsigned int iThreads = 1)
+{
+	return numint_cubature_batch<R, A>(numint_batch_adapter<R, A, t_func>{fkt, vecMin.size()},
+		vecMin, vecMax, epsAbs, epsRel, pErr, iMaxEvals, iThreads);
+}
+
+
 // --------------------------------------------------------------------------------
 
 
@@ -115,7 +671,10 @@ R convolute(const std::function<R(A)>& fkt0, const std::function<R(A)>& fkt1,
 }
 
 
-
+/**
+ * direct discrete convolution
+ * @see FFTConv in dft.h for long signals and fixed kernels
+ */
 template<class cont_type = std::vector<double>>
 cont_type convolute_discrete(const cont_type& f, const cont_type& g)
 {
@@ -123,15 +682,19 @@ cont_type convolute_discrete(const cont_type& f, const cont_type& g)
 	const std::size_t N = g.size();
 
 	cont_type conv;
+	if(M==0 || N==0)
+		return conv;
 	conv.reserve(M+N-1);
 
 	for(std::size_t n=0; n<M+N-1; ++n)
 	{
 		typename cont_type::value_type val = 0.;
 
-		for(std::size_t m=0; m<M; ++m)
-			if(n>=m && n-m<N)
-				val += f[m] * g[n-m];
+		// only the overlapping range, n-m < N
+		const std::size_t mmin = n >= N ? n-N+1 : 0;
+		const std::size_t mmax = std::min(n, M-1);
+		for(std::size_t m=mmin; m<=mmax; ++m)
+			val += f[m] * g[n-m];
 
 		conv.push_back(val);
 	}
@@ -10,6 +10,7 @@
 
 #include <cstdlib>
 #include <exception>
+#include <atomic>
 #include <time.h>
 #include <sys/time.h>
 
@@ -18,6 +19,9 @@ namespace tl {
 static std::mt19937 g_randeng_fallback;
 static bool g_bFallbackInited = 0;
 
+// seed for the counter-based streams
+static std::atomic<unsigned int> g_uiStreamSeed(0);
+
 static thread_local std::mt19937/*_64*/ g_randeng;
 static thread_local bool g_bHasEntropy = 0;
 static thread_local bool g_bIsSeeded = 0;
@@ -70,6 +74,7 @@ void init_rand_seed(unsigned int uiSeed)
 	srand(uiSeed);
 	g_randeng = std::mt19937/*_64*/(uiSeed);
 	g_bIsSeeded = 1;
+	g_uiStreamSeed = uiSeed;
 
 	// copy first engine to thread-global fallback
 	if(!g_bFallbackInited)
@@ -79,6 +84,11 @@ void init_rand_seed(unsigned int uiSeed)
 	}
 }
 
+Philox4x32 get_rand_stream(std::uint64_t iStream)
+{
+	return Philox4x32(g_uiStreamSeed.load(), iStream);
+}
+
 unsigned int simple_rand(unsigned int iMax)
 {
 	return rand() % iMax;
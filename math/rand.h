@@ -15,17 +15,29 @@
 #include <future>
 #include <type_traits>
 #include <limits>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
 
 #include <boost/type_traits/function_traits.hpp>
 #include <boost/multi_array.hpp>
 #include <boost/array.hpp>
+#include <boost/math/constants/constants.hpp>
 
 #include "../helper/traits.h"
+#include "../helper/thread.h"
 
 
 namespace tl {
 
 extern std::mt19937& get_randeng();
+class Philox4x32;
+
+/**
+ * counter-based stream number iStream for the current seed
+ */
+extern Philox4x32 get_rand_stream(std::uint64_t iStream);
 
 
 // ----------------------------------------------------------------------------
@@ -124,7 +136,7 @@ static T rand_minmax(T tMin, T tMax)
  * specialisation for 'bool'
  */
 template<>
-bool rand_minmax(bool tMin, bool tMax)
+inline bool rand_minmax(bool tMin, bool tMax)
 {
 	using t_rand = _rand_int<unsigned char>;
 
@@ -462,5 +474,603 @@ t_arr<T, DIM> rand_idx(
 
 // ----------------------------------------------------------------------------
 
+
+
+// ----------------------------------------------------------------------------
+// counter-based random streams
+
+/**
+ * counter-based random number engine (Philox4x32-10)
+ * the n-th number of a stream is a pure function of (seed, stream, n),
+ * so streams are independent, and skipping ahead is free.
+ * usable as engine for the std::*_distribution classes.
+ * @see (Salmon 2011)
+ */
+class Philox4x32
+{
+public:
+	using result_type = std::uint32_t;
+
+	static constexpr std::uint32_t M0 = 0xd2511f53, M1 = 0xcd9e8d57;
+	static constexpr std::uint32_t W0 = 0x9e3779b9, W1 = 0xbb67ae85;
+	static constexpr std::size_t ROUNDS = 10;
+
+	// number of blocks processed together by the bulk generator
+	static constexpr std::size_t LANES = 16;
+
+
+protected:
+	std::uint32_t m_key[2];
+	std::uint32_t m_stream[2];
+
+	// position of the next number in the stream
+	std::uint64_t m_iPos = 0;
+
+	// cached current block
+	std::uint32_t m_buf[4];
+	std::uint64_t m_iBufBlock = std::uint64_t(-1);
+
+
+public:
+	explicit Philox4x32(std::uint64_t iSeed = 0, std::uint64_t iStream = 0)
+	{
+		seed(iSeed, iStream);
+	}
+
+	void seed(std::uint64_t iSeed, std::uint64_t iStream = 0)
+	{
+		m_key[0] = std::uint32_t(iSeed);
+		m_key[1] = std::uint32_t(iSeed >> 32);
+		m_stream[0] = std::uint32_t(iStream);
+		m_stream[1] = std::uint32_t(iStream >> 32);
+		m_iPos = 0;
+		m_iBufBlock = std::uint64_t(-1);
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	/**
+	 * jump ahead by n numbers
+	 */
+	void discard(std::uint64_t n) { m_iPos += n; }
+
+	std::uint64_t GetPos() const { return m_iPos; }
+	void SetPos(std::uint64_t iPos) { m_iPos = iPos; }
+
+	/**
+	 * an independent stream with the same seed
+	 */
+	Philox4x32 GetStream(std::uint64_t iStream) const
+	{
+		Philox4x32 eng(*this);
+		eng.m_stream[0] = std::uint32_t(iStream);
+		eng.m_stream[1] = std::uint32_t(iStream >> 32);
+		eng.m_iPos = 0;
+		eng.m_iBufBlock = std::uint64_t(-1);
+		return eng;
+	}
+
+
+	result_type operator()()
+	{
+		const std::uint64_t iBlock = m_iPos >> 2;
+		if(iBlock != m_iBufBlock)
+		{
+			gen_blocks(iBlock, 1, m_buf);
+			m_iBufBlock = iBlock;
+		}
+
+		return m_buf[(m_iPos++) & 3];
+	}
+
+
+	/**
+	 * fills an array with the next n numbers of the stream
+	 */
+	void fill(result_type* pOut, std::size_t n)
+	{
+		// leading part of a partially used block
+		while(n && (m_iPos & 3))
+		{
+			*pOut++ = (*this)();
+			--n;
+		}
+
+		// whole blocks
+		const std::size_t iBlocks = n >> 2;
+		gen_blocks(m_iPos >> 2, iBlocks, pOut);
+		m_iPos += iBlocks << 2;
+		pOut += iBlocks << 2;
+		n &= 3;
+
+		// trailing part
+		while(n--)
+			*pOut++ = (*this)();
+	}
+
+
+	/**
+	 * the philox rounds on LANES independent counters
+	 */
+	static void rounds(std::uint32_t* c0, std::uint32_t* c1,
+		std::uint32_t* c2, std::uint32_t* c3, std::uint32_t k0, std::uint32_t k1)
+	{
+		for(std::size_t r=0; r<ROUNDS; ++r)
+		{
+			for(std::size_t l=0; l<LANES; ++l)
+			{
+				const std::uint64_t p0 = std::uint64_t(M0) * c0[l];
+				const std::uint64_t p1 = std::uint64_t(M1) * c2[l];
+
+				const std::uint32_t n0 = std::uint32_t(p1 >> 32) ^ c1[l] ^ k0;
+				const std::uint32_t n2 = std::uint32_t(p0 >> 32) ^ c3[l] ^ k1;
+				c1[l] = std::uint32_t(p1);
+				c3[l] = std::uint32_t(p0);
+				c0[l] = n0;
+				c2[l] = n2;
+			}
+
+			k0 += W0;
+			k1 += W1;
+		}
+	}
+
+
+	/**
+	 * generates iNumBlocks blocks of four numbers starting at block iBlock0.
+	 * LANES blocks are processed in parallel in separate arrays,
+	 * which lets the compiler vectorise the rounds.
+	 */
+	void gen_blocks(std::uint64_t iBlock0, std::size_t iNumBlocks, result_type* pOut) const
+	{
+		for(std::size_t b=0; b<iNumBlocks; b+=LANES)
+		{
+			std::uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+
+			for(std::size_t l=0; l<LANES; ++l)
+			{
+				const std::uint64_t iBlock = iBlock0 + b + l;
+				c0[l] = std::uint32_t(iBlock);
+				c1[l] = std::uint32_t(iBlock >> 32);
+				c2[l] = m_stream[0];
+				c3[l] = m_stream[1];
+			}
+
+			rounds(c0, c1, c2, c3, m_key[0], m_key[1]);
+
+			const std::size_t iLanes = (iNumBlocks - b < LANES ? iNumBlocks - b : std::size_t(LANES));
+			for(std::size_t l=0; l<iLanes; ++l)
+			{
+				result_type *pBlock = pOut + ((b+l) << 2);
+				pBlock[0] = c0[l];
+				pBlock[1] = c1[l];
+				pBlock[2] = c2[l];
+				pBlock[3] = c3[l];
+			}
+		}
+	}
+};
+
+
+
+/**
+ * random numbers with an explicit engine
+ */
+template<typename INT, class t_eng>
+INT rand_int(INT iMin, INT iMax, t_eng& eng)
+{
+	if(iMin > iMax)
+		std::swap(iMin, iMax);
+
+	std::uniform_int_distribution<INT> dist(iMin, iMax);
+	return dist(eng);
+}
+
+template<typename REAL, class t_eng>
+REAL rand_real(REAL dMin, REAL dMax, t_eng& eng)
+{
+	if(dMin > dMax)
+		std::swap(dMin, dMax);
+
+	std::uniform_real_distribution<REAL> dist(dMin, dMax);
+	return dist(eng);
+}
+
+template<typename T, class t_eng>
+T rand01(t_eng& eng)
+{
+	return rand_real<T, t_eng>(T(0), T(1), eng);
+}
+
+template<typename T, class t_eng>
+bool rand_prob(T p, t_eng& eng)
+{
+	return rand01<T, t_eng>(eng) <= p;
+}
+
+template<typename REAL, class t_eng>
+REAL rand_norm(REAL dMu, REAL dSigma, t_eng& eng)
+{
+	std::normal_distribution<REAL> dist(dMu, dSigma);
+	return dist(eng);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// bulk generation
+// all values of an array are taken from consecutive positions in the stream,
+// the result is therefore the same for any number of threads.
+
+// number of values per work item in the threaded bulk generators
+#define TLIBS_RAND_CHUNK 4096
+
+
+/**
+ * number of 32-bit stream values consumed per uniform random number
+ */
+template<class REAL> constexpr std::size_t _rand_words()
+{ return sizeof(REAL) > sizeof(std::uint32_t) ? 2 : 1; }
+
+
+/**
+ * converts stream values to uniform reals in [0, 1[
+ * the random bits are put into the mantissa of a number in [1, 2[,
+ * which avoids the (non-vectorisable) integer to float conversion
+ */
+template<class REAL>
+void _rand_u32_to_01(const std::uint32_t* pIn, REAL* pOut, std::size_t n)
+{
+	if(sizeof(REAL) == sizeof(std::uint64_t))
+	{
+		// 52 bits
+		for(std::size_t i=0; i<n; ++i)
+		{
+			const std::uint64_t u = (std::uint64_t(0x3ff) << 52) |
+				(((std::uint64_t(pIn[2*i]) << 32) | pIn[2*i+1]) >> 12);
+			REAL d;
+			std::memcpy(&d, &u, sizeof(d));
+			pOut[i] = d - REAL(1);
+		}
+	}
+	else if(sizeof(REAL) == sizeof(std::uint32_t))
+	{
+		// 23 bits
+		for(std::size_t i=0; i<n; ++i)
+		{
+			const std::uint32_t u = (std::uint32_t(0x7f) << 23) | (pIn[i] >> 9);
+			REAL f;
+			std::memcpy(&f, &u, sizeof(f));
+			pOut[i] = f - REAL(1);
+		}
+	}
+	else
+	{
+		const REAL dScale = REAL(1) / REAL(std::uint64_t(1) << 32);
+		for(std::size_t i=0; i<n; ++i)
+			pOut[i] = (REAL(pIn[_rand_words<REAL>()*i]) +
+				REAL(pIn[_rand_words<REAL>()*i + 1]) * dScale) * dScale;
+	}
+}
+
+
+/**
+ * runs fkt(eng, iStart, iEnd) on chunks of [0, n[ with engines positioned
+ * at iStart*iWords, and advances the engine behind the last value,
+ * if bPairs is set, values are drawn in pairs and an odd n is rounded up
+ */
+template<class t_func>
+void _rand_chunks(std::size_t n, std::size_t iWords, Philox4x32& eng,
+	unsigned int iThreads, t_func&& fkt, bool bPairs = 0)
+{
+	const std::size_t iChunks = (n + TLIBS_RAND_CHUNK - 1) / TLIBS_RAND_CHUNK;
+	const std::uint64_t iPos0 = eng.GetPos();
+
+	run_stripes(iChunks, get_num_threads(iChunks, iThreads),
+		[&](std::size_t iChunkStart, std::size_t iChunkEnd) -> void
+	{
+		Philox4x32 engChunk(eng);
+
+		for(std::size_t iChunk=iChunkStart; iChunk<iChunkEnd; ++iChunk)
+		{
+			const std::size_t iStart = iChunk*TLIBS_RAND_CHUNK;
+			const std::size_t iEnd = std::min<std::size_t>(iStart+TLIBS_RAND_CHUNK, n);
+
+			engChunk.SetPos(iPos0 + iStart*iWords);
+			fkt(engChunk, iStart, iEnd);
+		}
+	});
+
+	const std::size_t iConsumed = bPairs ? (n + 1)/2*2 : n;
+	eng.SetPos(iPos0 + iConsumed*iWords);
+}
+
+
+/**
+ * fills an array with uniform random reals in [0, 1[
+ */
+template<typename REAL>
+void rand01_n(REAL* pOut, std::size_t n, Philox4x32& eng, unsigned int iThreads = 1)
+{
+	const std::size_t iWords = _rand_words<REAL>();
+
+	_rand_chunks(n, iWords, eng, iThreads,
+		[pOut, iWords](Philox4x32& engChunk, std::size_t iStart, std::size_t iEnd) -> void
+	{
+		std::uint32_t buf[TLIBS_RAND_CHUNK*2];
+		engChunk.fill(buf, (iEnd-iStart)*iWords);
+		_rand_u32_to_01<REAL>(buf, pOut+iStart, iEnd-iStart);
+	});
+}
+
+
+/**
+ * fills an array with uniform random reals in [dMin, dMax[
+ */
+template<typename REAL>
+void rand_real_n(REAL* pOut, std::size_t n, REAL dMin, REAL dMax,
+	Philox4x32& eng, unsigned int iThreads = 1)
+{
+	if(dMin > dMax)
+		std::swap(dMin, dMax);
+
+	rand01_n<REAL>(pOut, n, eng, iThreads);
+
+	const REAL dRange = dMax - dMin;
+	for(std::size_t i=0; i<n; ++i)
+		pOut[i] = dMin + dRange*pOut[i];
+}
+
+
+/**
+ * fills an array with Gaussian-distributed random numbers (Box-Muller)
+ */
+template<typename REAL>
+void rand_norm_n(REAL* pOut, std::size_t n, REAL dMu, REAL dSigma,
+	Philox4x32& eng, unsigned int iThreads = 1)
+{
+	const std::size_t iWords = _rand_words<REAL>();
+	const REAL dTwoPi = boost::math::constants::two_pi<REAL>();
+
+	// the chunk size is even, so the pairs do not depend on the chunking,
+	// the spare value of an odd n is dropped, but its words are consumed
+	_rand_chunks(n, iWords, eng, iThreads,
+		[=](Philox4x32& engChunk, std::size_t iStart, std::size_t iEnd) -> void
+	{
+		const std::size_t iLen = iEnd - iStart;
+		const std::size_t iPairs = (iLen + 1) / 2;
+
+		std::uint32_t buf[TLIBS_RAND_CHUNK*2];
+		REAL u[TLIBS_RAND_CHUNK];
+		engChunk.fill(buf, 2*iPairs*iWords);
+		_rand_u32_to_01<REAL>(buf, u, 2*iPairs);
+
+		REAL *pChunk = pOut + iStart;
+		for(std::size_t i=0; i<iPairs; ++i)
+		{
+			const REAL r = dSigma * std::sqrt(REAL(-2) * std::log(REAL(1) - u[2*i]));
+			const REAL phi = dTwoPi * u[2*i+1];
+
+			pChunk[2*i] = dMu + r*std::cos(phi);
+			if(2*i+1 < iLen)
+				pChunk[2*i+1] = dMu + r*std::sin(phi);
+		}
+	}, 1);
+}
+
+
+/**
+ * fills an array with exp-distributed random numbers
+ */
+template<typename REAL>
+void rand_exp_n(REAL* pOut, std::size_t n, REAL dLam,
+	Philox4x32& eng, unsigned int iThreads = 1)
+{
+	rand01_n<REAL>(pOut, n, eng, iThreads);
+
+	const REAL dInvLam = REAL(1) / dLam;
+	for(std::size_t i=0; i<n; ++i)
+		pOut[i] = -dInvLam * std::log(REAL(1) - pOut[i]);
+}
+
+
+/**
+ * upper 64 bits of the 128 bit product a*b
+ */
+static inline std::uint64_t _rand_mulhi64(std::uint64_t a, std::uint64_t b)
+{
+	const std::uint64_t a0 = a & 0xffffffff, a1 = a >> 32;
+	const std::uint64_t b0 = b & 0xffffffff, b1 = b >> 32;
+	const std::uint64_t p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+
+	const std::uint64_t iMid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+	return p11 + (p01 >> 32) + (p10 >> 32) + (iMid >> 32);
+}
+
+
+/**
+ * fills an array with random integers in [iMin, iMax] using the multiply-shift mapping:
+ * ranges of up to 2^32 values use one random word per value and have a bias < range/2^32,
+ * larger ranges use two words per value and have a bias < range/2^64
+ */
+template<typename INT>
+void rand_int_n(INT* pOut, std::size_t n, INT iMin, INT iMax,
+	Philox4x32& eng, unsigned int iThreads = 1)
+{
+	if(iMin > iMax)
+		std::swap(iMin, iMax);
+
+	// number of values minus one, calculated modulo 2^64 to avoid signed overflows
+	const std::uint64_t iSpan = std::uint64_t(iMax) - std::uint64_t(iMin);
+	const std::uint64_t iBase = std::uint64_t(iMin);
+
+	if(iSpan <= 0xffffffff)
+	{
+		const std::uint64_t iRange = iSpan + 1;
+
+		_rand_chunks(n, 1, eng, iThreads,
+			[=](Philox4x32& engChunk, std::size_t iStart, std::size_t iEnd) -> void
+		{
+			std::uint32_t buf[TLIBS_RAND_CHUNK];
+			engChunk.fill(buf, iEnd-iStart);
+
+			for(std::size_t i=iStart; i<iEnd; ++i)
+				pOut[i] = INT(iBase + ((std::uint64_t(buf[i-iStart]) * iRange) >> 32));
+		});
+	}
+	else
+	{
+		// iRange == 0 stands for the full range of 2^64 values
+		const std::uint64_t iRange = iSpan + 1;
+
+		_rand_chunks(n, 2, eng, iThreads,
+			[=](Philox4x32& engChunk, std::size_t iStart, std::size_t iEnd) -> void
+		{
+			std::uint32_t buf[TLIBS_RAND_CHUNK*2];
+			engChunk.fill(buf, (iEnd-iStart)*2);
+
+			for(std::size_t i=iStart; i<iEnd; ++i)
+			{
+				const std::uint64_t iRnd = (std::uint64_t(buf[2*(i-iStart)]) << 32)
+					| buf[2*(i-iStart) + 1];
+				pOut[i] = INT(iBase + (iRange ? _rand_mulhi64(iRnd, iRange) : iRnd));
+			}
+		});
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+// quasi-random sequences
+
+/**
+ * Sobol low-discrepancy sequence in up to MAX_DIM dimensions, generated in gray code order
+ * optionally randomised by a digital shift, which keeps the low discrepancy,
+ * but makes independent replicas for error estimates possible
+ * @see https://en.wikipedia.org/wiki/Sobol_sequence
+ * @see (Joe 2008), doi: https://doi.org/10.1137/070709359 for the direction numbers
+ */
+class Sobol
+{
+public:
+	static constexpr std::size_t MAX_DIM = 10;
+	static constexpr std::size_t BITS = 32;
+
+
+protected:
+	std::size_t m_iDim = 1;
+
+	std::uint32_t m_dir[MAX_DIM][BITS];
+	std::uint32_t m_x[MAX_DIM];
+	std::uint32_t m_shift[MAX_DIM];
+
+	// index of the next point
+	std::uint64_t m_iIdx = 0;
+
+
+public:
+	explicit Sobol(std::size_t iDim = 1)
+	{
+		// primitive polynomial degree s, coefficients a and initial m_k for the dimensions 2..MAX_DIM
+		static const std::uint32_t s[MAX_DIM] = { 0, 1, 2, 3, 3, 4, 4, 5, 5, 5 };
+		static const std::uint32_t a[MAX_DIM] = { 0, 0, 1, 1, 2, 1, 4, 2, 4, 7 };
+		static const std::uint32_t m[MAX_DIM][5] = {
+			{0}, {1}, {1,3}, {1,3,1}, {1,1,1}, {1,1,3,3},
+			{1,3,5,13}, {1,1,5,5,17}, {1,1,5,5,5}, {1,1,7,11,19} };
+
+		m_iDim = std::min(std::max<std::size_t>(iDim, 1), MAX_DIM);
+
+		// first dimension: van der Corput sequence
+		for(std::size_t k=0; k<BITS; ++k)
+			m_dir[0][k] = std::uint32_t(1) << (BITS-1-k);
+
+		for(std::size_t d=1; d<m_iDim; ++d)
+		{
+			const std::size_t iDeg = s[d];
+			for(std::size_t k=0; k<BITS; ++k)
+			{
+				if(k < iDeg)
+				{
+					m_dir[d][k] = m[d][k] << (BITS-1-k);
+					continue;
+				}
+
+				std::uint32_t v = m_dir[d][k-iDeg] ^ (m_dir[d][k-iDeg] >> iDeg);
+				for(std::size_t j=1; j<iDeg; ++j)
+				{
+					if((a[d] >> (iDeg-1-j)) & 1)
+						v ^= m_dir[d][k-j];
+				}
+				m_dir[d][k] = v;
+			}
+		}
+
+		std::fill(m_shift, m_shift+MAX_DIM, std::uint32_t(0));
+		reset();
+	}
+
+	std::size_t GetDim() const { return m_iDim; }
+
+	/**
+	 * restarts the sequence, keeping the shift
+	 */
+	void reset()
+	{
+		m_iIdx = 0;
+		std::copy(m_shift, m_shift+MAX_DIM, m_x);
+	}
+
+	/**
+	 * randomises the sequence by a digital shift drawn from eng and restarts it
+	 */
+	template<class t_eng>
+	void SetShift(t_eng& eng)
+	{
+		std::uniform_int_distribution<std::uint32_t> dist;
+		for(std::size_t d=0; d<m_iDim; ++d)
+			m_shift[d] = dist(eng);
+		reset();
+	}
+
+	/**
+	 * writes the next GetDim() coordinates in [0, 1[
+	 */
+	template<class REAL>
+	void next(REAL* pPt)
+	{
+		const REAL dScale = REAL(1) / REAL(std::uint64_t(1) << BITS);
+		for(std::size_t d=0; d<m_iDim; ++d)
+			pPt[d] = REAL(m_x[d]) * dScale;
+
+		// flip the direction number of the lowest zero bit of the index
+		std::uint64_t iIdx = m_iIdx++;
+		std::size_t iBit = 0;
+		while(iIdx & 1)
+		{
+			iIdx >>= 1;
+			++iBit;
+		}
+		if(iBit < BITS)
+		{
+			for(std::size_t d=0; d<m_iDim; ++d)
+				m_x[d] ^= m_dir[d][iBit];
+		}
+	}
+
+	/**
+	 * writes the next n points, one after the other
+	 */
+	template<class REAL>
+	void next_n(REAL* pPts, std::size_t n)
+	{
+		for(std::size_t i=0; i<n; ++i)
+			next(pPts + i*m_iDim);
+	}
+};
+
+
+// ----------------------------------------------------------------------------
+
 }
 #endif
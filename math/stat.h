@@ -11,6 +11,7 @@
 #include "linalg.h"
 #include "distr.h"
 #include "numint.h"
+#include "../helper/thread.h"
 
 #include <boost/math/special_functions/binomial.hpp>
 //#include <boost/numeric/ublas/io.hpp>
@@ -45,7 +46,7 @@ typename vec_type::value_type mean_square_value(const vec_type& vec)
 {
 	using T = typename vec_type::value_type;
 	if(vec.size()==0) return T(0);
-	else if(vec.size()==1) return vec[0];
+	else if(vec.size()==1) return vec[0]*vec[0];
 
 	T tMean = vec[0]*vec[0];
 	for(std::size_t i=1; i<vec.size(); ++i)
@@ -129,6 +130,467 @@ typename vec_type::value_type std_dev(const vec_type_prob& vecP, const vec_type&
 }
 
 
+// -----------------------------------------------------------------------------
+// mergeable single-pass accumulators
+// partial results of separate chunks can be merged exactly, the bulk functions
+// use two passes over small blocks which stay in the cache.
+// @see (Chan, Golub, LeVeque 1979), https://doi.org/10.1007/978-3-642-51461-6_3
+// @see (Pebay 2008), https://doi.org/10.2172/1028931
+
+// number of values per block in the bulk accumulators
+#define TLIBS_STAT_BLOCK 256
+
+// number of values per work item in the threaded functions
+#define TLIBS_STAT_CHUNK 65536
+
+
+/**
+ * accumulates weight, mean and the central moment sums M2, M3, M4
+ */
+template<class t_real=double>
+class MomentAccumulator
+{
+protected:
+	t_real m_dW = t_real(0);	// sum of weights
+	t_real m_dMean = t_real(0);
+	t_real m_dM2 = t_real(0), m_dM3 = t_real(0), m_dM4 = t_real(0);
+
+public:
+	void reset() { *this = MomentAccumulator<t_real>(); }
+
+	/**
+	 * merges the statistics of another set of values
+	 */
+	void merge(t_real dWb, t_real dMeanb, t_real dM2b, t_real dM3b, t_real dM4b)
+	{
+		if(dWb <= t_real(0))
+			return;
+		if(m_dW <= t_real(0))
+		{
+			m_dW = dWb; m_dMean = dMeanb;
+			m_dM2 = dM2b; m_dM3 = dM3b; m_dM4 = dM4b;
+			return;
+		}
+
+		const t_real dWa = m_dW;
+		const t_real dW = dWa + dWb;
+		const t_real dDelta = dMeanb - m_dMean;
+		const t_real dDeltaW = dDelta / dW;
+		const t_real dDeltaW2 = dDeltaW*dDeltaW;
+
+		m_dM4 += dM4b + dDelta*dDeltaW2*dDeltaW * dWa*dWb * (dWa*dWa - dWa*dWb + dWb*dWb)
+			+ t_real(6)*dDeltaW2 * (dWa*dWa*dM2b + dWb*dWb*m_dM2)
+			+ t_real(4)*dDeltaW * (dWa*dM3b - dWb*m_dM3);
+		m_dM3 += dM3b + dDelta*dDeltaW2 * dWa*dWb * (dWa - dWb)
+			+ t_real(3)*dDeltaW * (dWa*dM2b - dWb*m_dM2);
+		m_dM2 += dM2b + dDelta*dDeltaW * dWa*dWb;
+		m_dMean += dDeltaW * dWb;
+		m_dW = dW;
+	}
+
+	void merge(const MomentAccumulator<t_real>& acc)
+	{
+		merge(acc.m_dW, acc.m_dMean, acc.m_dM2, acc.m_dM3, acc.m_dM4);
+	}
+
+	MomentAccumulator<t_real>& operator+=(const MomentAccumulator<t_real>& acc)
+	{
+		merge(acc);
+		return *this;
+	}
+
+	/**
+	 * adds a single (weighted) value
+	 */
+	void add(t_real x, t_real w = t_real(1))
+	{
+		merge(w, x, t_real(0), t_real(0), t_real(0));
+	}
+
+	/**
+	 * adds an array of values, e.g. a column of a memory-mapped table
+	 */
+	template<class T>
+	void add_n(const T* px, std::size_t n, std::size_t iStride = 1)
+	{
+		t_real buf[TLIBS_STAT_BLOCK];
+
+		for(std::size_t iStart=0; iStart<n; iStart+=TLIBS_STAT_BLOCK)
+		{
+			const std::size_t iLen = std::min<std::size_t>(TLIBS_STAT_BLOCK, n-iStart);
+
+			t_real dSum = t_real(0);
+			for(std::size_t i=0; i<iLen; ++i)
+			{
+				buf[i] = t_real(px[(iStart+i)*iStride]);
+				dSum += buf[i];
+			}
+			const t_real dMean = dSum / t_real(iLen);
+
+			t_real dM2 = t_real(0), dM3 = t_real(0), dM4 = t_real(0);
+			for(std::size_t i=0; i<iLen; ++i)
+			{
+				const t_real d = buf[i] - dMean;
+				const t_real d2 = d*d;
+				dM2 += d2;
+				dM3 += d2*d;
+				dM4 += d2*d2;
+			}
+
+			merge(t_real(iLen), dMean, dM2, dM3, dM4);
+		}
+	}
+
+	/**
+	 * adds an array of weighted values, e.g. histogram bins
+	 */
+	template<class T, class T_w>
+	void add_n(const T* px, const T_w* pw, std::size_t n,
+		std::size_t iStride = 1, std::size_t iStrideW = 1)
+	{
+		t_real buf[TLIBS_STAT_BLOCK], bufW[TLIBS_STAT_BLOCK];
+
+		for(std::size_t iStart=0; iStart<n; iStart+=TLIBS_STAT_BLOCK)
+		{
+			const std::size_t iLen = std::min<std::size_t>(TLIBS_STAT_BLOCK, n-iStart);
+
+			t_real dSum = t_real(0), dSumW = t_real(0);
+			for(std::size_t i=0; i<iLen; ++i)
+			{
+				buf[i] = t_real(px[(iStart+i)*iStride]);
+				bufW[i] = t_real(pw[(iStart+i)*iStrideW]);
+				dSum += bufW[i]*buf[i];
+				dSumW += bufW[i];
+			}
+			if(dSumW <= t_real(0))
+				continue;
+			const t_real dMean = dSum / dSumW;
+
+			t_real dM2 = t_real(0), dM3 = t_real(0), dM4 = t_real(0);
+			for(std::size_t i=0; i<iLen; ++i)
+			{
+				const t_real d = buf[i] - dMean;
+				const t_real d2 = d*d;
+				dM2 += bufW[i]*d2;
+				dM3 += bufW[i]*d2*d;
+				dM4 += bufW[i]*d2*d2;
+			}
+
+			merge(dSumW, dMean, dM2, dM3, dM4);
+		}
+	}
+
+
+	t_real GetWeight() const { return m_dW; }
+	t_real GetMean() const { return m_dMean; }
+
+	/**
+	 * variance, with Bessel's correction for frequency weights
+	 */
+	t_real GetVariance(bool bCorr=1) const
+	{
+		const t_real dNorm = bCorr ? m_dW - t_real(1) : m_dW;
+		if(dNorm <= t_real(0)) return t_real(0);
+		return m_dM2 / dNorm;
+	}
+
+	t_real GetStdDev(bool bCorr=1) const { return std::sqrt(GetVariance(bCorr)); }
+
+	/**
+	 * skewness, <(x-<x>)^3> / sigma^3
+	 */
+	t_real GetSkewness() const
+	{
+		if(m_dM2 <= t_real(0)) return t_real(0);
+		return std::sqrt(m_dW) * m_dM3 / std::pow(m_dM2, t_real(1.5));
+	}
+
+	/**
+	 * excess kurtosis, <(x-<x>)^4> / sigma^4 - 3
+	 */
+	t_real GetKurtosis() const
+	{
+		if(m_dM2 <= t_real(0)) return t_real(0);
+		return m_dW * m_dM4 / (m_dM2*m_dM2) - t_real(3);
+	}
+};
+
+
+/**
+ * accumulates weight, mean vector and co-moment matrix of iDim-dimensional points
+ */
+template<class t_real=double>
+class CovarianceAccumulator
+{
+protected:
+	std::size_t m_iDim = 0;
+	t_real m_dW = t_real(0);
+	std::vector<t_real> m_vecMean;
+
+	// upper triangle of sum( (x-<x>) (x-<x>)^T ), row-major
+	std::vector<t_real> m_vecC;
+
+	// block buffers
+	std::vector<t_real> m_vecBlock, m_vecBlockMean, m_vecBlockC;
+
+protected:
+	static std::size_t tri_size(std::size_t iDim) { return iDim*(iDim+1)/2; }
+
+public:
+	CovarianceAccumulator(std::size_t iDim = 1)
+		: m_iDim(iDim), m_vecMean(iDim, t_real(0)), m_vecC(tri_size(iDim), t_real(0))
+	{}
+
+	void reset() { *this = CovarianceAccumulator<t_real>(m_iDim); }
+
+	std::size_t GetDim() const { return m_iDim; }
+	t_real GetWeight() const { return m_dW; }
+
+	/**
+	 * merges the statistics of another set of points
+	 */
+	void merge(t_real dWb, const t_real* pMeanb, const t_real* pCb)
+	{
+		if(dWb <= t_real(0))
+			return;
+
+		const t_real dWa = m_dW;
+		const t_real dW = dWa + dWb;
+		const t_real dFact = dWa*dWb / dW;
+
+		std::size_t iIdx = 0;
+		for(std::size_t i=0; i<m_iDim; ++i)
+		{
+			const t_real dDeltai = pMeanb[i] - m_vecMean[i];
+			for(std::size_t j=i; j<m_iDim; ++j, ++iIdx)
+				m_vecC[iIdx] += pCb[iIdx] + dFact * dDeltai * (pMeanb[j] - m_vecMean[j]);
+		}
+
+		for(std::size_t i=0; i<m_iDim; ++i)
+			m_vecMean[i] += (pMeanb[i] - m_vecMean[i]) * dWb / dW;
+		m_dW = dW;
+	}
+
+	void merge(const CovarianceAccumulator<t_real>& acc)
+	{
+		merge(acc.m_dW, acc.m_vecMean.data(), acc.m_vecC.data());
+	}
+
+	CovarianceAccumulator<t_real>& operator+=(const CovarianceAccumulator<t_real>& acc)
+	{
+		merge(acc);
+		return *this;
+	}
+
+	/**
+	 * adds a single (weighted) point
+	 */
+	template<class T>
+	void add(const T* px, t_real w = t_real(1))
+	{
+		if(w <= t_real(0))
+			return;
+
+		const t_real dW = m_dW + w;
+		const t_real dFact = m_dW*w / dW;
+
+		std::size_t iIdx = 0;
+		for(std::size_t i=0; i<m_iDim; ++i)
+		{
+			const t_real dDeltai = t_real(px[i]) - m_vecMean[i];
+			for(std::size_t j=i; j<m_iDim; ++j, ++iIdx)
+				m_vecC[iIdx] += dFact * dDeltai * (t_real(px[j]) - m_vecMean[j]);
+		}
+
+		for(std::size_t i=0; i<m_iDim; ++i)
+			m_vecMean[i] += (t_real(px[i]) - m_vecMean[i]) * w / dW;
+		m_dW = dW;
+	}
+
+	/**
+	 * adds n points whose components are iStride elements apart,
+	 * e.g. the rows of a memory-mapped table (iStride = number of columns)
+	 */
+	template<class T>
+	void add_n(const T* px, std::size_t n, std::size_t iStride = 0)
+	{
+		if(iStride == 0)
+			iStride = m_iDim;
+
+		const std::size_t iBlock = std::max<std::size_t>(TLIBS_STAT_BLOCK/m_iDim, 1);
+		m_vecBlock.resize(iBlock*m_iDim);
+		m_vecBlockMean.resize(m_iDim);
+		m_vecBlockC.resize(m_vecC.size());
+
+		for(std::size_t iStart=0; iStart<n; iStart+=iBlock)
+		{
+			const std::size_t iLen = std::min(iBlock, n-iStart);
+
+			// block mean
+			std::fill(m_vecBlockMean.begin(), m_vecBlockMean.end(), t_real(0));
+			for(std::size_t iPt=0; iPt<iLen; ++iPt)
+			{
+				const T* pPt = px + (iStart+iPt)*iStride;
+				t_real* pBlock = m_vecBlock.data() + iPt*m_iDim;
+				for(std::size_t i=0; i<m_iDim; ++i)
+				{
+					pBlock[i] = t_real(pPt[i]);
+					m_vecBlockMean[i] += pBlock[i];
+				}
+			}
+			for(t_real& dMean : m_vecBlockMean)
+				dMean /= t_real(iLen);
+
+			// block co-moments
+			for(std::size_t iPt=0; iPt<iLen; ++iPt)
+			{
+				t_real* pBlock = m_vecBlock.data() + iPt*m_iDim;
+				for(std::size_t i=0; i<m_iDim; ++i)
+					pBlock[i] -= m_vecBlockMean[i];
+			}
+
+			std::size_t iIdx = 0;
+			for(std::size_t i=0; i<m_iDim; ++i)
+			{
+				for(std::size_t j=i; j<m_iDim; ++j, ++iIdx)
+				{
+					t_real dC = t_real(0);
+					for(std::size_t iPt=0; iPt<iLen; ++iPt)
+						dC += m_vecBlock[iPt*m_iDim + i] * m_vecBlock[iPt*m_iDim + j];
+					m_vecBlockC[iIdx] = dC;
+				}
+			}
+
+			merge(t_real(iLen), m_vecBlockMean.data(), m_vecBlockC.data());
+		}
+	}
+
+
+	t_real GetMean(std::size_t i) const { return m_vecMean[i]; }
+
+	ublas::vector<t_real> GetMean() const
+	{
+		ublas::vector<t_real> vec(m_iDim);
+		std::copy(m_vecMean.begin(), m_vecMean.end(), vec.begin());
+		return vec;
+	}
+
+	/**
+	 * covariance matrix, with Bessel's correction for frequency weights
+	 */
+	ublas::matrix<t_real> GetCovariance(bool bCorr=1) const
+	{
+		ublas::matrix<t_real> mat(m_iDim, m_iDim);
+		const t_real dNorm = bCorr ? m_dW - t_real(1) : m_dW;
+		const t_real dInvNorm = dNorm > t_real(0) ? t_real(1)/dNorm : t_real(0);
+
+		std::size_t iIdx = 0;
+		for(std::size_t i=0; i<m_iDim; ++i)
+			for(std::size_t j=i; j<m_iDim; ++j, ++iIdx)
+				mat(i,j) = mat(j,i) = m_vecC[iIdx] * dInvNorm;
+
+		return mat;
+	}
+
+	/**
+	 * correlation matrix, K_ij = C_ij / (sigma_i sigma_j)
+	 */
+	ublas::matrix<t_real> GetCorrelation() const
+	{
+		ublas::matrix<t_real> mat = GetCovariance(0);
+		ublas::vector<t_real> vecStdDev(m_iDim);
+		for(std::size_t i=0; i<m_iDim; ++i)
+			vecStdDev[i] = std::sqrt(mat(i,i));
+
+		for(std::size_t i=0; i<m_iDim; ++i)
+			for(std::size_t j=0; j<m_iDim; ++j)
+				mat(i,j) /= vecStdDev[i]*vecStdDev[j];
+
+		return mat;
+	}
+};
+
+
+/**
+ * runs fkt(acc, iStart, iEnd) on chunks of [0, n[ and merges the results in chunk order,
+ * so the result does not depend on the number of threads
+ */
+template<class t_acc, class t_func>
+t_acc _stat_chunks(std::size_t n, unsigned int iThreads, const t_acc& accInit, t_func&& fkt)
+{
+	const std::size_t iChunks = (n + TLIBS_STAT_CHUNK - 1) / TLIBS_STAT_CHUNK;
+	std::vector<t_acc> vecAcc(iChunks, accInit);
+
+	run_stripes(iChunks, get_num_threads(iChunks, iThreads),
+		[&](std::size_t iChunkStart, std::size_t iChunkEnd) -> void
+	{
+		for(std::size_t iChunk=iChunkStart; iChunk<iChunkEnd; ++iChunk)
+		{
+			const std::size_t iStart = iChunk*TLIBS_STAT_CHUNK;
+			const std::size_t iEnd = std::min<std::size_t>(iStart+TLIBS_STAT_CHUNK, n);
+			fkt(vecAcc[iChunk], iStart, iEnd);
+		}
+	});
+
+	t_acc acc(accInit);
+	for(const t_acc& accChunk : vecAcc)
+		acc.merge(accChunk);
+	return acc;
+}
+
+
+/**
+ * mean and central moments of an array
+ * (iThreads == 0 uses all hardware threads)
+ */
+template<class t_real=double, class T>
+MomentAccumulator<t_real> moments_n(const T* px, std::size_t n,
+	std::size_t iStride = 1, unsigned int iThreads = 1)
+{
+	return _stat_chunks(n, iThreads, MomentAccumulator<t_real>(),
+		[px, iStride](MomentAccumulator<t_real>& acc, std::size_t iStart, std::size_t iEnd) -> void
+	{
+		acc.add_n(px + iStart*iStride, iEnd-iStart, iStride);
+	});
+}
+
+
+/**
+ * weighted mean and central moments of an array
+ */
+template<class t_real=double, class T, class T_w>
+MomentAccumulator<t_real> moments_n(const T* px, const T_w* pw, std::size_t n,
+	std::size_t iStride = 1, std::size_t iStrideW = 1, unsigned int iThreads = 1)
+{
+	return _stat_chunks(n, iThreads, MomentAccumulator<t_real>(),
+		[=](MomentAccumulator<t_real>& acc, std::size_t iStart, std::size_t iEnd) -> void
+	{
+		acc.add_n(px + iStart*iStride, pw + iStart*iStrideW, iEnd-iStart, iStride, iStrideW);
+	});
+}
+
+
+/**
+ * mean vector and covariance of n iDim-dimensional points, iStride elements apart
+ */
+template<class t_real=double, class T>
+CovarianceAccumulator<t_real> covariance_n(const T* px, std::size_t n, std::size_t iDim,
+	std::size_t iStride = 0, unsigned int iThreads = 1)
+{
+	if(iStride == 0)
+		iStride = iDim;
+
+	return _stat_chunks(n, iThreads, CovarianceAccumulator<t_real>(iDim),
+		[px, iStride](CovarianceAccumulator<t_real>& acc, std::size_t iStart, std::size_t iEnd) -> void
+	{
+		acc.add_n(px + iStart*iStride, iEnd-iStart, iStride);
+	});
+}
+
+
+// -----------------------------------------------------------------------------
+
+
 /**
  * entropy of a discrete distribution
  * S = - < log p_i >
@@ -151,12 +613,14 @@ t_real entropy(const t_func& funcPdf, std::size_t iMax)
 /**
  * entropy of a continuous distribution
  * S = - < log p(x_i) >
+ * integrated adaptively using at most iMaxIntervals intervals
  * @see e.g.: https://en.wikipedia.org/wiki/Entropy_(information_theory)
  */
 template<class t_real=double, class t_func>
-t_real entropy(const t_func& funcPdf, t_real dXMin, t_real dXMax, std::size_t iSteps=128)
+t_real entropy(const t_func& funcPdf, t_real dXMin, t_real dXMax, std::size_t iMaxIntervals=128,
+	t_real dEps=t_real(1e-10))
 {
-	std::function<t_real(t_real)> fktInt = [&funcPdf](t_real dX) -> t_real
+	auto fktInt = [&funcPdf](t_real dX) -> t_real
 	{
 		t_real dVal = funcPdf(dX);
 		if(!float_equal(dVal, t_real(0)))
@@ -164,7 +628,7 @@ t_real entropy(const t_func& funcPdf, t_real dXMin, t_real dXMax, std::size_t iS
 		return t_real(0);
 	};
 
-	t_real dS = numint_simpN(fktInt, dXMin, dXMax, iSteps);
+	t_real dS = numint_gk<t_real, t_real>(fktInt, dXMin, dXMax, dEps, dEps, nullptr, iMaxIntervals);
 	return -dS;
 }
 
@@ -275,154 +739,250 @@ std::tuple<ublas::matrix<T>, ublas::matrix<T>>
 covariance(const std::vector<ublas::vector<T>>& vecVals, const std::vector<T>* pProb = 0)
 {
 	using t_mat = ublas::matrix<T>;
-	using t_vecvec = typename std::remove_reference<decltype(vecVals)>::type;
-	using t_innervec_org = decltype(vecVals[0]);
-	using t_innervec = typename std::remove_const<
-		typename std::remove_reference<t_innervec_org>::type>::type;
-
 	if(vecVals.size() == 0) return std::make_tuple(t_mat(), t_mat());
 
-	// mean vector <X_i>
-	t_innervec vecMean;
-	if(pProb)
-		vecMean = mean_value<std::vector<T>, t_vecvec>(*pProb, vecVals);
-	else
-		vecMean = mean_value<t_vecvec>(vecVals);
+	CovarianceAccumulator<T> acc(vecVals[0].size());
+	for(std::size_t i=0; i<vecVals.size(); ++i)
+		acc.add(&vecVals[i][0], pProb ? (*pProb)[i] : T(1));
+
+	// average, sometimes defined as C /= (N-1)
+	return std::make_tuple(acc.GetCovariance(0), acc.GetCorrelation());
+}
 
-	t_mat matCov = zero_m<t_mat>(vecVals[0].size(), vecVals[0].size());
-	T tSum = T(0);
-	const std::size_t N = vecVals.size();
 
-	for(std::size_t i=0; i<N; ++i)
-	{
-		T tprob = T(1);
+// -----------------------------------------------------------------------------
+
 
-		// X_i - <X_i>
-		t_innervec vec = vecVals[i] - vecMean;
+// number of independent partial sums in the chi^2 reductions
+#define TLIBS_CHI2_LANES 8
 
-		// matrix elements, AA^t
-		t_mat matOuter = outer(vec, vec);
 
-		// probabilities for final averaging, <...>
-		if(pProb)
+/**
+ * compensated sum in independent lanes, which the compiler can vectorise
+ * (only valid without -ffast-math, which would remove the compensation)
+ * @see W. Kahan, Commun. ACM 8(1), p. 40 (1965), doi: https://doi.org/10.1145/363707.363723
+ */
+template<class T>
+struct _chi2_kahan_lanes
+{
+	T sum[TLIBS_CHI2_LANES];
+	T comp[TLIBS_CHI2_LANES];
+
+	_chi2_kahan_lanes()
+	{
+		std::fill(sum, sum+TLIBS_CHI2_LANES, T(0));
+		std::fill(comp, comp+TLIBS_CHI2_LANES, T(0));
+	}
+
+	/**
+	 * adds n values, n has to be a multiple of TLIBS_CHI2_LANES
+	 */
+	void add(const T* pVals, std::size_t n)
+	{
+		for(std::size_t i=0; i<n; i+=TLIBS_CHI2_LANES)
 		{
-			tprob = (*pProb)[i];
-			matOuter *= tprob;
+			for(std::size_t j=0; j<TLIBS_CHI2_LANES; ++j)
+			{
+				const T y = pVals[i+j] - comp[j];
+				const T t = sum[j] + y;
+				comp[j] = (t - sum[j]) - y;
+				sum[j] = t;
+			}
 		}
-
-		matCov += matOuter;
-		tSum += tprob;
 	}
+};
 
-	// average, sometimes defined as C /= (N-1)
-	matCov /= tSum /*-T(1)*/;
+
+/**
+ * adds a value to a (sum, compensation) pair, for values of any magnitude
+ * @see A. Neumaier, ZAMM 54(1), pp. 39-51 (1974), doi: https://doi.org/10.1002/zamm.19740540106
+ */
+template<class T>
+void _neumaier_add(T& tSum, T& tComp, T tVal)
+{
+	const T t = tSum + tVal;
+	if(std::abs(tSum) >= std::abs(tVal))
+		tComp += (tSum - t) + tVal;
+	else
+		tComp += (tVal - t) + tSum;
+	tSum = t;
+}
 
 
-	// --------------------------------------------------------------------------------
-	// correlation matrix
-	t_innervec vecVar = diag_vec(matCov);
-	t_innervec vecStdDev(vecVar.size());
+/**
+ * compensated sum of fktTerm(i) for i in [0, N[
+ * the terms are evaluated in fixed chunks, which are distributed over iThreads threads
+ * and summed in chunk order, so the result does not depend on the number of threads
+ * (iThreads == 0 uses all hardware threads)
+ */
+template<class T, class t_func>
+T _chi2_reduce(std::size_t N, unsigned int iThreads, t_func&& fktTerm)
+{
+	const std::size_t iChunks = (N + TLIBS_STAT_CHUNK - 1) / TLIBS_STAT_CHUNK;
+	std::vector<std::pair<T, T>> vecChunks(iChunks);
 
-	std::transform(vecVar.begin(), vecVar.end(), vecStdDev.begin(),
-		[](typename t_innervec::value_type d) -> typename t_innervec::value_type
-		{ return std::sqrt(d); });
+	run_stripes(iChunks, get_num_threads(iChunks, iThreads),
+		[&](std::size_t iChunkStart, std::size_t iChunkEnd) -> void
+	{
+		T buf[TLIBS_STAT_BLOCK];
 
-	t_mat matStdDev = outer(vecStdDev, vecStdDev);
-	t_mat matCorr = ublas::element_div(matCov, matStdDev);
-	// --------------------------------------------------------------------------------
+		for(std::size_t iChunk=iChunkStart; iChunk<iChunkEnd; ++iChunk)
+		{
+			const std::size_t iStart = iChunk*TLIBS_STAT_CHUNK;
+			const std::size_t iEnd = std::min<std::size_t>(iStart+TLIBS_STAT_CHUNK, N);
+			_chi2_kahan_lanes<T> lanes;
+
+			for(std::size_t iBlock=iStart; iBlock<iEnd; iBlock+=TLIBS_STAT_BLOCK)
+			{
+				const std::size_t iLen = std::min<std::size_t>(TLIBS_STAT_BLOCK, iEnd-iBlock);
+				for(std::size_t i=0; i<iLen; ++i)
+					buf[i] = fktTerm(iBlock + i);
+
+				// pad to full lanes
+				const std::size_t iPadded = (iLen + TLIBS_CHI2_LANES-1)
+					/ TLIBS_CHI2_LANES * TLIBS_CHI2_LANES;
+				std::fill(buf+iLen, buf+iPadded, T(0));
+
+				lanes.add(buf, iPadded);
+			}
+
+			T tSum = T(0), tComp = T(0);
+			for(std::size_t j=0; j<TLIBS_CHI2_LANES; ++j)
+			{
+				_neumaier_add(tSum, tComp, lanes.sum[j]);
+				_neumaier_add(tSum, tComp, -lanes.comp[j]);
+			}
+			vecChunks[iChunk] = std::make_pair(tSum, tComp);
+		}
+	});
 
-	return std::make_tuple(matCov, matCorr);
+	T tSum = T(0), tComp = T(0);
+	for(const std::pair<T, T>& chunk : vecChunks)
+	{
+		_neumaier_add(tSum, tComp, chunk.first);
+		_neumaier_add(tSum, tComp, chunk.second);
+	}
+	return tSum + tComp;
 }
 
 
-// -----------------------------------------------------------------------------
+/**
+ * weight of a data point, 1 if no weights are given
+ */
+template<class T, class t_iter_w>
+T _chi2_weight(const t_iter_w w, std::size_t i)
+{
+	return w ? T(w[i]) : T(1);
+}
+
+template<class T>
+T _chi2_weight(std::nullptr_t, std::size_t)
+{
+	return T(1);
+}
+
+
+/**
+ * squared and weighted deviation of a single data point
+ * points with zero weight (e.g. masked detector pixels) give 0, even if their values are nan
+ */
+template<class T, class t_dat>
+T _chi2_term(T td, T tdy, T tw)
+{
+	if(std::abs(tdy) < std::numeric_limits<t_dat>::min())
+		tdy = std::numeric_limits<t_dat>::min();
+
+	const T tchi = td / tdy;
+	return tw == T(0) ? T(0) : tw * tchi*tchi;
+}
 
 
 /**
  * calculates chi^2 distance of a function model to data points
- * chi^2 = sum( (y_i - f(x_i))^2 / sigma_i^2 )
+ * chi^2 = sum( w_i * (y_i - f(x_i))^2 / sigma_i^2 )
+ * the optional weights w_i can be used to mask out bad data points,
+ * func has to be callable from several threads concurrently if iThreads != 1
  * @see e.g.: (Arfken 2013), p. 1170
  */
-template<class T, class t_func, class t_iter_dat=T*>
+template<class T, class t_func, class t_iter_dat=T*, class t_iter_w=const T*>
 T chi2(const t_func& func, std::size_t N,
-	const t_iter_dat x, const t_iter_dat y, const t_iter_dat dy)
+	const t_iter_dat x, const t_iter_dat y, const t_iter_dat dy,
+	const t_iter_w w = nullptr, unsigned int iThreads = 1)
 {
-	using t_dat = typename std::remove_pointer<t_iter_dat>::type;
-	T tchi2 = T(0);
+	using t_dat = typename std::remove_const<typename std::remove_pointer<t_iter_dat>::type>::type;
 
-	for(std::size_t i=0; i<N; ++i)
+	return _chi2_reduce<T>(N, iThreads, [&](std::size_t i) -> T
 	{
+		const T tw = _chi2_weight<T>(w, i);
+		if(tw == T(0))
+			return T(0);
+
 		T td = T(y[i]) - func(T(x[i]));
 		T tdy = dy ? T(dy[i]) : T(0.1*td);	// 10% error if none given
-
-		if(std::abs(tdy) < std::numeric_limits<t_dat>::min())
-			tdy = std::numeric_limits<t_dat>::min();
-
-		T tchi = T(td) / T(tdy);
-		tchi2 += tchi*tchi;
-	}
-
-	return tchi2;
+		return _chi2_term<T, t_dat>(td, tdy, tw);
+	});
 }
 
 
 template<class t_vec, class t_func>
 typename t_vec::value_type chi2(const t_func& func,
-	const t_vec& x, const t_vec& y, const t_vec& dy)
+	const t_vec& x, const t_vec& y, const t_vec& dy,
+	const t_vec* pw = nullptr, unsigned int iThreads = 1)
 {
 	using T = typename t_vec::value_type;
-	return chi2<T, t_func, T*>(func, x.size(), x.data(), y.data(),
-		dy.size() ? dy.data() : nullptr);
+	return chi2<T, t_func, const T*>(func, x.size(), x.data(), y.data(),
+		dy.size() ? dy.data() : nullptr, pw ? pw->data() : nullptr, iThreads);
 }
 
 
 /**
  * chi^2 which doesn't use an x value, but an index instead: y[idx] - func(idx)
  */
-template<class T, class t_func, class t_iter_dat=T*>
-T chi2_idx(const t_func& func, std::size_t N, const t_iter_dat y, const t_iter_dat dy)
+template<class T, class t_func, class t_iter_dat=T*, class t_iter_w=const T*>
+T chi2_idx(const t_func& func, std::size_t N, const t_iter_dat y, const t_iter_dat dy,
+	const t_iter_w w = nullptr, unsigned int iThreads = 1)
 {
-	using t_dat = typename std::remove_pointer<t_iter_dat>::type;
-	T tchi2 = T(0);
+	using t_dat = typename std::remove_const<typename std::remove_pointer<t_iter_dat>::type>::type;
 
-	for(std::size_t i=0; i<N; ++i)
+	return _chi2_reduce<T>(N, iThreads, [&](std::size_t i) -> T
 	{
+		const T tw = _chi2_weight<T>(w, i);
+		if(tw == T(0))
+			return T(0);
+
 		T td = T(y[i]) - func(i);
 		T tdy = dy ? T(dy[i]) : T(0.1*td);	// 10% error if none given
-
-		if(std::abs(tdy) < std::numeric_limits<t_dat>::min())
-			tdy = std::numeric_limits<t_dat>::min();
-
-		T tchi = T(td) / T(tdy);
-		tchi2 += tchi*tchi;
-	}
-
-	return tchi2;
+		return _chi2_term<T, t_dat>(td, tdy, tw);
+	});
 }
 
 
 /**
  * direct chi^2 calculation with a model array instead of a model function
  */
-template<class T, class t_iter_dat=T*>
-T chi2_direct(std::size_t N, const t_iter_dat func_y, const t_iter_dat y, const t_iter_dat dy)
+template<class T, class t_iter_dat=T*, class t_iter_w=const T*>
+T chi2_direct(std::size_t N, const t_iter_dat func_y, const t_iter_dat y, const t_iter_dat dy,
+	const t_iter_w w = nullptr, unsigned int iThreads = 1)
 {
-	using t_dat = typename std::remove_pointer<t_iter_dat>::type;
-	T tchi2 = T(0);
+	using t_dat = typename std::remove_const<typename std::remove_pointer<t_iter_dat>::type>::type;
 
-	for(std::size_t i=0; i<N; ++i)
+	// branch-free terms, so that the loop can be vectorised
+	if(dy)
 	{
-		T td = T(y[i]) - T(func_y[i]);
-		T tdy = dy ? T(dy[i]) : T(0.1*td);	// 10% error if none given
-
-		if(std::abs(tdy) < std::numeric_limits<t_dat>::min())
-			tdy = std::numeric_limits<t_dat>::min();
-
-		T tchi = T(td) / T(tdy);
-		tchi2 += tchi*tchi;
+		return _chi2_reduce<T>(N, iThreads, [&](std::size_t i) -> T
+		{
+			return _chi2_term<T, t_dat>(T(y[i]) - T(func_y[i]), T(dy[i]),
+				_chi2_weight<T>(w, i));
+		});
+	}
+	else
+	{
+		return _chi2_reduce<T>(N, iThreads, [&](std::size_t i) -> T
+		{
+			const T td = T(y[i]) - T(func_y[i]);
+			return _chi2_term<T, t_dat>(td, T(0.1*td), _chi2_weight<T>(w, i));
+		});
 	}
-
-	return tchi2;
 }
 
 
@@ -431,23 +991,18 @@ T chi2_direct(std::size_t N, const t_iter_dat func_y, const t_iter_dat y, const
  */
 template<class T, class T_dat, class t_func, template<class...> class t_vec=std::vector>
 T chi2_nd(const t_func& func,
-	const t_vec<t_vec<T_dat>>& vecvecX, const t_vec<T_dat>& vecY, const t_vec<T_dat>& vecDY)
+	const t_vec<t_vec<T_dat>>& vecvecX, const t_vec<T_dat>& vecY, const t_vec<T_dat>& vecDY,
+	const t_vec<T_dat>* pvecW = nullptr, unsigned int iThreads = 1)
 {
-	T tchi2 = T(0);
-
-	for(std::size_t i=0; i<vecvecX.size(); ++i)
+	return _chi2_reduce<T>(vecvecX.size(), iThreads, [&](std::size_t i) -> T
 	{
-		T td = T(vecY[i]) - func(vecvecX[i]);
-		T tdy = vecDY[i];
-
-		if(std::abs(tdy) < std::numeric_limits<T_dat>::min())
-			tdy = std::numeric_limits<T_dat>::min();
+		const T tw = pvecW ? T((*pvecW)[i]) : T(1);
+		if(tw == T(0))
+			return T(0);
 
-		T tchi = T(td) / T(tdy);
-		tchi2 += tchi*tchi;
-	}
-
-	return tchi2;
+		T td = T(vecY[i]) - func(vecvecX[i]);
+		return _chi2_term<T, T_dat>(td, T(vecDY[i]), tw);
+	});
 }
 
 
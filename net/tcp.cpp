@@ -13,3 +13,5 @@
 
 template class tl::TcpTxtClient<>;
 template class tl::TcpTxtServer<>;
+template class tl::TcpSession<>;
+template class tl::TcpMultiServer<>;
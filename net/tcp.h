@@ -17,7 +17,14 @@
 
 #include <string>
 #include <list>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <atomic>
 #include <thread>
+#include <cstdint>
 
 
 namespace tl {
@@ -29,6 +36,44 @@ namespace sig = boost::signals2;
 namespace lf = boost::lockfree;
 
 
+/**
+ * message framing
+ *   TEXT: messages separated by a delimiter
+ *   BINARY: 8 byte header (little-endian uint32 payload length and type tag), then the payload
+ */
+enum class TcpFraming { TEXT, BINARY };
+
+#define TLIBS_TCP_BIN_HEADER 8
+
+
+/**
+ * received binary message, the data points into the receive buffer
+ * and is only valid during the receive callback
+ */
+struct TcpBinMsg
+{
+	std::uint32_t iType = 0;
+	const char *pcData = nullptr;
+	std::size_t iLen = 0;
+};
+
+
+/**
+ * queued binary message to send
+ */
+struct TcpBinWrite
+{
+	char pcHeader[TLIBS_TCP_BIN_HEADER];
+
+	// either a copy of the data from the buffer pool or shared data
+	std::vector<char> vecData;
+	std::shared_ptr<const std::vector<char>> pShared;
+
+	const char* GetData() const { return pShared ? pShared->data() : vecData.data(); }
+	std::size_t GetLen() const { return pShared ? pShared->size() : vecData.size(); }
+};
+
+
 template<class t_ch=char, class t_str=std::basic_string<t_ch>>
 class TcpTxtClient
 {
@@ -50,11 +95,29 @@ protected:
 	t_ch m_pcReadBuffer[m_iReadBufLen];
 	t_str m_strReadBuffer;
 
+	// binary framing
+	TcpFraming m_framing = TcpFraming::TEXT;
+	std::size_t m_iMaxMsgLen = 1 << 28;
+
+	// receive buffer, holding the unparsed bytes in [m_iBinReadStart, m_iBinReadEnd[
+	std::vector<char> m_vecBinRead;
+	std::size_t m_iBinReadStart = 0, m_iBinReadEnd = 0;
+	std::vector<TcpBinMsg> m_vecBinMsgs;
+
+	// send queue, the batch being written and the pool of free send buffers
+	std::mutex m_mtxBinWrite;
+	std::deque<TcpBinWrite> m_dequeBinWrite;
+	std::vector<TcpBinWrite> m_vecBinWriting;
+	std::vector<std::vector<char>> m_vecBinPool;
+	bool m_bBinWriting = 0;
+
 	using t_sigRecv = sig::signal<void(const t_str&)>;
+	using t_sigRecvBin = sig::signal<void(const std::vector<TcpBinMsg>&)>;
 	using t_sigDisconn = sig::signal<void(const t_str&, const t_str&)>;
 	using t_sigConn = sig::signal<void(const t_str&, const t_str&)>;
 
 	t_sigRecv m_sigRecv;
+	t_sigRecvBin m_sigRecvBin;
 	t_sigDisconn m_sigDisconn;
 	t_sigConn m_sigConn;
 
@@ -63,7 +126,15 @@ public:
 	virtual ~TcpTxtClient();
 	void set_delim(const t_str& strDelim) { m_strCmdDelim = strDelim; }
 
+	/**
+	 * has to be set before connecting
+	 */
+	void set_framing(TcpFraming framing) { m_framing = framing; }
+	TcpFraming get_framing() const { return m_framing; }
+	void set_max_msg_len(std::size_t iLen) { m_iMaxMsgLen = iLen; }
+
 	void add_receiver(const typename t_sigRecv::slot_type& conn);
+	void add_bin_receiver(const typename t_sigRecvBin::slot_type& conn);
 	void add_disconnect(const typename t_sigDisconn::slot_type& disconn);
 	void add_connect(const typename t_sigConn::slot_type& conn);
 
@@ -74,9 +145,17 @@ public:
 	void write(const t_str& str);
 	void wait();
 
+	void write_bin(const void* pvData, std::size_t iLen, std::uint32_t iType=0);
+	void write_bin(const std::shared_ptr<const std::vector<char>>& pData, std::uint32_t iType=0);
+
 protected:
 	void flush_write();
 	void read_loop();
+
+	void queue_bin(TcpBinWrite&& msg, std::size_t iLen, std::uint32_t iType);
+	void flush_write_bin();
+	void read_loop_bin();
+	void reset_bin();
 };
 
 
@@ -102,6 +181,180 @@ public:
 	void add_server_start(const typename t_sigServerStart::slot_type& start);
 };
 
+
+
+// --------------------------------------------------------------------------------
+// server for many concurrent clients
+
+/**
+ * message queued for sending to a session, the payload is shared between sessions
+ */
+struct TcpOutMsg
+{
+	char pcHeader[TLIBS_TCP_BIN_HEADER];
+	bool bHeader = 0;
+
+	std::shared_ptr<const void> pKeep;
+	const char *pcData = nullptr;
+	std::size_t iLen = 0;
+};
+
+
+template<class t_ch, class t_str> class TcpMultiServer;
+
+
+/**
+ * connection to one client of a TcpMultiServer,
+ * all handlers of a session run on the thread of its io_service
+ */
+template<class t_ch=char, class t_str=std::basic_string<t_ch>>
+class TcpSession : public std::enable_shared_from_this<TcpSession<t_ch, t_str>>
+{
+	friend class TcpMultiServer<t_ch, t_str>;
+
+protected:
+	TcpMultiServer<t_ch, t_str> *m_pServer = nullptr;
+	std::size_t m_iId = 0;
+	asio::io_service& m_service;
+	ip::tcp::socket m_sock;
+	t_str m_strRemote;
+
+	// receive buffer, holding the unparsed bytes in [m_iReadStart, m_iReadEnd[
+	std::vector<char> m_vecRead;
+	std::size_t m_iReadStart = 0, m_iReadEnd = 0;
+	std::vector<TcpBinMsg> m_vecMsgs;
+	t_str m_strReadBuffer;
+
+	// send queue and the batch being written
+	std::mutex m_mtxWrite;
+	std::deque<TcpOutMsg> m_dequeWrite;
+	std::vector<TcpOutMsg> m_vecWriting;
+	std::size_t m_iQueued = 0;
+	bool m_bWriting = 0;
+
+	std::atomic<bool> m_bClosed;
+	std::atomic<std::size_t> m_iDropped;
+
+public:
+	TcpSession(TcpMultiServer<t_ch, t_str> *pServer, std::size_t iId, asio::io_service& service);
+	virtual ~TcpSession() = default;
+
+	std::size_t get_id() const { return m_iId; }
+	const t_str& get_remote() const { return m_strRemote; }
+	bool is_open() const { return !m_bClosed; }
+
+	std::size_t get_queued();
+	std::size_t get_num_dropped() const { return m_iDropped; }
+
+	bool write(const std::shared_ptr<const t_str>& pStr);
+	bool write_bin(const std::shared_ptr<const std::vector<char>>& pData, std::uint32_t iType=0);
+	void close();
+
+protected:
+	void start();
+	bool queue(TcpOutMsg&& msg);
+	void flush_write();
+	void read_loop();
+	void do_close();
+};
+
+
+/**
+ * accepts any number of clients and serves them on a pool of io_service threads
+ */
+template<class t_ch=char, class t_str=std::basic_string<t_ch>>
+class TcpMultiServer
+{
+	friend class TcpSession<t_ch, t_str>;
+
+public:
+	using t_session = TcpSession<t_ch, t_str>;
+	using t_sessionptr = std::shared_ptr<t_session>;
+
+protected:
+	// one io_service per thread, sessions are distributed round-robin
+	std::vector<std::unique_ptr<asio::io_service>> m_vecServices;
+	std::vector<std::unique_ptr<asio::io_service::work>> m_vecWork;
+	std::vector<std::thread> m_vecThreads;
+	std::unique_ptr<ip::tcp::acceptor> m_pacceptor;
+	std::unique_ptr<asio::steady_timer> m_ptimerAccept;	// back-off when out of descriptors
+	std::size_t m_iNextService = 0;
+
+	std::mutex m_mtxSessions;
+	std::map<std::size_t, t_sessionptr> m_mapSessions;
+	std::size_t m_iNextId = 1;
+	bool m_bStopping = 0;	// no new sessions are registered, guarded by m_mtxSessions
+
+	TcpFraming m_framing = TcpFraming::TEXT;
+	t_str m_strCmdDelim = "\n";
+	std::size_t m_iMaxMsgLen = 1 << 28;
+
+	// backpressure: maximum number of unsent bytes per session
+	std::size_t m_iMaxQueued = 1 << 24;
+	bool m_bDisconnectSlow = 0;
+
+	using t_sigRecv = sig::signal<void(std::size_t iSession, const t_str&)>;
+	using t_sigRecvBin = sig::signal<void(std::size_t iSession, const std::vector<TcpBinMsg>&)>;
+	using t_sigConn = sig::signal<void(std::size_t iSession, const t_str& strRemote)>;
+	using t_sigDisconn = sig::signal<void(std::size_t iSession, const t_str& strRemote)>;
+	using t_sigServerStart = sig::signal<void(unsigned short iPort)>;
+
+	t_sigRecv m_sigRecv;
+	t_sigRecvBin m_sigRecvBin;
+	t_sigConn m_sigConn;
+	t_sigDisconn m_sigDisconn;
+	t_sigServerStart m_sigServerStart;
+
+public:
+	TcpMultiServer() = default;
+	virtual ~TcpMultiServer();
+
+	/**
+	 * have to be set before starting the server
+	 */
+	void set_delim(const t_str& strDelim) { m_strCmdDelim = strDelim; }
+	void set_framing(TcpFraming framing) { m_framing = framing; }
+	void set_max_msg_len(std::size_t iLen) { m_iMaxMsgLen = iLen; }
+
+	/**
+	 * messages exceeding the send queue limit of a session are dropped,
+	 * or the session is closed if bDisconnectSlow is set
+	 */
+	void set_max_queued(std::size_t iBytes, bool bDisconnectSlow=0)
+	{ m_iMaxQueued = iBytes; m_bDisconnectSlow = bDisconnectSlow; }
+
+	bool start_server(unsigned short iPort, unsigned int iThreads=0);
+	void stop_server();
+	bool is_running() const { return m_pacceptor != nullptr; }
+
+	std::size_t get_num_sessions();
+	std::vector<std::size_t> get_session_ids();
+	std::vector<t_sessionptr> get_sessions();
+	t_sessionptr get_session(std::size_t iSession);
+	void disconnect_session(std::size_t iSession);
+
+	bool write(std::size_t iSession, const t_str& str);
+	bool write_bin(std::size_t iSession, const void* pvData, std::size_t iLen, std::uint32_t iType=0);
+
+	/**
+	 * sends the same data to all sessions, returns the number of sessions it was queued for
+	 */
+	std::size_t broadcast(const t_str& str);
+	std::size_t broadcast(const std::shared_ptr<const t_str>& pStr);
+	std::size_t broadcast_bin(const void* pvData, std::size_t iLen, std::uint32_t iType=0);
+	std::size_t broadcast_bin(const std::shared_ptr<const std::vector<char>>& pData, std::uint32_t iType=0);
+
+	void add_receiver(const typename t_sigRecv::slot_type& conn);
+	void add_bin_receiver(const typename t_sigRecvBin::slot_type& conn);
+	void add_connect(const typename t_sigConn::slot_type& conn);
+	void add_disconnect(const typename t_sigDisconn::slot_type& disconn);
+	void add_server_start(const typename t_sigServerStart::slot_type& start);
+
+protected:
+	void accept_loop();
+	void remove_session(std::size_t iSession);
+};
+
 }
 
 #ifdef TLIBS_INC_HDR_IMPLS
@@ -16,9 +16,85 @@
 #include "../log/log.h"
 #include "../string/string.h"
 #include <boost/tokenizer.hpp>
+#include <algorithm>
+#include <cstring>
 
 namespace tl {
 
+static inline std::uint32_t _tcp_get_le32(const char* pc)
+{
+	const unsigned char* pcu = reinterpret_cast<const unsigned char*>(pc);
+	return std::uint32_t(pcu[0]) | (std::uint32_t(pcu[1]) << 8)
+		| (std::uint32_t(pcu[2]) << 16) | (std::uint32_t(pcu[3]) << 24);
+}
+
+static inline void _tcp_put_le32(char* pc, std::uint32_t iVal)
+{
+	for(int i=0; i<4; ++i)
+		pc[i] = char((iVal >> (8*i)) & 0xff);
+}
+
+/**
+ * moves a partially received binary message to the front of the buffer
+ * and makes room for its remaining bytes
+ */
+static inline void _tcp_prepare_bin_read(std::vector<char>& vecBuf,
+	std::size_t& iStart, std::size_t& iEnd, std::size_t iMaxLen)
+{
+	static constexpr const std::size_t iMinRead = 1 << 16;
+
+	if(iStart > 0)
+	{
+		std::memmove(vecBuf.data(), vecBuf.data() + iStart, iEnd - iStart);
+		iEnd -= iStart;
+		iStart = 0;
+	}
+
+	std::size_t iWanted = iEnd + iMinRead;
+	if(iEnd >= TLIBS_TCP_BIN_HEADER)
+	{
+		const std::size_t iMsgLen = TLIBS_TCP_BIN_HEADER
+			+ std::min<std::size_t>(_tcp_get_le32(vecBuf.data()), iMaxLen);
+		iWanted = std::max(iWanted, iMsgLen);
+	}
+	if(vecBuf.size() < iWanted)
+		vecBuf.resize(std::max(iWanted, 2*vecBuf.size()));
+}
+
+/**
+ * collects all complete binary messages in [iStart, iEnd[ of the buffer
+ * @return false if a message exceeds the maximum length
+ */
+static inline bool _tcp_parse_bin(const std::vector<char>& vecBuf,
+	std::size_t& iStart, std::size_t iEnd, std::size_t iMaxLen,
+	std::vector<TcpBinMsg>& vecMsgs)
+{
+	while(iEnd - iStart >= TLIBS_TCP_BIN_HEADER)
+	{
+		const char* pcHeader = vecBuf.data() + iStart;
+		const std::size_t iLen = _tcp_get_le32(pcHeader);
+		if(iLen > iMaxLen)
+		{
+			log_err("Binary message too long: ", iLen, " bytes.");
+			return false;
+		}
+
+		if(iEnd - iStart < TLIBS_TCP_BIN_HEADER + iLen)
+			break;
+
+		TcpBinMsg msg;
+		msg.iType = _tcp_get_le32(pcHeader + 4);
+		msg.pcData = pcHeader + TLIBS_TCP_BIN_HEADER;
+		msg.iLen = iLen;
+		vecMsgs.push_back(msg);
+
+		iStart += TLIBS_TCP_BIN_HEADER + iLen;
+	}
+
+	return true;
+}
+
+
 template<class t_ch, class t_str>
 bool TcpTxtClient<t_ch, t_str>::get_cmd_tokens(const t_str& str, const t_str& strDelim,
 	std::vector<t_str>& vecStr, t_str& strRemainder)
@@ -63,6 +139,7 @@ TcpTxtClient<t_ch, t_str>::~TcpTxtClient()
 	disconnect();
 
 	m_sigRecv.disconnect_all_slots();
+	m_sigRecvBin.disconnect_all_slots();
 	m_sigDisconn.disconnect_all_slots();
 	m_sigConn.disconnect_all_slots();
 }
@@ -129,18 +206,29 @@ void TcpTxtClient<t_ch, t_str>::disconnect(bool bAlwaysSendSignal)
 	const bool bConnected = is_connected();
 	if(bConnected)
 	{
-		m_psock->shutdown(ip::tcp::socket::shutdown_send);
+		sys::error_code err;
+		m_psock->shutdown(ip::tcp::socket::shutdown_send, err);
 		m_pservice->stop();
-		m_psock->close();
+		m_psock->close(err);
 	}
 
-	if(m_psock) { delete m_psock; m_psock = 0; }
+	// called from a handler: the service thread cannot join itself,
+	// the remaining clean-up happens in the next disconnect from outside
+	if(m_pthread && m_pthread->get_id() == std::this_thread::get_id())
+	{
+		if(bConnected || bAlwaysSendSignal)
+			m_sigDisconn(m_strHost, m_strService);
+		return;
+	}
+
+	// let a running handler finish before its socket is deleted
 	if(m_pthread)
 	{
 		m_pthread->join();
 		delete m_pthread;
 		m_pthread = 0;
 	}
+	if(m_psock) { delete m_psock; m_psock = 0; }
 	if(m_pservice) { delete m_pservice; m_pservice = 0; }
 
 	if(bConnected || bAlwaysSendSignal)
@@ -155,6 +243,8 @@ void TcpTxtClient<t_ch, t_str>::disconnect(bool bAlwaysSendSignal)
 	{
 		if(pstr) { delete pstr; pstr = nullptr; }
 	}
+
+	reset_bin();
 }
 
 template<class t_ch, class t_str>
@@ -221,6 +311,12 @@ void TcpTxtClient<t_ch, t_str>::flush_write()
 template<class t_ch, class t_str>
 void TcpTxtClient<t_ch, t_str>::read_loop()
 {
+	if(m_framing == TcpFraming::BINARY)
+	{
+		read_loop_bin();
+		return;
+	}
+
 	//tl::log_debug("In read loop.");
 	asio::async_read(*m_psock, asio::buffer(m_pcReadBuffer, m_iReadBufLen), asio::transfer_at_least(1),
 	[this](const sys::error_code& err, std::size_t len)
@@ -254,6 +350,188 @@ void TcpTxtClient<t_ch, t_str>::read_loop()
   }
 
 
+// --------------------------------------------------------------------------------
+// binary framing
+
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::reset_bin()
+{
+	m_vecBinRead.clear();
+	m_vecBinMsgs.clear();
+	m_iBinReadStart = m_iBinReadEnd = 0;
+
+	std::lock_guard<std::mutex> lock(m_mtxBinWrite);
+	m_dequeBinWrite.clear();
+	m_vecBinWriting.clear();
+	m_bBinWriting = 0;
+}
+
+/**
+ * writes a copy of the data, using a buffer from the pool
+ */
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::write_bin(const void* pvData, std::size_t iLen, std::uint32_t iType)
+{
+	TcpBinWrite msg;
+	{
+		std::lock_guard<std::mutex> lock(m_mtxBinWrite);
+		if(m_vecBinPool.size())
+		{
+			msg.vecData.swap(m_vecBinPool.back());
+			m_vecBinPool.pop_back();
+		}
+	}
+
+	const char* pcData = reinterpret_cast<const char*>(pvData);
+	msg.vecData.assign(pcData, pcData + iLen);
+	queue_bin(std::move(msg), iLen, iType);
+}
+
+/**
+ * writes shared data without copying, it is kept alive until it has been sent
+ */
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::write_bin(const std::shared_ptr<const std::vector<char>>& pData,
+	std::uint32_t iType)
+{
+	if(!pData) return;
+
+	TcpBinWrite msg;
+	msg.pShared = pData;
+	queue_bin(std::move(msg), pData->size(), iType);
+}
+
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::queue_bin(TcpBinWrite&& msg, std::size_t iLen, std::uint32_t iType)
+{
+	if(!is_connected())
+	{
+		log_err("Not connected, cannot write to socket.");
+		return;
+	}
+	if(iLen > m_iMaxMsgLen || iLen > std::size_t(0xffffffff))
+	{
+		log_err("Binary message too long: ", iLen, " bytes.");
+		return;
+	}
+
+	_tcp_put_le32(msg.pcHeader, std::uint32_t(iLen));
+	_tcp_put_le32(msg.pcHeader+4, iType);
+
+	bool bStartWriting = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mtxBinWrite);
+		m_dequeBinWrite.emplace_back(std::move(msg));
+
+		if(!m_bBinWriting)
+			m_bBinWriting = bStartWriting = 1;
+	}
+
+	if(bStartWriting)
+		m_pservice->post([this]() { flush_write_bin(); });
+}
+
+/**
+ * sends all queued messages with one gathering write
+ */
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::flush_write_bin()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtxBinWrite);
+		for(TcpBinWrite& msg : m_dequeBinWrite)
+			m_vecBinWriting.emplace_back(std::move(msg));
+		m_dequeBinWrite.clear();
+
+		if(m_vecBinWriting.empty())
+		{
+			m_bBinWriting = 0;
+			return;
+		}
+	}
+
+	std::vector<asio::const_buffer> vecBufs;
+	vecBufs.reserve(m_vecBinWriting.size() * 2);
+	for(const TcpBinWrite& msg : m_vecBinWriting)
+	{
+		vecBufs.emplace_back(msg.pcHeader, TLIBS_TCP_BIN_HEADER);
+		if(msg.GetLen())
+			vecBufs.emplace_back(msg.GetData(), msg.GetLen());
+	}
+
+	asio::async_write(*m_psock, vecBufs,
+	[this](const sys::error_code& err, std::size_t)
+	{
+		{
+			// return the copied buffers to the pool
+			std::lock_guard<std::mutex> lock(m_mtxBinWrite);
+			for(TcpBinWrite& msg : m_vecBinWriting)
+			{
+				if(msg.pShared || m_vecBinPool.size() >= 64 || msg.vecData.capacity() > (1<<20))
+					continue;
+				msg.vecData.clear();
+				m_vecBinPool.emplace_back(std::move(msg.vecData));
+			}
+			m_vecBinWriting.clear();
+
+			if(err)
+				m_bBinWriting = 0;
+		}
+
+		if(err)
+		{
+			disconnect();
+			return;
+		}
+
+		flush_write_bin();
+	});
+}
+
+/**
+ * reads into the receive buffer and passes all complete messages
+ * to the receivers in one batch
+ */
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::read_loop_bin()
+{
+	_tcp_prepare_bin_read(m_vecBinRead, m_iBinReadStart, m_iBinReadEnd, m_iMaxMsgLen);
+
+	m_psock->async_read_some(asio::buffer(m_vecBinRead.data() + m_iBinReadEnd,
+		m_vecBinRead.size() - m_iBinReadEnd),
+	[this](const sys::error_code& err, std::size_t len)
+	{
+		if(err)
+		{
+			if(err != asio::error::eof)
+			{
+				log_err("TCP read error. Category: ", err.category().name(),
+					", message: ", err.message(), ".");
+			}
+			disconnect();
+			return;
+		}
+
+		m_iBinReadEnd += len;
+		m_vecBinMsgs.clear();
+
+		if(!_tcp_parse_bin(m_vecBinRead, m_iBinReadStart, m_iBinReadEnd, m_iMaxMsgLen, m_vecBinMsgs))
+		{
+			disconnect();
+			return;
+		}
+
+		if(m_vecBinMsgs.size())
+			m_sigRecvBin(m_vecBinMsgs);
+
+		if(m_iBinReadStart == m_iBinReadEnd)
+			m_iBinReadStart = m_iBinReadEnd = 0;
+
+		read_loop_bin();
+	});
+}
+
+
 // --------------------------------------------------------------------------------
 // Signals
 template<class t_ch, class t_str>
@@ -262,6 +540,12 @@ void TcpTxtClient<t_ch, t_str>::add_receiver(const typename t_sigRecv::slot_type
 	m_sigRecv.connect(conn);
 }
 
+template<class t_ch, class t_str>
+void TcpTxtClient<t_ch, t_str>::add_bin_receiver(const typename t_sigRecvBin::slot_type& conn)
+{
+	m_sigRecvBin.connect(conn);
+}
+
 template<class t_ch, class t_str>
 void TcpTxtClient<t_ch, t_str>::add_disconnect(const typename t_sigDisconn::slot_type& disconn)
 {
@@ -366,5 +650,619 @@ void TcpTxtServer<t_ch, t_str>::add_server_start(const typename t_sigServerStart
 // --------------------------------------------------------------------------------
 
 
+
+// --------------------------------------------------------------------------------
+// sessions of the multi-client server
+
+template<class t_ch, class t_str>
+TcpSession<t_ch, t_str>::TcpSession(TcpMultiServer<t_ch, t_str> *pServer,
+	std::size_t iId, asio::io_service& service)
+	: m_pServer(pServer), m_iId(iId), m_service(service), m_sock(service),
+		m_bClosed(false), m_iDropped(0)
+{}
+
+template<class t_ch, class t_str>
+void TcpSession<t_ch, t_str>::start()
+{
+	if(m_bClosed) return;
+
+	m_pServer->m_sigConn(m_iId, m_strRemote);
+	read_loop();
+}
+
+template<class t_ch, class t_str>
+std::size_t TcpSession<t_ch, t_str>::get_queued()
+{
+	std::lock_guard<std::mutex> lock(m_mtxWrite);
+	return m_iQueued;
+}
+
+template<class t_ch, class t_str>
+bool TcpSession<t_ch, t_str>::write(const std::shared_ptr<const t_str>& pStr)
+{
+	if(!pStr) return 0;
+
+	TcpOutMsg msg;
+	msg.pKeep = pStr;
+	msg.pcData = reinterpret_cast<const char*>(pStr->data());
+	msg.iLen = pStr->length() * sizeof(t_ch);
+	return queue(std::move(msg));
+}
+
+template<class t_ch, class t_str>
+bool TcpSession<t_ch, t_str>::write_bin(const std::shared_ptr<const std::vector<char>>& pData,
+	std::uint32_t iType)
+{
+	if(!pData) return 0;
+	if(pData->size() > m_pServer->m_iMaxMsgLen || pData->size() > std::size_t(0xffffffff))
+	{
+		log_err("Binary message too long: ", pData->size(), " bytes.");
+		return 0;
+	}
+
+	TcpOutMsg msg;
+	msg.bHeader = 1;
+	_tcp_put_le32(msg.pcHeader, std::uint32_t(pData->size()));
+	_tcp_put_le32(msg.pcHeader+4, iType);
+	msg.pKeep = pData;
+	msg.pcData = pData->data();
+	msg.iLen = pData->size();
+	return queue(std::move(msg));
+}
+
+template<class t_ch, class t_str>
+bool TcpSession<t_ch, t_str>::queue(TcpOutMsg&& msg)
+{
+	if(m_bClosed) return 0;
+
+	const std::size_t iMsgLen = msg.iLen + (msg.bHeader ? TLIBS_TCP_BIN_HEADER : 0);
+	bool bStartWriting = 0, bOverflow = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mtxWrite);
+
+		// a single message is always accepted by an idle session
+		if(m_iQueued > 0 && m_iQueued + iMsgLen > m_pServer->m_iMaxQueued)
+		{
+			bOverflow = 1;
+		}
+		else
+		{
+			m_iQueued += iMsgLen;
+			m_dequeWrite.emplace_back(std::move(msg));
+
+			if(!m_bWriting)
+				m_bWriting = bStartWriting = 1;
+		}
+	}
+
+	if(bOverflow)
+	{
+		++m_iDropped;
+		if(m_pServer->m_bDisconnectSlow)
+			close();
+		return 0;
+	}
+
+	if(bStartWriting)
+	{
+		std::shared_ptr<TcpSession<t_ch, t_str>> pThis = this->shared_from_this();
+		m_service.post([pThis]() { pThis->flush_write(); });
+	}
+	return 1;
+}
+
+/**
+ * sends all queued messages with one gathering write
+ */
+template<class t_ch, class t_str>
+void TcpSession<t_ch, t_str>::flush_write()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtxWrite);
+		for(TcpOutMsg& msg : m_dequeWrite)
+			m_vecWriting.emplace_back(std::move(msg));
+		m_dequeWrite.clear();
+
+		if(m_vecWriting.empty() || m_bClosed)
+		{
+			m_bWriting = 0;
+			return;
+		}
+	}
+
+	std::size_t iBatchLen = 0;
+	std::vector<asio::const_buffer> vecBufs;
+	vecBufs.reserve(m_vecWriting.size() * 2);
+	for(const TcpOutMsg& msg : m_vecWriting)
+	{
+		if(msg.bHeader)
+		{
+			vecBufs.emplace_back(msg.pcHeader, TLIBS_TCP_BIN_HEADER);
+			iBatchLen += TLIBS_TCP_BIN_HEADER;
+		}
+		if(msg.iLen)
+		{
+			vecBufs.emplace_back(msg.pcData, msg.iLen);
+			iBatchLen += msg.iLen;
+		}
+	}
+
+	std::shared_ptr<TcpSession<t_ch, t_str>> pThis = this->shared_from_this();
+	asio::async_write(m_sock, vecBufs,
+	[pThis, iBatchLen](const sys::error_code& err, std::size_t)
+	{
+		{
+			std::lock_guard<std::mutex> lock(pThis->m_mtxWrite);
+			pThis->m_vecWriting.clear();
+			pThis->m_iQueued -= std::min(iBatchLen, pThis->m_iQueued);
+
+			if(err)
+				pThis->m_bWriting = 0;
+		}
+
+		if(err)
+		{
+			pThis->do_close();
+			return;
+		}
+
+		pThis->flush_write();
+	});
+}
+
+template<class t_ch, class t_str>
+void TcpSession<t_ch, t_str>::read_loop()
+{
+	std::shared_ptr<TcpSession<t_ch, t_str>> pThis = this->shared_from_this();
+	TcpMultiServer<t_ch, t_str> *pServer = m_pServer;
+
+	if(pServer->m_framing == TcpFraming::BINARY)
+	{
+		_tcp_prepare_bin_read(m_vecRead, m_iReadStart, m_iReadEnd, pServer->m_iMaxMsgLen);
+
+		m_sock.async_read_some(asio::buffer(m_vecRead.data() + m_iReadEnd, m_vecRead.size() - m_iReadEnd),
+		[pThis, pServer](const sys::error_code& err, std::size_t len)
+		{
+			if(err)
+			{
+				pThis->do_close();
+				return;
+			}
+
+			pThis->m_iReadEnd += len;
+			pThis->m_vecMsgs.clear();
+			if(!_tcp_parse_bin(pThis->m_vecRead, pThis->m_iReadStart, pThis->m_iReadEnd,
+				pServer->m_iMaxMsgLen, pThis->m_vecMsgs))
+			{
+				pThis->do_close();
+				return;
+			}
+
+			if(pThis->m_vecMsgs.size())
+				pServer->m_sigRecvBin(pThis->m_iId, pThis->m_vecMsgs);
+
+			if(pThis->m_iReadStart == pThis->m_iReadEnd)
+				pThis->m_iReadStart = pThis->m_iReadEnd = 0;
+
+			pThis->read_loop();
+		});
+	}
+	else
+	{
+		static constexpr const std::size_t iReadLen = 4096;
+		if(m_vecRead.size() < iReadLen*sizeof(t_ch))
+			m_vecRead.resize(iReadLen*sizeof(t_ch));
+
+		m_sock.async_read_some(asio::buffer(m_vecRead.data(), m_vecRead.size()),
+		[pThis, pServer](const sys::error_code& err, std::size_t len)
+		{
+			if(err)
+			{
+				pThis->do_close();
+				return;
+			}
+
+			pThis->m_strReadBuffer.append(reinterpret_cast<const t_ch*>(pThis->m_vecRead.data()),
+				len / sizeof(t_ch));
+
+			std::vector<t_str> vecCmds;
+			if(TcpTxtClient<t_ch, t_str>::get_cmd_tokens(pThis->m_strReadBuffer,
+				pServer->m_strCmdDelim, vecCmds, pThis->m_strReadBuffer))
+			{
+				for(const t_str& strCmd : vecCmds)
+					pServer->m_sigRecv(pThis->m_iId, strCmd);
+			}
+
+			pThis->read_loop();
+		});
+	}
+}
+
+/**
+ * closes the session from any thread
+ */
+template<class t_ch, class t_str>
+void TcpSession<t_ch, t_str>::close()
+{
+	std::shared_ptr<TcpSession<t_ch, t_str>> pThis = this->shared_from_this();
+	m_service.post([pThis]() { pThis->do_close(); });
+}
+
+template<class t_ch, class t_str>
+void TcpSession<t_ch, t_str>::do_close()
+{
+	if(m_bClosed.exchange(true))
+		return;
+
+	sys::error_code err;
+	m_sock.shutdown(ip::tcp::socket::shutdown_both, err);
+	m_sock.close(err);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mtxWrite);
+		m_dequeWrite.clear();
+		m_iQueued = 0;
+	}
+
+	m_pServer->remove_session(m_iId);
+}
+
+
+
+// --------------------------------------------------------------------------------
+// multi-client server
+
+template<class t_ch, class t_str>
+TcpMultiServer<t_ch, t_str>::~TcpMultiServer()
+{
+	stop_server();
+
+	m_sigRecv.disconnect_all_slots();
+	m_sigRecvBin.disconnect_all_slots();
+	m_sigConn.disconnect_all_slots();
+	m_sigDisconn.disconnect_all_slots();
+	m_sigServerStart.disconnect_all_slots();
+}
+
+/**
+ * starts listening and runs iThreads io_service threads (0: number of cores)
+ */
+template<class t_ch, class t_str>
+bool TcpMultiServer<t_ch, t_str>::start_server(unsigned short iPort, unsigned int iThreads)
+{
+	stop_server();
+
+	if(iThreads == 0)
+		iThreads = std::max<unsigned int>(1, std::thread::hardware_concurrency());
+
+	try
+	{
+		for(unsigned int iThread=0; iThread<iThreads; ++iThread)
+		{
+			m_vecServices.emplace_back(new asio::io_service);
+			m_vecWork.emplace_back(new asio::io_service::work(*m_vecServices.back()));
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtxSessions);
+			m_bStopping = 0;
+		}
+
+		ip::tcp::endpoint endpoint(ip::tcp::v4(), iPort);
+		m_pacceptor.reset(new ip::tcp::acceptor(*m_vecServices[0], endpoint));
+		m_ptimerAccept.reset(new asio::steady_timer(*m_vecServices[0]));
+		m_iNextService = 0;
+		accept_loop();
+
+		for(unsigned int iThread=0; iThread<iThreads; ++iThread)
+		{
+			asio::io_service *pService = m_vecServices[iThread].get();
+			m_vecThreads.emplace_back([pService]()
+			{
+				try
+				{
+					pService->run();
+				}
+				catch(const std::exception& ex)
+				{
+					log_err("TCP server thread exited with error: ", ex.what(), ".");
+				}
+			});
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		log_err(ex.what());
+		stop_server();
+		return 0;
+	}
+
+	m_sigServerStart(iPort);
+	return 1;
+}
+
+/**
+ * closes all sessions and waits for the service threads
+ */
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::stop_server()
+{
+	// sessions accepted from now on are closed instead of registered,
+	// so the snapshot below contains all sessions that need closing
+	{
+		std::lock_guard<std::mutex> lock(m_mtxSessions);
+		m_bStopping = 1;
+	}
+
+	if(m_pacceptor)
+	{
+		ip::tcp::acceptor *pacceptor = m_pacceptor.get();
+		asio::steady_timer *ptimer = m_ptimerAccept.get();
+		m_vecServices[0]->post([pacceptor, ptimer]()
+		{
+			sys::error_code err;
+			pacceptor->close(err);
+			ptimer->cancel(err);
+		});
+	}
+
+	for(const t_sessionptr& pSession : get_sessions())
+		pSession->close();
+
+	// the threads return when all pending handlers are done
+	m_vecWork.clear();
+	for(std::thread& thread : m_vecThreads)
+		thread.join();
+	m_vecThreads.clear();
+
+	m_ptimerAccept.reset();
+	m_pacceptor.reset();
+	{
+		std::lock_guard<std::mutex> lock(m_mtxSessions);
+		m_mapSessions.clear();
+	}
+	m_vecServices.clear();
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::accept_loop()
+{
+	asio::io_service& service = *m_vecServices[m_iNextService];
+	m_iNextService = (m_iNextService + 1) % m_vecServices.size();
+
+	t_sessionptr pSession = std::make_shared<t_session>(this, m_iNextId++, service);
+	m_pacceptor->async_accept(pSession->m_sock,
+	[this, pSession](const sys::error_code& err)
+	{
+		// the acceptor may already be closed if the connection completed before stop_server
+		if(err == asio::error::operation_aborted || !m_pacceptor->is_open())
+			return;
+
+		if(err)
+		{
+			log_err("TCP server error.",
+				" Category: ", err.category().name(),
+				", message: ", err.message(), ".");
+
+			// out of file descriptors: retry later instead of spinning
+			if(err == sys::errc::too_many_files_open || err == sys::errc::too_many_files_open_in_system)
+			{
+				m_ptimerAccept->expires_from_now(std::chrono::milliseconds(100));
+				m_ptimerAccept->async_wait([this](const sys::error_code& errTimer)
+				{
+					if(!errTimer && m_pacceptor->is_open())
+						accept_loop();
+				});
+				return;
+			}
+
+			// only errors of the aborted connection are recoverable
+			if(err != sys::errc::connection_aborted && err != sys::errc::connection_reset
+				&& err != sys::errc::resource_unavailable_try_again
+				&& err != sys::errc::interrupted && err != sys::errc::protocol_error)
+			{
+				log_err("TCP server stops accepting connections.");
+				return;
+			}
+		}
+		else
+		{
+			sys::error_code errEndpoint;
+			ip::tcp::endpoint endpoint = pSession->m_sock.remote_endpoint(errEndpoint);
+			if(!errEndpoint)
+				pSession->m_strRemote = endpoint.address().to_string() + ":" + tl::var_to_str(endpoint.port());
+
+			bool bStopping = 0;
+			{
+				std::lock_guard<std::mutex> lock(m_mtxSessions);
+				bStopping = m_bStopping;
+				if(!bStopping)
+					m_mapSessions[pSession->get_id()] = pSession;
+			}
+
+			if(bStopping)
+			{
+				sys::error_code errClose;
+				pSession->m_sock.close(errClose);
+				return;
+			}
+
+			pSession->m_service.post([pSession]() { pSession->start(); });
+		}
+
+		accept_loop();
+	});
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::remove_session(std::size_t iSession)
+{
+	t_str strRemote;
+	{
+		std::lock_guard<std::mutex> lock(m_mtxSessions);
+		auto iter = m_mapSessions.find(iSession);
+		if(iter == m_mapSessions.end())
+			return;
+
+		strRemote = iter->second->get_remote();
+		m_mapSessions.erase(iter);
+	}
+
+	m_sigDisconn(iSession, strRemote);
+}
+
+template<class t_ch, class t_str>
+std::size_t TcpMultiServer<t_ch, t_str>::get_num_sessions()
+{
+	std::lock_guard<std::mutex> lock(m_mtxSessions);
+	return m_mapSessions.size();
+}
+
+template<class t_ch, class t_str>
+std::vector<std::size_t> TcpMultiServer<t_ch, t_str>::get_session_ids()
+{
+	std::lock_guard<std::mutex> lock(m_mtxSessions);
+
+	std::vector<std::size_t> vecIds;
+	vecIds.reserve(m_mapSessions.size());
+	for(const auto& pair : m_mapSessions)
+		vecIds.push_back(pair.first);
+	return vecIds;
+}
+
+template<class t_ch, class t_str>
+std::vector<typename TcpMultiServer<t_ch, t_str>::t_sessionptr>
+TcpMultiServer<t_ch, t_str>::get_sessions()
+{
+	std::lock_guard<std::mutex> lock(m_mtxSessions);
+
+	std::vector<t_sessionptr> vecSessions;
+	vecSessions.reserve(m_mapSessions.size());
+	for(const auto& pair : m_mapSessions)
+		vecSessions.push_back(pair.second);
+	return vecSessions;
+}
+
+template<class t_ch, class t_str>
+typename TcpMultiServer<t_ch, t_str>::t_sessionptr
+TcpMultiServer<t_ch, t_str>::get_session(std::size_t iSession)
+{
+	std::lock_guard<std::mutex> lock(m_mtxSessions);
+	auto iter = m_mapSessions.find(iSession);
+	if(iter == m_mapSessions.end())
+		return nullptr;
+	return iter->second;
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::disconnect_session(std::size_t iSession)
+{
+	t_sessionptr pSession = get_session(iSession);
+	if(pSession)
+		pSession->close();
+}
+
+template<class t_ch, class t_str>
+bool TcpMultiServer<t_ch, t_str>::write(std::size_t iSession, const t_str& str)
+{
+	t_sessionptr pSession = get_session(iSession);
+	if(!pSession)
+	{
+		log_err("No TCP session with id ", iSession, ".");
+		return 0;
+	}
+
+	return pSession->write(std::make_shared<const t_str>(str));
+}
+
+template<class t_ch, class t_str>
+bool TcpMultiServer<t_ch, t_str>::write_bin(std::size_t iSession,
+	const void* pvData, std::size_t iLen, std::uint32_t iType)
+{
+	t_sessionptr pSession = get_session(iSession);
+	if(!pSession)
+	{
+		log_err("No TCP session with id ", iSession, ".");
+		return 0;
+	}
+
+	const char* pcData = reinterpret_cast<const char*>(pvData);
+	return pSession->write_bin(std::make_shared<const std::vector<char>>(pcData, pcData + iLen), iType);
+}
+
+template<class t_ch, class t_str>
+std::size_t TcpMultiServer<t_ch, t_str>::broadcast(const t_str& str)
+{
+	return broadcast(std::make_shared<const t_str>(str));
+}
+
+template<class t_ch, class t_str>
+std::size_t TcpMultiServer<t_ch, t_str>::broadcast(const std::shared_ptr<const t_str>& pStr)
+{
+	std::size_t iQueued = 0;
+	for(const t_sessionptr& pSession : get_sessions())
+	{
+		if(pSession->write(pStr))
+			++iQueued;
+	}
+	return iQueued;
+}
+
+template<class t_ch, class t_str>
+std::size_t TcpMultiServer<t_ch, t_str>::broadcast_bin(const void* pvData, std::size_t iLen,
+	std::uint32_t iType)
+{
+	const char* pcData = reinterpret_cast<const char*>(pvData);
+	return broadcast_bin(std::make_shared<const std::vector<char>>(pcData, pcData + iLen), iType);
+}
+
+template<class t_ch, class t_str>
+std::size_t TcpMultiServer<t_ch, t_str>::broadcast_bin(const std::shared_ptr<const std::vector<char>>& pData,
+	std::uint32_t iType)
+{
+	std::size_t iQueued = 0;
+	for(const t_sessionptr& pSession : get_sessions())
+	{
+		if(pSession->write_bin(pData, iType))
+			++iQueued;
+	}
+	return iQueued;
+}
+
+
+// --------------------------------------------------------------------------------
+// Signals
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::add_receiver(const typename t_sigRecv::slot_type& conn)
+{
+	m_sigRecv.connect(conn);
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::add_bin_receiver(const typename t_sigRecvBin::slot_type& conn)
+{
+	m_sigRecvBin.connect(conn);
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::add_connect(const typename t_sigConn::slot_type& conn)
+{
+	m_sigConn.connect(conn);
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::add_disconnect(const typename t_sigDisconn::slot_type& disconn)
+{
+	m_sigDisconn.connect(disconn);
+}
+
+template<class t_ch, class t_str>
+void TcpMultiServer<t_ch, t_str>::add_server_start(const typename t_sigServerStart::slot_type& conn)
+{
+	m_sigServerStart.connect(conn);
+}
+// --------------------------------------------------------------------------------
+
+
 }
 #endif
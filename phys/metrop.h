@@ -0,0 +1,994 @@
+/**
+ * parallel checkerboard metropolis algorithm for the ising model
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @date oct-2026
+ * @license GPLv2 or GPLv3
+ */
+
+#ifndef __TLIBS_METROP_H__
+#define __TLIBS_METROP_H__
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+#include "../math/rand.h"
+#include "../helper/thread.h"
+#include "../helper/exception.h"
+#include "../log/log.h"
+
+
+namespace tl {
+
+// binary (de)serialisation helpers for the checkpoints
+template<class T>
+void _metrop_write(std::ostream& ostr, const T& val)
+{
+	ostr.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template<class T>
+void _metrop_write(std::ostream& ostr, const std::vector<T>& vec)
+{
+	_metrop_write<std::uint64_t>(ostr, vec.size());
+	ostr.write(reinterpret_cast<const char*>(vec.data()), vec.size()*sizeof(T));
+}
+
+template<class T>
+bool _metrop_read(std::istream& istr, T& val)
+{
+	istr.read(reinterpret_cast<char*>(&val), sizeof(T));
+	return bool(istr);
+}
+
+/**
+ * reads a vector which has to have iExpected elements,
+ * the size is checked before anything is allocated
+ */
+template<class T>
+bool _metrop_read(std::istream& istr, std::vector<T>& vec, std::size_t iExpected)
+{
+	std::uint64_t iSize = 0;
+	if(!_metrop_read(istr, iSize) || iSize != iExpected)
+		return false;
+	vec.resize(iSize);
+	istr.read(reinterpret_cast<char*>(vec.data()), iSize*sizeof(T));
+	return bool(istr);
+}
+
+
+/**
+ * ising lattice with H = -J sum_<ij> s_i s_j - B sum_i s_i
+ *
+ * the spins are stored as int8 (+1/-1) in a lattice with a halo layer
+ * around it. for open boundaries the halo stays 0, for periodic boundaries
+ * it holds a copy of the opposite face. the neighbours of a site are then
+ * always at the same constant offsets.
+ *
+ * one sweep updates all sites of one checkerboard colour in parallel, then the other.
+ * the random numbers are taken from a counter-based stream at positions given by
+ * sweep, colour and site, so the result does not depend on the number of threads.
+ *
+ * @see (Scherer 2010), p. 104
+ * @see (Schroeder 2000), p. 346 ff
+ */
+template<class t_real = double, std::size_t DIM = 2>
+class MetropIsing
+{
+public:
+	using t_spin = std::int8_t;
+	using t_dims = std::array<std::size_t, DIM>;
+
+	/**
+	 * observables per site after a sweep
+	 */
+	struct Observables
+	{
+		t_real dE = 0;		// energy per site
+		t_real dM = 0;		// magnetisation per site
+	};
+
+
+protected:
+	t_dims m_dims;			// lattice size
+	t_dims m_dimsPad;		// lattice size including the halo
+	t_dims m_strides;		// strides in the padded lattice
+	std::vector<t_spin> m_vecSpins;
+
+	std::size_t m_iNumSites = 0;
+	std::size_t m_iLineLen = 0;		// number of sites along the innermost dimension
+	std::size_t m_iNumLines = 0;	// number of lines along the innermost dimension
+
+	bool m_bPeriodic = true;
+	unsigned int m_iThreads = 0;
+
+	t_real m_dJ = 1, m_dB = 0;
+	t_real m_dBeta = 1;
+
+	// acceptance thresholds for 32-bit random numbers, indexed by [spin>0][s*h + 2*DIM]
+	std::uint64_t m_thresh[2][4*DIM + 1];
+
+	// sum over bonds s_i s_j and over spins s_i
+	std::int64_t m_iBonds = 0, m_iMag = 0;
+
+	std::uint64_t m_iSeed = 0;
+	Philox4x32 m_eng;
+	std::uint64_t m_iSweep = 0;
+
+
+protected:
+	/**
+	 * recalculates the acceptance thresholds from the boltzmann factors
+	 */
+	void CalcThresholds()
+	{
+		const t_real dMax = t_real(std::uint64_t(1) << 32);
+
+		for(int iSpin=0; iSpin<2; ++iSpin)
+		{
+			const t_real dSpin = (iSpin ? t_real(1) : t_real(-1));
+
+			for(int iSH=-2*int(DIM); iSH<=2*int(DIM); ++iSH)
+			{
+				// h = s*(s*h)
+				const t_real dH = dSpin * t_real(iSH);
+				const t_real dEDiff = t_real(2) * dSpin * (m_dJ*dH + m_dB);
+
+				std::uint64_t iThresh = std::uint64_t(1) << 32;
+				if(dEDiff > t_real(0))
+					iThresh = std::uint64_t(std::exp(-m_dBeta*dEDiff) * dMax);
+				m_thresh[iSpin][iSH + 2*DIM] = iThresh;
+			}
+		}
+	}
+
+
+	/**
+	 * offset of the first site of a line in the padded lattice and the parity of the line
+	 */
+	std::size_t GetLineOffset(std::size_t iLine, unsigned int& iParity) const
+	{
+		std::size_t iOffs = 1;
+		iParity = 0;
+
+		for(std::ptrdiff_t iDim=std::ptrdiff_t(DIM)-2; iDim>=0; --iDim)
+		{
+			const std::size_t iCoord = iLine % m_dims[iDim];
+			iLine /= m_dims[iDim];
+
+			iOffs += (iCoord+1) * m_strides[iDim];
+			iParity += unsigned(iCoord);
+		}
+
+		iParity &= 1;
+		return iOffs;
+	}
+
+
+	/**
+	 * sum of the neighbouring spins
+	 */
+	int GetField(std::size_t iIdx) const
+	{
+		int iH = 0;
+		for(std::size_t iDim=0; iDim<DIM; ++iDim)
+			iH += m_vecSpins[iIdx - m_strides[iDim]] + m_vecSpins[iIdx + m_strides[iDim]];
+		return iH;
+	}
+
+
+	/**
+	 * copies the faces of the lattice into the opposite halos
+	 */
+	void UpdateHalo()
+	{
+		if(!m_bPeriodic)
+			return;
+
+		for(std::size_t iDim=0; iDim<DIM; ++iDim)
+		{
+			const std::size_t iStride = m_strides[iDim];
+			const std::size_t iJump = m_dims[iDim] * iStride;
+
+			// iterate over all padded sites with coordinate 0 in dimension iDim
+			t_dims idx; idx.fill(0);
+			while(1)
+			{
+				std::size_t iIdx = 0;
+				for(std::size_t i=0; i<DIM; ++i)
+					iIdx += idx[i] * m_strides[i];
+
+				m_vecSpins[iIdx] = m_vecSpins[iIdx + iJump];
+				m_vecSpins[iIdx + iJump + iStride] = m_vecSpins[iIdx + iStride];
+
+				// next index, skipping dimension iDim
+				std::ptrdiff_t i = std::ptrdiff_t(DIM)-1;
+				for(; i>=0; --i)
+				{
+					if(std::size_t(i) == iDim)
+						continue;
+					if(++idx[i] < m_dimsPad[i])
+						break;
+					idx[i] = 0;
+				}
+				if(i < 0)
+					break;
+			}
+		}
+	}
+
+
+	/**
+	 * updates all sites of one colour
+	 */
+	void HalfSweep(unsigned int iColour)
+	{
+		std::atomic<std::int64_t> iBondsDiff(0), iMagDiff(0);
+		const std::uint64_t iPosBase = (m_iSweep*2 + iColour) * m_iNumLines;
+
+		run_stripes(m_iNumLines, get_num_threads(m_iNumLines, m_iThreads),
+			[this, iColour, iPosBase, &iBondsDiff, &iMagDiff]
+			(std::size_t iLineStart, std::size_t iLineEnd) -> void
+		{
+			Philox4x32 eng(m_eng);
+			std::vector<std::uint32_t> vecRnd(m_iLineLen);
+			std::int64_t iBonds = 0, iMag = 0;
+
+			for(std::size_t iLine=iLineStart; iLine<iLineEnd; ++iLine)
+			{
+				unsigned int iParity = 0;
+				const std::size_t iOffs = GetLineOffset(iLine, iParity);
+
+				eng.SetPos((iPosBase + iLine) * m_iLineLen);
+				eng.fill(vecRnd.data(), m_iLineLen);
+
+				for(std::size_t iX=(iColour+iParity)&1; iX<m_iLineLen; iX+=2)
+				{
+					const std::size_t iIdx = iOffs + iX;
+					const int iSpin = m_vecSpins[iIdx];
+					const int iH = GetField(iIdx);
+
+					if(std::uint64_t(vecRnd[iX]) < m_thresh[iSpin > 0][iSpin*iH + 2*int(DIM)])
+					{
+						m_vecSpins[iIdx] = t_spin(-iSpin);
+						iBonds -= 2*iSpin*iH;
+						iMag -= 2*iSpin;
+					}
+				}
+			}
+
+			iBondsDiff += iBonds;
+			iMagDiff += iMag;
+		});
+
+		m_iBonds += iBondsDiff;
+		m_iMag += iMagDiff;
+
+		UpdateHalo();
+	}
+
+
+public:
+	/**
+	 * @param dims lattice size, all sizes have to be even for periodic boundaries
+	 * @param iThreads number of threads, 0: all hardware threads
+	 */
+	MetropIsing(const t_dims& dims, t_real dJ, bool bPeriodic = true,
+		std::uint64_t iSeed = 0, unsigned int iThreads = 0)
+		: m_dims(dims), m_bPeriodic(bPeriodic), m_iThreads(iThreads),
+			m_dJ(dJ), m_iSeed(iSeed), m_eng(iSeed)
+	{
+		m_iNumSites = 1;
+		for(std::size_t iDim=0; iDim<DIM; ++iDim)
+		{
+			if(m_dims[iDim] == 0)
+				throw Err("Invalid lattice size.");
+			if(m_bPeriodic && (m_dims[iDim] % 2))
+				throw Err("Periodic checkerboard lattice needs even sizes.");
+
+			m_dimsPad[iDim] = m_dims[iDim] + 2;
+			m_iNumSites *= m_dims[iDim];
+		}
+
+		m_strides[DIM-1] = 1;
+		for(std::ptrdiff_t iDim=std::ptrdiff_t(DIM)-2; iDim>=0; --iDim)
+			m_strides[iDim] = m_strides[iDim+1] * m_dimsPad[iDim+1];
+
+		m_iLineLen = m_dims[DIM-1];
+		m_iNumLines = m_iNumSites / m_iLineLen;
+
+		m_vecSpins.resize(m_strides[0] * m_dimsPad[0], t_spin(0));
+		SetAll(1);
+		CalcThresholds();
+	}
+
+
+	/**
+	 * sets the temperature, the boltzmann constant dk gives the units
+	 */
+	void SetTemperature(t_real dT, t_real dk = 1)
+	{
+		m_dBeta = t_real(1) / (dk*dT);
+		CalcThresholds();
+	}
+
+	void SetCoupling(t_real dJ) { m_dJ = dJ; CalcThresholds(); }
+	void SetField(t_real dB) { m_dB = dB; CalcThresholds(); }
+	void SetThreads(unsigned int iThreads) { m_iThreads = iThreads; }
+
+	t_real GetBeta() const { return m_dBeta; }
+	const t_dims& GetDims() const { return m_dims; }
+	std::size_t GetNumSites() const { return m_iNumSites; }
+	std::uint64_t GetNumSweeps() const { return m_iSweep; }
+	std::uint64_t GetSeed() const { return m_iSeed; }
+
+
+	/**
+	 * index into the padded lattice
+	 */
+	std::size_t GetIndex(const t_dims& idx) const
+	{
+		std::size_t iIdx = 0;
+		for(std::size_t iDim=0; iDim<DIM; ++iDim)
+			iIdx += (idx[iDim]+1) * m_strides[iDim];
+		return iIdx;
+	}
+
+	t_spin GetSpin(const t_dims& idx) const { return m_vecSpins[GetIndex(idx)]; }
+
+	void SetSpin(const t_dims& idx, t_spin spin)
+	{
+		m_vecSpins[GetIndex(idx)] = (spin > 0 ? 1 : -1);
+		UpdateHalo();
+		CalcObservables();
+	}
+
+
+	/**
+	 * calls fkt(idx, iPaddedIdx) for all sites
+	 */
+	template<class t_func>
+	void ForAllSites(t_func&& fkt) const
+	{
+		t_dims idx; idx.fill(0);
+		while(1)
+		{
+			fkt(idx, GetIndex(idx));
+
+			std::ptrdiff_t i = std::ptrdiff_t(DIM)-1;
+			for(; i>=0; --i)
+			{
+				if(++idx[i] < m_dims[i])
+					break;
+				idx[i] = 0;
+			}
+			if(i < 0)
+				break;
+		}
+	}
+
+
+	void SetAll(t_spin spin)
+	{
+		ForAllSites([this, spin](const t_dims&, std::size_t iIdx) -> void
+		{
+			m_vecSpins[iIdx] = (spin > 0 ? 1 : -1);
+		});
+
+		UpdateHalo();
+		CalcObservables();
+	}
+
+	/**
+	 * random spins, using stream iStream of the engine
+	 */
+	void Randomise(std::uint64_t iStream = 1)
+	{
+		Philox4x32 eng = m_eng.GetStream(iStream);
+
+		ForAllSites([this, &eng](const t_dims&, std::size_t iIdx) -> void
+		{
+			m_vecSpins[iIdx] = (eng() & 1) ? 1 : -1;
+		});
+
+		UpdateHalo();
+		CalcObservables();
+	}
+
+
+	/**
+	 * copies the spins from/to an array indexable by arr(idx) with bool or +-1 values
+	 * (e.g. the boost::multi_array<bool, DIM> used by tl::metrop)
+	 */
+	template<class t_arr>
+	void FromArray(const t_arr& arr)
+	{
+		ForAllSites([this, &arr](const t_dims& idx, std::size_t iIdx) -> void
+		{
+			m_vecSpins[iIdx] = (arr(idx) > 0 ? 1 : -1);
+		});
+
+		UpdateHalo();
+		CalcObservables();
+	}
+
+	template<class t_arr>
+	void ToArray(t_arr& arr) const
+	{
+		using t_val = typename std::decay<decltype(arr(m_dims))>::type;
+		// spin down is false for bool arrays and -1 otherwise
+		const t_val valDown = std::is_same<t_val, bool>::value ? t_val(0) : t_val(-1);
+
+		ForAllSites([this, &arr, valDown](const t_dims& idx, std::size_t iIdx) -> void
+		{
+			arr(idx) = (m_vecSpins[iIdx] > 0 ? t_val(1) : valDown);
+		});
+	}
+
+
+	/**
+	 * recalculates the bond and spin sums from scratch
+	 */
+	void CalcObservables()
+	{
+		m_iBonds = m_iMag = 0;
+
+		ForAllSites([this](const t_dims&, std::size_t iIdx) -> void
+		{
+			const int iSpin = m_vecSpins[iIdx];
+			m_iMag += iSpin;
+
+			// only count the bonds in positive direction
+			for(std::size_t iDim=0; iDim<DIM; ++iDim)
+				m_iBonds += iSpin * m_vecSpins[iIdx + m_strides[iDim]];
+		});
+	}
+
+
+	t_real GetEnergy() const
+	{
+		return -m_dJ*t_real(m_iBonds) - m_dB*t_real(m_iMag);
+	}
+
+	t_real GetMagnetisation() const
+	{
+		return t_real(m_iMag);
+	}
+
+	Observables GetObservables() const
+	{
+		Observables obs;
+		obs.dE = GetEnergy() / t_real(m_iNumSites);
+		obs.dM = GetMagnetisation() / t_real(m_iNumSites);
+		return obs;
+	}
+
+
+	/**
+	 * writes the lattice and the random stream state
+	 */
+	void Save(std::ostream& ostr) const
+	{
+		for(std::size_t iDim=0; iDim<DIM; ++iDim)
+			_metrop_write<std::uint64_t>(ostr, m_dims[iDim]);
+		_metrop_write<std::uint8_t>(ostr, m_bPeriodic);
+		_metrop_write(ostr, m_dJ);
+		_metrop_write(ostr, m_dB);
+		_metrop_write(ostr, m_dBeta);
+		_metrop_write(ostr, m_iSeed);
+		_metrop_write(ostr, m_iSweep);
+		_metrop_write(ostr, m_vecSpins);
+	}
+
+	/**
+	 * reads a lattice written by Save, the lattice size has to match
+	 */
+	bool Load(std::istream& istr)
+	{
+		for(std::size_t iDim=0; iDim<DIM; ++iDim)
+		{
+			std::uint64_t iSize = 0;
+			if(!_metrop_read(istr, iSize) || iSize != m_dims[iDim])
+			{
+				log_err("Lattice size mismatch in dimension ", iDim, ".");
+				return false;
+			}
+		}
+
+		// the state is only changed if everything could be read
+		std::uint8_t iPeriodic = 0;
+		t_real dJ = 0, dB = 0, dBeta = 0;
+		std::uint64_t iSeed = 0, iSweep = 0;
+		std::vector<t_spin> vecSpins;
+
+		if(!_metrop_read(istr, iPeriodic) || !_metrop_read(istr, dJ) ||
+			!_metrop_read(istr, dB) || !_metrop_read(istr, dBeta) ||
+			!_metrop_read(istr, iSeed) || !_metrop_read(istr, iSweep) ||
+			!_metrop_read(istr, vecSpins, m_vecSpins.size()))
+		{
+			log_err("Invalid lattice data.");
+			return false;
+		}
+
+		m_bPeriodic = (iPeriodic != 0);
+		m_dJ = dJ;
+		m_dB = dB;
+		m_dBeta = dBeta;
+		m_iSeed = iSeed;
+		m_iSweep = iSweep;
+		m_eng.seed(iSeed);
+		m_vecSpins = std::move(vecSpins);
+
+		CalcThresholds();
+		CalcObservables();
+		return true;
+	}
+
+
+	/**
+	 * runs checkerboard sweeps
+	 * @param pvecObs if given, the observables after each sweep are appended
+	 */
+	void Sweep(std::size_t iNumSweeps = 1, std::vector<Observables>* pvecObs = nullptr)
+	{
+		if(pvecObs)
+			pvecObs->reserve(pvecObs->size() + iNumSweeps);
+
+		for(std::size_t iSweep=0; iSweep<iNumSweeps; ++iSweep)
+		{
+			HalfSweep(0);
+			HalfSweep(1);
+			++m_iSweep;
+
+			if(pvecObs)
+				pvecObs->push_back(GetObservables());
+		}
+	}
+};
+
+
+// ----------------------------------------------------------------------------
+/**
+ * histogram with equidistant bins in [dMin, dMax]
+ */
+template<class t_real = double>
+struct MetropHistogram
+{
+	t_real dMin = 0, dMax = 1;
+	std::vector<std::uint64_t> vecCounts;
+
+	MetropHistogram() = default;
+	MetropHistogram(t_real _dMin, t_real _dMax, std::size_t iBins)
+		: dMin(_dMin), dMax(_dMax), vecCounts(iBins, 0)
+	{}
+
+	void Add(t_real dVal)
+	{
+		if(vecCounts.empty())
+			return;
+
+		const t_real dBin = (dVal - dMin) / (dMax - dMin) * t_real(vecCounts.size());
+		std::size_t iBin = 0;
+		if(dBin >= t_real(vecCounts.size()))
+			iBin = vecCounts.size() - 1;
+		else if(dBin > t_real(0))
+			iBin = std::size_t(dBin);
+
+		++vecCounts[iBin];
+	}
+
+	t_real GetBinCentre(std::size_t iBin) const
+	{
+		return dMin + (t_real(iBin) + t_real(0.5)) * (dMax - dMin) / t_real(vecCounts.size());
+	}
+
+	void Clear() { std::fill(vecCounts.begin(), vecCounts.end(), 0); }
+};
+
+
+
+/**
+ * parallel tempering (replica exchange) with one MetropIsing lattice per temperature
+ *
+ * all replicas are swept concurrently, afterwards neighbouring temperatures
+ * are exchanged with probability min(1, exp((beta_i - beta_j) (E_i - E_j))).
+ * the observables are accumulated per temperature.
+ *
+ * @see (Hukushima 1996)
+ */
+template<class t_real = double, std::size_t DIM = 2>
+class MetropTempering
+{
+public:
+	using t_ising = MetropIsing<t_real, DIM>;
+	using t_dims = typename t_ising::t_dims;
+	using t_hist = MetropHistogram<t_real>;
+
+	/**
+	 * averages at one temperature
+	 */
+	struct Results
+	{
+		t_real dT = 0;
+		std::uint64_t iNumMeas = 0;
+		t_real dE = 0;			// energy per site
+		t_real dC = 0;			// heat capacity per site
+		t_real dM = 0;			// |magnetisation| per site
+		t_real dChi = 0;		// susceptibility per site
+		t_real dBinder = 0;		// binder cumulant 1 - <M^4>/(3 <M^2>^2)
+		t_real dSwapRate = 0;	// acceptance of the exchange with the next temperature
+	};
+
+
+protected:
+	std::vector<t_real> m_vecT;
+	t_real m_dk = 1;
+	t_real m_dEMax = 1;		// range of the energy histograms
+	unsigned int m_iThreads = 0;
+
+	std::vector<t_ising> m_vecReplicas;
+	std::vector<std::size_t> m_vecReplIdx;	// replica at the given temperature index
+
+	std::uint64_t m_iSeed = 0;
+	Philox4x32 m_engSwap;
+	std::uint64_t m_iRound = 0;
+	std::vector<std::uint64_t> m_vecSwapTries, m_vecSwapAcc;
+
+	// sums of E, E^2, |M|, M^2, M^4 (per lattice) and histograms per temperature
+	std::vector<std::uint64_t> m_vecNumMeas;
+	std::vector<t_real> m_vecSumE, m_vecSumE2, m_vecSumM, m_vecSumM2, m_vecSumM4;
+	std::vector<t_hist> m_vecHistE, m_vecHistM;
+
+
+protected:
+	void SetReplicaTemperature(std::size_t iTemp)
+	{
+		m_vecReplicas[m_vecReplIdx[iTemp]].SetTemperature(m_vecT[iTemp], m_dk);
+	}
+
+	/**
+	 * tries to exchange neighbouring temperatures, alternating between even and odd pairs
+	 */
+	void Exchange()
+	{
+		const std::size_t iNumT = m_vecT.size();
+		m_engSwap.SetPos(m_iRound * iNumT);
+
+		for(std::size_t iTemp=(m_iRound & 1); iTemp+1<iNumT; iTemp+=2)
+		{
+			const t_ising& repl0 = m_vecReplicas[m_vecReplIdx[iTemp]];
+			const t_ising& repl1 = m_vecReplicas[m_vecReplIdx[iTemp+1]];
+
+			const t_real dArg = (repl0.GetBeta() - repl1.GetBeta())
+				* (repl0.GetEnergy() - repl1.GetEnergy());
+
+			++m_vecSwapTries[iTemp];
+			if(dArg >= t_real(0) || rand01<t_real>(m_engSwap) < std::exp(dArg))
+			{
+				std::swap(m_vecReplIdx[iTemp], m_vecReplIdx[iTemp+1]);
+				SetReplicaTemperature(iTemp);
+				SetReplicaTemperature(iTemp+1);
+				++m_vecSwapAcc[iTemp];
+			}
+		}
+	}
+
+	void Measure()
+	{
+		for(std::size_t iTemp=0; iTemp<m_vecT.size(); ++iTemp)
+		{
+			const t_ising& repl = m_vecReplicas[m_vecReplIdx[iTemp]];
+			const t_real dN = t_real(repl.GetNumSites());
+			const t_real dE = repl.GetEnergy();
+			const t_real dM = std::abs(repl.GetMagnetisation());
+
+			++m_vecNumMeas[iTemp];
+			m_vecSumE[iTemp] += dE;
+			m_vecSumE2[iTemp] += dE*dE;
+			m_vecSumM[iTemp] += dM;
+			m_vecSumM2[iTemp] += dM*dM;
+			m_vecSumM4[iTemp] += dM*dM*dM*dM;
+
+			m_vecHistE[iTemp].Add(dE / dN);
+			m_vecHistM[iTemp].Add(repl.GetMagnetisation() / dN);
+		}
+	}
+
+
+public:
+	/**
+	 * @param vecT temperatures, ascending
+	 * @param dk boltzmann constant in the units of J/T
+	 * @param iThreads total number of threads, 0: all hardware threads
+	 */
+	MetropTempering(const t_dims& dims, t_real dJ, const std::vector<t_real>& vecT,
+		t_real dk = 1, bool bPeriodic = true, std::uint64_t iSeed = 0,
+		unsigned int iThreads = 0, std::size_t iBinsE = 256, std::size_t iBinsM = 256)
+		: m_vecT(vecT), m_dk(dk), m_dEMax(t_real(DIM) * std::abs(dJ)),
+			m_iThreads(iThreads), m_iSeed(iSeed),
+			m_engSwap(iSeed, 2)
+	{
+		const std::size_t iNumT = m_vecT.size();
+		if(iNumT == 0)
+			throw Err("No temperatures given.");
+
+		m_vecReplicas.reserve(iNumT);
+		for(std::size_t iTemp=0; iTemp<iNumT; ++iTemp)
+		{
+			// one key per replica, its stream 1 is used for the initial configuration
+			m_vecReplicas.emplace_back(dims, dJ, bPeriodic, iSeed + iTemp, 1);
+			m_vecReplIdx.push_back(iTemp);
+			SetReplicaTemperature(iTemp);
+		}
+
+		m_vecSwapTries.resize(iNumT, 0);
+		m_vecSwapAcc.resize(iNumT, 0);
+
+		m_vecHistE.resize(iNumT, t_hist(-m_dEMax, m_dEMax, iBinsE));
+		m_vecHistM.resize(iNumT, t_hist(-1, 1, iBinsM));
+		ClearMeasurements();
+	}
+
+
+	std::size_t GetNumTemperatures() const { return m_vecT.size(); }
+	const std::vector<t_real>& GetTemperatures() const { return m_vecT; }
+	std::uint64_t GetNumRounds() const { return m_iRound; }
+	void SetThreads(unsigned int iThreads) { m_iThreads = iThreads; }
+
+	/**
+	 * lattice currently at temperature index iTemp
+	 */
+	t_ising& GetReplica(std::size_t iTemp) { return m_vecReplicas[m_vecReplIdx[iTemp]]; }
+	const t_ising& GetReplica(std::size_t iTemp) const { return m_vecReplicas[m_vecReplIdx[iTemp]]; }
+
+	const t_hist& GetEnergyHistogram(std::size_t iTemp) const { return m_vecHistE[iTemp]; }
+	const t_hist& GetMagnetisationHistogram(std::size_t iTemp) const { return m_vecHistM[iTemp]; }
+
+
+	/**
+	 * sets the field for all replicas, the energy histogram range is adapted
+	 */
+	void SetField(t_real dB)
+	{
+		for(t_ising& repl : m_vecReplicas)
+			repl.SetField(dB);
+
+		const t_real dEMax = m_dEMax + std::abs(dB);
+		for(t_hist& hist : m_vecHistE)
+			hist = t_hist(-dEMax, dEMax, hist.vecCounts.size());
+		ClearMeasurements();
+	}
+
+	void Randomise()
+	{
+		for(t_ising& repl : m_vecReplicas)
+			repl.Randomise(1);
+	}
+
+	void ClearMeasurements()
+	{
+		const std::size_t iNumT = m_vecT.size();
+
+		m_vecNumMeas.assign(iNumT, 0);
+		for(std::vector<t_real>* pvec : { &m_vecSumE, &m_vecSumE2, &m_vecSumM, &m_vecSumM2, &m_vecSumM4 })
+			pvec->assign(iNumT, t_real(0));
+
+		for(t_hist& hist : m_vecHistE) hist.Clear();
+		for(t_hist& hist : m_vecHistM) hist.Clear();
+		std::fill(m_vecSwapTries.begin(), m_vecSwapTries.end(), 0);
+		std::fill(m_vecSwapAcc.begin(), m_vecSwapAcc.end(), 0);
+	}
+
+
+	/**
+	 * runs iRounds rounds, each consisting of iSweeps sweeps on all replicas
+	 * followed by a measurement (if bMeasure is set) and an exchange step
+	 */
+	void Run(std::size_t iRounds, std::size_t iSweeps = 1, bool bMeasure = true)
+	{
+		const std::size_t iNumRepl = m_vecReplicas.size();
+
+		// parallelise either over the replicas or, for a single replica, over its lattice lines,
+		// nesting both would start new threads within the replica threads in every half-sweep
+		const unsigned int iThreadsAll = get_num_threads(std::size_t(-1), m_iThreads);
+		const unsigned int iThreads = (iNumRepl > 1 ? get_num_threads(iNumRepl, iThreadsAll) : 1);
+		for(t_ising& repl : m_vecReplicas)
+			repl.SetThreads(iThreads > 1 ? 1 : iThreadsAll);
+
+		for(std::size_t iRound=0; iRound<iRounds; ++iRound)
+		{
+			run_stripes(iNumRepl, iThreads, [this, iSweeps](std::size_t iStart, std::size_t iEnd) -> void
+			{
+				for(std::size_t iRepl=iStart; iRepl<iEnd; ++iRepl)
+					m_vecReplicas[iRepl].Sweep(iSweeps);
+			});
+
+			if(bMeasure)
+				Measure();
+			Exchange();
+			++m_iRound;
+		}
+	}
+
+
+	std::vector<Results> GetResults() const
+	{
+		std::vector<Results> vecRes(m_vecT.size());
+
+		for(std::size_t iTemp=0; iTemp<m_vecT.size(); ++iTemp)
+		{
+			Results& res = vecRes[iTemp];
+			res.dT = m_vecT[iTemp];
+			res.iNumMeas = m_vecNumMeas[iTemp];
+			if(m_vecSwapTries[iTemp])
+				res.dSwapRate = t_real(m_vecSwapAcc[iTemp]) / t_real(m_vecSwapTries[iTemp]);
+			if(!res.iNumMeas)
+				continue;
+
+			const t_real dN = t_real(m_vecReplicas[0].GetNumSites());
+			const t_real dNum = t_real(res.iNumMeas);
+			const t_real dkT = m_dk * m_vecT[iTemp];
+
+			const t_real dE = m_vecSumE[iTemp] / dNum;
+			const t_real dE2 = m_vecSumE2[iTemp] / dNum;
+			const t_real dM = m_vecSumM[iTemp] / dNum;
+			const t_real dM2 = m_vecSumM2[iTemp] / dNum;
+			const t_real dM4 = m_vecSumM4[iTemp] / dNum;
+
+			res.dE = dE / dN;
+			res.dC = (dE2 - dE*dE) / (dkT * m_vecT[iTemp] * dN);
+			res.dM = dM / dN;
+			res.dChi = (dM2 - dM*dM) / (dkT * dN);
+			if(dM2 > t_real(0))
+				res.dBinder = t_real(1) - dM4 / (t_real(3) * dM2*dM2);
+		}
+
+		return vecRes;
+	}
+
+
+	/**
+	 * writes the complete state, the file is replaced only after it has been written
+	 */
+	bool SaveCheckpoint(const std::string& strFile) const
+	{
+		const std::string strTmp = strFile + ".tmp";
+		{
+			std::ofstream ofstr(strTmp, std::ios_base::binary);
+			if(!ofstr)
+			{
+				log_err("Cannot open checkpoint file \"", strTmp, "\".");
+				return false;
+			}
+
+			ofstr.write("TLPT", 4);
+			_metrop_write<std::uint32_t>(ofstr, DIM);
+			_metrop_write(ofstr, m_vecT);
+			_metrop_write(ofstr, m_dk);
+			_metrop_write(ofstr, m_iSeed);
+			_metrop_write(ofstr, m_iRound);
+			_metrop_write<std::uint64_t>(ofstr, 0);	// placeholder for format changes
+			_metrop_write(ofstr, m_vecSwapTries);
+			_metrop_write(ofstr, m_vecSwapAcc);
+			_metrop_write(ofstr, m_vecNumMeas);
+			for(const std::vector<t_real>* pvec : { &m_vecSumE, &m_vecSumE2, &m_vecSumM, &m_vecSumM2, &m_vecSumM4 })
+				_metrop_write(ofstr, *pvec);
+			for(const std::vector<t_hist>* pvec : { &m_vecHistE, &m_vecHistM })
+			{
+				for(const t_hist& hist : *pvec)
+				{
+					_metrop_write(ofstr, hist.dMin);
+					_metrop_write(ofstr, hist.dMax);
+					_metrop_write(ofstr, hist.vecCounts);
+				}
+			}
+
+			std::vector<std::uint64_t> vecReplIdx(m_vecReplIdx.begin(), m_vecReplIdx.end());
+			_metrop_write(ofstr, vecReplIdx);
+			for(const t_ising& repl : m_vecReplicas)
+				repl.Save(ofstr);
+
+			if(!ofstr.flush())
+			{
+				log_err("Cannot write checkpoint file \"", strTmp, "\".");
+				return false;
+			}
+		}
+
+		if(std::rename(strTmp.c_str(), strFile.c_str()) != 0)
+		{
+			log_err("Cannot rename checkpoint file \"", strTmp, "\".");
+			return false;
+		}
+		return true;
+	}
+
+
+	/**
+	 * resumes from a checkpoint, the lattice size and the temperatures have to match
+	 */
+	bool LoadCheckpoint(const std::string& strFile)
+	{
+		std::ifstream ifstr(strFile, std::ios_base::binary);
+		if(!ifstr)
+		{
+			log_err("Cannot open checkpoint file \"", strFile, "\".");
+			return false;
+		}
+
+		char cMagic[4];
+		std::uint32_t iDim = 0;
+		std::vector<t_real> vecT;
+		ifstr.read(cMagic, 4);
+		if(!ifstr || std::string(cMagic, 4) != "TLPT" || !_metrop_read(ifstr, iDim) || iDim != DIM
+			|| !_metrop_read(ifstr, vecT, m_vecT.size()) || vecT != m_vecT)
+		{
+			log_err("Checkpoint \"", strFile, "\" does not match the simulation.");
+			return false;
+		}
+
+		// read everything into a copy of the state, which replaces the current one on success
+		t_real dk = 0;
+		std::uint64_t iSeed = 0, iRound = 0, iReserved = 0;
+		std::vector<std::uint64_t> vecSwapTries, vecSwapAcc, vecNumMeas, vecReplIdx;
+		std::vector<t_real> vecSumE, vecSumE2, vecSumM, vecSumM2, vecSumM4;
+		std::vector<t_hist> vecHistE = m_vecHistE, vecHistM = m_vecHistM;
+		std::vector<t_ising> vecReplicas = m_vecReplicas;
+
+		const std::size_t iNumT = m_vecT.size();
+		bool bOk = _metrop_read(ifstr, dk) && _metrop_read(ifstr, iSeed)
+			&& _metrop_read(ifstr, iRound) && _metrop_read(ifstr, iReserved)
+			&& _metrop_read(ifstr, vecSwapTries, iNumT) && _metrop_read(ifstr, vecSwapAcc, iNumT)
+			&& _metrop_read(ifstr, vecNumMeas, iNumT);
+		for(std::vector<t_real>* pvec : { &vecSumE, &vecSumE2, &vecSumM, &vecSumM2, &vecSumM4 })
+			bOk = bOk && _metrop_read(ifstr, *pvec, iNumT);
+		for(std::vector<t_hist>* pvec : { &vecHistE, &vecHistM })
+		{
+			for(t_hist& hist : *pvec)
+			{
+				bOk = bOk && _metrop_read(ifstr, hist.dMin) && _metrop_read(ifstr, hist.dMax)
+					&& _metrop_read(ifstr, hist.vecCounts, hist.vecCounts.size());
+			}
+		}
+		bOk = bOk && _metrop_read(ifstr, vecReplIdx, vecReplicas.size());
+		for(std::uint64_t iIdx : vecReplIdx)
+			bOk = bOk && iIdx < vecReplicas.size();
+
+		for(t_ising& repl : vecReplicas)
+			bOk = bOk && repl.Load(ifstr);
+
+		if(!bOk)
+		{
+			log_err("Invalid checkpoint \"", strFile, "\".");
+			return false;
+		}
+
+		m_dk = dk;
+		m_iSeed = iSeed;
+		m_iRound = iRound;
+		m_vecSwapTries = std::move(vecSwapTries);
+		m_vecSwapAcc = std::move(vecSwapAcc);
+		m_vecNumMeas = std::move(vecNumMeas);
+		m_vecSumE = std::move(vecSumE);
+		m_vecSumE2 = std::move(vecSumE2);
+		m_vecSumM = std::move(vecSumM);
+		m_vecSumM2 = std::move(vecSumM2);
+		m_vecSumM4 = std::move(vecSumM4);
+		m_vecHistE = std::move(vecHistE);
+		m_vecHistM = std::move(vecHistM);
+		m_vecReplicas = std::move(vecReplicas);
+		m_vecReplIdx.assign(vecReplIdx.begin(), vecReplIdx.end());
+		m_engSwap.seed(m_iSeed, 2);
+		return true;
+	}
+};
+
+}
+#endif
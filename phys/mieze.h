@@ -12,6 +12,10 @@
 
 #include "neutrons.h"
 #include "../math/linalg.h"
+#include "../math/numint.h"
+#include "../math/rand.h"
+
+#include <complex>
 
 
 namespace tl {
@@ -211,156 +215,267 @@ Y mieze_reduction_det_d(const t_length<Sys,Y>& d,
 // MIEZE contrast reduction due to sample geometry
 
 /**
- * numerical approximation to the R_sample integral of
- * @see formula (9) in Brandl et. al., NIMA 654(1), pp. 394-398 (2011), doi: https://doi.org/10.1016/j.nima.2011.07.003
+ * unit-free description of a cuboid sample for the contrast reduction integrals:
+ * phases accumulated along the sample edges, extinction exponent along the depth,
+ * and the start of the depth range in units of the depth
+ * (-1/2 for a centred sample, 0 for scattering from the surface)
+ */
+template<class t_real = double>
+struct MiezeCuboid
+{
+	t_real phase_x = 0, phase_y = 0, phase_z = 0;
+	t_real ext_z = 0;
+	t_real z0 = -0.5;
+};
+
+
+/**
+ * phases along the edges of a cuboid sample rotated by theta_s
  */
 template<class Sys, class Y>
-Y mieze_reduction_sample_cuboid(const t_length<Sys,Y>& len_x,
+void _mieze_cuboid_phases(const t_length<Sys,Y>& len_x,
 	const t_length<Sys,Y>& len_y, const t_length<Sys,Y>& len_z,
-	const t_freq<Sys,Y>& fM,
-	const t_length<Sys,Y>& lam,
+	const t_freq<Sys,Y>& fM, const t_length<Sys,Y>& lam,
 	const t_angle<Sys,Y>& twotheta, const t_angle<Sys,Y>& theta_s,
-	std::size_t ITERS=100)
+	MiezeCuboid<Y>& cub)
 {
-	using namespace units;
-	using namespace co;
-
 	const t_freq<Sys,Y> omegaM = 2.*get_pi<Y>()*fM;
-	t_velocity<Sys,Y> v = lam2p(lam)/co::m_n;
+	const t_velocity<Sys,Y> v = lam2p(lam)/co::m_n;
 
-	ublas::vector<Y> ki(3);
-	ki[0] = 0.;
-	ki[1] = 0.;
-	ki[2] = 1.;
-
-	ublas::vector<Y> kf(3);
-	kf[0] = sin(twotheta);
-	kf[1] = 0.;
-	kf[2] = cos(twotheta);
-
-	ublas::vector<Y> q_dir = ki-kf;
-
-	t_length<Sys,Y> dX = len_x / Y(ITERS);
-	t_length<Sys,Y> dY = len_y / Y(ITERS);
-	t_length<Sys,Y> dZ = len_z / Y(ITERS);
-
-	t_length<Sys,Y> x, y, z;
-
-	t_volume<Sys,Y> integral = 0.*meters*meters*meters;
-	t_volume<Sys,Y> vol = 0.*meters*meters*meters;
+	// q_dir = ki - kf
+	const Y q_dir[3] = { -sin(twotheta), Y(0), Y(1) - cos(twotheta) };
 
 	const Y stheta_s = sin(theta_s);
 	const Y ctheta_s = cos(theta_s);
 
-	for(x=-len_x/2.; x<len_x/2.; x+=dX)
-		for(y=-len_y/2.; y<len_y/2.; y+=dY)
-			for(z=-len_z/2.; z<len_z/2.; z+=dZ)
-			{
-				t_length<Sys,Y> pos[3];
-				// rotate sample
-				pos[0] = ctheta_s*x + stheta_s*z;
-				pos[1] = y;
-				pos[2] = -stheta_s*x + ctheta_s*z;
-
-				t_length<Sys,Y> path_diff = q_dir[0]*pos[0] + q_dir[1]*pos[1] + q_dir[2]*pos[2];
-				Y phase = omegaM * path_diff / v;
-
-				t_volume<Sys,Y> func_det = dX*dY*dZ;
-
-				vol += func_det;
-				integral += func_det * cos(phase);
-			}
+	// the phase is linear in the position inside the rotated sample
+	cub.phase_x = omegaM/v * len_x * (q_dir[0]*ctheta_s - q_dir[2]*stheta_s);
+	cub.phase_y = omegaM/v * len_y * q_dir[1];
+	cub.phase_z = omegaM/v * len_z * (q_dir[0]*stheta_s + q_dir[2]*ctheta_s);
+}
 
-	//std::cout << "\ndiff_vol: " << (vol - (len_x*len_y*len_z)) << std::endl;
-	//std::cout << "dxdydz = " << dX*dY*dZ << std::endl;
 
-	vol = len_x*len_y*len_z;
-	return integral / vol;
+/**
+ * centred cuboid sample rotated by theta_s
+ */
+template<class Sys, class Y>
+MiezeCuboid<Y> mieze_cuboid(const t_length<Sys,Y>& len_x,
+	const t_length<Sys,Y>& len_y, const t_length<Sys,Y>& len_z,
+	const t_freq<Sys,Y>& fM,
+	const t_length<Sys,Y>& lam,
+	const t_angle<Sys,Y>& twotheta, const t_angle<Sys,Y>& theta_s)
+{
+	MiezeCuboid<Y> cub;
+	_mieze_cuboid_phases(len_x, len_y, len_z, fM, lam, twotheta, theta_s, cub);
+	return cub;
 }
 
 
 /**
- * Scattering with extinction
+ * cuboid sample in reflection with extinction along the depth
  */
 template<class Sys, class Y>
-Y mieze_reduction_sample_cuboid_extinction(const t_length<Sys,Y>& len_x,
+MiezeCuboid<Y> mieze_cuboid_extinction(const t_length<Sys,Y>& len_x,
 	const t_length<Sys,Y>& len_y, const t_length<Sys,Y>& len_z,
 	const t_length_inverse<Sys,Y>& mu,
 	const t_freq<Sys,Y>& fM,
 	const t_length<Sys,Y>& lam,
-	const t_angle<Sys,Y>& twotheta,
-	std::size_t ITERS=100)
+	const t_angle<Sys,Y>& twotheta)
 {
-	const Y SUBDIVS = Y(ITERS);
+	using namespace units;
 
-	using namespace co;
+	t_angle<Sys,Y> theta_s = twotheta/2. - get_pi<Y>()/2.*radians;
+	const Y ctheta_s = cos(theta_s);
 
-	t_frequency<Sys,Y> omegaM = 2.*get_pi<Y>()*fM;
-	t_velocity<Sys,Y> v = lam2p(lam)/co::m_n;
+	t_length<Sys,Y> zpath = 1./(mu*2.);	// reflexive: path taken twice
+	//zpath /= ctheta_s;
+	//if(zpath > len_z)
+		zpath = len_z;
 
-	ublas::vector<Y> ki(3);
-	ki[0] = 0.;
-	ki[1] = 0.;
-	ki[2] = 1.;
+	MiezeCuboid<Y> cub;
+	_mieze_cuboid_phases(len_x, len_y, zpath, fM, lam, twotheta, theta_s, cub);
+	cub.ext_z = mu * zpath * 2. / ctheta_s;	// reflexive: path taken twice
+	cub.z0 = 0.;
+	return cub;
+}
 
-	ublas::vector<Y> kf(3);
-	kf[0] = sin(twotheta);
-	kf[1] = 0.;
-	kf[2] = cos(twotheta);
 
-	ublas::vector<Y> q_dir = ki-kf;
+/**
+ * contrast reduction of a cuboid sample by adaptive cubature over its volume
+ * @see formula (9) in Brandl et. al., NIMA 654(1), pp. 394-398 (2011), doi: https://doi.org/10.1016/j.nima.2011.07.003
+ */
+template<class t_real = double>
+t_real mieze_reduction_cuboid(const MiezeCuboid<t_real>& cub,
+	std::size_t iMaxEvals = 1000000, t_real eps = 1e-6)
+{
+	auto fkt = [&cub](const t_real* pPos, t_real* pVal, std::size_t N) -> void
+	{
+		for(std::size_t i=0; i<N; ++i)
+		{
+			const t_real extinction_factor = std::exp(-cub.ext_z * (pPos[3*i+2] - cub.z0));
+			pVal[i] = extinction_factor * std::cos(cub.phase_x*pPos[3*i]
+				+ cub.phase_y*pPos[3*i+1] + cub.phase_z*pPos[3*i+2]);
+		}
+	};
 
+	const t_real integral = numint_cubature_batch<t_real, t_real>(fkt,
+		std::vector<t_real>{-0.5, -0.5, cub.z0}, std::vector<t_real>{0.5, 0.5, cub.z0 + 1.},
+		eps, t_real(0), nullptr, iMaxEvals);
 
-	t_length<Sys,Y> x, y, z;
-	t_volume<Sys,Y> integral = 0.*meters*meters*meters;
-	t_volume<Sys,Y> vol = 0.*meters*meters*meters;
+	// extinction-weighted volume
+	const t_real vol = numint_gk<t_real, t_real>(
+		[&cub](t_real z) -> t_real { return std::exp(-cub.ext_z * z); },
+		t_real(0), t_real(1), eps, t_real(0));
 
+	return integral / vol;
+}
 
-	t_angle<Sys,Y> theta_s = twotheta/2. - get_pi<Y>()/2.*radians;
-	const Y stheta_s = sin(theta_s);
-	const Y ctheta_s = cos(theta_s);
 
+/**
+ * (1 - exp(-z)) / z
+ */
+template<class T>
+T _mieze_expm1_div(const T& z)
+{
+	if(std::abs(z) < 1e-4)
+		return T(1) - z/T(2) + z*z/T(6);
+	return (T(1) - std::exp(-z)) / z;
+}
 
-	t_length<Sys,Y> zpath = 1./(mu*2.);	// reflexive: path taken twice
-	//zpath /= ctheta_s;
-	//if(zpath > len_z)
-		zpath = len_z;
 
-	t_length<Sys,Y> dX = len_x / SUBDIVS;
-	t_length<Sys,Y> dY = len_y / SUBDIVS;
-	t_length<Sys,Y> dZ = zpath / SUBDIVS;
+/**
+ * contrast reductions of N cuboid samples, threaded over the samples
+ *
+ * the phase is linear in the position and the extinction only depends on the depth,
+ * so the volume integral factorises into one-dimensional integrals with closed forms:
+ * sin(phi/2)/(phi/2) along x and y, and the damped oscillation along z
+ */
+template<class t_real = double>
+void mieze_reduction_cuboid_n(const MiezeCuboid<t_real>* pCub, t_real* pRed, std::size_t N,
+	unsigned int iThreads = 0)
+{
+	using t_cplx = std::complex<t_real>;
 
-	const t_volume<Sys,Y> func_det = dX*dY*dZ;
+	run_stripes(N, get_num_threads(N/256 + 1, iThreads),
+		[pCub, pRed](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		for(std::size_t i=iStart; i<iEnd; ++i)
+		{
+			const MiezeCuboid<t_real>& cub = pCub[i];
 
-	for(x=-len_x/2.; x<len_x/2.; x+=dX)
-		for(y=-len_y/2.; y<len_y/2.; y+=dY)
-			for(z=0.*meters; z<zpath; z+=dZ)
-			{
-				//z = len_z/2.;
-				t_length<Sys,Y> pos[3];
-				// rotate sample
-				pos[0] = ctheta_s*x + stheta_s*z;
-				pos[1] = y;
-				pos[2] = -stheta_s*x + ctheta_s*z;
+			const t_real hx = t_real(0.5)*cub.phase_x, hy = t_real(0.5)*cub.phase_y;
+			const t_real fx = (hx == t_real(0) ? t_real(1) : std::sin(hx)/hx);
+			const t_real fy = (hy == t_real(0) ? t_real(1) : std::sin(hy)/hy);
+
+			const t_cplx fz = std::polar(t_real(1), cub.phase_z*cub.z0) *
+				_mieze_expm1_div(t_cplx(cub.ext_z, -cub.phase_z));
+			const t_real vol = _mieze_expm1_div(cub.ext_z);
 
-				t_length<Sys,Y> path_diff = q_dir[0]*pos[0] + q_dir[1]*pos[1] + q_dir[2]*pos[2];
-				Y phase = omegaM * path_diff / v;
+			pRed[i] = fx * fy * fz.real() / vol;
+		}
+	});
+}
 
-				t_length<Sys,Y> dist = z/*+len_z/2.*/;
-				dist /= ctheta_s;
 
-				Y extinction_factor = exp(-mu * dist * 2.); // reflexive: path taken twice
-				//std::cout << "extinction: " << extinction_factor << ", phase: " << phase << std::endl;
-				//extinction_factor = 1.;
+/**
+ * contrast reduction of a cuboid sample by randomised quasi-Monte-Carlo integration
+ * using iReplicas digitally shifted Sobol sequences with iSamples points in total,
+ * the standard error of the replica mean is written to pErr
+ */
+template<class t_real = double>
+t_real mieze_reduction_cuboid_qmc(const MiezeCuboid<t_real>& cub, std::size_t iSamples,
+	t_real* pErr = nullptr, std::size_t iReplicas = 16, std::uint64_t iSeed = 0,
+	unsigned int iThreads = 1)
+{
+	constexpr std::size_t BATCH = 1024;
+	iReplicas = std::max<std::size_t>(iReplicas, 1);
+	const std::size_t iPerReplica = std::max<std::size_t>(iSamples / iReplicas, 1);
+	const t_real vol = _mieze_expm1_div(cub.ext_z);
+
+	std::vector<t_real> vecRepl(iReplicas);
+	run_stripes(iReplicas, get_num_threads(iReplicas, iThreads),
+		[&](std::size_t iStart, std::size_t iEnd) -> void
+	{
+		t_real pts[BATCH*3], vals[BATCH];
+
+		for(std::size_t iRepl=iStart; iRepl<iEnd; ++iRepl)
+		{
+			Philox4x32 eng(iSeed, iRepl);
+			Sobol sobol(3);
+			sobol.SetShift(eng);
 
-				//if(extinction_factor > 1 / std::exp(1))
+			t_real sum = 0;
+			for(std::size_t iPt=0; iPt<iPerReplica; iPt+=BATCH)
+			{
+				const std::size_t N = std::min(BATCH, iPerReplica-iPt);
+				sobol.next_n(pts, N);
+
+				for(std::size_t i=0; i<N; ++i)
 				{
-					vol += extinction_factor * func_det;
-					integral += extinction_factor * func_det * cos(phase);
+					const t_real x = pts[3*i] - t_real(0.5), y = pts[3*i+1] - t_real(0.5);
+					const t_real z = pts[3*i+2];
+					vals[i] = std::exp(-cub.ext_z*z) * std::cos(cub.phase_x*x
+						+ cub.phase_y*y + cub.phase_z*(z + cub.z0));
 				}
+				for(std::size_t i=0; i<N; ++i)
+					sum += vals[i];
 			}
 
-	return integral / vol;
+			vecRepl[iRepl] = sum / t_real(iPerReplica) / vol;
+		}
+	});
+
+	t_real mean = 0, var = 0;
+	for(t_real val : vecRepl)
+		mean += val;
+	mean /= t_real(iReplicas);
+	for(t_real val : vecRepl)
+		var += (val-mean)*(val-mean);
+
+	if(pErr)
+	{
+		*pErr = iReplicas > 1 ?
+			std::sqrt(var / t_real(iReplicas-1) / t_real(iReplicas)) :
+			std::numeric_limits<t_real>::quiet_NaN();
+	}
+	return mean;
+}
+
+
+/**
+ * numerical approximation to the R_sample integral of
+ * @see formula (9) in Brandl et. al., NIMA 654(1), pp. 394-398 (2011), doi: https://doi.org/10.1016/j.nima.2011.07.003
+ * ITERS^3 bounds the number of integrand evaluations of the adaptive cubature, eps is its absolute tolerance
+ * @see mieze_reduction_cuboid_n for many samples or orientations at once
+ */
+template<class Sys, class Y>
+Y mieze_reduction_sample_cuboid(const t_length<Sys,Y>& len_x,
+	const t_length<Sys,Y>& len_y, const t_length<Sys,Y>& len_z,
+	const t_freq<Sys,Y>& fM,
+	const t_length<Sys,Y>& lam,
+	const t_angle<Sys,Y>& twotheta, const t_angle<Sys,Y>& theta_s,
+	std::size_t ITERS=100, Y eps=1e-6)
+{
+	return mieze_reduction_cuboid<Y>(mieze_cuboid(len_x, len_y, len_z, fM, lam, twotheta, theta_s),
+		ITERS*ITERS*ITERS, eps);
+}
+
+
+/**
+ * Scattering with extinction
+ * ITERS^3 bounds the number of integrand evaluations of the adaptive cubature, eps is its absolute tolerance
+ */
+template<class Sys, class Y>
+Y mieze_reduction_sample_cuboid_extinction(const t_length<Sys,Y>& len_x,
+	const t_length<Sys,Y>& len_y, const t_length<Sys,Y>& len_z,
+	const t_length_inverse<Sys,Y>& mu,
+	const t_freq<Sys,Y>& fM,
+	const t_length<Sys,Y>& lam,
+	const t_angle<Sys,Y>& twotheta,
+	std::size_t ITERS=100, Y eps=1e-6)
+{
+	return mieze_reduction_cuboid<Y>(mieze_cuboid_extinction(len_x, len_y, len_z, mu, fM, lam, twotheta),
+		ITERS*ITERS*ITERS, eps);
 }
 
 
@@ -12,9 +12,11 @@
 #include "../math/math.h"
 #include "../math/linalg.h"
 #include "../helper/exception.h"
+#include "../helper/thread.h"
 
 #include <boost/units/pow.hpp>
 #include <cmath>
+#include <vector>
 
 
 namespace tl {
@@ -887,6 +889,138 @@ t_real DHO_model(t_real E, t_real T, t_real E0, t_real hwhm, t_real amp, t_real
 }
 
 
+/**
+ * block length for the array versions of the statistical factors
+ */
+#ifndef TLIBS_NEUTRONS_BLOCK
+	#define TLIBS_NEUTRONS_BLOCK 256
+#endif
+
+
+/**
+ * Bose factors for an array of energies, pN[i] = bose(pE[i], T)
+ * with a cutoff as in bose_cutoff if E_cutoff >= 0, pN must not alias pE
+ */
+template<class t_real=double>
+void bose_n(const t_real* pE, t_real* pN, std::size_t n, t_real T,
+	t_real E_cutoff=t_real(-1))
+{
+	const t_real kB = get_kB<t_real>() * get_one_kelvin<t_real>()/get_one_meV<t_real>();
+	const t_real dInvkT = t_real(1) / (kB*T);
+	const bool bCutoff = (E_cutoff >= t_real(0));
+
+	for(std::size_t iBlock=0; iBlock<n; iBlock+=TLIBS_NEUTRONS_BLOCK)
+	{
+		const std::size_t iLen = std::min<std::size_t>(TLIBS_NEUTRONS_BLOCK, n-iBlock);
+		const t_real *pBlockE = pE + iBlock;
+		t_real *pBlockN = pN + iBlock;
+
+		for(std::size_t i=0; i<iLen; ++i)
+		{
+			const t_real E = std::abs(pBlockE[i]);
+			pBlockN[i] = ((bCutoff && E < E_cutoff) ? E_cutoff : E) * dInvkT;
+		}
+
+		exp_n(pBlockN, pBlockN, iLen);
+
+		for(std::size_t i=0; i<iLen; ++i)
+		{
+			pBlockN[i] = t_real(1)/(pBlockN[i] - t_real(1))
+				+ (pBlockE[i] >= t_real(0) ? t_real(1) : t_real(0));
+		}
+	}
+}
+
+
+/**
+ * Bose factors with a lower cutoff energy for an array of energies
+ */
+template<class t_real=double>
+void bose_cutoff_n(const t_real* pE, t_real* pN, std::size_t n, t_real T,
+	t_real E_cutoff=t_real(0.02))
+{
+	bose_n<t_real>(pE, pN, n, T, std::abs(E_cutoff));
+}
+
+
+/**
+ * hwhm/((E-E0)^2 + hwhm^2) - hwhm/((E+E0)^2 + hwhm^2) = 4*hwhm*E*E0 * _DHO_lorentz(E, E0, hwhm^2),
+ * which avoids the cancellation of the two lorentzians and needs only one division
+ */
+template<class t_real=double>
+t_real _DHO_lorentz(t_real E, t_real E0, t_real hwhm2)
+{
+	const t_real dm = E - E0, dp = E + E0;
+	return t_real(1) / ((dm*dm + hwhm2) * (dp*dp + hwhm2));
+}
+
+
+/**
+ * DHO model for an array of energies, pS[i] = DHO_model(pE[i], T, E0, hwhm, amp, offs),
+ * the bose factor and the model share the buffer and the exponential of each point
+ */
+template<class t_real=double>
+void DHO_model_n(const t_real* pE, t_real* pS, std::size_t n,
+	t_real T, t_real E0, t_real hwhm, t_real amp, t_real offs)
+{
+	bose_n<t_real>(pE, pS, n, T);
+
+	const t_real dScale = t_real(4)*amp*hwhm / get_pi<t_real>();
+	const t_real hwhm2 = hwhm*hwhm;
+
+	for(std::size_t i=0; i<n; ++i)
+		pS[i] = std::abs(pS[i] * pE[i] * dScale * _DHO_lorentz<t_real>(pE[i], E0, hwhm2)) + offs;
+}
+
+
+/**
+ * DHO dynamical structure factor S(Q, E) on a (Q, E) grid for one temperature
+ * pE: energy axis with iNumE points
+ * pE0, pHWHM, pAmp: dispersion branches, indexed [iQ*iNumBranches + iBranch]
+ * pS: resulting intensity map, indexed [iQ*iNumE + iE]
+ * the bose factors only depend on E and are calculated once for all Q and branches,
+ * the Q rows are distributed over iThreads threads (0: hardware concurrency)
+ */
+template<class t_real=double>
+void DHO_model_grid(const t_real* pE, std::size_t iNumE, t_real T,
+	const t_real* pE0, const t_real* pHWHM, const t_real* pAmp,
+	std::size_t iNumQ, std::size_t iNumBranches, t_real offs, t_real* pS,
+	unsigned int iThreads=0, t_real E_cutoff=t_real(-1))
+{
+	// bose factor times energy
+	std::vector<t_real> vecBoseE(iNumE);
+	bose_n<t_real>(pE, vecBoseE.data(), iNumE, T, E_cutoff);
+	for(std::size_t iE=0; iE<iNumE; ++iE)
+		vecBoseE[iE] *= pE[iE];
+	const t_real *pBoseE = vecBoseE.data();
+
+	run_stripes(iNumQ, get_num_threads(iNumQ, iThreads),
+		[&](std::size_t iStart, std::size_t iEnd)
+	{
+		for(std::size_t iQ=iStart; iQ<iEnd; ++iQ)
+		{
+			t_real *pRow = pS + iQ*iNumE;
+			for(std::size_t iE=0; iE<iNumE; ++iE)
+				pRow[iE] = offs;
+
+			for(std::size_t iBranch=0; iBranch<iNumBranches; ++iBranch)
+			{
+				const std::size_t iIdx = iQ*iNumBranches + iBranch;
+				const t_real E0 = pE0[iIdx];
+				const t_real hwhm2 = pHWHM[iIdx]*pHWHM[iIdx];
+				const t_real dScale = t_real(4)*pAmp[iIdx]*pHWHM[iIdx] / get_pi<t_real>();
+
+				for(std::size_t iE=0; iE<iNumE; ++iE)
+				{
+					pRow[iE] += std::abs(pBoseE[iE] * dScale *
+						_DHO_lorentz<t_real>(pE[iE], E0, hwhm2));
+				}
+			}
+		}
+	});
+}
+
+
 // --------------------------------------------------------------------------------
 
 /**
@@ -910,6 +1044,25 @@ Y fermi(const t_energy<Sys,Y>& E, const t_energy<Sys,Y>& mu,
 		Y(T/kelvin));
 }
 
+
+/**
+ * Fermi distribution for an array of energies, pN[i] = fermi(pE[i], mu, T)
+ */
+template<class t_real=double>
+void fermi_n(const t_real* pE, t_real* pN, std::size_t n, t_real mu, t_real T)
+{
+	const t_real kB = get_kB<t_real>() * get_one_kelvin<t_real>()/get_one_meV<t_real>();
+	const t_real dInvkT = t_real(1) / (kB*T);
+
+	for(std::size_t i=0; i<n; ++i)
+		pN[i] = (pE[i] - mu) * dInvkT;
+
+	exp_n(pN, pN, n);
+
+	for(std::size_t i=0; i<n; ++i)
+		pN[i] = t_real(1)/(pN[i] + t_real(1));
+}
+
 // --------------------------------------------------------------------------------
 
 
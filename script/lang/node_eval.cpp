@@ -1129,7 +1129,7 @@ Symbol* NodeBinaryOp::eval_funcinit(ParseInfo &info, RuntimeInfo& runinfo, Symbo
 			vecFuncs.push_back(pNodeFunc);
 
 			if(strFktName != T_STR"__cmd__")
-				tl::log_debug("Imported function \"", strFktName, 
+				TLIBS_LOG_DEBUG("Imported function \"", strFktName,
 					"\" from module \"", runinfo.strInitScrFile, "\".");
 		}
 	}
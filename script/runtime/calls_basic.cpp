@@ -382,7 +382,7 @@ static Symbol* fkt_import(const std::vector<Symbol*>& vecSyms,
 			if(!bOk)
 			{
 				t_string strInstPrefix = t_string(INSTALL_PREFIX) + "/share/hermelin/";
-				tl::log_debug("Importing from ", strInstPrefix);
+				TLIBS_LOG_DEBUG("Importing from ", strInstPrefix);
 
 				bOk = _import_file(strInstPrefix + strFile, info, runinfo, pSymTab);
 			}
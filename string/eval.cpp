@@ -14,6 +14,10 @@ namespace tl
 	template std::pair<bool, double> eval_expr<std::string, double>(const std::string& str) noexcept;
 	template std::pair<bool, float> eval_expr<std::string, float>(const std::string& str) noexcept;
 	template std::pair<bool, int> eval_expr<std::string, int>(const std::string& str) noexcept;
+
+	template class CompiledExpr<double, std::string>;
+	template class CompiledExpr<float, std::string>;
+	template class CompiledExpr<int, std::string>;
 }
 
 
@@ -10,11 +10,87 @@
 
 #include <string>
 #include <utility>
+#include <vector>
+#include <cstdint>
+
+// maximum stack depth of a compiled expression
+#define TLIBS_EXPR_MAX_STACK 64
+// number of points processed together by CompiledExpr::eval_n
+#define TLIBS_EXPR_BLOCK 256
 
 namespace tl
 {
 	template<class t_str=std::string, class t_val=double>
 	std::pair<bool, t_val> eval_expr(const t_str& str) noexcept;
+
+
+	enum class ExprOp : std::uint8_t
+	{
+		CONST, VAR,
+		ADD, SUB, MUL, DIV, POW, NEG,
+		FUNC1, FUNC2,
+	};
+
+	/**
+	 * instruction of a compiled expression in postfix order
+	 */
+	template<class t_val>
+	struct ExprInstr
+	{
+		ExprOp op = ExprOp::CONST;
+
+		t_val val = t_val(0);			// for CONST
+		std::size_t iVar = 0;			// for VAR
+		t_val (*pFunc1)(t_val) = nullptr;
+		t_val (*pFunc2)(t_val, t_val) = nullptr;
+	};
+
+
+	/**
+	 * expression which is parsed once and can then be evaluated many times
+	 * with different variable values
+	 */
+	template<class t_val=double, class t_str=std::string>
+	class CompiledExpr
+	{
+		public:
+			using t_code = std::vector<ExprInstr<t_val>>;
+
+		protected:
+			t_code m_code;
+			std::vector<t_str> m_vecVars;
+			std::size_t m_iStackSize = 0;
+			bool m_bOk = false;
+
+		public:
+			CompiledExpr() = default;
+			CompiledExpr(const t_str& strExpr, const std::vector<t_str>& vecVars = {});
+
+			/**
+			 * parses the expression, vecVars lists the variable names in the order
+			 * in which their values are later passed to eval
+			 */
+			bool compile(const t_str& strExpr, const std::vector<t_str>& vecVars = {});
+
+			bool IsOk() const { return m_bOk; }
+			explicit operator bool() const { return m_bOk; }
+
+			const t_code& GetCode() const { return m_code; }
+			const std::vector<t_str>& GetVars() const { return m_vecVars; }
+
+			/**
+			 * evaluates the expression, pVars holds one value per variable
+			 */
+			t_val eval(const t_val* pVars = nullptr) const;
+			t_val eval(const std::vector<t_val>& vecVars) const { return eval(vecVars.data()); }
+			t_val operator()(const t_val* pVars = nullptr) const { return eval(pVars); }
+
+			/**
+			 * evaluates the expression for n points,
+			 * ppVars[i] points to the n values of the i-th variable
+			 */
+			void eval_n(const t_val* const* ppVars, t_val* pOut, std::size_t n) const;
+	};
 }
 
 #ifdef TLIBS_INC_HDR_IMPLS
@@ -16,6 +16,7 @@
 #include <utility>
 #include <unordered_map>
 #include <type_traits>
+#include <stdexcept>
 #include "string.h"
 #include "../log/log.h"
 #include "../math/math.h"
@@ -23,12 +24,24 @@
 
 namespace tl
 {
+	/**
+	 * looks up a function or constant, unknown names are reported by name
+	 */
+	template<class t_map>
+	const typename t_map::mapped_type& _eval_lookup(const t_map& map,
+		const std::string& strName, const char* pcWhat)
+	{
+		auto iter = map.find(strName);
+		if(iter == map.end())
+			throw std::out_of_range(std::string("Unknown ") + pcWhat + " \"" + strName + "\"");
+		return iter->second;
+	}
+
 	// real functions with one parameter
 	template<class t_str, class t_val,
 		typename std::enable_if<std::is_floating_point<t_val>::value>::type* =nullptr>
-	t_val call_func1(const t_str& strName, t_val t)
+	t_val (*get_func1(const t_str& strName))(t_val)
 	{
-		//std::cout << "calling " << strName << " with arg " << t << std::endl;
 		static const std::unordered_map</*t_str*/std::string, t_val(*)(t_val)> s_funcs =
 		{
 			{ "sin", std::sin }, { "cos", std::cos }, { "tan", std::tan },
@@ -46,13 +59,13 @@ namespace tl
 			{ "abs", std::abs },
 		};
 
-		return s_funcs.at(wstr_to_str(strName))(t);
+		return _eval_lookup(s_funcs, wstr_to_str(strName), "function");
 	}
 
 	// real functions with two parameters
 	template<class t_str, class t_val,
 		typename std::enable_if<std::is_floating_point<t_val>::value>::type* =nullptr>
-	t_val call_func2(const t_str& strName, t_val t1, t_val t2)
+	t_val (*get_func2(const t_str& strName))(t_val, t_val)
 	{
 		static const std::unordered_map</*t_str*/std::string, t_val(*)(t_val, t_val)> s_funcs =
 		{
@@ -60,7 +73,22 @@ namespace tl
 			{ "mod", std::fmod },
 		};
 
-		return s_funcs.at(wstr_to_str(strName))(t1, t2);
+		return _eval_lookup(s_funcs, wstr_to_str(strName), "function");
+	}
+
+	template<class t_str, class t_val,
+		typename std::enable_if<std::is_floating_point<t_val>::value>::type* =nullptr>
+	t_val call_func1(const t_str& strName, t_val t)
+	{
+		//std::cout << "calling " << strName << " with arg " << t << std::endl;
+		return get_func1<t_str, t_val>(strName)(t);
+	}
+
+	template<class t_str, class t_val,
+		typename std::enable_if<std::is_floating_point<t_val>::value>::type* =nullptr>
+	t_val call_func2(const t_str& strName, t_val t1, t_val t2)
+	{
+		return get_func2<t_str, t_val>(strName)(t1, t2);
 	}
 
 	// real constants
@@ -83,41 +111,55 @@ namespace tl
 			{ "kB", t_val(kB/meV*kelvin) },		// kB in [meV / K]
 		};
 
-		return s_consts.at(wstr_to_str(strName));
+		return _eval_lookup(s_consts, wstr_to_str(strName), "constant");
 	}
 
 
 	// alternative: int functions with one parameter
 	template<class t_str, class t_val,
 		typename std::enable_if<std::is_integral<t_val>::value>::type* =nullptr>
-	t_val call_func1(const t_str& strName, t_val t)
+	t_val (*get_func1(const t_str& strName))(t_val)
 	{
 		static const std::unordered_map</*t_str*/std::string, t_val(*)(t_val)> s_funcs =
 		{
 			{ "abs", std::abs },
 		};
 
-		return s_funcs.at(wstr_to_str(strName))(t);
+		return _eval_lookup(s_funcs, wstr_to_str(strName), "function");
+	}
+
+	template<class t_str, class t_val,
+		typename std::enable_if<std::is_integral<t_val>::value>::type* =nullptr>
+	t_val call_func1(const t_str& strName, t_val t)
+	{
+		return get_func1<t_str, t_val>(strName)(t);
 	}
 
 	// alternative: int functions with two parameters
 	template<class t_str, class t_val,
 		typename std::enable_if<std::is_integral<t_val>::value>::type* =nullptr>
-	t_val call_func2(const t_str& strName, t_val t1, t_val t2)
+	t_val (*get_func2(const t_str& strName))(t_val, t_val)
 	{
-		static const std::unordered_map</*t_str*/std::string, std::function<t_val(t_val, t_val)>> s_funcs =
+		static const std::unordered_map</*t_str*/std::string, t_val(*)(t_val, t_val)> s_funcs =
 		{
 			{ "pow", [](t_val _t1, t_val _t2) -> t_val { return t_val(std::pow(_t1, _t2)); } },
 			{ "mod", [](t_val _t1, t_val _t2) -> t_val { return _t1 % _t2; } },
 		};
 
-		return s_funcs.at(wstr_to_str(strName))(t1, t2);
+		return _eval_lookup(s_funcs, wstr_to_str(strName), "function");
+	}
+
+	template<class t_str, class t_val,
+		typename std::enable_if<std::is_integral<t_val>::value>::type* =nullptr>
+	t_val call_func2(const t_str& strName, t_val t1, t_val t2)
+	{
+		return get_func2<t_str, t_val>(strName)(t1, t2);
 	}
 
 	// alternative: int constants
 	template<class t_str, class t_val,
 		typename std::enable_if<std::is_integral<t_val>::value>::type* =nullptr>
-	t_val get_const(const t_str& strName)
+	t_val get_const(const t_str& /*strName*/)
 	{
 		/*static const std::unordered_map<std::string, t_val> s_consts =
 		{
@@ -259,6 +301,416 @@ namespace tl
 			return std::make_pair(false, t_val(0));
 		}
 	}
+
+
+	// ------------------------------------------------------------------------
+	// compiled expressions
+
+	template<class t_val,
+		typename std::enable_if<std::is_floating_point<t_val>::value>::type* =nullptr>
+	t_val expr_pow(t_val t1, t_val t2) { return std::pow(t1, t2); }
+
+	template<class t_val,
+		typename std::enable_if<std::is_integral<t_val>::value>::type* =nullptr>
+	t_val expr_pow(t_val t1, t_val t2) { return t_val(std::pow(t1, t2)); }
+
+
+	/**
+	 * helpers for the code generation in CompileGrammar
+	 */
+	template<class t_val>
+	struct ExprCodeGen
+	{
+		using t_instr = ExprInstr<t_val>;
+
+		// wrapped, so that spirit does not treat the code as a container attribute
+		struct t_code
+		{
+			std::vector<t_instr> vec;
+
+			std::size_t size() const { return vec.size(); }
+			const t_instr& operator[](std::size_t i) const { return vec[i]; }
+			void push_back(const t_instr& instr) { vec.push_back(instr); }
+			void append(const t_code& code) { vec.insert(vec.end(), code.vec.begin(), code.vec.end()); }
+		};
+
+		static bool is_const(const t_code& code)
+		{
+			return code.size() == 1 && code[0].op == ExprOp::CONST;
+		}
+
+		static t_val binop(ExprOp op, t_val t1, t_val t2)
+		{
+			switch(op)
+			{
+				case ExprOp::ADD: return t1 + t2;
+				case ExprOp::SUB: return t1 - t2;
+				case ExprOp::MUL: return t1 * t2;
+				case ExprOp::DIV: return t1 / t2;
+				case ExprOp::POW: return expr_pow<t_val>(t1, t2);
+				default: return t_val(0);
+			}
+		}
+
+		static t_code make_const(t_val val)
+		{
+			t_instr instr;
+			instr.op = ExprOp::CONST;
+			instr.val = val;
+			t_code code;
+			code.push_back(instr);
+			return code;
+		}
+
+		static t_code make_var(std::size_t iVar)
+		{
+			t_instr instr;
+			instr.op = ExprOp::VAR;
+			instr.iVar = iVar;
+			t_code code;
+			code.push_back(instr);
+			return code;
+		}
+
+		/**
+		 * applies the sign, constants are folded
+		 */
+		static t_code make_sign(t_val sign, t_code code)
+		{
+			if(sign >= t_val(0))
+				return code;
+			if(is_const(code))
+				return make_const(-code[0].val);
+
+			t_instr instr;
+			instr.op = ExprOp::NEG;
+			code.push_back(instr);
+			return code;
+		}
+
+		/**
+		 * combines two operands with a binary operator, constants are folded
+		 */
+		static t_code make_binop(ExprOp op, t_code code1, const t_code& code2)
+		{
+			if(is_const(code1) && is_const(code2))
+				return make_const(binop(op, code1[0].val, code2[0].val));
+
+			code1.append(code2);
+			t_instr instr;
+			instr.op = op;
+			code1.push_back(instr);
+			return code1;
+		}
+
+		// sign is +1 or -1 from the grammar
+		static t_code make_addsub(t_val sign, t_code code1, const t_code& code2)
+		{
+			return make_binop(sign >= t_val(0) ? ExprOp::ADD : ExprOp::SUB,
+				std::move(code1), code2);
+		}
+
+		static t_code make_func1(t_val (*pFunc)(t_val), t_code code)
+		{
+			if(is_const(code))
+				return make_const(pFunc(code[0].val));
+
+			t_instr instr;
+			instr.op = ExprOp::FUNC1;
+			instr.pFunc1 = pFunc;
+			code.push_back(instr);
+			return code;
+		}
+
+		static t_code make_func2(t_val (*pFunc)(t_val, t_val), t_code code1, const t_code& code2)
+		{
+			if(is_const(code1) && is_const(code2))
+				return make_const(pFunc(code1[0].val, code2[0].val));
+
+			code1.append(code2);
+			t_instr instr;
+			instr.op = ExprOp::FUNC2;
+			instr.pFunc2 = pFunc;
+			code1.push_back(instr);
+			return code1;
+		}
+	};
+
+
+	/**
+	 * same grammar as ExprGrammar, but generating postfix code instead of values
+	 */
+	template<class t_str, class t_val, class t_skip=asc::space_type>
+	class CompileGrammar : public qi::grammar<
+		typename t_str::const_iterator, typename ExprCodeGen<t_val>::t_code(), t_skip>
+	{
+		protected:
+			using t_ch = typename t_str::value_type;
+			using t_iter = typename t_str::const_iterator;
+			using t_gen = ExprCodeGen<t_val>;
+			using t_code = typename t_gen::t_code;
+			using t_valparser = typename std::conditional<
+				std::is_floating_point<t_val>::value,
+				qi::real_parser<t_val>, qi::int_parser<t_val>>::type;
+
+			const std::vector<t_str>* m_pvecVars = nullptr;
+
+			qi::rule<t_iter, t_code(), t_skip> m_expr, m_term;
+			qi::rule<t_iter, t_code(), t_skip> m_val, m_baseval, m_num, m_ident_val;
+			qi::rule<t_iter, t_code(), t_skip> m_func1, m_func2;
+			qi::rule<t_iter, t_val(), t_skip> m_pm, m_pm_opt, m_p, m_m;
+			qi::rule<t_iter, t_str(), t_skip> m_ident;
+
+			/**
+			 * variable or constant
+			 */
+			t_code make_ident(const t_str& strName) const
+			{
+				for(std::size_t iVar=0; iVar<m_pvecVars->size(); ++iVar)
+					if((*m_pvecVars)[iVar] == strName)
+						return t_gen::make_var(iVar);
+
+				return t_gen::make_const(get_const<t_str, t_val>(strName));
+			}
+
+		public:
+			CompileGrammar(const std::vector<t_str>& vecVars)
+				: CompileGrammar::base_type(m_expr, "expr"), m_pvecVars(&vecVars)
+			{
+				// + or -
+				m_expr = ((m_pm_opt > m_term) [ qi::_val = ph::bind(&t_gen::make_sign, qi::_1, qi::_2) ]
+					> *((m_p|m_m) > m_term) [ qi::_val = ph::bind(&t_gen::make_addsub, qi::_1, qi::_val, qi::_2) ]);
+
+				m_pm_opt = (m_p | m_m) [ qi::_val = qi::_1 ]
+					| qi::eps [ qi::_val = t_val(1) ];
+				m_p = qi::char_(t_ch('+')) [ qi::_val = t_val(1) ];
+				m_m = qi::char_(t_ch('-')) [ qi::_val = t_val(-1) ];
+
+				// * or /
+				m_term = (m_val [ qi::_val = qi::_1 ]
+					> *((t_ch('*') > m_val) [ qi::_val = ph::bind(&t_gen::make_binop, ExprOp::MUL, qi::_val, qi::_1) ]
+						| (t_ch('/') > m_val) [ qi::_val = ph::bind(&t_gen::make_binop, ExprOp::DIV, qi::_val, qi::_1) ]))
+					| m_val [ qi::_val = qi::_1 ];
+
+				// pow
+				m_val = m_baseval [ qi::_val = qi::_1 ]
+					> *((t_ch('^') > m_baseval)
+					[ qi::_val = ph::bind(&t_gen::make_binop, ExprOp::POW, qi::_val, qi::_1) ]);
+
+				// all alternatives have to yield code
+				m_baseval = m_num | m_func2 | m_func1 | m_ident_val
+					| (t_ch('(') > m_expr > t_ch(')'));
+
+				m_num = t_valparser() [ qi::_val = ph::bind(&t_gen::make_const, qi::_1) ];
+
+				// functions are resolved at compile time
+				m_ident_val = m_ident [ qi::_val = ph::bind(&CompileGrammar::make_ident, this, qi::_1) ];
+
+				m_func2 = (m_ident >> t_ch('(') >> m_expr >> t_ch(',') >> m_expr >> t_ch(')'))
+					[ qi::_val = ph::bind([](const t_str& strName, const t_code& code1, const t_code& code2) -> t_code
+					{ return t_gen::make_func2(get_func2<t_str, t_val>(strName), code1, code2); },
+					qi::_1, qi::_2, qi::_3) ];
+				m_func1 = ((m_ident >> t_ch('(') >> m_expr >> t_ch(')')))
+					[ qi::_val = ph::bind([](const t_str& strName, const t_code& code) -> t_code
+					{ return t_gen::make_func1(get_func1<t_str, t_val>(strName), code); },
+					qi::_1, qi::_2) ];
+
+				m_ident = qi::lexeme[qi::char_("A-Za-z_") > *qi::char_("0-9A-Za-z_")];
+			}
+
+			~CompileGrammar() {}
+	};
+
+
+	template<class t_val, class t_str>
+	CompiledExpr<t_val, t_str>::CompiledExpr(const t_str& strExpr, const std::vector<t_str>& vecVars)
+	{
+		compile(strExpr, vecVars);
+	}
+
+
+	template<class t_val, class t_str>
+	bool CompiledExpr<t_val, t_str>::compile(const t_str& strExpr, const std::vector<t_str>& vecVars)
+	{
+		m_bOk = false;
+		m_code.clear();
+		m_vecVars = vecVars;
+		m_iStackSize = 0;
+
+		if(trimmed(strExpr).length() == 0)
+		{
+			m_code = ExprCodeGen<t_val>::make_const(t_val(0)).vec;
+			m_iStackSize = 1;
+			return m_bOk = true;
+		}
+
+		try
+		{
+			using t_iter = typename t_str::const_iterator;
+			t_iter beg = strExpr.begin(), end = strExpr.end();
+
+			typename ExprCodeGen<t_val>::t_code code;
+			CompileGrammar<t_str, t_val> gram(m_vecVars);
+			bool bOk = qi::phrase_parse(beg, end, gram, asc::space, code);
+			if(!bOk || beg != end)
+			{
+				log_err("Could not parse expression \"", wstr_to_str(strExpr), "\".");
+				return false;
+			}
+			m_code = std::move(code.vec);
+		}
+		catch(const std::exception& ex)
+		{
+			log_err("Parsing failed with error: ", ex.what(), ".");
+			return false;
+		}
+
+		// needed stack size
+		std::size_t iDepth = 0;
+		for(const ExprInstr<t_val>& instr : m_code)
+		{
+			switch(instr.op)
+			{
+				case ExprOp::CONST: case ExprOp::VAR: ++iDepth; break;
+				case ExprOp::NEG: case ExprOp::FUNC1: break;
+				default: --iDepth; break;
+			}
+			m_iStackSize = std::max(m_iStackSize, iDepth);
+		}
+
+		if(m_iStackSize > TLIBS_EXPR_MAX_STACK)
+		{
+			log_err("Expression is too deeply nested.");
+			m_code.clear();
+			return false;
+		}
+
+		return m_bOk = true;
+	}
+
+
+	template<class t_val, class t_str>
+	t_val CompiledExpr<t_val, t_str>::eval(const t_val* pVars) const
+	{
+		t_val stack[TLIBS_EXPR_MAX_STACK];
+		std::size_t iTop = 0;
+
+		for(const ExprInstr<t_val>& instr : m_code)
+		{
+			switch(instr.op)
+			{
+				case ExprOp::CONST: stack[iTop++] = instr.val; break;
+				case ExprOp::VAR: stack[iTop++] = pVars[instr.iVar]; break;
+				case ExprOp::ADD: --iTop; stack[iTop-1] += stack[iTop]; break;
+				case ExprOp::SUB: --iTop; stack[iTop-1] -= stack[iTop]; break;
+				case ExprOp::MUL: --iTop; stack[iTop-1] *= stack[iTop]; break;
+				case ExprOp::DIV: --iTop; stack[iTop-1] /= stack[iTop]; break;
+				case ExprOp::POW: --iTop; stack[iTop-1] = expr_pow<t_val>(stack[iTop-1], stack[iTop]); break;
+				case ExprOp::NEG: stack[iTop-1] = -stack[iTop-1]; break;
+				case ExprOp::FUNC1: stack[iTop-1] = instr.pFunc1(stack[iTop-1]); break;
+				case ExprOp::FUNC2: --iTop; stack[iTop-1] = instr.pFunc2(stack[iTop-1], stack[iTop]); break;
+			}
+		}
+
+		return iTop ? stack[0] : t_val(0);
+	}
+
+
+	/**
+	 * the instructions are applied to blocks of points,
+	 * so that the inner loops run over contiguous arrays
+	 */
+	template<class t_val, class t_str>
+	void CompiledExpr<t_val, t_str>::eval_n(const t_val* const* ppVars, t_val* pOut, std::size_t n) const
+	{
+		constexpr std::size_t BLOCK = TLIBS_EXPR_BLOCK;
+
+		if(!m_bOk)
+		{
+			std::fill(pOut, pOut+n, t_val(0));
+			return;
+		}
+
+		std::vector<t_val> vecStack(m_iStackSize * BLOCK);
+
+		for(std::size_t iStart=0; iStart<n; iStart+=BLOCK)
+		{
+			const std::size_t iLen = std::min(BLOCK, n-iStart);
+			t_val *pTop = vecStack.data();	// one past the topmost block
+
+			for(const ExprInstr<t_val>& instr : m_code)
+			{
+				// operands are only addressed by the operators that pop them
+				switch(instr.op)
+				{
+					case ExprOp::CONST:
+						std::fill(pTop, pTop+iLen, instr.val);
+						pTop += BLOCK;
+						break;
+					case ExprOp::VAR:
+						std::copy(ppVars[instr.iVar]+iStart, ppVars[instr.iVar]+iStart+iLen, pTop);
+						pTop += BLOCK;
+						break;
+					case ExprOp::ADD:
+					{
+						t_val *pA = pTop - 2*BLOCK, *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pA[i] += pB[i];
+						pTop = pB;
+						break;
+					}
+					case ExprOp::SUB:
+					{
+						t_val *pA = pTop - 2*BLOCK, *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pA[i] -= pB[i];
+						pTop = pB;
+						break;
+					}
+					case ExprOp::MUL:
+					{
+						t_val *pA = pTop - 2*BLOCK, *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pA[i] *= pB[i];
+						pTop = pB;
+						break;
+					}
+					case ExprOp::DIV:
+					{
+						t_val *pA = pTop - 2*BLOCK, *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pA[i] /= pB[i];
+						pTop = pB;
+						break;
+					}
+					case ExprOp::POW:
+					{
+						t_val *pA = pTop - 2*BLOCK, *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pA[i] = expr_pow<t_val>(pA[i], pB[i]);
+						pTop = pB;
+						break;
+					}
+					case ExprOp::NEG:
+					{
+						t_val *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pB[i] = -pB[i];
+						break;
+					}
+					case ExprOp::FUNC1:
+					{
+						t_val *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pB[i] = instr.pFunc1(pB[i]);
+						break;
+					}
+					case ExprOp::FUNC2:
+					{
+						t_val *pA = pTop - 2*BLOCK, *pB = pTop - BLOCK;
+						for(std::size_t i=0; i<iLen; ++i) pA[i] = instr.pFunc2(pA[i], pB[i]);
+						pTop = pB;
+						break;
+					}
+				}
+			}
+
+			std::copy(vecStack.data(), vecStack.data()+iLen, pOut+iStart);
+		}
+	}
 }
 
 #endif
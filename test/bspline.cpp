@@ -0,0 +1,163 @@
+/**
+ * tlibs test file
+ * b-spline evaluation and smoothing splines
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o bspline bspline.cpp ../log/log.cpp
+
+#include "../fit/interpolation.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+using t_real = double;
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> dist(-1., 1.);
+	std::normal_distribution<t_real> noise(0., 0.1);
+
+	// de boor vs. recursive basis functions on a non-uniform knot vector
+	for(unsigned int iDeg : { 1, 2, 3, 5 })
+	{
+		const std::size_t N = 20;
+		std::vector<t_real> vecKnots(N + iDeg + 1), vecCtrl(N);
+		for(std::size_t i=0; i<vecKnots.size(); ++i)
+			vecKnots[i] = t_real(i) + 0.4*dist(rng);
+		for(t_real& d : vecCtrl)
+			d = dist(rng);
+
+		t_real dMaxDev = 0, dMaxDevDiff = 0;
+		for(t_real t=vecKnots[iDeg]; t<vecKnots[N]; t+=0.01)
+		{
+			t_real dRef = 0;
+			for(std::size_t i=0; i<N; ++i)
+				dRef += vecCtrl[i] * tl::bspline_base<t_real>(int(i), int(iDeg), t, vecKnots);
+
+			t_real dVal = 0, dDiff = 0, dVal1 = 0, dVal0 = 0;
+			const t_real h = 1e-6, t1 = t+h, t0 = t-h;
+			tl::bspline_n(vecCtrl.data(), N, 1, vecKnots, &t, 1, &dVal);
+			tl::bspline_n(vecCtrl.data(), N, 1, vecKnots, &t, 1, &dDiff, 1);
+			tl::bspline_n(vecCtrl.data(), N, 1, vecKnots, &t1, 1, &dVal1);
+			tl::bspline_n(vecCtrl.data(), N, 1, vecKnots, &t0, 1, &dVal0);
+
+			dMaxDev = std::max(dMaxDev, std::abs(dVal - dRef));
+			// the derivative is discontinuous at the knots for degree 1
+			if(iDeg > 1)
+				dMaxDevDiff = std::max(dMaxDevDiff, std::abs(dDiff - (dVal1-dVal0)/(2.*h)));
+		}
+
+		std::cout << "degree " << iDeg << ": max. deviation from recursion: " << dMaxDev
+			<< ", derivative: " << dMaxDevDiff << std::endl;
+	}
+
+	// parametric curve through a noisy spectrum
+	{
+		const std::size_t N = 200, iPts = 100000;
+		std::vector<t_real> vecX(N), vecY(N);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			vecX[i] = t_real(i);
+			vecY[i] = std::sin(t_real(i)*0.1) + noise(rng);
+		}
+
+		tl::BSpline<t_real> spline(N, vecX.data(), vecY.data(), 3);
+		std::vector<t_real> vecT(iPts), vecSplX(iPts), vecSplY(iPts);
+		for(std::size_t i=0; i<iPts; ++i)
+			vecT[i] = t_real(i) / t_real(iPts-1);
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+		spline.eval_n(vecT.data(), iPts, vecSplX.data(), vecSplY.data());
+		watch.stop();
+
+		t_real dMaxDev = 0;
+		for(std::size_t i=0; i<iPts; i+=997)
+		{
+			tl::ublas::vector<t_real> vec = spline(vecT[i]);
+			dMaxDev = std::max(dMaxDev, std::abs(vec[0]-vecSplX[i]) + std::abs(vec[1]-vecSplY[i]));
+		}
+
+		std::cout << "bspline, " << iPts << " points: " << watch.GetDur()*1e3 << " ms"
+			<< ", end points: (" << vecSplX.front() << ", " << vecSplY.front() << "), ("
+			<< vecSplX.back() << ", " << vecSplY.back() << ")"
+			<< ", single vs. batch: " << dMaxDev << std::endl;
+
+		// the old recursive evaluation, on fewer points
+		const std::size_t iOld = 1000;
+		std::vector<t_real> vecKnots(N + 4);
+		for(std::size_t i=0; i<vecKnots.size(); ++i)
+			vecKnots[i] = i<4 ? t_real(i)*1e-12 : (i>=N ? 1.-t_real(N+3-i)*1e-12 : t_real(i-3)/t_real(N-3));
+		t_real dSum = 0;
+		watch.start();
+		for(std::size_t i=0; i<iOld; ++i)
+		{
+			const t_real t = t_real(i) / t_real(iOld);
+			for(std::size_t j=0; j<N; ++j)
+				dSum += vecY[j] * tl::bspline_base<t_real>(int(j), 3, t, vecKnots);
+		}
+		watch.stop();
+		std::cout << "recursive bspline: " << watch.GetDur()/t_real(iOld)*t_real(iPts)*1e3
+			<< " ms for " << iPts << " points (extrapolated, checksum " << dSum << ")" << std::endl;
+	}
+
+	// smoothing splines
+	{
+		const std::size_t N = 100000;
+		std::vector<t_real> vecX(N), vecY(N), vecTrue(N);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			vecX[i] = 10.*t_real(i)/t_real(N-1);
+			vecTrue[i] = std::sin(vecX[i]) + 0.2*vecX[i];
+			vecY[i] = vecTrue[i] + noise(rng);
+		}
+
+		for(t_real dLambda : { 1e-4, 1., 100. })
+		{
+			for(std::size_t iSegs : { std::size_t(0), std::size_t(50) })
+			{
+				tl::Stopwatch<t_real> watch;
+				watch.start();
+				tl::SmoothSpline<t_real> spline(N, vecX.data(), vecY.data(), dLambda, nullptr, iSegs);
+				std::vector<t_real> vecFit(N);
+				spline.eval_n(vecX.data(), N, vecFit.data());
+				watch.stop();
+
+				t_real dRms = 0, dRmsTrue = 0;
+				for(std::size_t i=0; i<N; ++i)
+				{
+					dRms += (vecFit[i]-vecY[i])*(vecFit[i]-vecY[i]);
+					dRmsTrue += (vecFit[i]-vecTrue[i])*(vecFit[i]-vecTrue[i]);
+				}
+
+				std::cout << "smoothing spline, lambda = " << dLambda << ", "
+					<< (iSegs ? std::to_string(iSegs) + " segments" : std::string("knots at data")) << ": "
+					<< "rms to data: " << std::sqrt(dRms/t_real(N))
+					<< ", to true curve: " << std::sqrt(dRmsTrue/t_real(N))
+					<< ", " << watch.GetDur()*1e3 << " ms" << std::endl;
+			}
+		}
+
+		// interpolation limit and straight line limit on few points
+		const t_real px[] = { 0., 1., 2.5, 3., 4. }, py[] = { 1., 2., 0., 1., 3. };
+		tl::SmoothSpline<t_real> splInterp(5, px, py, 1e-10), splLine(5, px, py, 1e10);
+		t_real dInterp = 0, dCurv = 0;
+		for(int i=0; i<5; ++i)
+		{
+			dInterp = std::max(dInterp, std::abs(splInterp(px[i]) - py[i]));
+			t_real dDiff2 = 0;
+			splLine.eval_n(px+i, 1, &dDiff2, 2);
+			dCurv = std::max(dCurv, std::abs(dDiff2));
+		}
+		std::cout << "interpolation limit: " << dInterp << ", line limit: curvature " << dCurv << std::endl;
+	}
+
+	return 0;
+}
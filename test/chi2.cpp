@@ -0,0 +1,121 @@
+/**
+ * tlibs test file
+ * compensated and parallel chi^2 sums
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o chi2 chi2.cpp -lpthread
+
+#include "../math/stat.h"
+#include "../math/rand.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <limits>
+
+using namespace tl;
+using t_real = double;
+
+
+int main()
+{
+	std::cout.precision(16);
+	Philox4x32 eng(7);
+
+	const std::size_t N = 4000000;
+	std::vector<t_real> vecX(N), vecY(N), vecDY(N), vecModel(N), vecW(N);
+	rand_real_n<t_real>(vecX.data(), N, -5., 5., eng);
+	rand_norm_n<t_real>(vecY.data(), N, 0., 1., eng);
+	rand_real_n<t_real>(vecDY.data(), N, 0.5, 1.5, eng);
+
+	auto func = [](t_real x) -> t_real { return 0.1*x*x; };
+	for(std::size_t i=0; i<N; ++i)
+	{
+		vecY[i] += func(vecX[i]);
+		vecModel[i] = func(vecX[i]);
+
+		// one large term to make the naive sum lose the small ones
+		if(i == 0) vecY[i] += 1e9;
+	}
+
+	// reference
+	long double dRef = 0;
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const long double d = ((long double)vecY[i] - vecModel[i]) / vecDY[i];
+		dRef += d*d;
+	}
+
+	Stopwatch<t_real> watch;
+	watch.start();
+	t_real dNaive = 0;
+	for(std::size_t i=0; i<N; ++i)
+	{
+		const t_real d = (vecY[i] - vecModel[i]) / vecDY[i];
+		dNaive += d*d;
+	}
+	watch.stop();
+	const t_real dTimeNaive = watch.GetDur();
+
+	watch.start();
+	const t_real dDirect1 = chi2_direct<t_real, const t_real*>(N, vecModel.data(), vecY.data(),
+		vecDY.data(), nullptr, 1);
+	watch.stop();
+	const t_real dTime = watch.GetDur();
+
+	const t_real dDirect3 = chi2_direct<t_real, const t_real*>(N, vecModel.data(), vecY.data(),
+		vecDY.data(), nullptr, 3);
+	const t_real dFunc = chi2<t_real, decltype(func), const t_real*>(func, N, vecX.data(),
+		vecY.data(), vecDY.data(), nullptr, 2);
+
+	std::cout << "reference:     " << t_real(dRef) << "\n"
+		<< "naive sum:     " << dNaive << "\n"
+		<< "chi2_direct:   " << dDirect1 << ", 3 threads: " << dDirect3 << "\n"
+		<< "chi2:          " << dFunc << "\n"
+		<< "chi2_direct: " << dTime/t_real(N)*1e9 << " ns per point, "
+		<< "naive sum: " << dTimeNaive/t_real(N)*1e9 << " ns per point" << std::endl;
+
+	// mask bad pixels, whose values are nan
+	{
+		long double dRefMasked = 0;
+		for(std::size_t i=0; i<N; ++i)
+		{
+			vecW[i] = (i % 97 == 0) ? 0. : 1.;
+			if(vecW[i] == 0.)
+				vecY[i] = std::numeric_limits<t_real>::quiet_NaN();
+			else
+			{
+				const long double d = ((long double)vecY[i] - vecModel[i]) / vecDY[i];
+				dRefMasked += d*d;
+			}
+		}
+
+		const t_real dMasked = chi2_direct<t_real, const t_real*>(N, vecModel.data(),
+			vecY.data(), vecDY.data(), vecW.data(), 2);
+		const t_real dMaskedFunc = chi2<t_real, decltype(func), const t_real*>(func, N,
+			vecX.data(), vecY.data(), vecDY.data(), vecW.data());
+
+		std::cout << "\nmasked reference: " << t_real(dRefMasked) << "\n"
+			<< "masked:           " << dMasked << ", " << dMaskedFunc << std::endl;
+	}
+
+	// n dimensions
+	{
+		std::vector<std::vector<t_real>> vecvecX;
+		std::vector<t_real> vecY2, vecDY2;
+		for(std::size_t i=0; i<100000; ++i)
+		{
+			vecvecX.push_back({ vecX[i], vecX[i+1] });
+			vecY2.push_back(vecX[i]*vecX[i+1] + 0.1);
+			vecDY2.push_back(0.1);
+		}
+
+		auto funcnd = [](const std::vector<t_real>& x) -> t_real { return x[0]*x[1]; };
+		std::cout << "\nchi2_nd: " << chi2_nd<t_real, t_real>(funcnd, vecvecX, vecY2, vecDY2)
+			<< " (expected " << vecY2.size() << ")" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * tlibs test file
+ * memory-mapped (compressed) input files
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o comp_mmap comp_mmap.cpp ../log/log.cpp -lboost_iostreams -lpthread
+
+#include "../file/comp.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+
+
+int main()
+{
+	std::string strData;
+	for(std::size_t i=0; i<2000000; ++i)
+		strData += std::to_string(i) + "\t" + std::to_string(double(i)*0.5) + "\n";
+
+	// uncompressed file: the view points into the mapped pages
+	{
+		std::ofstream("comp_mmap_tst.dat", std::ios::binary).write(strData.data(), strData.size());
+
+		tl::Stopwatch<double> watch;
+		watch.start();
+		tl::CompMappedFile file("comp_mmap_tst.dat");
+		watch.stop();
+
+		std::cout << "plain: ok: " << file.IsOk() << ", mapped: " << file.IsMapped()
+			<< ", equal: " << (std::string(file.begin(), file.end()) == strData)
+			<< ", " << watch.GetDur()*1e3 << " ms" << std::endl;
+
+		std::string strLine;
+		std::getline(*file.GetIstream(), strLine);
+		std::cout << "\tfirst line via istream: " << strLine << std::endl;
+	}
+
+	const std::pair<tl::Compressor, const char*> comps[] =
+	{
+		{ tl::Compressor::GZ, "gz" },
+		{ tl::Compressor::BZ2, "bz2" },
+		{ tl::Compressor::XZ, "xz" },
+		{ tl::Compressor::ZSTD, "zst" },
+	};
+
+	for(const auto& comp : comps)
+	{
+		for(unsigned int iThreads : { 1, 4 })
+		{
+			const std::string strFile = std::string("comp_mmap_tst.") + comp.second;
+			{
+				std::istringstream istr(strData);
+				std::ofstream ofstr(strFile, std::ios::binary);
+				tl::comp_stream_to_stream<char>(istr, ofstr, comp.first, iThreads);
+			}
+
+			std::ifstream ifstr(strFile, std::ios::binary);
+			std::string strComp((std::istreambuf_iterator<char>(ifstr)), std::istreambuf_iterator<char>());
+
+			tl::Stopwatch<double> watch;
+			watch.start();
+			tl::CompMappedFile file(strFile, iThreads);
+			watch.stop();
+
+			std::cout << comp.second << " (" << iThreads << " thread(s) for compression): "
+				<< "ok: " << file.IsOk()
+				<< ", detected: " << (file.GetCompressor() == comp.first)
+				<< ", equal: " << (std::string(file.begin(), file.end()) == strData)
+				<< ", length from container: " << tl::_comp_decomp_len(strComp.data(), strComp.size(), comp.first)
+				<< " of " << strData.size()
+				<< ", " << watch.GetDur()*1e3 << " ms" << std::endl;
+
+			std::remove(strFile.c_str());
+		}
+	}
+
+	// memory to memory with the preallocated output
+	{
+		char *pcComp = nullptr, *pcDecomp = nullptr;
+		std::size_t iLenComp = 0, iLenDecomp = 0;
+		tl::comp_mem_to_mem<char>(strData.data(), strData.size(), pcComp, iLenComp, tl::Compressor::GZ);
+		bool bOk = tl::decomp_mem_to_mem<char>(pcComp, iLenComp, pcDecomp, iLenDecomp);
+		std::cout << "mem to mem: " << bOk << ", equal: "
+			<< (std::string(pcDecomp, iLenDecomp) == strData) << std::endl;
+		delete[] pcComp;
+		delete[] pcDecomp;
+	}
+
+	// empty file
+	{
+		std::ofstream("comp_mmap_tst.dat", std::ios::binary);
+		tl::CompMappedFile file("comp_mmap_tst.dat");
+		std::cout << "empty: ok: " << file.IsOk() << ", size: " << file.size() << std::endl;
+	}
+	std::remove("comp_mmap_tst.dat");
+
+	return 0;
+}
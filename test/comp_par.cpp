@@ -0,0 +1,139 @@
+/**
+ * tlibs test file
+ * parallel block-wise (de)compression
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o comp_par comp_par.cpp ../log/log.cpp -lboost_iostreams -lpthread
+
+#include "../file/comp.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+
+/**
+ * compressible test data
+ */
+std::string make_data(std::size_t iLen)
+{
+	std::string str;
+	str.reserve(iLen + 64);
+
+	std::size_t iLine = 0;
+	while(str.size() < iLen)
+	{
+		str += "line " + std::to_string(iLine) + ", value " + std::to_string(std::rand() % 1000) + "\n";
+		++iLine;
+	}
+
+	str.resize(iLen);
+	return str;
+}
+
+
+int main()
+{
+	const std::string strData = make_data(std::size_t(TLIBS_COMP_BLOCK)*9 + 12345);
+
+	const std::pair<tl::Compressor, const char*> comps[] =
+	{
+		{ tl::Compressor::GZ, "gz" },
+		{ tl::Compressor::BZ2, "bz2" },
+		{ tl::Compressor::XZ, "xz" },
+		{ tl::Compressor::ZSTD, "zst" },
+	};
+
+	for(const auto& comp : comps)
+	{
+		for(unsigned int iThreads : { 1, 4 })
+		{
+			tl::Stopwatch<double> watch;
+
+			// compress
+			std::istringstream istrData(strData);
+			std::stringstream ostrComp;
+			watch.start();
+			bool bComp = tl::comp_stream_to_stream<char>(istrData, ostrComp, comp.first, iThreads);
+			watch.stop();
+			const double dTimeComp = watch.GetDur();
+			const std::string strComp = ostrComp.str();
+
+			// decompress, serially and in parallel
+			std::istringstream istrComp1(strComp), istrComp4(strComp);
+			std::ostringstream ostrDecomp1, ostrDecomp4;
+			bool bDecomp1 = tl::decomp_stream_to_stream<char>(istrComp1, ostrDecomp1, tl::Compressor::AUTO, 1);
+			watch.start();
+			bool bDecomp4 = tl::decomp_stream_to_stream<char>(istrComp4, ostrDecomp4, tl::Compressor::AUTO, 4);
+			watch.stop();
+			const double dTimeDecomp = watch.GetDur();
+
+			const double dMB = double(strData.size()) / 1024. / 1024.;
+			std::cout << comp.second << ", " << iThreads << " thread(s): "
+				<< "ratio " << double(strComp.size()) / double(strData.size())
+				<< ", comp " << dMB / dTimeComp << " MiB/s"
+				<< ", decomp " << dMB / dTimeDecomp << " MiB/s"
+				<< ", ok: " << bComp << bDecomp1 << bDecomp4
+				<< ", serial == parallel == input: "
+				<< (ostrDecomp1.str() == strData && ostrDecomp4.str() == strData)
+				<< std::endl;
+
+			// compatibility with the command-line tools
+			if(iThreads == 4 && comp.first != tl::Compressor::ZSTD)
+			{
+				const std::string strFile = std::string("comp_par_tst.") + comp.second;
+				std::ofstream(strFile, std::ios::binary).write(strComp.data(), strComp.size());
+
+				const std::string strCmd = std::string(comp.first == tl::Compressor::GZ ? "gzip" :
+					comp.first == tl::Compressor::BZ2 ? "bzip2" : "xz") + " -t " + strFile + " 2>/dev/null";
+				std::cout << "\t" << strCmd.substr(0, strCmd.find(' ')) << " -t: "
+					<< (std::system(strCmd.c_str()) == 0 ? "ok" : "failed or not available") << std::endl;
+				std::remove(strFile.c_str());
+			}
+		}
+	}
+
+
+	// empty input
+	{
+		std::istringstream istrEmpty;
+		std::stringstream ostrComp;
+		std::ostringstream ostrDecomp;
+		tl::comp_stream_to_stream<char>(istrEmpty, ostrComp, tl::Compressor::GZ, 4);
+		std::istringstream istrComp(ostrComp.str());
+		bool bOk = tl::decomp_stream_to_stream<char>(istrComp, ostrDecomp, tl::Compressor::GZ, 4);
+		std::cout << "empty: " << bOk << ", " << ostrDecomp.str().size() << " bytes" << std::endl;
+	}
+
+
+	// files from the serial compressor are still read correctly in block mode
+	{
+		std::istringstream istrData(strData);
+		std::stringstream ostrComp;
+		tl::comp_stream_to_stream<char>(istrData, ostrComp, tl::Compressor::GZ, 1);
+
+		// append an indexed member to a plain one
+		std::istringstream istrData2(strData);
+		tl::comp_stream_to_stream<char>(istrData2, ostrComp, tl::Compressor::GZ, 4);
+
+		std::istringstream istrComp(ostrComp.str());
+		std::ostringstream ostrDecomp;
+		bool bOk = tl::decomp_stream_to_stream<char>(istrComp, ostrDecomp, tl::Compressor::GZ, 4);
+		std::cout << "plain + indexed gzip: " << bOk << ", " << (ostrDecomp.str() == strData+strData) << std::endl;
+	}
+
+
+	// xz output streams are not available, they have to be written with comp_stream_to_stream
+	{
+		std::ostringstream ostrXZ;
+		const bool bOstr = (tl::create_comp_ostream<char>(ostrXZ, tl::Compressor::XZ) != nullptr);
+		std::cout << "xz output stream: " << bOstr << " (expected 0)" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * tlibs test file
+ * direct and fft convolution
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o conv conv.cpp ../log/log.cpp
+
+#include "../math/dft.h"
+#include "../math/numint.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+using t_real = double;
+
+
+t_real max_diff(const std::vector<t_real>& vec0, const std::vector<t_real>& vec1)
+{
+	if(vec0.size() != vec1.size())
+		return t_real(-1);
+
+	t_real dMax = 0.;
+	for(std::size_t i=0; i<vec0.size(); ++i)
+		dMax = std::max(dMax, std::abs(vec0[i] - vec1[i]));
+	return dMax;
+}
+
+
+/**
+ * gaussian resolution function
+ */
+std::vector<t_real> make_kernel(std::size_t iLen)
+{
+	std::vector<t_real> vec(iLen);
+	const t_real dSig = t_real(iLen) / 8.;
+	for(std::size_t i=0; i<iLen; ++i)
+	{
+		const t_real dX = t_real(i) - t_real(iLen-1)/2.;
+		vec[i] = std::exp(-dX*dX / (2.*dSig*dSig));
+	}
+	return vec;
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> dist(0., 1.);
+
+	// correctness against the direct convolution
+	for(std::size_t iKernel : { 5, 64, 501, 2000 })
+	{
+		for(std::size_t iLen : { 1, 100, 3000, 20000 })
+		{
+			std::vector<t_real> vecSig(iLen);
+			for(t_real& d : vecSig) d = dist(rng);
+			const std::vector<t_real> vecKernel = make_kernel(iKernel);
+
+			tl::FFTConv<t_real> conv(vecKernel);
+			const std::vector<t_real> vecRef = tl::convolute_discrete(vecSig, vecKernel);
+			const std::vector<t_real> vecConv = conv.Convolve(vecSig);
+			const std::vector<t_real> vecSame = conv.Convolve(vecSig, tl::ConvMode::SAME);
+
+			std::vector<t_real> vecRefSame(vecRef.begin() + (iKernel-1)/2, vecRef.begin() + (iKernel-1)/2 + iLen);
+
+			std::cout << "kernel " << iKernel << ", signal " << iLen << ": "
+				<< (conv.UseFFT(iLen) ? "fft   " : "direct")
+				<< ", max. deviation: " << max_diff(vecRef, vecConv)
+				<< ", same mode: " << max_diff(vecRefSame, vecSame) << std::endl;
+		}
+	}
+
+	// batched convolution of signals with different lengths
+	{
+		const std::vector<t_real> vecKernel = make_kernel(300);
+		std::vector<std::vector<t_real>> vecSigs;
+		for(std::size_t iLen : { 2000, 1500, 7, 4000, 2000 })
+		{
+			std::vector<t_real> vecSig(iLen);
+			for(t_real& d : vecSig) d = dist(rng);
+			vecSigs.emplace_back(std::move(vecSig));
+		}
+
+		tl::FFTConv<t_real> conv(vecKernel);
+		std::vector<std::vector<t_real>> vecConvs = conv.ConvolveMany(vecSigs);
+
+		t_real dMax = 0.;
+		for(std::size_t iSig=0; iSig<vecSigs.size(); ++iSig)
+			dMax = std::max(dMax, max_diff(tl::convolute_discrete(vecSigs[iSig], vecKernel), vecConvs[iSig]));
+		std::cout << "batched: max. deviation: " << dMax << std::endl;
+	}
+
+	// speed, as inside a fit loop
+	for(std::size_t iLen : { 500, 4000, 20000 })
+	{
+		const std::size_t iKernel = iLen/2 + 1;
+		const std::size_t iRounds = 40000000 / (iLen*iKernel) + 1;
+
+		std::vector<t_real> vecSig(iLen);
+		for(t_real& d : vecSig) d = dist(rng);
+		const std::vector<t_real> vecKernel = make_kernel(iKernel);
+		tl::FFTConv<t_real> conv(vecKernel);
+		std::vector<t_real> vecOut(conv.GetOutLen(iLen));
+
+		t_real dSum = 0.;
+		tl::Stopwatch<t_real> watch;
+
+		watch.start();
+		for(std::size_t i=0; i<iRounds; ++i)
+			dSum += tl::convolute_discrete(vecSig, vecKernel)[iLen/2];
+		watch.stop();
+		const t_real dDirect = watch.GetDur() / t_real(iRounds);
+
+		watch.start();
+		for(std::size_t i=0; i<iRounds; ++i)
+		{
+			conv.Convolve(vecSig.data(), iLen, vecOut.data());
+			dSum += vecOut[iLen/2];
+		}
+		watch.stop();
+		const t_real dAuto = watch.GetDur() / t_real(iRounds);
+
+		std::vector<std::vector<t_real>> vecSigs(16, vecSig);
+		watch.start();
+		for(std::size_t i=0; i<iRounds; ++i)
+			dSum += conv.ConvolveMany(vecSigs)[3][iLen/2];
+		watch.stop();
+		const t_real dBatch = watch.GetDur() / t_real(iRounds*vecSigs.size());
+
+		std::cout << "signal " << iLen << ", kernel " << iKernel << ": "
+			<< "convolute_discrete " << dDirect*1e6 << " us, "
+			<< "FFTConv " << dAuto*1e6 << " us, "
+			<< "batched " << dBatch*1e6 << " us per signal"
+			<< " (checksum " << dSum << ")" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * tlibs test file
+ * tabulated inverse cdf and alias sampling
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o distr3 distr3.cpp -lpthread
+
+#include "../math/distr.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace tl;
+using t_real = double;
+
+
+template<class t_distr>
+void check_table(const char* pcName, const t_distr& distr)
+{
+	const t_real dEps = 1e-10;
+	DistrTable<t_distr> tab(distr, dEps);
+
+	// measure the errors on a fine grid in p and in x
+	const std::size_t N = 100000;
+	std::vector<t_real> vecP(N), vecX(N), vecXTab(N), vecF(N), vecFTab(N);
+	for(std::size_t i=0; i<N; ++i)
+		vecP[i] = (t_real(i) + 0.5) / t_real(N);
+
+	Stopwatch<t_real> watch;
+	watch.start();
+	distr.cdf_inv_n(vecP.data(), vecX.data(), N);
+	watch.stop();
+	const t_real dExact = watch.GetDur();
+
+	watch.start();
+	tab.cdf_inv_n(vecP.data(), vecXTab.data(), N);
+	watch.stop();
+	const t_real dTab = watch.GetDur();
+
+	t_real dErrInv = 0;
+	distr.cdf_n(vecXTab.data(), vecF.data(), N);
+	for(std::size_t i=0; i<N; ++i)
+		dErrInv = std::max(dErrInv, std::abs(vecF[i] - vecP[i]));
+
+	t_real dErrCdf = 0;
+	distr.cdf_n(vecX.data(), vecF.data(), N);
+	tab.cdf_n(vecX.data(), vecFTab.data(), N);
+	for(std::size_t i=0; i<N; ++i)
+		dErrCdf = std::max(dErrCdf, std::abs(vecFTab[i] - vecF[i]));
+
+	std::cout << pcName << ": " << tab.GetNumNodes() << " nodes, ok: " << tab.IsOk()
+		<< ", max. inverse error: " << dErrInv << ", max. cdf error: " << dErrCdf
+		<< ", quantile: " << dExact/t_real(N)*1e9 << " ns, "
+		<< "table: " << dTab/t_real(N)*1e9 << " ns" << std::endl;
+}
+
+
+template<class t_distr>
+void check_alias(const char* pcName, const t_distr& distr)
+{
+	DistrAlias<t_distr> alias(distr);
+
+	const std::size_t N = 1000000;
+	std::vector<t_real> vecSamples(N);
+	Philox4x32 eng(1234);
+
+	Stopwatch<t_real> watch;
+	watch.start();
+	alias.sample_n(vecSamples.data(), N, eng);
+	watch.stop();
+
+	// compare the histogram with the pdf
+	const t_real dMin = *std::min_element(vecSamples.begin(), vecSamples.end());
+	const t_real dMax = *std::max_element(vecSamples.begin(), vecSamples.end());
+	std::vector<t_real> vecHisto(std::size_t(dMax-dMin) + 1);
+	for(t_real d : vecSamples)
+		vecHisto[std::size_t(d - dMin)] += 1;
+
+	t_real dChi2 = 0;
+	std::size_t iBins = 0;
+	for(std::size_t i=0; i<vecHisto.size(); ++i)
+	{
+		const t_real dExpected = distr.pdf(dMin + t_real(i)) * t_real(N);
+		if(dExpected < 5.)
+			continue;
+		dChi2 += (vecHisto[i]-dExpected)*(vecHisto[i]-dExpected) / dExpected;
+		++iBins;
+	}
+
+	std::cout << pcName << ": " << alias.GetSize() << " bins, chi^2/bins = "
+		<< dChi2/t_real(iBins) << ", " << watch.GetDur()/t_real(N)*1e9
+		<< " ns per sample" << std::endl;
+}
+
+
+int main()
+{
+	check_table("normal", t_normal_dist<t_real>(1., 2.));
+	check_table("cauchy", t_cauchy_dist<t_real>(0., 1.));
+	check_table("gamma", t_gamma_dist<t_real>(0.5, 2.));
+	check_table("gamma", t_gamma_dist<t_real>(3., 1.));
+	check_table("beta", t_beta_dist<t_real>(2., 5.));
+	check_table("student", t_student_dist<t_real>(3.));
+	check_table("lognormal", t_lognormal_dist<t_real>(0., 1.));
+
+	std::cout << std::endl;
+	check_alias("poisson", t_poisson_dist<t_real>(25.));
+	check_alias("binomial", t_binomial_dist<t_real>(100., 0.3));
+	check_alias("hypergeometric", t_hypergeo_dist<t_real>(30., 50., 200.));
+
+	return 0;
+}
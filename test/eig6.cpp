@@ -0,0 +1,98 @@
+/**
+ * tlibs test file
+ * batched hermitian eigenproblems
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// gcc -I/usr/include/lapacke -o eig6 eig6.cpp ../math/linalg2.cpp ../math/rand.cpp ../log/log.cpp -lstdc++ -lm -llapacke -llapack -lpthread -std=c++11
+// gcc -DNO_LAPACK -o eig6 eig6.cpp ../math/rand.cpp ../log/log.cpp -lstdc++ -lm -lpthread -std=c++11
+
+#include "../math/linalg.h"
+#include "../math/linalg2.h"
+#include "../math/rand.h"
+#include <iostream>
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+
+
+/**
+ * max. |M v - lambda v| over all eigenpairs in the batch
+ */
+t_real max_residual(const std::vector<t_cplx>& vecMats, const std::vector<t_real>& vecEvals,
+	const std::vector<t_cplx>& vecEvecs, const std::vector<std::size_t>& vecNum, std::size_t N)
+{
+	t_real dMax = 0.;
+	for(std::size_t iMat=0; iMat<vecNum.size(); ++iMat)
+	{
+		const t_cplx *pM = vecMats.data() + iMat*N*N;
+
+		for(std::size_t iEV=0; iEV<vecNum[iMat]; ++iEV)
+		{
+			const t_cplx *pV = vecEvecs.data() + (iMat*N + iEV)*N;
+			const t_real dEval = vecEvals[iMat*N + iEV];
+
+			for(std::size_t i=0; i<N; ++i)
+			{
+				t_cplx c = -dEval*pV[i];
+				for(std::size_t j=0; j<N; ++j)
+					c += pM[i*N + j]*pV[j];
+				dMax = std::max(dMax, std::abs(c));
+			}
+		}
+	}
+	return dMax;
+}
+
+
+void tst(std::size_t N, std::size_t iNumMats)
+{
+	std::vector<t_cplx> vecMats(N*N*iNumMats);
+	for(std::size_t iMat=0; iMat<iNumMats; ++iMat)
+	{
+		t_cplx *pM = vecMats.data() + iMat*N*N;
+		for(std::size_t i=0; i<N; ++i)
+		{
+			pM[i*N + i] = tl::rand_real<t_real>(-1., 1.);
+			for(std::size_t j=i+1; j<N; ++j)
+			{
+				pM[i*N + j] = t_cplx(tl::rand_real<t_real>(-1., 1.), tl::rand_real<t_real>(-1., 1.));
+				pM[j*N + i] = std::conj(pM[i*N + j]);
+			}
+		}
+	}
+
+	std::vector<t_real> vecEvals(N*iNumMats);
+	std::vector<t_cplx> vecEvecs(N*N*iNumMats);
+	std::vector<std::size_t> vecNum(iNumMats, N);
+
+	bool bOk = tl::eigenvec_herm_batch<t_real>(vecMats.data(), iNumMats, N, 0,
+		vecEvals.data(), vecEvecs.data());
+	std::cout << "N = " << N << ", ok: " << bOk << ", max. residual: "
+		<< max_residual(vecMats, vecEvals, vecEvecs, vecNum, N) << std::endl;
+
+	std::vector<t_real> vecEvals2(N*iNumMats);
+	tl::eigenval_herm_batch<t_real>(vecMats.data(), iNumMats, N, 0, vecEvals2.data(), 1);
+	t_real dMaxDiff = 0.;
+	for(std::size_t i=0; i<vecEvals.size(); ++i)
+		dMaxDiff = std::max(dMaxDiff, std::abs(vecEvals[i] - vecEvals2[i]));
+	std::cout << "N = " << N << ", eigenvalue-only max. diff: " << dMaxDiff << std::endl;
+
+	bOk = tl::eigenvecsel_herm_batch<t_real>(vecMats.data(), iNumMats, N, 0,
+		vecEvals.data(), vecEvecs.data(), vecNum.data(), 0., 10.);
+	std::cout << "N = " << N << ", ok: " << bOk << ", positive eigenvalues of first matrix: "
+		<< vecNum[0] << ", max. residual: "
+		<< max_residual(vecMats, vecEvals, vecEvecs, vecNum, N) << std::endl;
+}
+
+
+int main()
+{
+	tl::init_rand();
+
+	for(std::size_t N : {2, 3, 4, 8, 24, 48})
+		tst(N, 1000);
+
+	return 0;
+}
@@ -4,13 +4,14 @@
  * @license GPLv2 or GPLv3
  */
 
-// gcc -o eval eval.cpp ../log/log.cpp -std=c++11 -lstdc++ -lm
+// gcc -O2 -o eval eval.cpp ../log/log.cpp -std=c++11 -lstdc++ -lm
 
 #include "../string/eval.h"
 #include "../string/eval_impl.h"
 #include <iostream>
 #include <tuple>
 #include <vector>
+#include "../time/stopwatch.h"
 
 int main()
 {
@@ -39,5 +40,77 @@ int main()
 	std::cout << "OK: " << result3.first;
 	std::cout << ", value: " << result3.second << std::endl;
 
+
+	// compiled expressions
+	for(const auto& tup : vecExprs)
+	{
+		tl::CompiledExpr<double> expr(std::get<0>(tup));
+		std::cout << "Compiled: " << std::get<0>(tup) << ", OK: " << bool(expr)
+			<< ", instructions: " << expr.GetCode().size()
+			<< ", value: " << expr.eval() << ", check: " << std::get<1>(tup) << std::endl;
+	}
+
+	tl::CompiledExpr<int> exprInt("mod(abs(x-4-3-2-1), y)", {"x", "y"});
+	std::cout << "Compiled int: " << exprInt.eval({5, 3}) << std::endl;
+
+	tl::CompiledExpr<double> exprErr("sin(x) + foo(x)", {"x"});
+	std::cout << "Unknown function, OK: " << bool(exprErr) << std::endl;
+
+
+	// model function evaluated over many points
+	{
+		const std::string strModel = "amp*exp(-0.5*((x-x0)/sig)^2) + offs - x*slope";
+		const std::vector<std::string> vecVars = { "x", "x0", "sig", "amp", "offs", "slope" };
+		const std::size_t N = 1000000;
+
+		std::vector<double> vecX(N), vecRes0(N), vecRes1(N), vecRes2(N);
+		for(std::size_t i=0; i<N; ++i)
+			vecX[i] = -5. + 10.*double(i)/double(N);
+		std::vector<std::vector<double>> vecParams(vecVars.size()-1);
+		const double dParams[] = { 0.5, 1.2, 3., 0.1, 0.01 };
+		for(std::size_t iParam=0; iParam<vecParams.size(); ++iParam)
+			vecParams[iParam].resize(N, dParams[iParam]);
+
+		tl::Stopwatch<double> watch;
+		watch.start();
+		for(std::size_t i=0; i<N/100; ++i)
+		{
+			std::ostringstream ostr;
+			ostr.precision(16);
+			ostr << vecX[i] << "-" << dParams[0];
+			vecRes0[i] = tl::eval_expr<std::string, double>("3*exp(-0.5*((" + ostr.str() + ")/1.2)^2)").second;
+		}
+		watch.stop();
+		std::cout << "eval_expr: " << double(N/100) / watch.GetDur() * 1e-6 << " M/s" << std::endl;
+
+		tl::CompiledExpr<double> expr(strModel, vecVars);
+		watch.start();
+		double dVars[] = { 0., 0.5, 1.2, 3., 0.1, 0.01 };
+		for(std::size_t i=0; i<N; ++i)
+		{
+			dVars[0] = vecX[i];
+			vecRes1[i] = expr.eval(dVars);
+		}
+		watch.stop();
+		std::cout << "CompiledExpr::eval: " << double(N) / watch.GetDur() * 1e-6 << " M/s" << std::endl;
+
+		const double* ppVars[] = { vecX.data(), vecParams[0].data(), vecParams[1].data(),
+			vecParams[2].data(), vecParams[3].data(), vecParams[4].data() };
+		watch.start();
+		expr.eval_n(ppVars, vecRes2.data(), N);
+		watch.stop();
+		std::cout << "CompiledExpr::eval_n: " << double(N) / watch.GetDur() * 1e-6 << " M/s" << std::endl;
+
+		double dMaxDiff = 0.;
+		for(std::size_t i=0; i<N; ++i)
+		{
+			const double dX = vecX[i];
+			const double dCheck = 3.*std::exp(-0.5*std::pow((dX-0.5)/1.2, 2.)) + 0.1 - dX*0.01;
+			dMaxDiff = std::max(dMaxDiff, std::abs(vecRes1[i]-dCheck));
+			dMaxDiff = std::max(dMaxDiff, std::abs(vecRes2[i]-dCheck));
+		}
+		std::cout << "max. diff: " << dMaxDiff << std::endl;
+	}
+
 	return 0;
 }
@@ -0,0 +1,148 @@
+/**
+ * tlibs test file
+ * benchmarks the blocked matrix products against ublas (and cblas, if available)
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O3 -march=native -std=c++11 -o gemm gemm.cpp ../math/rand.cpp ../log/log.cpp -lpthread
+// g++ -O3 -march=native -std=c++11 -DUSE_CBLAS -o gemm gemm.cpp ../math/rand.cpp ../log/log.cpp -lpthread -lcblas
+
+#include "../math/linalg.h"
+#include "../math/rand.h"
+#include "../time/stopwatch.h"
+#include <iostream>
+#include <complex>
+
+#ifdef USE_CBLAS
+extern "C"
+{
+	#include <cblas.h>
+}
+#endif
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+using t_mat = tl::ublas::matrix<t_real>;
+using t_mat_cm = tl::ublas::matrix<t_real, tl::ublas::column_major>;
+using t_vec = tl::ublas::vector<t_real>;
+using t_mat_c = tl::ublas::matrix<t_cplx>;
+
+
+template<class t_m>
+t_m rand_mat(std::size_t iRows, std::size_t iCols)
+{
+	t_m mat(iRows, iCols);
+	for(std::size_t i=0; i<iRows; ++i)
+		for(std::size_t j=0; j<iCols; ++j)
+			mat(i,j) = tl::rand_real<t_real>(-1., 1.);
+	return mat;
+}
+
+template<class t_m>
+t_real max_diff(const t_m& mat0, const t_m& mat1)
+{
+	t_real dMax = 0.;
+	for(std::size_t i=0; i<mat0.size1(); ++i)
+		for(std::size_t j=0; j<mat0.size2(); ++j)
+			dMax = std::max(dMax, std::abs(mat0(i,j) - mat1(i,j)));
+	return dMax;
+}
+
+
+template<class t_m>
+void bench_mm(std::size_t N, unsigned int iThreads)
+{
+	t_m mat0 = rand_mat<t_m>(N, N+3);
+	t_m mat1 = rand_mat<t_m>(N+3, N-1);
+
+	tl::Stopwatch<t_real> watch;
+
+	watch.start();
+	t_m matUblas = tl::ublas::prod(mat0, mat1);
+	watch.stop();
+	t_real dUblas = watch.GetDur();
+
+	watch.start();
+	t_m matBlocked = tl::prod_mm_blocked<t_m>(mat0, mat1, iThreads);
+	watch.stop();
+	t_real dBlocked = watch.GetDur();
+
+	std::cout << "mm, N = " << N << ", threads = " << iThreads
+		<< ": ublas: " << dUblas << " s, blocked: " << dBlocked << " s"
+		<< ", speedup: " << dUblas/dBlocked
+		<< ", max. diff: " << max_diff(matUblas, matBlocked);
+
+#ifdef USE_CBLAS
+	t_mat matC(N, N-1);
+	const t_mat mat0_rm = mat0, mat1_rm = mat1;
+	watch.start();
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, N-1, N+3,
+		1., &mat0_rm.data()[0], N+3, &mat1_rm.data()[0], N-1, 0., &matC.data()[0], N-1);
+	watch.stop();
+	std::cout << ", cblas: " << watch.GetDur() << " s";
+#endif
+
+	std::cout << std::endl;
+}
+
+
+void bench_mv(std::size_t N)
+{
+	t_mat mat = rand_mat<t_mat>(N, N);
+	t_vec vec(N);
+	for(std::size_t i=0; i<N; ++i)
+		vec[i] = tl::rand_real<t_real>(-1., 1.);
+
+	tl::Stopwatch<t_real> watch;
+
+	watch.start();
+	t_vec vecUblas = tl::ublas::prod(mat, vec);
+	watch.stop();
+	t_real dUblas = watch.GetDur();
+
+	watch.start();
+	t_vec vecBlocked = tl::prod_mv_blocked<t_vec, t_mat>(mat, vec);
+	watch.stop();
+	t_real dBlocked = watch.GetDur();
+
+	std::cout << "mv, N = " << N << ": ublas: " << dUblas << " s, blocked: "
+		<< dBlocked << " s, max. diff: " << tl::ublas::norm_inf(vecUblas-vecBlocked)
+		<< std::endl;
+}
+
+
+void test_cplx(std::size_t N)
+{
+	t_mat_c mat0(N, N), mat1(N, N);
+	for(std::size_t i=0; i<N; ++i)
+		for(std::size_t j=0; j<N; ++j)
+		{
+			mat0(i,j) = t_cplx(tl::rand_real<t_real>(-1., 1.), tl::rand_real<t_real>(-1., 1.));
+			mat1(i,j) = t_cplx(tl::rand_real<t_real>(-1., 1.), tl::rand_real<t_real>(-1., 1.));
+		}
+
+	t_mat_c matUblas = tl::ublas::prod(mat0, mat1);
+	t_mat_c matAuto = tl::prod_mm(mat0, mat1);
+	std::cout << "complex mm, N = " << N << ", max. diff: "
+		<< max_diff(matUblas, matAuto) << std::endl;
+}
+
+
+int main()
+{
+	tl::init_rand();
+
+	for(std::size_t N : { 5, 67, 256, 513, 1024 })
+	{
+		bench_mm<t_mat>(N, 1);
+		bench_mm<t_mat>(N, 0);
+		bench_mm<t_mat_cm>(N, 0);
+	}
+
+	for(std::size_t N : { 100, 1000, 4000 })
+		bench_mv(N);
+
+	test_cplx(150);
+	return 0;
+}
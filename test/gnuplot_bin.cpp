@@ -0,0 +1,166 @@
+/**
+ * tlibs test file
+ * binary and asynchronous gnuplot data transfer
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o gnuplot_bin gnuplot_bin.cpp ../gfx/gnuplot.cpp ../log/log.cpp -lboost_iostreams -lpthread
+
+#include "../gfx/gnuplot.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+using t_real = double;
+
+
+/**
+ * detector image with a moving peak
+ */
+void make_image(std::vector<std::vector<t_real>>& vecImg, std::size_t iFrame)
+{
+	const std::size_t N = vecImg.size();
+	const t_real dX0 = t_real(N)*(0.25 + 0.5*std::sin(0.1*t_real(iFrame))*0.5 + 0.25);
+
+	for(std::size_t iY=0; iY<N; ++iY)
+	{
+		vecImg[iY].resize(N);
+		for(std::size_t iX=0; iX<N; ++iX)
+		{
+			const t_real dX = t_real(iX) - dX0, dY = t_real(iY) - t_real(N)/2.;
+			vecImg[iY][iX] = std::exp(-(dX*dX + dY*dY) / (2.*t_real(N*N)/100.));
+		}
+	}
+}
+
+
+/**
+ * plots into a stand-in for gnuplot which dumps its input to a file,
+ * and checks that every binary image has the expected number of bytes
+ */
+void check_payload(bool bAsync)
+{
+	const std::size_t N = 200, iFrames = 20;
+	std::vector<std::vector<t_real>> vecImg(N);
+	const char *pcScript = "gnuplot_bin_tst.sh", *pcDump = "gnuplot_bin_tst.dat";
+
+	{
+		std::ofstream ofstr(pcScript);
+		ofstr << "if [ \"$1\" = \"--version\" ]; then echo \"gnuplot stand-in\"; "
+			<< "else cat > " << pcDump << "; fi\n";
+	}
+
+	std::size_t iDropped = 0;
+	{
+		tl::GnuPlot<t_real> plt;
+		if(!plt.Init(std::string("sh ") + pcScript))
+		{
+			std::cerr << "Cannot start gnuplot stand-in." << std::endl;
+			return;
+		}
+
+		plt.SetAsync(bAsync);
+		for(std::size_t iFrame=0; iFrame<iFrames; ++iFrame)
+		{
+			make_image(vecImg, iFrame);
+			plt.SetPrec(iFrame%2 ? 6 : 8);
+			plt.SetTitle(("Frame " + std::to_string(iFrame)).c_str());
+			plt.SimplePlot2d(vecImg, -1., 1., -1., 1.);
+		}
+		plt.WaitAsync();
+		iDropped = plt.GetNumDroppedPlots();
+		plt.DeInit();
+	}
+
+	std::ifstream ifstr(pcDump, std::ios_base::binary);
+	std::ostringstream ostrDump;
+	ostrDump << ifstr.rdbuf();
+	const std::string strDump = ostrDump.str();
+	std::remove(pcScript);
+	std::remove(pcDump);
+
+	const std::string strHeader = "binary array=(" + std::to_string(N) + "," + std::to_string(N) + ")";
+	const std::size_t iPayload = N*N*sizeof(float);
+	std::size_t iNumPlots = 0, iNumOk = 0;
+
+	for(std::size_t iPos = strDump.find(strHeader); iPos != std::string::npos;
+		iPos = strDump.find(strHeader, iPos))
+	{
+		++iNumPlots;
+
+		// the payload is followed by the next command or by the end of the stream
+		const std::size_t iData = strDump.find('\n', iPos) + 1;
+		const std::size_t iEnd = iData + iPayload;
+		if(iEnd == strDump.size() || (iEnd < strDump.size() && strDump.compare(iEnd, 4, "set ") == 0))
+			++iNumOk;
+
+		iPos = std::min(iEnd, strDump.size());
+	}
+
+	std::cout << (bAsync ? "binary, async" : "binary") << ": "
+		<< iNumPlots << " plots + " << iDropped << " dropped (expected " << iFrames << "), "
+		<< iNumOk << " with " << iPayload << " bytes of payload" << std::endl;
+}
+
+
+int main()
+{
+	check_payload(0);
+	check_payload(1);
+
+	const std::size_t N = 1000, iFrames = 10;
+	std::vector<std::vector<t_real>> vecImg(N);
+
+	tl::GnuPlot<t_real> plt;
+	if(!plt.Init())
+	{
+		std::cerr << "Cannot start gnuplot, skipping the timings." << std::endl;
+		return 0;
+	}
+
+	for(int iMode=0; iMode<3; ++iMode)
+	{
+		plt.SetBinary(iMode != 0);
+		plt.SetAsync(iMode == 2);
+
+		tl::Stopwatch<t_real> watch, watchCaller;
+		watch.start();
+		watchCaller.start();
+		for(std::size_t iFrame=0; iFrame<iFrames; ++iFrame)
+		{
+			make_image(vecImg, iFrame);
+			plt.SetTitle(("Frame " + std::to_string(iFrame)).c_str());
+			plt.SimplePlot2d(vecImg, -1., 1., -1., 1.);
+		}
+		watchCaller.stop();
+		plt.WaitAsync();
+		watch.stop();
+
+		std::cout << (iMode==0 ? "text" : (iMode==1 ? "binary" : "binary, async")) << ": "
+			<< watchCaller.GetDur()/t_real(iFrames)*1e3 << " ms per frame in the caller, "
+			<< watch.GetDur()/t_real(iFrames)*1e3 << " ms per frame total, "
+			<< plt.GetNumDroppedPlots() << " dropped" << std::endl;
+	}
+
+	// line plots with error bars
+	plt.SetAsync(0);
+	plt.StartPlot();
+	tl::PlotObj<t_real> obj;
+	for(int i=0; i<100; ++i)
+	{
+		obj.vecX.push_back(t_real(i));
+		obj.vecY.push_back(std::sin(t_real(i)*0.1));
+		obj.vecErrY.push_back(0.05);
+	}
+	plt.AddLine(obj);
+	plt.FinishPlot();
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * tlibs test file
+ * linear, cubic and monotone interpolation of tabulated curves
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o interp interp.cpp ../log/log.cpp
+
+#include "../fit/interpolation.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+using t_real = double;
+
+
+/**
+ * per-call lookup over 2-vectors as in the previous LinInterp, for comparison
+ * (with the interval index fixed, the previous version used the next interval)
+ */
+t_real lininterp_ref(const std::vector<tl::ublas::vector<t_real>>& vecPts, t_real x)
+{
+	auto iterLower = std::upper_bound(vecPts.begin()+1, vecPts.end()-1, x,
+		[](const t_real& x, const tl::ublas::vector<t_real>& vec) -> bool
+		{ return x < vec[0]; }) - 1;
+	auto iter2 = iterLower + 1;
+
+	const t_real xpos = (x-(*iterLower)[0]) / ((*iter2)[0] - (*iterLower)[0]);
+	return tl::lerp<t_real, t_real>((*iterLower)[1], (*iter2)[1], xpos);
+}
+
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<t_real> dist(0., 1.);
+
+	const std::size_t N = 500, iQueries = 4000000;
+
+	for(bool bUniform : { 1, 0 })
+	{
+		// resolution curve, unsorted input for the non-uniform table
+		std::vector<t_real> vecX(N), vecY(N);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			vecX[i] = bUniform ? t_real(i)*0.02 : 10.*dist(rng);
+			vecY[i] = std::exp(-(vecX[i]-5.)*(vecX[i]-5.));
+		}
+
+		tl::LinInterp<t_real> lin(N, vecX.data(), vecY.data());
+		tl::CubicInterp<t_real> cubic(N, vecX.data(), vecY.data());
+		tl::CubicInterp<t_real> pchip(N, vecX.data(), vecY.data(), true);
+
+		std::vector<tl::ublas::vector<t_real>> vecPts;
+		for(std::size_t i=0; i<lin.GetSize(); ++i)
+			vecPts.push_back(tl::make_vec<tl::ublas::vector<t_real>>({lin.GetX()[i], lin.GetY()[i]}));
+
+		std::vector<t_real> vecQSorted(iQueries), vecQRand(iQueries), vecOut(iQueries);
+		for(std::size_t i=0; i<iQueries; ++i)
+		{
+			vecQSorted[i] = -0.5 + 11.*t_real(i)/t_real(iQueries);
+			vecQRand[i] = -0.5 + 11.*dist(rng);
+		}
+
+		std::cout << (bUniform ? "uniform" : "non-uniform") << " grid, detected as uniform: "
+			<< lin.IsUniform() << std::endl;
+
+		for(const std::vector<t_real>* pvecQ : { &vecQSorted, &vecQRand })
+		{
+			tl::Stopwatch<t_real> watch;
+			t_real dSum = 0;
+
+			watch.start();
+			for(std::size_t i=0; i<iQueries; ++i)
+				dSum += lininterp_ref(vecPts, (*pvecQ)[i]);
+			watch.stop();
+			const t_real dRef = watch.GetDur();
+
+			watch.start();
+			lin.eval_n(pvecQ->data(), iQueries, vecOut.data());
+			watch.stop();
+			const t_real dBatch = watch.GetDur();
+
+			t_real dMaxDev = 0;
+			for(std::size_t i=0; i<iQueries; i+=101)
+			{
+				dMaxDev = std::max(dMaxDev, std::abs(vecOut[i] - lininterp_ref(vecPts, (*pvecQ)[i])));
+				dMaxDev = std::max(dMaxDev, std::abs(vecOut[i] - lin((*pvecQ)[i])));
+			}
+
+			watch.start();
+			cubic.eval_n(pvecQ->data(), iQueries, vecOut.data());
+			watch.stop();
+			const t_real dCubic = watch.GetDur();
+
+			t_real dMaxDevCubic = 0;
+			for(std::size_t i=0; i<iQueries; i+=101)
+				dMaxDevCubic = std::max(dMaxDevCubic, std::abs(vecOut[i] - cubic((*pvecQ)[i])));
+
+			std::cout << "\t" << (pvecQ == &vecQSorted ? "sorted" : "random") << " queries: "
+				<< "per call " << dRef/t_real(iQueries)*1e9 << " ns, "
+				<< "batch " << dBatch/t_real(iQueries)*1e9 << " ns, "
+				<< "cubic " << dCubic/t_real(iQueries)*1e9 << " ns per point, "
+				<< "max. deviation " << dMaxDev << ", " << dMaxDevCubic
+				<< " (checksum " << dSum << ")" << std::endl;
+		}
+
+		// interpolation errors inside the table
+		t_real dErrLin = 0, dErrCubic = 0, dErrPchip = 0;
+		for(t_real x=lin.GetX().front(); x<=lin.GetX().back(); x+=1e-3)
+		{
+			const t_real y = std::exp(-(x-5.)*(x-5.));
+			dErrLin = std::max(dErrLin, std::abs(lin(x) - y));
+			dErrCubic = std::max(dErrCubic, std::abs(cubic(x) - y));
+			dErrPchip = std::max(dErrPchip, std::abs(pchip(x) - y));
+		}
+		std::cout << "\tmax. errors: linear " << dErrLin << ", cubic " << dErrCubic
+			<< ", pchip " << dErrPchip << std::endl;
+	}
+
+	// monotone data: the cubic spline overshoots, pchip does not
+	{
+		const t_real px[] = { 0., 1., 2., 3., 4., 5. }, py[] = { 0., 0., 0., 1., 1., 1. };
+		tl::CubicInterp<t_real> cubic(6, px, py), pchip(6, px, py, true);
+
+		t_real dMinCubic = 0, dMaxCubic = 1, dMinPchip = 0, dMaxPchip = 1;
+		for(t_real x=0.; x<=5.; x+=1e-3)
+		{
+			dMinCubic = std::min(dMinCubic, cubic(x));
+			dMaxCubic = std::max(dMaxCubic, cubic(x));
+			dMinPchip = std::min(dMinPchip, pchip(x));
+			dMaxPchip = std::max(dMaxPchip, pchip(x));
+		}
+		std::cout << "step: cubic range [" << dMinCubic << ", " << dMaxCubic << "], "
+			<< "pchip range [" << dMinPchip << ", " << dMaxPchip << "]" << std::endl;
+	}
+
+	return 0;
+}
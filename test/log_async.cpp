@@ -0,0 +1,155 @@
+/**
+ * tlibs test file
+ * asynchronous logging
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o log_async log_async.cpp ../log/log.cpp -lpthread
+
+#include "../log/log.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+
+std::size_t count_lines(const std::string& str)
+{
+	return std::count(str.begin(), str.end(), '\n');
+}
+
+
+/**
+ * logs iNum messages from each of iThreads threads
+ */
+double log_threads(tl::Log& log, unsigned int iThreads, std::size_t iNum)
+{
+	tl::Stopwatch<double> watch;
+	watch.start();
+
+	std::vector<std::thread> vecThreads;
+	for(unsigned int iTh=0; iTh<iThreads; ++iTh)
+	{
+		vecThreads.emplace_back([&log, iTh, iNum]()
+		{
+			for(std::size_t i=0; i<iNum; ++i)
+				log("Thread ", iTh, ", message ", i, ", value ", 1.2345*double(i), ".");
+		});
+	}
+	for(std::thread& th : vecThreads)
+		th.join();
+
+	watch.stop();
+	return watch.GetDur();
+}
+
+
+int main()
+{
+	const unsigned int iThreads = 4;
+	const std::size_t iNum = 100000;
+
+	tl::Log log("TEST", tl::LogColor::NONE, nullptr);
+	log.RemoveOstr(&std::cerr);
+	log.SetShowThread(1);
+
+	// synchronous
+	{
+		std::ostringstream ostr;
+		log.AddOstr(&ostr, 0);
+		double dDur = log_threads(log, iThreads, iNum);
+		log.RemoveOstr(&ostr);
+
+		std::cout << "sync: " << count_lines(ostr.str()) << " lines, "
+			<< double(iThreads*iNum)/dDur*1e-6 << " M msgs/s" << std::endl;
+	}
+
+	// asynchronous, blocking
+	{
+		std::ostringstream ostr;
+		log.AddOstr(&ostr, 0);
+		tl::Log::SetAsync(1, 4096, tl::LogOverflow::BLOCK);
+		double dDur = log_threads(log, iThreads, iNum);
+		tl::Log::FlushAsync();
+		tl::Log::SetAsync(0);
+		log.RemoveOstr(&ostr);
+
+		std::cout << "async, block: " << count_lines(ostr.str()) << " lines, "
+			<< double(iThreads*iNum)/dDur*1e-6 << " M msgs/s" << std::endl;
+
+		std::string strLine = ostr.str().substr(0, ostr.str().find('\n'));
+		std::cout << "first line: " << strLine << std::endl;
+	}
+
+	// asynchronous, dropping
+	{
+		std::ostringstream ostr;
+		log.AddOstr(&ostr, 0);
+		tl::Log::SetAsync(1, 64, tl::LogOverflow::DROP);
+		double dDur = log_threads(log, iThreads, iNum);
+		tl::Log::FlushAsync();
+		tl::Log::SetAsync(0);
+		log.RemoveOstr(&ostr);
+
+		std::cout << "async, drop: " << count_lines(ostr.str()) << " lines, "
+			<< tl::Log::GetNumDropped() << " dropped, "
+			<< double(iThreads*iNum)/dDur*1e-6 << " M msgs/s" << std::endl;
+	}
+
+	// restarting the writer while other threads are logging
+	{
+		std::ostringstream ostr;
+		log.AddOstr(&ostr, 0);
+		tl::Log::SetAsync(1, 1024, tl::LogOverflow::BLOCK);
+		const std::uint64_t iDroppedBefore = tl::Log::GetNumDropped();
+
+		std::thread thRestart([]()
+		{
+			for(int i=0; i<20; ++i)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				tl::Log::SetAsync(1, i%2 ? 256 : 1024, tl::LogOverflow::BLOCK);
+			}
+		});
+		log_threads(log, iThreads, iNum);
+		thRestart.join();
+		tl::Log::FlushAsync();
+		tl::Log::SetAsync(0);
+		log.RemoveOstr(&ostr);
+
+		const std::uint64_t iDropped = tl::Log::GetNumDropped() - iDroppedBefore;
+		std::cout << "async, restarted: " << count_lines(ostr.str()) << " lines + "
+			<< iDropped << " dropped = " << count_lines(ostr.str()) + iDropped
+			<< " (expected " << iThreads*iNum << ")" << std::endl;
+	}
+
+	// switching between asynchronous and synchronous mode while other threads are logging
+	{
+		std::ostringstream ostr;
+		log.AddOstr(&ostr, 0);
+		const std::uint64_t iDroppedBefore = tl::Log::GetNumDropped();
+
+		std::thread thToggle([]()
+		{
+			for(int i=0; i<200; ++i)
+			{
+				tl::Log::SetAsync(i%2 == 0, 256, tl::LogOverflow::BLOCK);
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+		});
+		log_threads(log, iThreads, iNum);
+		thToggle.join();
+		tl::Log::SetAsync(0);
+		log.RemoveOstr(&ostr);
+
+		const std::uint64_t iDropped = tl::Log::GetNumDropped() - iDroppedBefore;
+		std::cout << "async toggled: " << count_lines(ostr.str()) << " lines, "
+			<< iDropped << " dropped (expected " << iThreads*iNum << " lines, 0 dropped)" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * tlibs test file
+ * compile-time log levels and lazy formatting
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o log_level log_level.cpp ../log/log.cpp -lpthread
+// g++ -O2 -std=c++11 -DTLIBS_LOG_MIN_LEVEL=2 -o log_level log_level.cpp ../log/log.cpp -lpthread
+
+#include "../log/log.h"
+#include "../time/stopwatch.h"
+#include <iostream>
+#include <string>
+
+
+static std::size_t g_iNumEvals = 0;
+
+std::string expensive(double d)
+{
+	++g_iNumEvals;
+	return std::to_string(d);
+}
+
+
+int main()
+{
+	std::cout << "minimum log level: " << TLIBS_LOG_MIN_LEVEL << std::endl;
+
+	// arguments of the macros are only evaluated if the logger is active
+	TLIBS_LOG_DEBUG("debug: ", expensive(1.));
+	TLIBS_LOG_INFO("info: ", expensive(2.));
+	TLIBS_LOG_WARN("warning: ", expensive(3.));
+	std::cout << "evaluations: " << g_iNumEvals << std::endl;
+
+	g_iNumEvals = 0;
+	tl::log_debug.SetEnabled(0);
+	TLIBS_LOG_DEBUG("debug: ", expensive(1.));
+	tl::log_debug.SetEnabled(1);
+
+	tl::log_info.RemoveOstr(&std::cerr);
+	TLIBS_LOG_INFO("info: ", expensive(2.));
+	tl::log_info.AddOstr(&std::cerr);
+	std::cout << "evaluations with disabled or unconnected loggers: " << g_iNumEvals << std::endl;
+
+	// lazy arguments are formatted once, independent of the number of streams
+	g_iNumEvals = 0;
+	std::ostringstream ostr;
+	tl::log_warn.AddOstr(&ostr, 0);
+	tl::log_warn("lazy: ", tl::log_lazy([]() { return expensive(4.); }));
+	tl::log_warn.RemoveOstr(&ostr);
+	std::cout << "lazy evaluations: " << g_iNumEvals << ", output: " << ostr.str();
+
+	// lazy argument from an lvalue functor, which is copied
+	{
+		g_iNumEvals = 0;
+		std::ostringstream ostrL;
+		auto fkt = []() { return expensive(5.); };
+		tl::log_warn.AddOstr(&ostrL, 0);
+		tl::log_warn("lazy lvalue: ", tl::log_lazy(fkt));
+		const auto lazy = tl::log_lazy(fkt);
+		tl::log_warn("lazy const: ", lazy);
+		tl::log_warn.RemoveOstr(&ostrL);
+		std::cout << "lvalue lazy evaluations: " << g_iNumEvals << ", output: " << ostrL.str();
+	}
+
+	// cost of disabled calls in a loop
+	{
+		const std::size_t N = 10000000;
+		tl::log_debug.SetEnabled(0);
+
+		tl::Stopwatch<double> watch;
+		watch.start();
+		for(std::size_t i=0; i<N; ++i)
+			tl::log_debug("i = ", i, ", value = ", expensive(double(i)));
+		watch.stop();
+		std::cout << "disabled direct call: " << watch.GetDur()/double(N)*1e9 << " ns" << std::endl;
+
+		watch.start();
+		for(std::size_t i=0; i<N; ++i)
+			TLIBS_LOG_DEBUG("i = ", i, ", value = ", expensive(double(i)));
+		watch.stop();
+		std::cout << "disabled macro call: " << watch.GetDur()/double(N)*1e9 << " ns" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * tlibs test file
+ * checkerboard metropolis algorithm
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O3 -march=native -std=c++11 -o metrop metrop.cpp ../math/rand.cpp ../log/log.cpp -lm -lpthread
+
+#include "../phys/metrop.h"
+#include "../phys/mag.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdio>
+
+using t_real = double;
+using t_ising = tl::MetropIsing<t_real, 2>;
+
+
+/**
+ * onsager's spontaneous magnetisation of the 2d square lattice (J = k = 1)
+ */
+t_real onsager_mag(t_real T)
+{
+	const t_real Tc = 2./std::log(1. + std::sqrt(2.));
+	if(T >= Tc) return 0.;
+	return std::pow(1. - std::pow(std::sinh(2./T), -4.), 1./8.);
+}
+
+
+int main()
+{
+	tl::init_rand();
+	const std::size_t L = 128;
+
+	// magnetisation below T_c
+	for(t_real T : { 1.5, 2.0, 2.2, 3.0 })
+	{
+		t_ising ising({L, L}, 1., true, 1234);
+		ising.SetTemperature(T);
+		ising.Sweep(1000);
+
+		std::vector<t_ising::Observables> vecObs;
+		ising.Sweep(2000, &vecObs);
+
+		t_real dM = 0., dE = 0.;
+		for(const auto& obs : vecObs)
+		{
+			dM += std::abs(obs.dM);
+			dE += obs.dE;
+		}
+		dM /= t_real(vecObs.size());
+		dE /= t_real(vecObs.size());
+
+		std::cout << "T = " << T << ": <|M|> = " << dM
+			<< " (onsager: " << onsager_mag(T) << "), <E> = " << dE << std::endl;
+	}
+
+
+	// incremental vs. recalculated energy, open boundaries and field, 3d
+	{
+		tl::MetropIsing<t_real, 3> ising({9, 10, 7}, 0.7, false, 5);
+		ising.SetTemperature(3.);
+		ising.SetField(0.2);
+		ising.Randomise();
+		ising.Sweep(100);
+
+		t_real dE0 = ising.GetEnergy(), dM0 = ising.GetMagnetisation();
+		ising.CalcObservables();
+		std::cout << "3d incremental E, M: " << dE0 << ", " << dM0
+			<< "; recalculated: " << ising.GetEnergy() << ", " << ising.GetMagnetisation()
+			<< std::endl;
+	}
+
+
+	// same result for different thread counts
+	{
+		t_ising ising1({64, 96}, 1., true, 99, 1);
+		t_ising ising4({64, 96}, 1., true, 99, 4);
+		for(t_ising* pIsing : { &ising1, &ising4 })
+		{
+			pIsing->SetTemperature(2.3);
+			pIsing->Randomise();
+			pIsing->Sweep(50);
+		}
+
+		bool bSame = 1;
+		ising1.ForAllSites([&ising1, &ising4, &bSame](const t_ising::t_dims& idx, std::size_t) -> void
+		{
+			if(ising1.GetSpin(idx) != ising4.GetSpin(idx))
+				bSame = 0;
+		});
+		std::cout << "1 thread == 4 threads: " << bSame << std::endl;
+	}
+
+
+	// round trip via tl::metrop's bool arrays
+	{
+		boost::multi_array<bool, 2> arr
+			= tl::rand_array<bool, 2, boost::array, boost::multi_array>({16, 8});
+		boost::multi_array<bool, 2> arr2(boost::extents[16][8]);
+
+		t_ising ising({16, 8}, 1.);
+		ising.FromArray(arr);
+		ising.ToArray(arr2);
+		std::cout << "array round trip: " << (arr == arr2) << std::endl;
+	}
+
+
+	// parallel tempering, resuming from a checkpoint has to give the same result
+	{
+		using t_pt = tl::MetropTempering<t_real, 2>;
+		const std::vector<t_real> vecT = { 1.8, 2.0, 2.1, 2.2, 2.25, 2.3, 2.4, 2.6 };
+
+		t_pt pt({32, 32}, 1., vecT, 1., true, 42);
+		pt.Randomise();
+		pt.Run(200, 1, false);
+		pt.Run(200);
+		pt.SaveCheckpoint("metrop_tst.chk");
+		pt.Run(300);
+
+		t_pt pt2({32, 32}, 1., vecT, 1., true, 0);
+		bool bLoaded = pt2.LoadCheckpoint("metrop_tst.chk");
+		pt2.Run(300);
+		std::remove("metrop_tst.chk");
+
+		const auto vecRes = pt.GetResults();
+		const auto vecRes2 = pt2.GetResults();
+
+		for(const auto& res : vecRes)
+		{
+			std::cout << "T = " << res.dT << ": E = " << res.dE << ", C = " << res.dC
+				<< ", |M| = " << res.dM << ", chi = " << res.dChi
+				<< ", U = " << res.dBinder << ", swap rate = " << res.dSwapRate << std::endl;
+		}
+
+		bool bSame = bLoaded;
+		for(std::size_t i=0; i<vecRes.size(); ++i)
+		{
+			if(vecRes[i].dE != vecRes2[i].dE || vecRes[i].dM != vecRes2[i].dM
+				|| pt.GetEnergyHistogram(i).vecCounts != pt2.GetEnergyHistogram(i).vecCounts)
+				bSame = 0;
+		}
+		std::cout << "resumed == uninterrupted: " << bSame << std::endl;
+
+		// a truncated checkpoint must leave the simulation untouched
+		pt.SaveCheckpoint("metrop_tst.chk");
+		{
+			std::ifstream ifstr("metrop_tst.chk", std::ios_base::binary);
+			std::string strChk((std::istreambuf_iterator<char>(ifstr)), std::istreambuf_iterator<char>());
+			std::ofstream ofstr("metrop_tst.chk", std::ios_base::binary);
+			ofstr.write(strChk.data(), strChk.size() - 100);
+		}
+
+		t_pt pt3({32, 32}, 1., vecT, 1., true, 7);
+		pt3.Run(50);
+		const auto vecRes3 = pt3.GetResults();
+		bool bLoaded3 = pt3.LoadCheckpoint("metrop_tst.chk");
+		std::remove("metrop_tst.chk");
+
+		bool bUnchanged = !bLoaded3;
+		const auto vecRes3b = pt3.GetResults();
+		for(std::size_t i=0; i<vecRes3.size(); ++i)
+		{
+			if(vecRes3[i].dE != vecRes3b[i].dE || vecRes3[i].dM != vecRes3b[i].dM
+				|| vecRes3[i].iNumMeas != vecRes3b[i].iNumMeas)
+				bUnchanged = 0;
+		}
+		std::cout << "truncated checkpoint rejected, state unchanged: " << bUnchanged << std::endl;
+
+		// a corrupt vector length must not be allocated
+		pt.SaveCheckpoint("metrop_tst.chk");
+		{
+			std::fstream fstr("metrop_tst.chk", std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+			const std::uint64_t iHuge = std::uint64_t(1) << 60;
+			fstr.seekp(4 + sizeof(std::uint32_t));	// length of the temperature vector
+			fstr.write(reinterpret_cast<const char*>(&iHuge), sizeof(iHuge));
+		}
+		bool bLoaded4 = pt3.LoadCheckpoint("metrop_tst.chk");
+		std::remove("metrop_tst.chk");
+		std::cout << "checkpoint with corrupt length rejected: " << !bLoaded4 << std::endl;
+	}
+
+
+	// speed
+	{
+		const std::size_t N = 1024, iSweeps = 100;
+		t_ising ising({N, N}, 1.);
+		ising.SetTemperature(2.269);
+		ising.Randomise();
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+		ising.Sweep(iSweeps);
+		watch.stop();
+		std::cout << "spin flips: " << t_real(N*N*iSweeps)/watch.GetDur()*1e-6
+			<< " M/s" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * tlibs test file
+ * mieze contrast reduction due to the sample volume
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o mieze_red mieze_red.cpp -lpthread
+
+#include "../phys/mieze.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace tl;
+using t_real = double;
+using t_len = t_length_si<t_real>;
+
+
+int main()
+{
+	std::cout.precision(8);
+
+	// first points of the sobol sequence
+	{
+		Sobol sobol(3);
+		t_real pt[3];
+		std::cout << "sobol:";
+		for(int i=0; i<8; ++i)
+		{
+			sobol.next(pt);
+			std::cout << " (" << pt[0] << ", " << pt[1] << ", " << pt[2] << ")";
+		}
+		std::cout << std::endl;
+	}
+
+	const t_len lx = 0.01*meters, ly = 0.01*meters, lz = 0.002*meters, lam = 8e-10*meters;
+	const t_length_inverse_si<t_real> mu = 50./meters;
+
+	// single samples: closed form, cubature and quasi-monte-carlo
+	for(t_real dTT : { 30., 90. })
+	{
+		for(t_real dFM : { 50e3, 800e3 })
+		{
+			const t_freq<units::si::system, t_real> fM = dFM/seconds;
+			const t_angle_si<t_real> tt = dTT/180.*get_pi<t_real>()*radians;
+
+			for(const MiezeCuboid<t_real>& cub :
+				{ mieze_cuboid(lx, ly, lz, fM, lam, tt, tt/2.),
+				mieze_cuboid_extinction(lx, ly, lz, mu, fM, lam, tt) })
+			{
+				t_real dExact = 0, dErr = 0;
+				mieze_reduction_cuboid_n(&cub, &dExact, 1);
+				const t_real dCub = mieze_reduction_cuboid(cub);
+				const t_real dQmc = mieze_reduction_cuboid_qmc(cub, 1<<16, &dErr);
+
+				std::cout << "2theta = " << dTT << ", fM = " << dFM << (cub.ext_z != 0. ? ", extinction" : "")
+					<< ": R = " << dExact << ", cubature: " << dCub-dExact
+					<< ", qmc: " << dQmc-dExact << " +- " << dErr << std::endl;
+			}
+		}
+	}
+
+	// map over modulation frequencies and sample rotations
+	{
+		const std::size_t iFreqs = 200, iAngles = 200;
+		const t_angle_si<t_real> tt = 60./180.*get_pi<t_real>()*radians;
+
+		std::vector<MiezeCuboid<t_real>> vecCub;
+		for(std::size_t iFreq=0; iFreq<iFreqs; ++iFreq)
+		{
+			const t_freq<units::si::system, t_real> fM = (10e3 + 1e6*t_real(iFreq)/t_real(iFreqs))/seconds;
+			for(std::size_t iAngle=0; iAngle<iAngles; ++iAngle)
+			{
+				const t_angle_si<t_real> ts = t_real(iAngle)/t_real(iAngles)*get_pi<t_real>()*radians;
+				vecCub.push_back(mieze_cuboid(lx, ly, lz, fM, lam, tt, ts));
+			}
+		}
+
+		std::vector<t_real> vecRed(vecCub.size());
+		Stopwatch<t_real> watch;
+		watch.start();
+		mieze_reduction_cuboid_n(vecCub.data(), vecRed.data(), vecCub.size());
+		watch.stop();
+		const t_real dMap = watch.GetDur();
+
+		// spot checks against the old defaults
+		const std::size_t iChecks = 10;
+		t_real dMaxDev = 0;
+		watch.start();
+		for(std::size_t i=0; i<vecCub.size(); i+=vecCub.size()/iChecks)
+			dMaxDev = std::max(dMaxDev, std::abs(mieze_reduction_cuboid(vecCub[i]) - vecRed[i]));
+		watch.stop();
+
+		std::cout << "map of " << vecCub.size() << " points: " << dMap*1e3 << " ms, "
+			<< "cubature: " << watch.GetDur()/t_real(iChecks)*1e3 << " ms per point, "
+			<< "max. deviation: " << dMaxDev << std::endl;
+	}
+
+	return 0;
+}
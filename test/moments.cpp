@@ -0,0 +1,128 @@
+/**
+ * tlibs test file
+ * single-pass and parallel moments and covariances
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o moments moments.cpp -lpthread
+
+#include "../math/stat.h"
+#include "../math/rand.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace tl;
+using t_real = double;
+
+
+int main()
+{
+	std::cout.precision(10);
+	Philox4x32 eng(42);
+
+	// large offset: naive sum of squares would lose all digits
+	{
+		const std::size_t N = 10000000;
+		std::vector<t_real> vec(N);
+		rand_norm_n<t_real>(vec.data(), N, 1e9, 2., eng);
+
+		// reference: two passes in long double
+		long double dSum = 0;
+		for(t_real d : vec) dSum += d;
+		const long double dMean = dSum / N;
+		long double dVar = 0;
+		for(t_real d : vec) dVar += (d-dMean)*(d-dMean);
+		dVar /= (N-1);
+
+		Stopwatch<t_real> watch;
+		watch.start();
+		MomentAccumulator<t_real> acc1 = moments_n(vec.data(), N, 1, 1);
+		watch.stop();
+		const t_real dTime1 = watch.GetDur();
+
+		watch.start();
+		MomentAccumulator<t_real> acc4 = moments_n(vec.data(), N, 1, 4);
+		watch.stop();
+
+		MomentAccumulator<t_real> accStream;
+		for(std::size_t i=0; i<1000; ++i)
+			accStream.add(vec[i]);
+
+		std::cout << "mean: " << acc1.GetMean() << ", reference: " << t_real(dMean) << "\n"
+			<< "variance: " << acc1.GetVariance() << ", reference: " << t_real(dVar) << "\n"
+			<< "threads give same result: " << (acc1.GetMean() == acc4.GetMean()
+				&& acc1.GetVariance() == acc4.GetVariance()) << "\n"
+			<< "skewness: " << acc1.GetSkewness() << ", kurtosis: " << acc1.GetKurtosis()
+			<< " (expected 0, 0)\n"
+			<< "streaming, 1000 values: mean = " << accStream.GetMean()
+			<< ", sigma = " << accStream.GetStdDev() << "\n"
+			<< "1 thread: " << dTime1/t_real(N)*1e9 << " ns per value, "
+			<< "4 threads: " << watch.GetDur()/t_real(N)*1e9 << " ns per value" << std::endl;
+	}
+
+	// higher moments of the exponential distribution
+	{
+		const std::size_t N = 10000000;
+		std::vector<t_real> vec(N);
+		rand_exp_n<t_real>(vec.data(), N, 1., eng);
+
+		MomentAccumulator<t_real> acc = moments_n(vec.data(), N);
+		std::cout << "\nexp: mean: " << acc.GetMean() << ", variance: " << acc.GetVariance()
+			<< ", skewness: " << acc.GetSkewness() << ", kurtosis: " << acc.GetKurtosis()
+			<< " (expected 1, 1, 2, 6)" << std::endl;
+	}
+
+	// weighted: histogram of a gaussian
+	{
+		std::vector<t_real> vecX, vecW;
+		for(t_real x=-10.; x<=10.; x+=0.01)
+		{
+			vecX.push_back(x + 3.);
+			vecW.push_back(std::exp(-0.5*x*x));
+		}
+
+		MomentAccumulator<t_real> acc = moments_n(vecX.data(), vecW.data(), vecX.size());
+		std::cout << "\nhistogram: mean: " << acc.GetMean()
+			<< ", sigma: " << acc.GetStdDev(0) << " (expected 3, 1)" << std::endl;
+	}
+
+	// covariance of interleaved 3d points
+	{
+		const std::size_t N = 1000000;
+		std::vector<t_real> vecRnd(3*N), vecPts(3*N);
+		rand_norm_n<t_real>(vecRnd.data(), 3*N, 0., 1., eng);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			const t_real *r = vecRnd.data() + 3*i;
+			t_real *p = vecPts.data() + 3*i;
+			p[0] = 100. + r[0];
+			p[1] = -5. + 2.*r[0] + r[1];
+			p[2] = 0.5*r[2];
+		}
+
+		CovarianceAccumulator<t_real> acc = covariance_n(vecPts.data(), N, 3);
+		std::cout << "\ncovariance: " << acc.GetCovariance()
+			<< "\n\texpected [[1, 2, 0], [2, 5, 0], [0, 0, 0.25]]"
+			<< "\ncorrelation: " << acc.GetCorrelation()
+			<< "\nmean: " << acc.GetMean() << std::endl;
+
+		// only the first two columns
+		CovarianceAccumulator<t_real> acc2 = covariance_n(vecPts.data(), N, 2, 3, 2);
+		std::cout << "columns 0, 1: " << acc2.GetCovariance() << std::endl;
+
+		std::vector<ublas::vector<t_real>> vecVecs;
+		for(std::size_t i=0; i<1000; ++i)
+			vecVecs.push_back(make_vec<ublas::vector<t_real>>(
+				{ vecPts[3*i], vecPts[3*i+1], vecPts[3*i+2] }));
+
+		CovarianceAccumulator<t_real> acc3(3);
+		acc3.add_n(vecPts.data(), 1000);
+		std::cout << "first 1000 points:\n\tcovariance(): " << std::get<0>(covariance(vecVecs))
+			<< "\n\taccumulator:  " << acc3.GetCovariance(0) << std::endl;
+	}
+
+	return 0;
+}
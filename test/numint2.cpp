@@ -0,0 +1,160 @@
+/**
+ * tlibs test file
+ * adaptive integration and cubature
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o numint2 numint2.cpp -lpthread
+
+#include "../math/numint.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+#include <cmath>
+
+using t_real = double;
+
+
+int main()
+{
+	std::cout.precision(12);
+	std::atomic<std::size_t> iEvals(0);
+
+	// smooth, peaked and oscillating integrands
+	{
+		auto fkt = [&iEvals](t_real x) -> t_real { ++iEvals; return std::exp(-x*x); };
+		t_real dErr = 0;
+		iEvals = 0;
+		t_real dVal = tl::numint_gk(fkt, -10., 10., 1e-12, 1e-12, &dErr);
+		std::cout << "gauss, gk:    " << dVal - std::sqrt(M_PI) << " (estimated " << dErr
+			<< ", " << iEvals << " evaluations)" << std::endl;
+
+		iEvals = 0;
+		dVal = tl::numint_simpN(std::function<t_real(t_real)>(fkt), -10., 10., 128);
+		std::cout << "gauss, simpN: " << dVal - std::sqrt(M_PI) << " (" << iEvals << " evaluations)" << std::endl;
+	}
+
+	{
+		auto fkt = [&iEvals](t_real x) -> t_real { ++iEvals; return 1. / (1e-4 + x*x); };
+		const t_real dRef = 2.*std::atan(1./1e-2) / 1e-2;
+		t_real dErr = 0;
+		iEvals = 0;
+		t_real dVal = tl::numint_gk(fkt, -1., 1., 0., 1e-10, &dErr);
+		std::cout << "lorentzian, gk:    " << (dVal - dRef)/dRef << " relative (estimated " << dErr/dRef
+			<< ", " << iEvals << " evaluations)" << std::endl;
+
+		iEvals = 0;
+		dVal = tl::numint_simpN(std::function<t_real(t_real)>(fkt), -1., 1., 100000);
+		std::cout << "lorentzian, simpN: " << (dVal - dRef)/dRef << " relative ("
+			<< iEvals << " evaluations)" << std::endl;
+	}
+
+	{
+		t_real dErr = 0;
+		t_real dVal = tl::numint_gk([](t_real x) -> t_real { return std::cos(100.*x); },
+			0., 10., 1e-12, 1e-12, &dErr);
+		std::cout << "oscillating, gk: " << dVal - std::sin(1000.)/100. << " (estimated " << dErr << ")" << std::endl;
+	}
+
+	// end point singularities
+	{
+		t_real dErr = 0;
+		iEvals = 0;
+		t_real dVal = tl::numint_tanhsinh([&iEvals](t_real x) -> t_real { ++iEvals; return 1./std::sqrt(x); },
+			0., 1., 1e-12, 1e-12, &dErr);
+		std::cout << "1/sqrt(x), tanh-sinh: " << dVal - 2. << " (estimated " << dErr
+			<< ", " << iEvals << " evaluations)" << std::endl;
+
+		iEvals = 0;
+		dVal = tl::numint_tanhsinh([&iEvals](t_real x) -> t_real { ++iEvals; return std::log(x)*std::log(1.-x); },
+			0., 1., 1e-12, 1e-12, &dErr);
+		std::cout << "log(x)log(1-x), tanh-sinh: " << dVal - (2. - M_PI*M_PI/6.) << " (estimated " << dErr
+			<< ", " << iEvals << " evaluations)" << std::endl;
+
+		iEvals = 0;
+		dVal = tl::numint_gk([&iEvals](t_real x) -> t_real { ++iEvals; return 1./std::sqrt(x); },
+			0., 1., 1e-12, 1e-12, &dErr);
+		std::cout << "1/sqrt(x), gk: " << dVal - 2. << " (estimated " << dErr
+			<< ", " << iEvals << " evaluations)" << std::endl;
+	}
+
+	// batched integrand
+	{
+		auto fkt = [](const t_real* pX, t_real* pY, std::size_t N) -> void
+		{
+			for(std::size_t i=0; i<N; ++i)
+				pY[i] = std::exp(-pX[i]) * std::sin(pX[i]);
+		};
+		t_real dErr = 0;
+		t_real dVal = tl::numint_gk_batch(fkt, 0., 50., 1e-12, 1e-12, &dErr);
+		std::cout << "batched gk: " << dVal - 0.5 << " (estimated " << dErr << ")" << std::endl;
+		dVal = tl::numint_tanhsinh_batch(fkt, 0., 50., 1e-12, 1e-12, &dErr);
+		std::cout << "batched tanh-sinh: " << dVal - 0.5 << " (estimated " << dErr << ")" << std::endl;
+	}
+
+	// cubature
+	for(std::size_t iDim : { 1, 2, 3, 5 })
+	{
+		const std::vector<t_real> vecMin(iDim, -1.), vecMax(iDim, 2.);
+		auto fkt = [iDim, &iEvals](const t_real* pX) -> t_real
+		{
+			++iEvals;
+			t_real dProd = 1.;
+			for(std::size_t i=0; i<iDim; ++i)
+				dProd *= std::cos(pX[i]);
+			return dProd;
+		};
+		const t_real dRef = std::pow(std::sin(2.) + std::sin(1.), t_real(iDim));
+
+		for(unsigned int iThreads : { 1, 4 })
+		{
+			t_real dErr = 0;
+			iEvals = 0;
+			t_real dVal = tl::numint_cubature(fkt, vecMin, vecMax, 1e-10, 1e-10, &dErr, 10000000, iThreads);
+			std::cout << "cubature, dim " << iDim << ", " << iThreads << " thread(s): "
+				<< dVal - dRef << " (estimated " << dErr << ", " << iEvals << " evaluations)" << std::endl;
+		}
+	}
+
+	// speed of the batched vs. scalar interfaces
+	{
+		const std::size_t iRounds = 2000;
+		auto fktScalar = [](t_real x) -> t_real { return std::exp(-x*x) * std::cos(5.*x); };
+		auto fktBatch = [](const t_real* pX, t_real* pY, std::size_t N) -> void
+		{
+			for(std::size_t i=0; i<N; ++i)
+				pY[i] = std::exp(-pX[i]*pX[i]) * std::cos(5.*pX[i]);
+		};
+
+		t_real dSum = 0;
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+		for(std::size_t i=0; i<iRounds; ++i)
+			dSum += tl::numint_simpN(std::function<t_real(t_real)>(fktScalar), -10., 10., 4096);
+		watch.stop();
+		const t_real dSimp = watch.GetDur();
+
+		watch.start();
+		for(std::size_t i=0; i<iRounds; ++i)
+			dSum += tl::numint_gk(fktScalar, -10., 10., 1e-12, 1e-12);
+		watch.stop();
+		const t_real dGK = watch.GetDur();
+
+		watch.start();
+		for(std::size_t i=0; i<iRounds; ++i)
+			dSum += tl::numint_gk_batch(fktBatch, -10., 10., 1e-12, 1e-12);
+		watch.stop();
+		const t_real dGKBatch = watch.GetDur();
+
+		std::cout << "simpN(4096): " << dSimp/t_real(iRounds)*1e6 << " us, "
+			<< "gk: " << dGK/t_real(iRounds)*1e6 << " us, "
+			<< "gk batched: " << dGKBatch/t_real(iRounds)*1e6 << " us"
+			<< " (checksum " << dSum << ")" << std::endl;
+	}
+
+	return 0;
+}
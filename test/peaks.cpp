@@ -0,0 +1,158 @@
+/**
+ * tlibs test file
+ * single-pass peak search with Savitzky-Golay derivatives
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o peaks peaks.cpp ../log/log.cpp -lpthread
+
+#include "../fit/interpolation.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+using t_real = double;
+
+
+/**
+ * gaussian peaks on a sloped background with noise
+ */
+static void make_spectrum(std::size_t iLen, t_real* px, t_real* py,
+	const std::vector<std::array<t_real, 3>>& vecPeaks, t_real dNoise, std::mt19937& rng)
+{
+	std::normal_distribution<t_real> noise(0., dNoise);
+	for(std::size_t i=0; i<iLen; ++i)
+	{
+		px[i] = 1000. + 0.5*t_real(i);
+		py[i] = 20. + 0.001*t_real(i) + noise(rng);
+
+		for(const auto& peak : vecPeaks)
+		{
+			const t_real dSig = peak[2] * tl::get_FWHM2SIGMA<t_real>();
+			py[i] += peak[1] * std::exp(-0.5*(px[i]-peak[0])*(px[i]-peak[0])/(dSig*dSig));
+		}
+	}
+}
+
+
+int main()
+{
+	std::mt19937 rng(123);
+
+	// savitzky-golay coefficients, e.g. (-3, 12, 17, 12, -3)/35 for 5 points and order 2
+	{
+		std::vector<t_real> vecSG = tl::savitzky_golay<t_real>(2, 2, 0);
+		std::cout << "SG(5, 2) * 35:";
+		for(t_real d : vecSG) std::cout << " " << d*35.;
+		std::vector<t_real> vecSG1 = tl::savitzky_golay<t_real>(2, 2, 1);
+		std::cout << "\nSG'(5, 2) * 10:";
+		for(t_real d : vecSG1) std::cout << " " << d*10.;
+		std::cout << std::endl;
+	}
+
+	// [position, amplitude, fwhm]
+	const std::vector<std::array<t_real, 3>> vecTrue =
+	{
+		{ 1100., 100., 8. },
+		{ 1250., 40., 15. },
+		{ 1262., 60., 10. },
+		{ 1700., 15., 20. },
+		{ 2100., 200., 5. },
+	};
+
+	const std::size_t iLen = 2500;
+	std::vector<t_real> vecX(iLen), vecY(iLen);
+	make_spectrum(iLen, vecX.data(), vecY.data(), vecTrue, 1., rng);
+
+	tl::PeakFinder<t_real> finder(6, 3);
+	finder.SetMinProminence(5.);
+
+	std::vector<tl::PeakInfo<t_real>> vecPeaks;
+	finder.find(iLen, vecX.data(), vecY.data(), vecPeaks);
+
+	std::cout << "\nexpected:" << std::endl;
+	for(const auto& peak : vecTrue)
+		std::cout << "\tx = " << peak[0] << ", amplitude = " << peak[1]
+			<< ", fwhm = " << peak[2] << std::endl;
+
+	std::cout << "found:" << std::endl;
+	for(const auto& peak : vecPeaks)
+		std::cout << "\tx = " << peak.dX << ", height = " << peak.dHeight
+			<< ", prominence = " << peak.dProminence << ", fwhm = " << peak.dWidth
+			<< ", bases = " << peak.dBaseLeft << ", " << peak.dBaseRight << std::endl;
+
+
+	// one long spectrum
+	{
+		const std::size_t iLongLen = 10000000;
+		std::vector<t_real> vecLongX(iLongLen), vecLongY(iLongLen);
+		std::vector<std::array<t_real, 3>> vecLongPeaks;
+		for(std::size_t i=0; i<100; ++i)
+			vecLongPeaks.push_back({ 1000. + t_real(i)*25000. + 1234., 50., 10. });
+
+		// only add the peaks nearby to keep the set-up fast
+		std::normal_distribution<t_real> noise(0., 1.);
+		for(std::size_t i=0; i<iLongLen; ++i)
+		{
+			vecLongX[i] = 1000. + 0.5*t_real(i);
+			vecLongY[i] = 20. + noise(rng);
+			const std::size_t iPeak = std::size_t((vecLongX[i] - 1000.) / 25000.);
+			for(std::size_t j=iPeak; j<std::min<std::size_t>(iPeak+2, 100); ++j)
+			{
+				const t_real dx = vecLongX[i] - vecLongPeaks[j][0];
+				if(std::abs(dx) < 100.)
+				{
+					const t_real dSig = 10. * tl::get_FWHM2SIGMA<t_real>();
+					vecLongY[i] += 50. * std::exp(-0.5*dx*dx/(dSig*dSig));
+				}
+			}
+		}
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+		finder.SetMinProminence(20.);
+		finder.find(iLongLen, vecLongX.data(), vecLongY.data(), vecPeaks);
+		watch.stop();
+
+		std::cout << "\n" << iLongLen << " points: " << vecPeaks.size() << " peaks (expected 100), "
+			<< watch.GetDur()*1e3 << " ms" << std::endl;
+	}
+
+
+	// many detector pixels
+	{
+		const std::size_t iPixels = 2000, iBins = 4096;
+		std::vector<t_real> vecPixX(iBins), vecPixY(iPixels*iBins);
+		for(std::size_t iPix=0; iPix<iPixels; ++iPix)
+		{
+			const std::vector<std::array<t_real, 3>> vecPixPeaks =
+				{ { 1500. + t_real(iPix % 100), 30., 12. } };
+			make_spectrum(iBins, vecPixX.data(), vecPixY.data() + iPix*iBins, vecPixPeaks, 1., rng);
+		}
+
+		std::vector<std::vector<tl::PeakInfo<t_real>>> vecPixPeaks;
+		finder.SetMinProminence(10.);
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+		finder.find_n(iBins, vecPixX.data(), vecPixY.data(), iPixels, vecPixPeaks, 0);
+		watch.stop();
+
+		std::size_t iOnePeak = 0;
+		for(std::size_t iPix=0; iPix<iPixels; ++iPix)
+		{
+			if(vecPixPeaks[iPix].size() == 1 &&
+				std::abs(vecPixPeaks[iPix][0].dX - (1500. + t_real(iPix % 100))) < 1.)
+				++iOnePeak;
+		}
+
+		std::cout << iPixels << " spectra: " << iOnePeak << " with the correct single peak, "
+			<< watch.GetDur()*1e3 << " ms" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * tlibs test file
+ * cached and prepared property queries
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o prop2 prop2.cpp ../log/log.cpp -lboost_iostreams -lpthread
+
+#include "../file/prop.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+
+int main()
+{
+	using t_prop = tl::Prop<std::string>;
+	t_prop prop;
+
+	std::vector<std::string> vecAddrs;
+	for(int iDev=0; iDev<20; ++iDev)
+	{
+		for(int iKey=0; iKey<20; ++iKey)
+		{
+			std::string strAddr = "instrument/device_" + std::to_string(iDev) + "/param_" + std::to_string(iKey);
+			prop.Add(strAddr, double(iDev*100 + iKey) + 0.5);
+			vecAddrs.push_back(strAddr);
+		}
+	}
+
+	// results have to be the same as before
+	{
+		bool bOk = 0, bOk2 = 1;
+		double dVal = prop.Query<double>("instrument/device_3/param_4", nullptr, &bOk);
+		prop.Query<double>("/instrument/device_3/param_99", nullptr, &bOk2);
+		std::string strVal = prop.Query<std::string>("instrument/device_3/param_4");
+		std::cout << "value: " << dVal << " (" << bOk << "), string: " << strVal
+			<< ", missing: " << bOk2 << ", default: "
+			<< prop.Query<double>("instrument/none", -1.) << std::endl;
+	}
+
+	// prepared queries see modifications
+	{
+		t_prop::Prepared<double> query = prop.Prepare<double>("instrument/device_0/param_0");
+		std::cout << "prepared: " << query();
+
+		tl::Prop<std::string>::t_prop tree = prop.GetProp();
+		tree.put("instrument.device_0.param_0", "12.5");
+		prop.SetProp(tree);
+		std::cout << ", after SetProp: " << query();
+
+		prop.Add("instrument/device_new/param", 7);
+		t_prop::Prepared<int> query2 = prop.Prepare<int>("instrument/device_new/param");
+		std::cout << ", added: " << query2() << std::endl;
+	}
+
+	// bulk queries
+	{
+		std::vector<std::string> vecTst = { vecAddrs[0], "instrument/nothing", vecAddrs[399] };
+		std::vector<bool> vecOk;
+		std::vector<double> vecVals = prop.QueryMany<double>(vecTst, -1., &vecOk);
+		std::cout << "bulk: ";
+		for(std::size_t i=0; i<vecVals.size(); ++i)
+			std::cout << vecVals[i] << " (" << vecOk[i] << ") ";
+		std::cout << std::endl;
+	}
+
+	// speed
+	{
+		const std::size_t iRounds = 200;
+		tl::Stopwatch<double> watch;
+		double dSum = 0.;
+
+		prop.SetCacheSize(0);
+		watch.start();
+		for(std::size_t iRound=0; iRound<iRounds; ++iRound)
+			for(const std::string& strAddr : vecAddrs)
+				dSum += prop.Query<double>(strAddr);
+		watch.stop();
+		const double dUncached = watch.GetDur();
+
+		prop.SetCacheSize(TLIBS_PROP_CACHE_SIZE);
+		watch.start();
+		for(std::size_t iRound=0; iRound<iRounds; ++iRound)
+			for(const std::string& strAddr : vecAddrs)
+				dSum += prop.Query<double>(strAddr);
+		watch.stop();
+		const double dCached = watch.GetDur();
+
+		watch.start();
+		for(std::size_t iRound=0; iRound<iRounds; ++iRound)
+			for(double dVal : prop.QueryMany<double>(vecAddrs))
+				dSum += dVal;
+		watch.stop();
+		const double dMany = watch.GetDur();
+
+		std::vector<t_prop::Prepared<double>> vecQueries;
+		for(const std::string& strAddr : vecAddrs)
+			vecQueries.push_back(prop.Prepare<double>(strAddr));
+		watch.start();
+		for(std::size_t iRound=0; iRound<iRounds; ++iRound)
+			for(const auto& query : vecQueries)
+				dSum += query();
+		watch.stop();
+		const double dPrepared = watch.GetDur();
+
+		const double dNum = double(iRounds * vecAddrs.size());
+		std::cout << "uncached: " << dUncached/dNum*1e9 << " ns, "
+			<< "cached: " << dCached/dNum*1e9 << " ns, "
+			<< "bulk: " << dMany/dNum*1e9 << " ns, "
+			<< "prepared: " << dPrepared/dNum*1e9 << " ns per query"
+			<< " (checksum " << dSum << ")" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * tlibs test file
+ * counter-based random streams
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O3 -march=native -std=c++11 -o rand2 rand2.cpp ../math/rand.cpp ../log/log.cpp -lm -lpthread
+
+#include "../math/rand.h"
+#include "../math/stat.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+using t_real = double;
+
+
+int main()
+{
+	// known answer test from the Random123 distribution (philox4x32_10, ctr=0, key=0)
+	{
+		tl::Philox4x32 eng(0, 0);
+		std::cout << std::hex;
+		for(int i=0; i<4; ++i)
+			std::cout << eng() << " ";
+		std::cout << std::dec << "(expected: 6627e8d5 e169c58d bc57ac4c 9b00dbd8)" << std::endl;
+	}
+
+
+	// jump-ahead and bulk generation
+	{
+		tl::Philox4x32 eng0(1234, 5), eng1(1234, 5);
+		std::vector<std::uint32_t> vec(1001);
+		eng0.discard(3);
+		eng0.fill(vec.data(), vec.size());
+
+		bool bSame = 1;
+		eng1.discard(3);
+		for(std::size_t i=0; i<vec.size(); ++i)
+			if(vec[i] != eng1())
+				bSame = 0;
+		std::cout << "bulk == sequential: " << bSame << std::endl;
+	}
+
+
+	// reproducibility across thread counts
+	{
+		const std::size_t N = 1000003;
+		std::vector<t_real> vec1(N), vec4(N);
+
+		tl::Philox4x32 eng1 = tl::get_rand_stream(7);
+		tl::Philox4x32 eng4 = tl::get_rand_stream(7);
+		tl::rand_norm_n<t_real>(vec1.data(), N, 1., 2., eng1, 1);
+		tl::rand_norm_n<t_real>(vec4.data(), N, 1., 2., eng4, 4);
+
+		std::cout << "1 thread == 4 threads: " << (vec1 == vec4)
+			<< ", mean: " << tl::mean_value(vec1)
+			<< ", std dev: " << tl::std_dev(vec1) << std::endl;
+	}
+
+
+	// consecutive odd-length calls continue the stream behind the dropped spare value
+	{
+		const std::size_t N1 = 4097, N2 = 1001;
+		std::vector<t_real> vec1(N1), vec2(N2), vecAll(N1+1+N2);
+
+		tl::Philox4x32 eng = tl::get_rand_stream(11);
+		tl::Philox4x32 engAll = tl::get_rand_stream(11);
+		tl::rand_norm_n<t_real>(vec1.data(), N1, 0., 1., eng, 4);
+		tl::rand_norm_n<t_real>(vec2.data(), N2, 0., 1., eng, 4);
+		tl::rand_norm_n<t_real>(vecAll.data(), vecAll.size(), 0., 1., engAll, 4);
+
+		const bool bSame = std::equal(vec1.begin(), vec1.end(), vecAll.begin()) &&
+			std::equal(vec2.begin(), vec2.end(), vecAll.begin()+N1+1);
+		std::cout << "consecutive odd calls == one call: " << bSame
+			<< ", engines at same position: " << (eng.GetPos() == engAll.GetPos()) << std::endl;
+	}
+
+
+	// speed compared to mt19937 + std::normal_distribution
+	{
+		const std::size_t N = 10000000;
+		std::vector<t_real> vec(N);
+		tl::Stopwatch<t_real> watch;
+
+		watch.start();
+		for(std::size_t i=0; i<N; ++i)
+			vec[i] = tl::rand_norm<t_real>(0., 1.);
+		watch.stop();
+		std::cout << "rand_norm: " << N/watch.GetDur()*1e-6 << " M/s" << std::endl;
+
+		tl::Philox4x32 eng(1, 0);
+		watch.start();
+		tl::rand_norm_n<t_real>(vec.data(), N, 0., 1., eng);
+		watch.stop();
+		std::cout << "rand_norm_n: " << N/watch.GetDur()*1e-6 << " M/s" << std::endl;
+
+		watch.start();
+		tl::rand01_n<t_real>(vec.data(), N, eng);
+		watch.stop();
+		std::cout << "rand01_n: " << N/watch.GetDur()*1e-6 << " M/s" << std::endl;
+
+		std::vector<int> vecInt(N);
+		tl::rand_int_n<int>(vecInt.data(), N, -3, 3, eng);
+		std::cout << "rand_int_n min/max: " << *std::min_element(vecInt.begin(), vecInt.end())
+			<< " " << *std::max_element(vecInt.begin(), vecInt.end()) << std::endl;
+
+		// ranges beyond 2^32 values
+		std::vector<std::int64_t> vecInt64(N);
+		const std::int64_t iMax64 = std::int64_t(3) << 40;
+		tl::rand_int_n<std::int64_t>(vecInt64.data(), N, -iMax64, iMax64, eng);
+		long double dMean64 = 0;
+		for(std::int64_t i : vecInt64) dMean64 += (long double)i;
+		dMean64 /= (long double)(N);
+		std::cout << "rand_int_n 64 bit min/max: "
+			<< double(*std::min_element(vecInt64.begin(), vecInt64.end())) / double(iMax64) << " "
+			<< double(*std::max_element(vecInt64.begin(), vecInt64.end())) / double(iMax64)
+			<< ", mean/max: " << double(dMean64) / double(iMax64) << " (expected -1 1 0)" << std::endl;
+
+		std::vector<std::uint64_t> vecFull(N);
+		tl::rand_int_n<std::uint64_t>(vecFull.data(), N, 0, std::uint64_t(-1), eng);
+		std::size_t iHigh = 0;
+		for(std::uint64_t i : vecFull) iHigh += (i >> 63);
+		std::cout << "rand_int_n full 64 bit range, fraction with the top bit set: "
+			<< double(iHigh)/double(N) << " (expected 0.5)" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * tlibs test file
+ * array versions of the bose, fermi and DHO functions and S(Q, E) on a grid
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O3 -march=native -std=c++11 -o sqw sqw.cpp -lpthread
+
+#include "../phys/neutrons.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <limits>
+
+using t_real = double;
+
+
+template<class T>
+T max_rel_err(const std::vector<T>& vec, const std::vector<T>& vecRef)
+{
+	T dErr = 0;
+	for(std::size_t i=0; i<vec.size(); ++i)
+	{
+		if(vecRef[i] == T(0) && vec[i] == T(0))
+			continue;
+		dErr = std::max(dErr, std::abs(vec[i] - vecRef[i]) / std::abs(vecRef[i]));
+	}
+	return dErr;
+}
+
+
+int main()
+{
+	// exp_n against std::exp
+	{
+		std::vector<t_real> vecX, vecY, vecRef;
+		for(t_real x=-750.; x<=710.; x+=0.0137)
+			vecX.push_back(x);
+		vecX.push_back(std::numeric_limits<t_real>::infinity());
+		vecX.push_back(-std::numeric_limits<t_real>::infinity());
+		vecX.push_back(std::numeric_limits<t_real>::quiet_NaN());
+
+		vecY.resize(vecX.size());
+		tl::exp_n(vecX.data(), vecY.data(), vecX.size());
+		for(t_real x : vecX) vecRef.push_back(std::exp(x));
+
+		t_real dErr = 0;
+		for(std::size_t i=0; i<vecX.size()-3; ++i)
+		{
+			// only normal numbers
+			if(vecRef[i] < std::numeric_limits<t_real>::min())
+				continue;
+			dErr = std::max(dErr, std::abs(vecY[i] - vecRef[i]) / vecRef[i]);
+		}
+
+		std::vector<float> vecXf, vecYf;
+		for(float x=-87.f; x<=88.f; x+=0.001f)
+			vecXf.push_back(x);
+		vecYf.resize(vecXf.size());
+		tl::exp_n(vecXf.data(), vecYf.data(), vecXf.size());
+		float fErr = 0;
+		for(std::size_t i=0; i<vecXf.size(); ++i)
+			fErr = std::max(fErr, std::abs(vecYf[i] - std::exp(vecXf[i])) / std::exp(vecXf[i]));
+
+		const std::size_t N = vecX.size();
+		std::cout << "exp_n: max. relative error: " << dErr
+			<< " (" << dErr/std::numeric_limits<t_real>::epsilon() << " eps), "
+			<< "float: " << fErr/std::numeric_limits<float>::epsilon() << " eps\n"
+			<< "exp(inf) = " << vecY[N-3] << ", exp(-inf) = " << vecY[N-2]
+			<< ", exp(nan) = " << vecY[N-1] << ", exp(-740) = " << vecY[std::size_t(10./0.0137)]
+			<< " (" << vecRef[std::size_t(10./0.0137)] << ")" << std::endl;
+	}
+
+	// bose, fermi and DHO for an array of energies
+	{
+		const std::size_t N = 1000000;
+		const t_real T = 100.;
+		std::vector<t_real> vecE(N), vecN(N), vecRef(N);
+		for(std::size_t i=0; i<N; ++i)
+			vecE[i] = -20. + 40.*(t_real(i) + 0.5)/t_real(N);
+
+		tl::Stopwatch<t_real> watch;
+
+		watch.start();
+		for(std::size_t i=0; i<N; ++i)
+			vecRef[i] = tl::bose<t_real>(vecE[i], T);
+		watch.stop();
+		const t_real dTimeScalar = watch.GetDur();
+		watch.start();
+		tl::bose_n<t_real>(vecE.data(), vecN.data(), N, T);
+		watch.stop();
+		std::cout << "\nbose: max. relative error: " << max_rel_err(vecN, vecRef)
+			<< ", scalar: " << dTimeScalar/t_real(N)*1e9 << " ns, "
+			<< "array: " << watch.GetDur()/t_real(N)*1e9 << " ns per point" << std::endl;
+
+		for(std::size_t i=0; i<N; ++i)
+			vecRef[i] = tl::bose_cutoff<t_real>(vecE[i], T, 0.5);
+		tl::bose_cutoff_n<t_real>(vecE.data(), vecN.data(), N, T, 0.5);
+		std::cout << "bose_cutoff: max. relative error: " << max_rel_err(vecN, vecRef) << std::endl;
+
+		watch.start();
+		for(std::size_t i=0; i<N; ++i)
+			vecRef[i] = tl::fermi<t_real>(vecE[i], 1., T);
+		watch.stop();
+		const t_real dTimeFermi = watch.GetDur();
+		watch.start();
+		tl::fermi_n<t_real>(vecE.data(), vecN.data(), N, 1., T);
+		watch.stop();
+		std::cout << "fermi: max. relative error: " << max_rel_err(vecN, vecRef)
+			<< ", scalar: " << dTimeFermi/t_real(N)*1e9 << " ns, "
+			<< "array: " << watch.GetDur()/t_real(N)*1e9 << " ns per point" << std::endl;
+
+		watch.start();
+		for(std::size_t i=0; i<N; ++i)
+			vecRef[i] = tl::DHO_model<t_real>(vecE[i], T, 5., 0.3, 10., 0.);
+		watch.stop();
+		const t_real dTimeDHO = watch.GetDur();
+		watch.start();
+		tl::DHO_model_n<t_real>(vecE.data(), vecN.data(), N, T, 5., 0.3, 10., 0.);
+		watch.stop();
+		std::cout << "DHO_model: max. relative error: " << max_rel_err(vecN, vecRef)
+			<< ", scalar: " << dTimeDHO/t_real(N)*1e9 << " ns, "
+			<< "array: " << watch.GetDur()/t_real(N)*1e9 << " ns per point" << std::endl;
+	}
+
+	// S(Q, E) of two branches on a 2000 x 1000 grid
+	{
+		const std::size_t iNumQ = 2000, iNumE = 1000, iBranches = 2;
+		const t_real T = 50., offs = 0.01;
+
+		std::vector<t_real> vecE(iNumE), vecE0(iNumQ*iBranches),
+			vecHWHM(iNumQ*iBranches), vecAmp(iNumQ*iBranches);
+		for(std::size_t iE=0; iE<iNumE; ++iE)
+			vecE[iE] = -15. + 30.*t_real(iE)/t_real(iNumE-1);
+		for(std::size_t iQ=0; iQ<iNumQ; ++iQ)
+		{
+			const t_real q = tl::get_pi<t_real>() * t_real(iQ)/t_real(iNumQ-1);
+
+			// acoustic and optic branch
+			vecE0[iQ*iBranches + 0] = 0.1 + 8.*std::abs(std::sin(0.5*q));
+			vecE0[iQ*iBranches + 1] = 12. - 2.*std::cos(q);
+			vecHWHM[iQ*iBranches + 0] = 0.2;
+			vecHWHM[iQ*iBranches + 1] = 0.5;
+			vecAmp[iQ*iBranches + 0] = 1.;
+			vecAmp[iQ*iBranches + 1] = 0.5;
+		}
+
+		std::vector<t_real> vecSRef(iNumQ*iNumE), vecS1(iNumQ*iNumE), vecS(iNumQ*iNumE);
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+		for(std::size_t iQ=0; iQ<iNumQ; ++iQ)
+		{
+			for(std::size_t iE=0; iE<iNumE; ++iE)
+			{
+				t_real dS = offs;
+				for(std::size_t iBranch=0; iBranch<iBranches; ++iBranch)
+				{
+					const std::size_t iIdx = iQ*iBranches + iBranch;
+					dS += tl::DHO_model<t_real>(vecE[iE], T, vecE0[iIdx],
+						vecHWHM[iIdx], vecAmp[iIdx], 0.);
+				}
+				vecSRef[iQ*iNumE + iE] = dS;
+			}
+		}
+		watch.stop();
+		const t_real dTimeScalar = watch.GetDur();
+
+		watch.start();
+		tl::DHO_model_grid<t_real>(vecE.data(), iNumE, T, vecE0.data(), vecHWHM.data(),
+			vecAmp.data(), iNumQ, iBranches, offs, vecS1.data(), 1);
+		watch.stop();
+		const t_real dTime1 = watch.GetDur();
+
+		watch.start();
+		tl::DHO_model_grid<t_real>(vecE.data(), iNumE, T, vecE0.data(), vecHWHM.data(),
+			vecAmp.data(), iNumQ, iBranches, offs, vecS.data(), 0);
+		watch.stop();
+
+		const t_real dPts = t_real(iNumQ*iNumE);
+		std::cout << "\nS(Q, E) grid: max. relative error: " << max_rel_err(vecS, vecSRef)
+			<< ", threads give same result: " << (vecS == vecS1) << "\n"
+			<< "scalar loop: " << dTimeScalar*1e3 << " ms (" << dTimeScalar/dPts*1e9 << " ns per point), "
+			<< "1 thread: " << dTime1*1e3 << " ms, "
+			<< "all threads: " << watch.GetDur()*1e3 << " ms" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * tlibs test file
+ * binary message framing over a loopback connection
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o tcp_bin tcp_bin.cpp ../net/tcp.cpp ../log/log.cpp -lboost_system -lpthread
+
+#include "../net/tcp.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+
+/**
+ * sends iNum messages of iLen bytes from a client to a server
+ * and returns the throughput in MiB/s
+ */
+double run(tl::TcpFraming framing, std::size_t iNum, std::size_t iLen, bool bShared,
+	unsigned short iPort, bool& bOk)
+{
+	tl::TcpTxtServer<> server;
+	tl::TcpTxtClient<> client;
+	server.set_framing(framing);
+	client.set_framing(framing);
+
+	std::atomic<std::size_t> iRecvBytes(0), iRecvMsgs(0), iBatches(0);
+	std::atomic<bool> bServerDisconn(0), bCorrect(1);
+
+	server.add_bin_receiver([&](const std::vector<tl::TcpBinMsg>& vecMsgs)
+	{
+		++iBatches;
+		for(const tl::TcpBinMsg& msg : vecMsgs)
+		{
+			if(msg.iLen != iLen || msg.iType != 7 || (iLen && msg.pcData[iLen-1] != 'y'))
+				bCorrect = 0;
+			iRecvBytes += msg.iLen;
+			++iRecvMsgs;
+		}
+	});
+	server.add_receiver([&](const std::string& str)
+	{
+		if(str.length() != iLen || (iLen && str[iLen-1] != 'y'))
+			bCorrect = 0;
+		iRecvBytes += str.length();
+		++iRecvMsgs;
+	});
+	server.add_disconnect([&](const std::string&, const std::string&)
+	{
+		bServerDisconn = 1;
+	});
+
+	server.start_server(iPort);
+	client.connect("127.0.0.1", std::to_string(iPort));
+	while(!client.is_connected())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	std::vector<char> vecData(iLen, 'x');
+	if(iLen)
+		vecData[iLen-1] = 'y';
+	std::shared_ptr<const std::vector<char>> pShared = std::make_shared<std::vector<char>>(vecData);
+	const std::string strData(vecData.begin(), vecData.end());
+
+	tl::Stopwatch<double> watch;
+	watch.start();
+	for(std::size_t i=0; i<iNum; ++i)
+	{
+		if(framing == tl::TcpFraming::TEXT)
+			client.write(strData + "\n");
+		else if(bShared)
+			client.write_bin(pShared, 7);
+		else
+			client.write_bin(vecData.data(), iLen, 7);
+	}
+
+	while(iRecvMsgs < iNum)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	watch.stop();
+
+	client.disconnect();
+	while(!bServerDisconn)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	server.disconnect();
+
+	bOk = bCorrect && iRecvBytes == iNum*iLen;
+	if(framing == tl::TcpFraming::BINARY)
+		std::cout << "\t" << iBatches << " receive callbacks for " << iNum << " messages" << std::endl;
+	return double(iNum*iLen) / 1024. / 1024. / watch.GetDur();
+}
+
+
+int main()
+{
+	unsigned short iPort = 32145;
+
+	for(std::size_t iLen : { 16, 1024, 65536 })
+	{
+		const std::size_t iNum = std::size_t(64) * 1024 * 1024 / iLen / (iLen < 1024 ? 16 : 1);
+		bool bOkTxt = 0, bOkBin = 0, bOkShared = 0;
+
+		// the delimiter search makes the text protocol too slow for large messages
+		const double dTxt = iLen <= 1024 ? run(tl::TcpFraming::TEXT, iNum, iLen, 0, iPort++, bOkTxt) : 0.;
+		const double dBin = run(tl::TcpFraming::BINARY, iNum, iLen, 0, iPort++, bOkBin);
+		const double dShared = run(tl::TcpFraming::BINARY, iNum, iLen, 1, iPort++, bOkShared);
+
+		std::cout << iNum << " messages of " << iLen << " bytes: "
+			<< "text " << dTxt << " MiB/s (ok: " << bOkTxt << "), "
+			<< "binary " << dBin << " MiB/s (ok: " << bOkBin << "), "
+			<< "binary, shared " << dShared << " MiB/s (ok: " << bOkShared << ")"
+			<< std::endl;
+	}
+
+	// message exceeding the limit closes the connection
+	{
+		tl::TcpTxtServer<> server;
+		tl::TcpTxtClient<> client;
+		server.set_framing(tl::TcpFraming::BINARY);
+		client.set_framing(tl::TcpFraming::BINARY);
+		server.set_max_msg_len(1024);
+
+		std::atomic<bool> bServerDisconn(0);
+		server.add_disconnect([&](const std::string&, const std::string&) { bServerDisconn = 1; });
+
+		server.start_server(iPort);
+		client.connect("127.0.0.1", std::to_string(iPort));
+		while(!client.is_connected())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		std::vector<char> vecData(4096);
+		client.write_bin(vecData.data(), vecData.size());
+		for(int i=0; i<1000 && !bServerDisconn; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::cout << "oversized message disconnects: " << bServerDisconn << std::endl;
+
+		client.disconnect();
+		server.disconnect();
+	}
+
+	return 0;
+}
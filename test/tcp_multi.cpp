@@ -0,0 +1,140 @@
+/**
+ * tlibs test file
+ * multi-client tcp server with broadcasts and backpressure
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o tcp_multi tcp_multi.cpp ../net/tcp.cpp ../log/log.cpp -lboost_system -lpthread
+
+#include "../net/tcp.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+
+int main()
+{
+	const unsigned short iPort = 32245;
+	const std::size_t iClients = 32, iMsgs = 2000, iMsgLen = 16384;
+
+	tl::TcpMultiServer<> server;
+	server.set_framing(tl::TcpFraming::BINARY);
+	server.set_max_queued(1 << 22);
+
+	std::atomic<std::size_t> iConns(0), iDisconns(0), iRequests(0);
+	server.add_connect([&](std::size_t, const std::string&) { ++iConns; });
+	server.add_disconnect([&](std::size_t, const std::string&) { ++iDisconns; });
+
+	// answer each request on the session it came from
+	server.add_bin_receiver([&](std::size_t iSession, const std::vector<tl::TcpBinMsg>& vecMsgs)
+	{
+		for(const tl::TcpBinMsg& msg : vecMsgs)
+		{
+			++iRequests;
+			server.write_bin(iSession, msg.pcData, msg.iLen, msg.iType + 1);
+		}
+	});
+
+	if(!server.start_server(iPort, 4))
+		return -1;
+
+	// clients, the last one being slow
+	std::vector<std::unique_ptr<tl::TcpTxtClient<>>> vecClients;
+	std::vector<std::unique_ptr<std::atomic<std::size_t>>> vecRecv, vecReplies;
+	for(std::size_t iClient=0; iClient<iClients; ++iClient)
+	{
+		vecClients.emplace_back(new tl::TcpTxtClient<>());
+		vecRecv.emplace_back(new std::atomic<std::size_t>(0));
+		vecReplies.emplace_back(new std::atomic<std::size_t>(0));
+
+		std::atomic<std::size_t> *piRecv = vecRecv.back().get(), *piReplies = vecReplies.back().get();
+		const bool bSlow = (iClient == iClients-1);
+
+		tl::TcpTxtClient<>& client = *vecClients.back();
+		client.set_framing(tl::TcpFraming::BINARY);
+		client.add_bin_receiver([piRecv, piReplies, bSlow](const std::vector<tl::TcpBinMsg>& vecMsgs)
+		{
+			for(const tl::TcpBinMsg& msg : vecMsgs)
+			{
+				if(msg.iType == 2)
+					++*piReplies;
+				else
+					++*piRecv;
+			}
+
+			if(bSlow)
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		});
+		client.connect("127.0.0.1", std::to_string(iPort));
+	}
+
+	while(iConns < iClients)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::cout << "sessions: " << server.get_num_sessions() << std::endl;
+
+	// requests and replies
+	for(auto& pClient : vecClients)
+		pClient->write_bin("request", 7, 1);
+	while(iRequests < iClients)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	// status broadcasts, the payload is shared by all sessions
+	std::shared_ptr<std::vector<char>> pStatus = std::make_shared<std::vector<char>>(iMsgLen, 's');
+
+	tl::Stopwatch<double> watch;
+	watch.start();
+	std::size_t iQueued = 0;
+	for(std::size_t iMsg=0; iMsg<iMsgs; ++iMsg)
+	{
+		iQueued += server.broadcast_bin(pStatus, 0);
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+
+	// wait for the fast clients
+	for(int i=0; i<10000; ++i)
+	{
+		bool bAllReceived = 1;
+		for(std::size_t iClient=0; iClient<iClients-1; ++iClient)
+			bAllReceived = bAllReceived && (*vecRecv[iClient] == iMsgs);
+		if(bAllReceived)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	watch.stop();
+
+	std::size_t iFastRecv = 0, iReplies = 0;
+	for(std::size_t iClient=0; iClient<iClients; ++iClient)
+	{
+		if(iClient < iClients-1)
+			iFastRecv += *vecRecv[iClient];
+		iReplies += *vecReplies[iClient];
+	}
+
+	std::cout << "replies: " << iReplies << " of " << iClients << std::endl;
+	std::cout << "fast clients received " << iFastRecv << " of " << (iClients-1)*iMsgs << " messages, "
+		<< double(iFastRecv*iMsgLen)/1024./1024./watch.GetDur() << " MiB/s in total" << std::endl;
+	std::cout << "slow client received " << *vecRecv.back() << " messages, "
+		<< (iClients*iMsgs - iQueued) << " were dropped" << std::endl;
+
+	// disconnect some of the clients
+	for(std::size_t iClient=0; iClient<iClients/2; ++iClient)
+		vecClients[iClient]->disconnect();
+	while(iDisconns < iClients/2)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::cout << "sessions after disconnects: " << server.get_num_sessions() << std::endl;
+
+	server.stop_server();
+	std::cout << "sessions after stop: " << server.get_num_sessions()
+		<< ", disconnect signals: " << iDisconns << std::endl;
+
+	for(auto& pClient : vecClients)
+		pClient->disconnect();
+	return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * tlibs test file
+ * streaming x3d and off output
+ * @author Tobias Weber <tobias.weber@tum.de>
+ * @license GPLv2 or GPLv3
+ */
+
+// g++ -O2 -std=c++11 -o x3d_stream x3d_stream.cpp ../file/x3d.cpp ../log/log.cpp -lboost_iostreams -lpthread
+
+#include "../file/x3d.h"
+#include "../file/off.h"
+#include "../time/stopwatch.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+using t_real = double;
+using t_vec = tl::ublas::vector<t_real>;
+
+
+std::size_t file_size(const char* pcFile)
+{
+	std::ifstream ifstr(pcFile, std::ios_base::binary | std::ios_base::ate);
+	return ifstr ? std::size_t(ifstr.tellg()) : 0;
+}
+
+
+int main()
+{
+	// supercell with two kinds of atoms
+	const int N = 40;
+	const t_vec vecCol1 = tl::make_vec({1., 0., 0.}), vecCol2 = tl::make_vec({0., 0., 1.});
+
+	// element tree
+	{
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+
+		tl::X3d<t_real> x3d;
+		for(int iX=0; iX<N; ++iX)
+		for(int iY=0; iY<N; ++iY)
+		for(int iZ=0; iZ<N; ++iZ)
+		{
+			tl::X3dTrafo<t_real> *pTrafo = new tl::X3dTrafo<t_real>();
+			pTrafo->SetTrans(tl::make_vec({t_real(iX), t_real(iY), t_real(iZ)}));
+
+			tl::X3dSphere<t_real> *pSphere = new tl::X3dSphere<t_real>((iX+iY+iZ) % 2 ? 0.2 : 0.3);
+			pSphere->SetColor((iX+iY+iZ) % 2 ? vecCol1 : vecCol2);
+			pTrafo->AddChild(pSphere);
+			x3d.GetScene().AddChild(pTrafo);
+		}
+		x3d.Save("x3d_tree_tst.x3d");
+
+		watch.stop();
+		std::cout << "element tree: " << N*N*N << " atoms, " << watch.GetDur() << " s, "
+			<< file_size("x3d_tree_tst.x3d") << " bytes" << std::endl;
+		std::remove("x3d_tree_tst.x3d");
+	}
+
+	// streaming, plain and compressed
+	for(tl::Compressor comp : { tl::Compressor::INVALID, tl::Compressor::GZ })
+	{
+		const char* pcFile = comp == tl::Compressor::GZ ? "x3d_stream_tst.x3dz" : "x3d_stream_tst.x3d";
+
+		tl::Stopwatch<t_real> watch;
+		watch.start();
+
+		tl::X3dStreamWriter<t_real> x3d;
+		x3d.Open(pcFile, comp, "supercell");
+		for(int iX=0; iX<N; ++iX)
+		for(int iY=0; iY<N; ++iY)
+		for(int iZ=0; iZ<N; ++iZ)
+		{
+			x3d.AddSphere(tl::make_vec({t_real(iX), t_real(iY), t_real(iZ)}),
+				(iX+iY+iZ) % 2 ? 0.2 : 0.3, (iX+iY+iZ) % 2 ? vecCol1 : vecCol2);
+		}
+
+		// unit cell faces sharing their vertices
+		x3d.BeginFaceSet(tl::make_vec({0.5, 0.5, 0.5, 0.8}));
+		for(int iAxis=0; iAxis<3; ++iAxis)
+		{
+			for(t_real dSide : { 0., t_real(N) })
+			{
+				std::vector<t_vec> vecPoly;
+				for(int iCorner=0; iCorner<4; ++iCorner)
+				{
+					t_vec vec(3);
+					vec[iAxis] = dSide;
+					vec[(iAxis+1)%3] = (iCorner==1 || iCorner==2) ? t_real(N) : 0.;
+					vec[(iAxis+2)%3] = (iCorner>=2) ? t_real(N) : 0.;
+					vecPoly.push_back(vec);
+				}
+				x3d.AddPolygon(vecPoly);
+			}
+		}
+		x3d.EndFaceSet();
+		bool bOk = x3d.Close();
+
+		watch.stop();
+		std::cout << "streaming" << (comp == tl::Compressor::GZ ? ", gzip" : "") << ": "
+			<< watch.GetDur() << " s, " << file_size(pcFile) << " bytes, ok: " << bOk << std::endl;
+
+		if(comp == tl::Compressor::INVALID)
+		{
+			std::ifstream ifstr(pcFile);
+			std::string strLine;
+			for(int i=0; i<14 && std::getline(ifstr, strLine); ++i)
+				std::cout << "\t" << strLine << std::endl;
+		}
+		std::remove(pcFile);
+	}
+
+	// off mesh of a grid, text and binary
+	{
+		const std::size_t M = 200;
+		for(bool bBinary : { 0, 1 })
+		{
+			const char* pcFile = bBinary ? "off_stream_tst_bin.off" : "off_stream_tst.off";
+
+			tl::Off3dStreamWriter<t_real> off;
+			off.Open(pcFile, M*M, (M-1)*(M-1), bBinary, tl::Compressor::INVALID, "grid");
+			for(std::size_t iX=0; iX<M; ++iX)
+				for(std::size_t iY=0; iY<M; ++iY)
+					off.AddVertex(t_real(iX), t_real(iY), std::sin(t_real(iX+iY)*0.1));
+			for(std::size_t iX=0; iX+1<M; ++iX)
+				for(std::size_t iY=0; iY+1<M; ++iY)
+					off.AddPoly({ iX*M+iY, (iX+1)*M+iY, (iX+1)*M+iY+1, iX*M+iY+1 });
+			bool bOk = off.Close();
+
+			std::cout << "off" << (bBinary ? " binary" : "") << ": " << file_size(pcFile)
+				<< " bytes, ok: " << bOk;
+			if(!bBinary)
+			{
+				tl::Off3d<t_real> offRead;
+				std::cout << ", read back: " << offRead.Load(pcFile);
+			}
+			std::cout << std::endl;
+			std::remove(pcFile);
+		}
+
+		// wrong number of elements
+		tl::Off3dStreamWriter<t_real> off;
+		std::ostringstream ostr;
+		off.Open(ostr, 3, 1);
+		off.AddVertex(0., 0., 0.);
+		std::cout << "incomplete off: " << off.Close() << std::endl;
+	}
+
+	return 0;
+}
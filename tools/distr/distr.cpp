@@ -218,11 +218,8 @@ void DistrDlg::Calc()
 			m_vecX = tl::linspace<t_real>(dMinX, dMaxX, NUM_PTS);
 			m_vecPDF.resize(m_vecX.size());
 			m_vecCDF.resize(m_vecX.size());
-			for(std::size_t iX=0; iX<m_vecX.size(); ++iX)
-			{
-				m_vecPDF[iX] = m_pDistr->pdf(m_vecX[iX]);
-				m_vecCDF[iX] = m_pDistr->cdf(m_vecX[iX]);
-			}
+			m_pDistr->pdf_n(m_vecX.data(), m_vecPDF.data(), m_vecX.size());
+			m_pDistr->cdf_n(m_vecX.data(), m_vecCDF.data(), m_vecX.size());
 		}
 
 		m_pCurvePDF->setRawSamples(m_vecX.data(), m_vecPDF.data(), m_vecX.size());
@@ -4,11 +4,12 @@
  * @date 8-oct-16
  * @license GPLv2 or GPLv3
  */
-// gcc -march=native -O3 -std=c++11 -DNO_JPEG -DNO_TIFF -o metrop metrop.cpp ../../log/log.cpp ../../math/rand.cpp -lstdc++ -lm -lpng
+// gcc -march=native -O3 -std=c++11 -DNO_JPEG -DNO_TIFF -o metrop metrop.cpp ../../log/log.cpp ../../math/rand.cpp -lstdc++ -lm -lpng -lpthread
 
-#include "../../math/mag.h"
+#include "../../phys/mag.h"
+#include "../../phys/metrop.h"
 #include "../../math/rand.h"
-#include "../../math/units.h"
+#include "../../phys/units.h"
 #include "../../gfx/gil.h"
 #include "../../helper/array.h"
 #include <iostream>
@@ -28,21 +29,25 @@ int main()
 	t_real J = 1.;		// meV
 	t_real T = 25.;		// K
 
-	std::size_t iIter = 1e7;
+	std::size_t iSweeps = 1000;
 
 	std::cout << "Width: "; std::cin >> iW;
 	std::cout << "Height: "; std::cin >> iH;
-	std::cout << "Iterations: "; std::cin >> iIter;
+	std::cout << "Sweeps: "; std::cin >> iSweeps;
 	std::cout << "J (meV): "; std::cin >> J;
 	std::cout << "T (K): "; std::cin >> T;
 
 	boost::multi_array<bool, 2> arr
 		= tl::rand_array<bool, 2, boost::array, boost::multi_array>({iW, iH});
 
-	t_real Etot = 0.;
+	tl::MetropIsing<t_real, 2> ising({std::size_t(iW), std::size_t(iH)}, J, false, tl::get_rand_seed());
+	ising.SetTemperature(T, k);
+	ising.FromArray(arr);
+
 	tl::log_info("Running Metropolis algo...");
-	tl::metrop<t_real, 2>({iW,iH}, iIter, J, k, T, arr, &Etot);
-	tl::log_info("Finished Metropolis algo. E/N = ", Etot, " meV.");
+	ising.Sweep(iSweeps);
+	ising.ToArray(arr);
+	tl::log_info("Finished Metropolis algo. E/N = ", ising.GetObservables().dE, " meV.");
 
 
 	tl::log_info("Writing image.");
@@ -4,11 +4,12 @@
  * @date 8-oct-16
  * @license GPLv2 or GPLv3
  */
-// gcc -march=native -O3 -std=c++11 -DNO_JPEG -DNO_TIFF -o metrop_series metrop_series.cpp ../../log/log.cpp ../../math/rand.cpp -lstdc++ -lm -lpng
+// gcc -march=native -O3 -std=c++11 -DNO_JPEG -DNO_TIFF -o metrop_series metrop_series.cpp ../../log/log.cpp ../../math/rand.cpp -lstdc++ -lm -lpng -lpthread
 
-#include "../../math/mag.h"
+#include "../../phys/mag.h"
+#include "../../phys/metrop.h"
 #include "../../math/rand.h"
-#include "../../math/units.h"
+#include "../../phys/units.h"
 #include "../../gfx/gil.h"
 #include "../../helper/array.h"
 #include <iostream>
@@ -23,23 +24,58 @@ int main()
 {
 	tl::init_rand();
 
-	std::size_t iIter = 1e7;
+	std::size_t iRounds = 2000;			// rounds of sweeps and replica exchanges
+	std::size_t iRoundsTherm = 500;		// rounds without measurement
+	std::size_t iRoundsCheckpoint = 100;
+	const std::string strCheckpoint = "metrop_series.chk";
 
 	long iW = 256;
 	long iH = 256;
 
 	t_real J = 2.5;		// meV
 
-	boost::multi_array<bool, 2> arr
-		= tl::rand_array<bool, 2, boost::array, boost::multi_array>({iW, iH});
+	std::vector<t_real> vecT;
+	for(t_real T=10.; T<=200.; T+=10.)
+		vecT.push_back(T);
+
+	using t_pt = tl::MetropTempering<t_real, 2>;
+	t_pt pt({std::size_t(iW), std::size_t(iH)}, J, vecT, k, false, tl::get_rand_seed());
+
+	if(std::ifstream(strCheckpoint) && pt.LoadCheckpoint(strCheckpoint))
+	{
+		tl::log_info("Resuming from round ", pt.GetNumRounds(), ".");
+	}
+	else
+	{
+		boost::multi_array<bool, 2> arr
+			= tl::rand_array<bool, 2, boost::array, boost::multi_array>({iW, iH});
+		for(std::size_t iT=0; iT<vecT.size(); ++iT)
+			pt.GetReplica(iT).FromArray(arr);
+	}
+
+	while(pt.GetNumRounds() < iRounds)
+	{
+		const bool bMeasure = (pt.GetNumRounds() >= iRoundsTherm);
+		const std::size_t iNext = std::min(iRounds, (pt.GetNumRounds()/iRoundsCheckpoint + 1) * iRoundsCheckpoint);
+
+		pt.Run(iNext - pt.GetNumRounds(), 1, bMeasure);
+		pt.SaveCheckpoint(strCheckpoint);
+		tl::log_info("Round ", pt.GetNumRounds(), " of ", iRounds, ".");
+	}
+
+
 	std::ofstream ofstrE("E.dat");
+	ofstrE << "# T (K)\tE (meV)\tC (meV/K)\t|M|\tchi (1/meV)\tswap rate\n";
+	for(const t_pt::Results& res : pt.GetResults())
+	{
+		ofstrE << res.dT << "\t" << res.dE << "\t" << res.dC << "\t"
+			<< res.dM << "\t" << res.dChi << "\t" << res.dSwapRate << std::endl;
+	}
 
-	for(t_real T=200.; T>=0.; T-=10.)
+	for(std::size_t iT=0; iT<vecT.size(); ++iT)
 	{
-		t_real Etot = 0., S = 0.;
-		tl::log_info("T = ", T, " K");
-		tl::metrop<t_real, 2>({iW,iH}, iIter, J, k, T, arr, &Etot, &S);
-		ofstrE << T << "\t" << Etot <<  "\t" << S << std::endl;
+		boost::multi_array<bool, 2> arr(boost::extents[iW][iH]);
+		pt.GetReplica(iT).ToArray(arr);
 
 		using t_view = tl::gil::gray8_view_t;
 		using t_pix = typename t_view::value_type;
@@ -52,7 +88,7 @@ int main()
 				*(view.row_begin(i)+j) = arr[i][j]*255;
 
 		std::ostringstream ostrImg;
-		ostrImg << "T" << T << ".png";
+		ostrImg << "T" << vecT[iT] << ".png";
 		tl::save_view(ostrImg.str().c_str(), &view);
 	}
 